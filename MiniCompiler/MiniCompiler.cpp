@@ -1,136 +1,44 @@
 // Copyright 2026 Chen Jisen. All rights reserved.
 // MiniCompiler.cpp: 定义应用程序的入口点。
 
-#include "lexer.h"
-#include "parser.h"
+#include "driver.h"
+#include "instrument.h"
+#include "server.h"
 
 #include <exception>
 #include <filesystem>
-#include <format>
-#include <fstream>
 #include <iostream>
-#include <print>
-#include <stdexcept>
 #include <string>
+#include <vector>
 
-namespace {
+// Counts heap allocations for --time-report.
+MINI_COMPILER_ALLOCATION_HOOKS()
 
-using std::format;
-using std::string;
-
-string read_file(std::filesystem::path const& path) {
-    // 1. 打开流（使用 binary 模式可以避免在 Windows
-    // 上因换行符转换导致的偏移错误）
-    std::ifstream file(path, std::ios::in | std::ios::binary);
-    if (!file) {
-        return "";
-    }
-
-    // 2. 直接读取字节流
-    auto size = std::filesystem::file_size(path);
-    string content(size, '\0');
-    file.read(content.data(), static_cast<std::streamsize>(size));
-    return content;
-}
-
-} // namespace
-
-int main() {
+// Usage: see usage_text in driver.h and server_usage_text in server.h.
+// Without inputs the built-in sample program is compiled.
+int main(int argc, char* argv[]) {
     using namespace mini_compiler;
-    string const source = R"(
-    let x: int = { let a: int = 2; let b: int = 3; a * b };  // x = 6
-    let y: int = 1 + 2 * 3 - 4 / 2;
-
-    fn foo(a: int, b: float) -> bool {
-        let s: string = "hi\n";
-        x = { return 5; 6 };
-        print(s);
-        return !(a!=0) && (x > 5);
-    }
-    fn calc(a: int, b: int, c: int) -> int {
-        -c + a * b + 10
-    }
-
-    let count: int = 0;
-    fn increment(amount: int) -> int {
-        count = count + amount;
-        return count;  // simplified
-    }
-
-    fn test() {
-        let a: int = -5;
-        let b: int = - -10;
-        let flag: bool = !true;
-        let x: int = 1 + 2 * 3;
-        x = x + 1;
-        print(x);
-        return;
-    }
-	fn test2() {
-		let c: char = 'a';
-		let nl: char = '\n';
-		let i: int = 0;
-		while i < 10 {
-			if i == 5 {
-				break;
-			}
-			i = i + 1;
-			continue;
-		}
-		let last: int = { i };
-	}
-
-    fn main() {
-        foo(2 - 3, 3.14 * 2);
-        x = add(x, 20, 10);
-        print("x: ", x);
-        let result: int = increment(5);
-        print("Result: ", result);
-        test();
-        test2();
-        let x1: int = if a > b { 5 } else { 10 };
-        while i < 10 { i = i + 1; }
-        print("Done");
-    }
-    )";
+    using std::string;
 
     try {
         auto const out_dir = std::filesystem::path(PROJECT_ROOT) / "out";
-        std::filesystem::create_directories(out_dir);
-        std::ofstream out_lex_file(
-            out_dir / "lex.txt", std::ios::out | std::ios::binary);
-        if (!out_lex_file) {
-            throw std::runtime_error("Failed to open output lex file");
+        std::vector<string> args(argv + 1, argv + argc);
+        if (!args.empty() && args.front() == "serve") {
+            args.erase(args.begin());
+            return run_server(args, out_dir);
         }
-
-        Lexer lexer(source);
-        auto tokens = lexer.tokenize();
-        for (auto const& token : tokens) {
-            string token_str(to_string(token.kind));
-            if (!token.lexeme.empty()) {
-                token_str = format("{:>10}    ({})", token.lexeme, token_str);
-            }
-            std::println(
-                out_lex_file,
-                "{:>2}:{:>2}    {}",
-                token.pos.lineno,
-                token.pos.colno,
-                token_str);
+        if (!args.empty() && args.front() == "run") {
+            args.erase(args.begin());
+            return run_program(args, std::cin, std::cout, std::cerr);
         }
-        Parser parser(tokens);
-        Program const prog = parser.parse();
-        std::cout << "Parsed OK. Statements=" << prog.statements.size() << "\n";
-
-        std::ofstream out_parser_file(
-            out_dir / "parser.txt", std::ios::out | std::ios::binary);
-        if (!out_parser_file) {
-            throw std::runtime_error("Failed to open output file");
+        if (!args.empty() && args.front() == "client") {
+            args.erase(args.begin());
+            return run_client(args, std::cin, std::cout, std::cerr);
         }
-        parser_debug_print(prog, out_parser_file);
+        DriverOptions const options = parse_command_line(args, out_dir);
+        return run_driver(options, std::cout, std::cerr);
     } catch (std::exception const& e) {
         std::cerr << "Error: " << e.what() << "\n";
         return 1;
     }
-
-    return 0;
 }
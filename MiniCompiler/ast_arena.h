@@ -0,0 +1,63 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// ast_arena.h
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace mini_compiler {
+
+// Bump allocator for AST nodes. Nodes are carved out of large chunks and are
+// never destroyed one by one: everything a node owns (child vectors) is
+// allocated from the same arena through AstVector, so releasing the chunks
+// frees the whole tree at once. Types created here must therefore not own
+// memory from anywhere else.
+class AstArena {
+  public:
+    AstArena() = default;
+
+    AstArena(AstArena const&) = delete;
+    AstArena& operator=(AstArena const&) = delete;
+
+    template <typename T, typename... Args> T* create(Args&&... args) {
+        void* const p = memory.allocate(sizeof(T), alignof(T));
+        ++created;
+        return ::new (p) T(std::forward<Args>(args)...);
+    }
+
+    // Nodes created here and in adopted arenas.
+    size_t node_count() const {
+        size_t count = created;
+        for (auto const& other : adopted) {
+            count += other->node_count();
+        }
+        return count;
+    }
+
+    std::pmr::memory_resource* resource() { return &memory; }
+
+    // Keeps `other` (and every node in it) alive as long as this arena, for
+    // trees stitched together from separately parsed pieces.
+    void adopt(std::unique_ptr<AstArena> other) {
+        adopted.push_back(std::move(other));
+    }
+
+  private:
+    // Small, so that per-item arenas (parallel and incremental parsing) stay
+    // cheap; chunk sizes grow geometrically for large programs.
+    static constexpr size_t initial_chunk = size_t{4} << 10;
+
+    std::pmr::monotonic_buffer_resource memory{initial_chunk};
+    std::vector<std::unique_ptr<AstArena>> adopted;
+    size_t created = 0;
+};
+
+// Vector whose storage lives in an AstArena.
+template <typename T> using AstVector = std::pmr::vector<T>;
+
+} // namespace mini_compiler
@@ -0,0 +1,637 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// ast_file.h
+
+#pragma once
+
+#include "flat_ast.h"
+#include "hash.h"
+#include "lexer.h"
+#include "parser.h"
+#include "source_file.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::optional;
+using std::runtime_error;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Binary AST files (.ast)
+// ==========================================
+//
+// A FlatAst written out as-is: a fixed header followed by the node, extra,
+// string, offset and character arrays, each 16-byte aligned. Loading maps
+// the file and points a FlatAstView at the arrays; there are no pointers to
+// fix up. materialize() turns (part of) a view back into a Program when a
+// pointer tree is needed.
+//
+// Version 1 layout (native byte order; the header records which):
+//   AstFileHeader (96 bytes)
+//   FlatNode[node_count]      kind, tag (operator TokenKind, BuiltInType or
+//                             type code), children / string ids
+//   uint32_t[extra_count]     child lists
+//   StrRef[string_count]      deduplicated string table
+//   uint32_t[offset_count]    source offset per node (0 or node_count)
+//   char[chars_size]          string table bytes
+
+struct AstFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t byte_order;   // byte_order_mark as written by the producer
+    uint64_t source_hash;  // XXH64 of the source text
+    uint32_t root_list;
+    uint32_t node_count;
+    uint32_t extra_count;
+    uint32_t string_count;
+    uint32_t offset_count;
+    uint32_t reserved;
+    uint64_t chars_size;
+    uint64_t nodes_at; // section file offsets
+    uint64_t extra_at;
+    uint64_t strings_at;
+    uint64_t offsets_at;
+    uint64_t chars_at;
+};
+
+static_assert(sizeof(AstFileHeader) == 96);
+
+inline constexpr std::array<char, 8> ast_file_magic = {
+    'M', 'C', 'A', 'S', 'T', '\r', '\n', '\x1a'};
+inline constexpr uint32_t ast_file_version = 2;
+inline constexpr uint32_t byte_order_mark = 0x01020304;
+
+namespace detail {
+
+inline constexpr uint64_t ast_section_align = 16;
+
+inline uint64_t align_section(uint64_t at) {
+    return (at + ast_section_align - 1) & ~(ast_section_align - 1);
+}
+
+} // namespace detail
+
+// Writes `ast` in the .ast format.
+inline void write_ast_file(
+    FlatAstView ast, uint64_t source_hash, std::ostream& out) {
+    AstFileHeader header{};
+    header.magic = ast_file_magic;
+    header.version = ast_file_version;
+    header.byte_order = byte_order_mark;
+    header.source_hash = source_hash;
+    header.root_list = ast.root_list_index();
+    header.node_count = static_cast<uint32_t>(ast.nodes().size());
+    header.extra_count = static_cast<uint32_t>(ast.extra().size());
+    header.string_count = static_cast<uint32_t>(ast.strings().size());
+    header.offset_count = static_cast<uint32_t>(ast.offsets().size());
+    header.chars_size = ast.string_chars().size();
+
+    struct Section {
+        void const* data;
+        uint64_t bytes;
+    };
+    std::array const sections{
+        Section{ast.nodes().data(), ast.nodes().size_bytes()},
+        Section{ast.extra().data(), ast.extra().size_bytes()},
+        Section{ast.strings().data(), ast.strings().size_bytes()},
+        Section{ast.offsets().data(), ast.offsets().size_bytes()},
+        Section{ast.string_chars().data(), ast.string_chars().size()}};
+    std::array<uint64_t*, 5> const offsets{
+        &header.nodes_at,
+        &header.extra_at,
+        &header.strings_at,
+        &header.offsets_at,
+        &header.chars_at};
+    uint64_t at = sizeof(AstFileHeader);
+    for (size_t i = 0; i < sections.size(); ++i) {
+        at = detail::align_section(at);
+        *offsets[i] = at;
+        at += sections[i].bytes;
+    }
+
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    uint64_t written = sizeof(AstFileHeader);
+    std::array<char, detail::ast_section_align> const padding{};
+    for (size_t i = 0; i < sections.size(); ++i) {
+        out.write(
+            padding.data(),
+            static_cast<std::streamsize>(*offsets[i] - written));
+        out.write(
+            static_cast<char const*>(sections[i].data),
+            static_cast<std::streamsize>(sections[i].bytes));
+        written = *offsets[i] + sections[i].bytes;
+    }
+}
+
+inline void save_ast_file(
+    FlatAstView ast, uint64_t source_hash, std::filesystem::path const& path) {
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    if (!out) {
+        throw runtime_error("Failed to open output file " + path.string());
+    }
+    write_ast_file(ast, source_hash, out);
+    if (!out) {
+        throw runtime_error("Failed to write " + path.string());
+    }
+}
+
+// ==========================================
+// Verification
+// ==========================================
+
+namespace detail {
+
+inline bool is_statement_kind(FlatKind kind) {
+    return kind == FlatKind::ExprStmt || kind == FlatKind::VarDecl ||
+           kind == FlatKind::FunctionDecl;
+}
+
+// Checks everything materialize() and the printers rely on, so a corrupt
+// or hostile file is rejected instead of read out of bounds: indices are in
+// range, children precede their parents (post-order) and have the kind
+// their slot expects.
+class FlatAstVerifier {
+  public:
+    explicit FlatAstVerifier(FlatAstView ast) : ast(ast) {}
+
+    void verify() const {
+        auto const nodes = ast.nodes();
+        if (!ast.offsets().empty() && ast.offsets().size() != nodes.size()) {
+            fail("offset count differs from node count");
+        }
+        for (StrRef const ref : ast.strings()) {
+            if (uint64_t{ref.offset} + ref.length >
+                ast.string_chars().size()) {
+                fail("string out of range");
+            }
+        }
+        NodeId previous = 0;
+        for (uint32_t const root : list(ast.root_list_index(), 1)) {
+            statement(root, static_cast<NodeId>(nodes.size()));
+            if (root < previous) {
+                fail("top-level items out of order");
+            }
+            previous = root + 1;
+        }
+        for (NodeId id = 0; id < nodes.size(); ++id) {
+            verify_node(id, nodes[id]);
+        }
+    }
+
+  private:
+    FlatAstView ast;
+
+    [[noreturn]] static void fail(string_view what) {
+        throw runtime_error(format("Malformed AST: {}", what));
+    }
+
+    // Words of the list at `index` holding count * stride words.
+    std::span<uint32_t const>
+    list(uint32_t index, uint32_t stride, uint32_t head = 0) const {
+        auto const extra = ast.extra();
+        if (index >= extra.size() ||
+            (uint64_t{extra[index]} * stride + head >
+             extra.size() - index - 1)) {
+            fail("list out of range");
+        }
+        return extra.subspan(index + 1, extra[index] * stride + head);
+    }
+
+    void check_string(uint32_t id) const {
+        if (id >= ast.strings().size()) {
+            fail("string id out of range");
+        }
+    }
+
+    static void check_type_code(uint32_t code) {
+        if (code > static_cast<uint32_t>(BuiltInType::String) + 1) {
+            fail("bad type code");
+        }
+    }
+
+    void child(NodeId id, NodeId parent) const {
+        if (id >= parent) {
+            fail("child does not precede its parent");
+        }
+    }
+
+    void expression(NodeId id, NodeId parent) const {
+        child(id, parent);
+        if (is_statement_kind(ast.node(id).kind)) {
+            fail("statement in expression position");
+        }
+    }
+
+    void optional_expression(NodeId id, NodeId parent) const {
+        if (id != no_node) {
+            expression(id, parent);
+        }
+    }
+
+    void statement(NodeId id, NodeId parent) const {
+        child(id, parent);
+        if (!is_statement_kind(ast.node(id).kind)) {
+            fail("expression in statement position");
+        }
+    }
+
+    void block(NodeId id, NodeId parent) const {
+        child(id, parent);
+        if (ast.node(id).kind != FlatKind::Block) {
+            fail("block expected");
+        }
+    }
+
+    static void check_op(uint8_t tag) {
+        if (get_token_class(static_cast<TokenKind>(tag)) ==
+            TokenClass::Unknown) {
+            fail("bad operator");
+        }
+    }
+
+    void verify_node(NodeId id, FlatNode const& n) const {
+        switch (n.kind) {
+        case FlatKind::Identifier:
+            check_string(n.a);
+            break;
+        case FlatKind::Literal:
+            check_type_code(n.tag + 1U);
+            check_string(n.a);
+            break;
+        case FlatKind::Call:
+            check_string(n.a);
+            for (uint32_t const arg : list(n.b, 1)) {
+                expression(arg, id);
+            }
+            break;
+        case FlatKind::Binary:
+            check_op(n.tag);
+            expression(n.a, id);
+            expression(n.b, id);
+            break;
+        case FlatKind::Prefix:
+        case FlatKind::Postfix:
+            check_op(n.tag);
+            expression(n.a, id);
+            break;
+        case FlatKind::Return:
+            optional_expression(n.a, id);
+            break;
+        case FlatKind::Assign:
+            expression(n.a, id);
+            expression(n.b, id);
+            break;
+        case FlatKind::Block:
+            for (uint32_t const stmt : list(n.a, 1)) {
+                statement(stmt, id);
+            }
+            optional_expression(n.b, id);
+            break;
+        case FlatKind::If:
+            expression(n.a, id);
+            block(n.b, id);
+            optional_expression(n.c, id);
+            break;
+        case FlatKind::While:
+            expression(n.a, id);
+            block(n.b, id);
+            break;
+        case FlatKind::Break:
+        case FlatKind::Continue:
+            check_string(n.a);
+            break;
+        case FlatKind::For:
+            check_string(n.a);
+            expression(n.b, id);
+            block(n.c, id);
+            break;
+        case FlatKind::ExprStmt:
+            expression(n.a, id);
+            break;
+        case FlatKind::VarDecl:
+            check_type_code(n.tag);
+            check_string(n.a);
+            check_string(n.b);
+            optional_expression(n.c, id);
+            break;
+        case FlatKind::FunctionDecl: {
+            check_type_code(n.tag);
+            check_string(n.a);
+            auto const params = list(n.b, 3, 1);
+            check_string(params[0]);
+            for (size_t i = 1; i < params.size(); i += 3) {
+                check_string(params[i]);
+                check_string(params[i + 1]);
+                check_type_code(params[i + 2]);
+            }
+            block(n.c, id);
+            break;
+        }
+        default:
+            fail("bad node kind");
+        }
+    }
+};
+
+} // namespace detail
+
+// Throws runtime_error unless `ast` is well formed.
+inline void verify_flat_ast(FlatAstView ast) {
+    detail::FlatAstVerifier(ast).verify();
+}
+
+// ==========================================
+// Loading
+// ==========================================
+
+// A mapped .ast file. The view points into the mapping, so it (and anything
+// materialized from it) must not outlive the AstFile.
+class AstFile {
+  public:
+    // With `verify`, the tree is checked with verify_flat_ast(); skip it
+    // only for files this process wrote itself.
+    static AstFile
+    open(std::filesystem::path const& path, bool verify = true) {
+        AstFile file;
+        file.bytes = SourceFile::open(path, LoadMode::Map);
+        file.load(path);
+        if (verify) {
+            verify_flat_ast(file.ast);
+        }
+        return file;
+    }
+
+    FlatAstView view() const { return ast; }
+
+    uint64_t source_hash() const { return header.source_hash; }
+
+    // Whether this file was produced from `source`.
+    bool matches(string_view source) const {
+        return xxh64(source) == header.source_hash;
+    }
+
+  private:
+    SourceFile bytes;
+    AstFileHeader header{};
+    FlatAstView ast;
+
+    template <typename T>
+    std::span<T const> section(uint64_t at, uint64_t count) const {
+        string_view const data = bytes.text();
+        if (at > data.size() || count > (data.size() - at) / sizeof(T)) {
+            throw runtime_error("Truncated AST file");
+        }
+        char const* const p = data.data() + at;
+        if (reinterpret_cast<uintptr_t>(p) % alignof(T) != 0) {
+            throw runtime_error("Misaligned AST file section");
+        }
+        // the producer wrote these objects with the same layout
+        return {reinterpret_cast<T const*>(p), static_cast<size_t>(count)};
+    }
+
+    void load(std::filesystem::path const& path) {
+        string_view const data = bytes.text();
+        if (data.size() < sizeof(AstFileHeader)) {
+            throw runtime_error("Not an AST file: " + path.string());
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (header.magic != ast_file_magic) {
+            throw runtime_error("Not an AST file: " + path.string());
+        }
+        if (header.version != ast_file_version) {
+            throw runtime_error(format(
+                "Unsupported AST file version {} in {}",
+                header.version,
+                path.string()));
+        }
+        if (header.byte_order != byte_order_mark) {
+            throw runtime_error(
+                "AST file has foreign byte order: " + path.string());
+        }
+        auto const chars = section<char>(header.chars_at, header.chars_size);
+        ast = FlatAstView(
+            section<FlatNode>(header.nodes_at, header.node_count),
+            section<uint32_t>(header.extra_at, header.extra_count),
+            section<StrRef>(header.strings_at, header.string_count),
+            string_view(chars.data(), chars.size()),
+            header.root_list,
+            section<uint32_t>(header.offsets_at, header.offset_count));
+    }
+};
+
+// ==========================================
+// Materialization
+// ==========================================
+
+namespace detail {
+
+// Rebuilds pointer-tree nodes in one forward pass: in post-order every child
+// is built before its parent. Subtrees are contiguous, so top-level items
+// [first, last) occupy the node range (roots[first - 1], roots[last - 1]].
+class Materializer {
+  public:
+    Materializer(
+        FlatAstView ast, size_t first, size_t last, Interner& interner)
+        : ast(ast), interner(interner),
+          roots(ast.roots().subspan(first, last - first)),
+          begin(first == 0 ? 0 : ast.roots()[first - 1] + 1),
+          end(roots.empty() ? begin : std::max(begin, roots.back() + 1)),
+          exprs(end - begin), stmts(end - begin),
+          symbols(ast.strings().size(), no_symbol) {}
+
+    Program materialize() {
+        for (NodeId id = begin; id < end; ++id) {
+            build(id, ast.node(id));
+        }
+        program.statements.reserve(roots.size());
+        for (NodeId const root : roots) {
+            program.statements.push_back(stmt(root));
+        }
+        return std::move(program);
+    }
+
+  private:
+    FlatAstView ast;
+    Interner& interner;
+    std::span<uint32_t const> roots;
+    NodeId begin;
+    NodeId end;
+    vector<ExprPtr> exprs;
+    vector<StmtPtr> stmts;
+    vector<Symbol> symbols;
+    Program program;
+
+    AstArena& arena() { return *program.arena; }
+
+    size_t slot(NodeId id) const {
+        if (id < begin || id >= end) {
+            throw runtime_error("Malformed AST: subtree not contiguous");
+        }
+        return id - begin;
+    }
+
+    ExprPtr expr(NodeId id) const { return exprs[slot(id)]; }
+
+    StmtPtr stmt(NodeId id) const { return stmts[slot(id)]; }
+
+    optional<ExprPtr> optional_expr(NodeId id) const {
+        if (id == no_node) {
+            return std::nullopt;
+        }
+        return expr(id);
+    }
+
+    // The BlockExpr of a Block child; its Expr shell stays unused.
+    BlockExpr block(NodeId id) const {
+        return std::move(std::get<BlockExpr>(expr(id)->node));
+    }
+
+    // Names are interned once per string table entry.
+    Identifier name(uint32_t str) {
+        if (symbols[str] == no_symbol) {
+            symbols[str] = interner.intern(ast.str(str));
+        }
+        return {.name = ast.str(str), .symbol = symbols[str]};
+    }
+
+    Type type(uint32_t code, uint32_t str) {
+        return {
+            .built_in_type = built_in_of(static_cast<uint8_t>(code)),
+            .name = name(str)};
+    }
+
+    void build(NodeId id, FlatNode const& n) {
+        switch (n.kind) {
+        case FlatKind::ExprStmt:
+            stmts[slot(id)] = Stmt::make(arena(), ExprStmt{expr(n.a)});
+            return;
+        case FlatKind::VarDecl:
+            stmts[slot(id)] = Stmt::make(
+                arena(),
+                VarDecl{
+                    .name = name(n.a),
+                    .type = type(n.tag, n.b),
+                    .init = optional_expr(n.c)});
+            return;
+        case FlatKind::FunctionDecl: {
+            uint32_t const count = ast.extra_at(n.b);
+            AstVector<Param> params(arena().resource());
+            params.reserve(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                uint32_t const param = n.b + 2 + i * 3;
+                params.push_back(
+                    {.name = name(ast.extra_at(param)),
+                     .type = type(
+                         ast.extra_at(param + 2), ast.extra_at(param + 1))});
+            }
+            stmts[slot(id)] = Stmt::make(
+                arena(),
+                FunctionDecl{
+                    .name = name(n.a),
+                    .params = std::move(params),
+                    .return_type = type(n.tag, ast.extra_at(n.b + 1)),
+                    .body = block(n.c)});
+            return;
+        }
+        default:
+            exprs[slot(id)] = Expr::make(arena(), build_expr(n));
+            return;
+        }
+    }
+
+    Expr::Node build_expr(FlatNode const& n) {
+        switch (n.kind) {
+        case FlatKind::Identifier:
+            return name(n.a);
+        case FlatKind::Literal:
+            return LiteralExpr{
+                .type = static_cast<BuiltInType>(n.tag),
+                .value = ast.str(n.a)};
+        case FlatKind::Call: {
+            AstVector<ExprPtr> args(arena().resource());
+            for (uint32_t const arg : ast.list(n.b)) {
+                args.push_back(expr(arg));
+            }
+            return CallExpr{.callee = name(n.a), .args = std::move(args)};
+        }
+        case FlatKind::Binary:
+            return BinaryExpr{
+                .op = static_cast<TokenKind>(n.tag),
+                .lhs = expr(n.a),
+                .rhs = expr(n.b)};
+        case FlatKind::Prefix:
+            return PrefixExpr{
+                .op = static_cast<TokenKind>(n.tag), .operand = expr(n.a)};
+        case FlatKind::Postfix:
+            return PostfixExpr{
+                .op = static_cast<TokenKind>(n.tag), .operand = expr(n.a)};
+        case FlatKind::Return:
+            return ReturnExpr{optional_expr(n.a)};
+        case FlatKind::Assign:
+            return AssignExpr{.lhs = expr(n.a), .rhs = expr(n.b)};
+        case FlatKind::Block: {
+            AstVector<StmtPtr> statements(arena().resource());
+            for (uint32_t const s : ast.list(n.a)) {
+                statements.push_back(stmt(s));
+            }
+            return BlockExpr{
+                .statements = std::move(statements),
+                .final_expr = optional_expr(n.b)};
+        }
+        case FlatKind::If:
+            return IfExpr{
+                .condition = expr(n.a),
+                .then_block = block(n.b),
+                .else_expr = optional_expr(n.c)};
+        case FlatKind::While:
+            return WhileExpr{.condition = expr(n.a), .body = block(n.b)};
+        case FlatKind::Break:
+            return BreakExpr{.keyword = ast.str(n.a)};
+        case FlatKind::Continue:
+            return ContinueExpr{.keyword = ast.str(n.a)};
+        case FlatKind::For:
+            return ForExpr{
+                .loop_var = name(n.a),
+                .iter_expr = expr(n.b),
+                .body = block(n.c)};
+        default:
+            throw runtime_error("Malformed AST: bad node kind");
+        }
+    }
+};
+
+} // namespace detail
+
+// Builds a Program from the top-level items [first, last) of a verified
+// view, touching only their nodes. Names and literals are views into the
+// view's string table; their symbols come from `interner`.
+inline Program materialize(
+    FlatAstView ast,
+    size_t first = 0,
+    size_t last = std::numeric_limits<size_t>::max(),
+    Interner& interner = global_interner()) {
+    last = std::min(last, ast.roots().size());
+    first = std::min(first, last);
+    return detail::Materializer(ast, first, last, interner).materialize();
+}
+
+} // namespace mini_compiler
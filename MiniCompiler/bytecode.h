@@ -0,0 +1,1111 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// bytecode.h
+
+#pragma once
+
+#include "interner.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "output_writer.h"
+#include "parser.h"
+#include "semantic.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::optional;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Instruction set
+// ==========================================
+//
+// Code for a stack machine. An instruction is one 32-bit word: the opcode
+// in the low byte, a 24-bit operand above it. Jump operands are signed and
+// relative to the next instruction; the others are indexes (a constant, a
+// frame slot, a function) or counts.
+//
+// Binary operators pop the right operand, then the left one, and push the
+// result; they are generic over the operand types and look at the value
+// tags. Arithmetic and comparisons also come in _CONST and _LOCAL forms
+// whose right operand is a constant or a frame slot: "x + 1" is two
+// instructions, not three. STORE_* pops the stored value. JUMP_IF_FALSE
+// and JUMP_IF_TRUE pop the condition; JUMP_IF_FALSE_OR_POP and
+// JUMP_IF_TRUE_OR_POP (&& and ||) keep it when they jump. CALL f expects
+// f's arguments on the stack and leaves the result in their place; PRINT n
+// prints and pops n values. TRAP raises a runtime error whose message is
+// its (string) constant: the compiler puts it where a program that did not
+// pass the checker makes no sense.
+//
+// A `for` loop keeps its count, counter and variable in three consecutive
+// slots s, s + 1, s + 2. FOR_PREP s pops the count and starts the loop;
+// FOR_LOOP s advances it. Each is followed by the JUMP it takes (out of
+// the loop, back into the body), so an iteration costs one dispatch.
+
+enum class OperandKind : uint8_t {
+    None,
+    Constant,
+    Local,
+    Global,
+    Count,
+    Jump,
+    Function
+};
+
+// X(name, mnemonic, operand kind)
+#define BYTECODE_OPS(X)                                                        \
+    X(Const, "CONST", Constant)                                                \
+    X(Unit, "UNIT", None)                                                      \
+    X(Pop, "POP", None)                                                        \
+    X(PopN, "POPN", Count)                                                     \
+    X(Dup, "DUP", None)                                                        \
+    X(LoadLocal, "LOAD_LOCAL", Local)                                          \
+    X(StoreLocal, "STORE_LOCAL", Local)                                        \
+    X(LoadGlobal, "LOAD_GLOBAL", Global)                                       \
+    X(StoreGlobal, "STORE_GLOBAL", Global)                                     \
+    X(Add, "ADD", None)                                                        \
+    X(AddConst, "ADD_CONST", Constant)                                         \
+    X(AddLocal, "ADD_LOCAL", Local)                                            \
+    X(Sub, "SUB", None)                                                        \
+    X(SubConst, "SUB_CONST", Constant)                                         \
+    X(SubLocal, "SUB_LOCAL", Local)                                            \
+    X(Mul, "MUL", None)                                                        \
+    X(MulConst, "MUL_CONST", Constant)                                         \
+    X(MulLocal, "MUL_LOCAL", Local)                                            \
+    X(Div, "DIV", None)                                                        \
+    X(DivConst, "DIV_CONST", Constant)                                         \
+    X(DivLocal, "DIV_LOCAL", Local)                                            \
+    X(Mod, "MOD", None)                                                        \
+    X(ModConst, "MOD_CONST", Constant)                                         \
+    X(ModLocal, "MOD_LOCAL", Local)                                            \
+    X(Shl, "SHL", None)                                                        \
+    X(Shr, "SHR", None)                                                        \
+    X(BitAnd, "BITAND", None)                                                  \
+    X(BitOr, "BITOR", None)                                                    \
+    X(BitXor, "XOR", None)                                                     \
+    X(Less, "LT", None)                                                        \
+    X(LessConst, "LT_CONST", Constant)                                         \
+    X(LessLocal, "LT_LOCAL", Local)                                            \
+    X(LessEq, "LE", None)                                                      \
+    X(LessEqConst, "LE_CONST", Constant)                                       \
+    X(LessEqLocal, "LE_LOCAL", Local)                                          \
+    X(Greater, "GT", None)                                                     \
+    X(GreaterConst, "GT_CONST", Constant)                                      \
+    X(GreaterLocal, "GT_LOCAL", Local)                                         \
+    X(GreaterEq, "GE", None)                                                   \
+    X(GreaterEqConst, "GE_CONST", Constant)                                    \
+    X(GreaterEqLocal, "GE_LOCAL", Local)                                       \
+    X(Equal, "EQ", None)                                                       \
+    X(EqualConst, "EQ_CONST", Constant)                                        \
+    X(EqualLocal, "EQ_LOCAL", Local)                                           \
+    X(NotEqual, "NE", None)                                                    \
+    X(NotEqualConst, "NE_CONST", Constant)                                     \
+    X(NotEqualLocal, "NE_LOCAL", Local)                                        \
+    X(Negate, "NEG", None)                                                     \
+    X(Not, "NOT", None)                                                        \
+    X(Complement, "COMPL", None)                                               \
+    X(Jump, "JUMP", Jump)                                                      \
+    X(JumpIfFalse, "JUMP_IF_FALSE", Jump)                                      \
+    X(JumpIfTrue, "JUMP_IF_TRUE", Jump)                                        \
+    X(JumpIfFalseOrPop, "JUMP_IF_FALSE_OR_POP", Jump)                          \
+    X(JumpIfTrueOrPop, "JUMP_IF_TRUE_OR_POP", Jump)                            \
+    X(ForPrep, "FOR_PREP", Local)                                              \
+    X(ForLoop, "FOR_LOOP", Local)                                              \
+    X(Call, "CALL", Function)                                                  \
+    X(Return, "RETURN", None)                                                  \
+    X(Print, "PRINT", Count)                                                   \
+    X(Halt, "HALT", None)                                                      \
+    X(Trap, "TRAP", Constant)
+
+#define AS_ENUM(name, mnemonic, operand) name,
+enum class Op : uint8_t { BYTECODE_OPS(AS_ENUM) };
+#undef AS_ENUM
+
+#define AS_COUNT(name, mnemonic, operand) +1
+inline constexpr size_t op_count = 0 BYTECODE_OPS(AS_COUNT);
+#undef AS_COUNT
+
+constexpr string_view to_string(Op op) {
+    switch (op) {
+#define AS_CASE(name, mnemonic, operand)                                       \
+    case Op::name:                                                             \
+        return mnemonic;
+        BYTECODE_OPS(AS_CASE)
+#undef AS_CASE
+    }
+    throw runtime_error("Unknown opcode");
+}
+
+constexpr OperandKind operand_kind(Op op) {
+    switch (op) {
+#define AS_CASE(name, mnemonic, operand)                                       \
+    case Op::name:                                                             \
+        return OperandKind::operand;
+        BYTECODE_OPS(AS_CASE)
+#undef AS_CASE
+    }
+    throw runtime_error("Unknown opcode");
+}
+
+// The _CONST and _LOCAL forms of a binary operator follow it.
+constexpr bool has_operand_forms(Op op) {
+    return (op >= Op::Add && op <= Op::ModLocal) ||
+           (op >= Op::Less && op <= Op::NotEqualLocal);
+}
+
+constexpr Op const_form(Op op) {
+    return static_cast<Op>(static_cast<uint8_t>(op) + 1);
+}
+
+constexpr Op local_form(Op op) {
+    return static_cast<Op>(static_cast<uint8_t>(op) + 2);
+}
+
+static_assert(const_form(Op::Mod) == Op::ModConst);
+static_assert(local_form(Op::NotEqual) == Op::NotEqualLocal);
+
+using Instruction = uint32_t;
+
+inline constexpr int32_t max_operand = (1 << 24) - 1;
+inline constexpr int32_t max_jump = (1 << 23) - 1;
+
+constexpr Instruction encode(Op op, int32_t operand = 0) {
+    return static_cast<uint32_t>(operand) << 8 | static_cast<uint8_t>(op);
+}
+
+constexpr Op op_of(Instruction instruction) {
+    return static_cast<Op>(instruction & 0xFF);
+}
+
+constexpr uint32_t operand_of(Instruction instruction) {
+    return instruction >> 8;
+}
+
+constexpr int32_t jump_offset_of(Instruction instruction) {
+    return static_cast<int32_t>(instruction) >> 8; // sign-extending
+}
+
+static_assert(jump_offset_of(encode(Op::Jump, -5)) == -5);
+static_assert(operand_of(encode(Op::Const, max_operand)) == max_operand);
+
+// ==========================================
+// Compiled program
+// ==========================================
+
+struct BytecodeFunction {
+    string name;
+    uint32_t params = 0;     // the first slots of the frame
+    uint32_t frame_size = 0; // slots, parameters included
+    uint32_t max_stack = 0;  // operand stack above the slots
+    vector<Instruction> code{};
+    vector<string> slot_names{}; // "a|b" for a slot reused by sibling scopes
+};
+
+// functions[0] is the top-level code; its frame holds the globals. It ends
+// by calling main() if the program declares one, then HALT.
+struct BytecodeModule {
+    vector<Value> constants;
+    std::deque<string> strings; // of the string constants
+    vector<BytecodeFunction> functions;
+};
+
+// ==========================================
+// Compiler
+// ==========================================
+
+// Translates a Program (normally one that passed check_program()) into a
+// BytecodeModule. Names are resolved with the rules of the checker and of
+// the Interpreter: variables become frame slots (sibling scopes share
+// them), globals the slots of the top-level frame, literals deduplicated
+// constants. Block and if values stay on the operand stack; loops become
+// jumps, and break and continue first drop what the loop's enclosing
+// expression had pushed. The compiler keeps track of the stack depth, so
+// every function knows the most operand slots it can need.
+//
+// Like the other passes, long operator and assignment chains are compiled
+// without recursion.
+class BytecodeCompiler {
+  public:
+    explicit BytecodeCompiler(Interner& interner = global_interner())
+        : interner(interner), print_symbol(interner.intern("print")),
+          true_symbol(interner.intern("true")),
+          false_symbol(interner.intern("false")) {}
+
+    BytecodeModule compile(Program const& program) {
+        module = {};
+        scalar_constants.clear();
+        string_constants.clear();
+        module.functions.push_back({.name = "<script>"});
+        fn = {};
+
+        names.enter();
+        names.declare(print_symbol, {.kind = Name::Kind::Print});
+        names.declare(
+            true_symbol,
+            {.kind = Name::Kind::Constant,
+             .index = constant(Value::of_bool(true))});
+        names.declare(
+            false_symbol,
+            {.kind = Name::Kind::Constant,
+             .index = constant(Value::of_bool(false))});
+        names.enter();
+        compile_statements(program.statements, false);
+        for (StmtPtr const stmt : program.statements) {
+            auto const* decl = std::get_if<FunctionDecl>(&stmt->node);
+            if (decl != nullptr && decl->name.name == "main" &&
+                decl->params.empty()) {
+                Name const& found = names.find(symbol_of(decl->name))->value;
+                emit(Op::Call, found.index, 1);
+                emit(Op::Pop, 0, -1);
+            }
+        }
+        emit(Op::Halt);
+        names.leave();
+        names.leave();
+        finish_function();
+        return std::move(module);
+    }
+
+  private:
+    struct Name {
+        enum class Kind : uint8_t { Variable, Constant, Function, Print };
+        Kind kind = Kind::Variable;
+        uint32_t index = 0; // slot, constant or function
+        uint32_t frame = 0; // of a variable: the function (0 top level)
+    };
+
+    static constexpr uint32_t global_depth = 2; // built-ins are depth 1
+
+    struct Loop {
+        uint32_t depth = 0; // of the operand stack around the loop
+        vector<size_t> breaks{};
+        vector<size_t> continues{};
+    };
+
+    // The function being compiled; saved while a nested one is.
+    struct FunctionState {
+        uint32_t index = 0;
+        bool returns_unit = false;
+        vector<Instruction> code{};
+        uint32_t depth = 0;
+        uint32_t max_depth = 0;
+        uint32_t next_slot = 0;
+        uint32_t frame_size = 0;
+        vector<string> slot_names{};
+        vector<Loop> loops{};
+        size_t label = 0; // the last position a jump goes to
+    };
+
+    struct ScalarKey {
+        BuiltInType type;
+        uint64_t bits;
+        bool operator==(ScalarKey const&) const = default;
+    };
+
+    struct ScalarKeyHash {
+        size_t operator()(ScalarKey const& key) const {
+            return static_cast<size_t>(
+                (key.bits ^ static_cast<uint64_t>(key.type) << 56) *
+                0x9E3779B97F4A7C15);
+        }
+    };
+
+    Interner& interner;
+    Symbol print_symbol;
+    Symbol true_symbol;
+    Symbol false_symbol;
+
+    BytecodeModule module;
+    std::unordered_map<ScalarKey, uint32_t, ScalarKeyHash> scalar_constants;
+    std::unordered_map<string_view, uint32_t> string_constants;
+    ScopedSymbolTable<Name> names;
+    FunctionState fn;
+
+    // explicit stacks of the chain compilations
+    vector<BinaryExpr const*> binary_stack;
+    vector<TokenKind> unary_stack;
+    vector<Identifier const*> target_stack;
+
+    // ------------------------------------------
+    // Emission
+    // ------------------------------------------
+
+    // Appends an instruction that changes the stack depth by `effect`.
+    void emit(Op op, uint32_t operand = 0, int effect = 0) {
+        if (operand > static_cast<uint32_t>(max_operand)) {
+            throw runtime_error(format(
+                "bytecode limit exceeded: {} operand {}",
+                string(to_string(op)),
+                operand));
+        }
+        fn.code.push_back(encode(op, static_cast<int32_t>(operand)));
+        fn.depth = static_cast<uint32_t>(static_cast<int>(fn.depth) + effect);
+        fn.max_depth = std::max(fn.max_depth, fn.depth);
+    }
+
+    // A forward jump, patched by bind().
+    size_t emit_jump(Op op, int effect = 0) {
+        emit(op, 0, effect);
+        return fn.code.size() - 1;
+    }
+
+    void bind(size_t jump) {
+        patch(jump, fn.code.size());
+        fn.label = fn.code.size();
+    }
+
+    // The position of the next instruction, as the target of jumps back.
+    size_t loop_label() {
+        fn.label = fn.code.size();
+        return fn.label;
+    }
+
+    void emit_jump_back(Op op, size_t target) {
+        emit(op);
+        patch(fn.code.size() - 1, target);
+    }
+
+    // A binary operator; "CONST k, op" and "LOAD_LOCAL s, op" become the
+    // op's _CONST and _LOCAL forms, unless something jumps to the op.
+    void emit_binary(Op op) {
+        if (has_operand_forms(op) && !fn.code.empty() &&
+            fn.label != fn.code.size()) {
+            Instruction const last = fn.code.back();
+            optional<Op> fused;
+            if (op_of(last) == Op::Const) {
+                fused = const_form(op);
+            } else if (op_of(last) == Op::LoadLocal) {
+                fused = local_form(op);
+            }
+            if (fused) {
+                fn.code.back() = encode(
+                    *fused, static_cast<int32_t>(operand_of(last)));
+                fn.depth -= 1;
+                return;
+            }
+        }
+        emit(op, 0, -1);
+    }
+
+    void patch(size_t jump, size_t target) {
+        auto const offset = static_cast<int64_t>(target) -
+                            static_cast<int64_t>(jump + 1);
+        if (offset < -max_jump - 1 || offset > max_jump) {
+            throw runtime_error("bytecode limit exceeded: jump too far");
+        }
+        fn.code[jump] =
+            encode(op_of(fn.code[jump]), static_cast<int32_t>(offset));
+    }
+
+    // Code after a return, break or continue is never reached; `keep`
+    // pretends it pushed the value its expression is expected to leave.
+    void unreachable_value(bool keep) {
+        if (keep) {
+            fn.depth += 1;
+            fn.max_depth = std::max(fn.max_depth, fn.depth);
+        }
+    }
+
+    void discard(bool keep) {
+        if (!keep) {
+            emit(Op::Pop, 0, -1);
+        }
+    }
+
+    void trap(string message, int effect) {
+        emit(Op::Trap, string_constant(std::move(message)), effect);
+    }
+
+    uint32_t constant(Value value) {
+        ScalarKey const key{
+            value.type,
+            value.type == BuiltInType::Float
+                ? std::bit_cast<uint64_t>(value.float_value)
+                : static_cast<uint64_t>(
+                      value.type == BuiltInType::Char
+                          ? value.char_value
+                          : (value.type == BuiltInType::Bool
+                                 ? static_cast<int64_t>(value.bool_value)
+                                 : value.int_value))};
+        auto const [it, inserted] = scalar_constants.try_emplace(
+            key, static_cast<uint32_t>(module.constants.size()));
+        if (inserted) {
+            module.constants.push_back(value);
+        }
+        return it->second;
+    }
+
+    uint32_t string_constant(string text) {
+        if (auto const it = string_constants.find(text);
+            it != string_constants.end()) {
+            return it->second;
+        }
+        string const& stored = module.strings.emplace_back(std::move(text));
+        auto const index = static_cast<uint32_t>(module.constants.size());
+        module.constants.push_back(Value::of_string(&stored));
+        string_constants.emplace(stored, index);
+        return index;
+    }
+
+    // ------------------------------------------
+    // Names
+    // ------------------------------------------
+
+    Symbol symbol_of(Identifier const& name) {
+        return name.symbol != no_symbol ? name.symbol
+                                        : interner.intern(name.name);
+    }
+
+    uint32_t allocate_slot(string_view name) {
+        uint32_t const slot = fn.next_slot++;
+        fn.frame_size = std::max(fn.frame_size, fn.next_slot);
+        if (slot == fn.slot_names.size()) {
+            fn.slot_names.emplace_back(name);
+        } else {
+            string& names_of_slot = fn.slot_names[slot];
+            if (names_of_slot != name &&
+                !names_of_slot.starts_with(string(name) + "|") &&
+                !names_of_slot.ends_with("|" + string(name))) {
+                names_of_slot += '|';
+                names_of_slot += name;
+            }
+        }
+        return slot;
+    }
+
+    void declare_variable(Identifier const& name, uint32_t slot) {
+        names.declare(
+            symbol_of(name),
+            {.kind = Name::Kind::Variable, .index = slot, .frame = fn.index});
+    }
+
+    // How a variable is reached from the current function, if it is one
+    // that can be.
+    optional<std::pair<Op, uint32_t>> variable(
+        Identifier const& name, bool store) {
+        auto const* binding = names.find(symbol_of(name));
+        if (binding == nullptr ||
+            binding->value.kind != Name::Kind::Variable) {
+            return std::nullopt;
+        }
+        Name const& found = binding->value;
+        if (found.frame == fn.index) {
+            return std::pair{
+                store ? Op::StoreLocal : Op::LoadLocal, found.index};
+        }
+        if (binding->depth == global_depth) {
+            return std::pair{
+                store ? Op::StoreGlobal : Op::LoadGlobal, found.index};
+        }
+        return std::nullopt; // a local of an enclosing function
+    }
+
+    // ------------------------------------------
+    // Statements and functions
+    // ------------------------------------------
+
+    // Compiles a block's statements. With `keep_last`, a trailing `if`
+    // statement (see is_value_statement()) leaves its value; returns
+    // whether one did.
+    template <typename Statements>
+    bool compile_statements(Statements const& statements, bool keep_last) {
+        for (StmtPtr const stmt : statements) {
+            if (auto const* decl = std::get_if<FunctionDecl>(&stmt->node)) {
+                hoist(*decl);
+            }
+        }
+        for (StmtPtr const stmt : statements) {
+            if (auto const* expr_stmt = std::get_if<ExprStmt>(&stmt->node)) {
+                bool const keep = keep_last && stmt == statements.back() &&
+                                  is_value_statement(*stmt);
+                compile(*expr_stmt->expr, keep);
+                if (keep) {
+                    return true;
+                }
+            } else if (auto const* decl = std::get_if<VarDecl>(&stmt->node)) {
+                if (decl->init) {
+                    compile(**decl->init, true);
+                } else {
+                    emit(Op::Unit, 0, 1);
+                }
+                uint32_t const slot = allocate_slot(decl->name.name);
+                emit(Op::StoreLocal, slot, -1);
+                declare_variable(decl->name, slot);
+            } else {
+                compile_function(std::get<FunctionDecl>(stmt->node));
+            }
+        }
+        return false;
+    }
+
+    void hoist(FunctionDecl const& decl) {
+        auto const index = static_cast<uint32_t>(module.functions.size());
+        module.functions.push_back(
+            {.name = string(decl.name.name),
+             .params = static_cast<uint32_t>(decl.params.size())});
+        names.declare(
+            symbol_of(decl.name),
+            {.kind = Name::Kind::Function, .index = index});
+    }
+
+    void compile_function(FunctionDecl const& decl) {
+        uint32_t const index =
+            names.find(symbol_of(decl.name))->value.index;
+        FunctionState outer = std::exchange(
+            fn,
+            {.index = index,
+             .returns_unit =
+                 decl.return_type.built_in_type == BuiltInType::Unit});
+        names.enter();
+        for (Param const& param : decl.params) {
+            declare_variable(param.name, allocate_slot(param.name.name));
+        }
+        if (fn.returns_unit) {
+            compile_block(decl.body, false);
+            emit(Op::Unit, 0, 1);
+        } else {
+            compile_block(decl.body, true);
+        }
+        emit(Op::Return, 0, -1);
+        names.leave();
+        finish_function();
+        fn = std::move(outer);
+    }
+
+    void finish_function() {
+        BytecodeFunction& function = module.functions[fn.index];
+        function.frame_size = fn.frame_size;
+        function.max_stack = fn.max_depth;
+        function.code = std::move(fn.code);
+        function.slot_names = std::move(fn.slot_names);
+    }
+
+    // ------------------------------------------
+    // Expressions
+    // ------------------------------------------
+
+    // Compiles `expr`; with `keep` its value is left on the stack.
+    void compile(Expr const& expr, bool keep) {
+        std::visit(
+            [this, keep](auto const& node) { compile_node(node, keep); },
+            expr.node);
+    }
+
+    void compile_node(Identifier const& name, bool keep) {
+        if (auto const access = variable(name, false)) {
+            emit(access->first, access->second, 1);
+            discard(keep);
+            return;
+        }
+        auto const* binding = names.find(symbol_of(name));
+        if (binding != nullptr && binding->value.kind == Name::Kind::Constant) {
+            if (keep) {
+                emit(Op::Const, binding->value.index, 1);
+            }
+            return;
+        }
+        trap(
+            format("'{}' is not a value here", string(name.name)),
+            keep ? 1 : 0);
+    }
+
+    void compile_node(LiteralExpr const& literal, bool keep) {
+        if (!keep) {
+            return;
+        }
+        if (literal.type == BuiltInType::String) {
+            emit(Op::Const, string_constant(decode_escapes(literal.value)), 1);
+            return;
+        }
+        std::deque<string> unused;
+        try {
+            emit(Op::Const, constant(literal_value(literal, unused)), 1);
+        } catch (runtime_error const& e) { // an out-of-range number
+            trap(e.what(), 1);
+        }
+    }
+
+    void compile_node(CallExpr const& call, bool keep) {
+        auto const* binding = names.find(symbol_of(call.callee));
+        optional<Name> const callee =
+            binding != nullptr ? optional(binding->value) : std::nullopt;
+        auto const args = static_cast<uint32_t>(call.args.size());
+        if (callee && callee->kind == Name::Kind::Print) {
+            for (ExprPtr const arg : call.args) {
+                compile(*arg, true);
+            }
+            emit(Op::Print, args, -static_cast<int>(args));
+            if (keep) {
+                emit(Op::Unit, 0, 1);
+            }
+            return;
+        }
+        if (!callee || callee->kind != Name::Kind::Function) {
+            trap(
+                format("'{}' is not a function", string(call.callee.name)),
+                keep ? 1 : 0);
+            return;
+        }
+        if (module.functions[callee->index].params != args) {
+            trap(
+                format(
+                    "wrong number of arguments to '{}'",
+                    string(call.callee.name)),
+                keep ? 1 : 0);
+            return;
+        }
+        for (ExprPtr const arg : call.args) {
+            compile(*arg, true);
+        }
+        emit(Op::Call, callee->index, 1 - static_cast<int>(args));
+        discard(keep);
+    }
+
+    static optional<Op> binary_op(TokenKind op) {
+        switch (op) {
+        case TokenKind::Plus:
+            return Op::Add;
+        case TokenKind::Minus:
+            return Op::Sub;
+        case TokenKind::Multiply:
+            return Op::Mul;
+        case TokenKind::Slash:
+            return Op::Div;
+        case TokenKind::Modulo:
+            return Op::Mod;
+        case TokenKind::KwLeftShift:
+            return Op::Shl;
+        case TokenKind::KwRightShift:
+            return Op::Shr;
+        case TokenKind::KwBitAnd:
+            return Op::BitAnd;
+        case TokenKind::KwBitOr:
+            return Op::BitOr;
+        case TokenKind::KwXor:
+            return Op::BitXor;
+        case TokenKind::Less:
+            return Op::Less;
+        case TokenKind::LessEq:
+            return Op::LessEq;
+        case TokenKind::Greater:
+            return Op::Greater;
+        case TokenKind::GreaterEq:
+            return Op::GreaterEq;
+        case TokenKind::EqualComparison:
+            return Op::Equal;
+        case TokenKind::NotEqualComparison:
+            return Op::NotEqual;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    // Left-deep chains "a + b + c + ...": the spine is collected on a stack
+    // and compiled from the leftmost operation out.
+    void compile_node(BinaryExpr const& root, bool keep) {
+        size_t const base = binary_stack.size();
+        for (BinaryExpr const* node = &root; node != nullptr;
+             node = std::get_if<BinaryExpr>(&node->lhs->node)) {
+            binary_stack.push_back(node);
+        }
+        compile(*binary_stack.back()->lhs, true);
+        while (binary_stack.size() > base) {
+            BinaryExpr const& node = *binary_stack.back();
+            binary_stack.pop_back();
+            if (node.op == TokenKind::LogicalAnd ||
+                node.op == TokenKind::LogicalOr) {
+                // the fall-through path pops the left operand
+                size_t const jump = emit_jump(
+                    node.op == TokenKind::LogicalAnd ? Op::JumpIfFalseOrPop
+                                                     : Op::JumpIfTrueOrPop,
+                    -1);
+                compile(*node.rhs, true);
+                bind(jump);
+                continue;
+            }
+            compile(*node.rhs, true);
+            if (auto const op = binary_op(node.op)) {
+                emit_binary(*op);
+            } else {
+                trap(
+                    format(
+                        "unsupported operator '{}'",
+                        string(to_string(node.op))),
+                    -1);
+            }
+        }
+        discard(keep);
+    }
+
+    void compile_node(PrefixExpr const& root, bool keep) {
+        compile_unary_chain(root, keep);
+    }
+
+    void compile_node(PostfixExpr const& root, bool keep) {
+        compile_unary_chain(root, keep);
+    }
+
+    // "- - x" or "x compl compl": the operators are collected on a stack and
+    // applied innermost first.
+    template <typename Node>
+    void compile_unary_chain(Node const& root, bool keep) {
+        size_t const base = unary_stack.size();
+        Node const* node = &root;
+        while (true) {
+            unary_stack.push_back(node->op);
+            Node const* inner = std::get_if<Node>(&node->operand->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        compile(*node->operand, true);
+        while (unary_stack.size() > base) {
+            TokenKind const op = unary_stack.back();
+            unary_stack.pop_back();
+            switch (op) {
+            case TokenKind::Plus:
+                break;
+            case TokenKind::Minus:
+                emit(Op::Negate);
+                break;
+            case TokenKind::Not:
+                emit(Op::Not);
+                break;
+            case TokenKind::KwCompl:
+                emit(Op::Complement);
+                break;
+            default:
+                trap(
+                    format(
+                        "unsupported unary operator '{}'",
+                        string(to_string(op))),
+                    0);
+                break;
+            }
+        }
+        discard(keep);
+    }
+
+    void compile_node(ReturnExpr const& node, bool keep) {
+        if (fn.index == 0) {
+            trap("'return' outside of a function", keep ? 1 : 0);
+            return;
+        }
+        if (node.value) {
+            compile(**node.value, !fn.returns_unit);
+        }
+        if (!node.value || fn.returns_unit) {
+            emit(Op::Unit, 0, 1);
+        }
+        emit(Op::Return, 0, -1);
+        unreachable_value(keep);
+    }
+
+    // Right-deep chains "a = b = c = ...": the targets are collected, then
+    // the value is stored into each from the innermost out.
+    void compile_node(AssignExpr const& root, bool keep) {
+        size_t const base = target_stack.size();
+        AssignExpr const* node = &root;
+        while (true) {
+            auto const* target = std::get_if<Identifier>(&node->lhs->node);
+            if (target == nullptr) {
+                target_stack.resize(base);
+                trap("left side of '=' is not a variable", keep ? 1 : 0);
+                return;
+            }
+            target_stack.push_back(target);
+            auto const* inner = std::get_if<AssignExpr>(&node->rhs->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        compile(*node->rhs, true);
+        while (target_stack.size() > base) {
+            Identifier const& target = *target_stack.back();
+            target_stack.pop_back();
+            if (target_stack.size() > base || keep) {
+                emit(Op::Dup, 0, 1);
+            }
+            if (auto const access = variable(target, true)) {
+                emit(access->first, access->second, -1);
+            } else {
+                trap(
+                    format("cannot assign to '{}'", string(target.name)),
+                    -1);
+            }
+        }
+    }
+
+    void compile_node(BlockExpr const& block, bool keep) {
+        compile_block(block, keep);
+    }
+
+    void compile_block(BlockExpr const& block, bool keep) {
+        names.enter();
+        uint32_t const first_slot = fn.next_slot;
+        bool const kept =
+            compile_statements(block.statements, keep && !block.final_expr);
+        if (block.final_expr) {
+            compile(**block.final_expr, keep);
+        } else if (keep && !kept) {
+            emit(Op::Unit, 0, 1);
+        }
+        fn.next_slot = first_slot; // sibling scopes reuse the slots
+        names.leave();
+    }
+
+    void compile_node(IfExpr const& node, bool keep) {
+        compile(*node.condition, true);
+        size_t const else_jump = emit_jump(Op::JumpIfFalse, -1);
+        if (!node.else_expr) { // the value is unit
+            compile_block(node.then_block, false);
+            bind(else_jump);
+            if (keep) {
+                emit(Op::Unit, 0, 1);
+            }
+            return;
+        }
+        uint32_t const depth = fn.depth;
+        compile_block(node.then_block, keep);
+        size_t const end_jump = emit_jump(Op::Jump);
+        bind(else_jump);
+        fn.depth = depth;
+        compile(**node.else_expr, keep);
+        bind(end_jump);
+    }
+
+    // The condition is tested at the bottom: one jump per iteration.
+    void compile_node(WhileExpr const& node, bool keep) {
+        size_t const enter = emit_jump(Op::Jump);
+        fn.loops.push_back({.depth = fn.depth});
+        size_t const body = loop_label();
+        compile_block(node.body, false);
+        bind(enter);
+        bind_continues();
+        compile(*node.condition, true);
+        emit_jump_back(Op::JumpIfTrue, body);
+        fn.depth -= 1;
+        bind_breaks();
+        if (keep) {
+            emit(Op::Unit, 0, 1);
+        }
+    }
+
+    // `for v in n` runs the body for v = 0, 1, ..., n - 1. The count and
+    // the counter live in hidden slots, so the body may assign v freely.
+    void compile_node(ForExpr const& node, bool keep) {
+        compile(*node.iter_expr, true); // outside the loop variable's scope
+        names.enter();
+        uint32_t const slots = allocate_slot("<for count>");
+        allocate_slot("<for counter>");
+        declare_variable(node.loop_var, allocate_slot(node.loop_var.name));
+        emit(Op::ForPrep, slots, -1);
+        size_t const exit = emit_jump(Op::Jump);
+        fn.loops.push_back({.depth = fn.depth});
+        size_t const body = loop_label();
+        compile_block(node.body, false);
+        bind_continues();
+        emit(Op::ForLoop, slots);
+        emit_jump_back(Op::Jump, body);
+        bind(exit);
+        bind_breaks();
+        fn.next_slot -= 3;
+        names.leave();
+        if (keep) {
+            emit(Op::Unit, 0, 1);
+        }
+    }
+
+    void bind_continues() {
+        for (size_t const jump : fn.loops.back().continues) {
+            bind(jump);
+        }
+    }
+
+    void bind_breaks() {
+        for (size_t const jump : fn.loops.back().breaks) {
+            bind(jump);
+        }
+        fn.loops.pop_back();
+    }
+
+    // Drops what was pushed inside the innermost loop's expression; the
+    // jump itself is emitted by the caller.
+    bool leave_to_loop(string_view keyword, bool keep) {
+        if (fn.loops.empty()) {
+            trap(format("'{}' outside of a loop", keyword), keep ? 1 : 0);
+            return false;
+        }
+        uint32_t const extra = fn.depth - fn.loops.back().depth;
+        if (extra > 0) {
+            emit(Op::PopN, extra); // the depth is restored below, dead code
+        }
+        return true;
+    }
+
+    void compile_node(BreakExpr const&, bool keep) {
+        if (leave_to_loop("break", keep)) {
+            fn.loops.back().breaks.push_back(emit_jump(Op::Jump));
+            unreachable_value(keep);
+        }
+    }
+
+    void compile_node(ContinueExpr const&, bool keep) {
+        if (!leave_to_loop("continue", keep)) {
+            return;
+        }
+        fn.loops.back().continues.push_back(emit_jump(Op::Jump));
+        unreachable_value(keep);
+    }
+};
+
+inline BytecodeModule compile_bytecode(
+    Program const& program, Interner& interner = global_interner()) {
+    return BytecodeCompiler(interner).compile(program);
+}
+
+// ==========================================
+// Disassembler
+// ==========================================
+//
+//   constants: 3
+//       0  bool    true
+//       2  string  "hi\n"
+//
+//   function 1 fib: params 1, frame 1, stack 4
+//       0000  LOAD_LOCAL            0          ; n
+//       0001  LT_CONST              3          ; 2
+//       0002  JUMP_IF_FALSE         +2         ; -> 0005
+
+inline void write_constant(OutputWriter& out, Value value) {
+    if (value.type != BuiltInType::String &&
+        value.type != BuiltInType::Char) {
+        write_value(out, value);
+        return;
+    }
+    char const quote = value.type == BuiltInType::String ? '"' : '\'';
+    string_view const text = value.type == BuiltInType::String
+                                 ? string_view(*value.string_value)
+                                 : string_view(&value.char_value, 1);
+    out.put(quote);
+    for (char const c : text) {
+        if (c == '\n') {
+            out << "\\n";
+        } else if (c == '\t') {
+            out << "\\t";
+        } else {
+            if (c == '\\' || c == quote) {
+                out.put('\\');
+            }
+            out.put(c);
+        }
+    }
+    out.put(quote);
+}
+
+inline void disassemble(BytecodeModule const& module, OutputWriter& out) {
+    out << "constants: ";
+    out.write_right(module.constants.size(), 0);
+    out.put('\n');
+    for (size_t i = 0; i < module.constants.size(); ++i) {
+        Value const value = module.constants[i];
+        out.write_right(i, 8);
+        out << "  ";
+        string_view const type = to_string(value.type);
+        out << type;
+        out.spaces(8 - type.size());
+        write_constant(out, value);
+        out.put('\n');
+    }
+
+    for (size_t f = 0; f < module.functions.size(); ++f) {
+        BytecodeFunction const& function = module.functions[f];
+        out << "\nfunction ";
+        out.write_right(f, 0);
+        out << ' ' << function.name << ": params ";
+        out.write_right(function.params, 0);
+        out << ", frame ";
+        out.write_right(function.frame_size, 0);
+        out << ", stack ";
+        out.write_right(function.max_stack, 0);
+        out.put('\n');
+        size_t const width = std::max<size_t>(
+            4, std::to_string(function.code.size()).size());
+        auto write_pc = [&](size_t pc) {
+            string const digits = std::to_string(pc);
+            for (size_t i = digits.size(); i < width; ++i) {
+                out.put('0');
+            }
+            out << digits;
+        };
+        for (size_t pc = 0; pc < function.code.size(); ++pc) {
+            Instruction const instruction = function.code[pc];
+            Op const op = op_of(instruction);
+            OperandKind const kind = operand_kind(op);
+            out << "    ";
+            write_pc(pc);
+            out << "  ";
+            if (kind == OperandKind::None) {
+                out << to_string(op) << '\n';
+                continue;
+            }
+            out << to_string(op);
+            out.spaces(22 - to_string(op).size());
+            uint32_t const index = operand_of(instruction);
+            string const operand =
+                kind == OperandKind::Jump
+                    ? format("{:+}", jump_offset_of(instruction))
+                    : std::to_string(index);
+            out << operand;
+            if (kind == OperandKind::Count) {
+                out.put('\n');
+                continue;
+            }
+            out.spaces(operand.size() < 10 ? 10 - operand.size() : 1);
+            out << " ; ";
+            switch (kind) {
+            case OperandKind::Constant:
+                write_constant(out, module.constants[index]);
+                break;
+            case OperandKind::Local:
+                out << function.slot_names[index];
+                break;
+            case OperandKind::Global:
+                out << module.functions.front().slot_names[index];
+                break;
+            case OperandKind::Function:
+                out << module.functions[index].name;
+                break;
+            default: // a jump
+                out << "-> ";
+                write_pc(static_cast<size_t>(
+                    static_cast<int64_t>(pc) + 1 +
+                    jump_offset_of(instruction)));
+                break;
+            }
+            out.put('\n');
+        }
+    }
+}
+
+} // namespace mini_compiler
@@ -0,0 +1,204 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// disk_cache.h
+
+#pragma once
+
+#include "hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace fs = std::filesystem;
+
+// ==========================================
+// Content-addressed on-disk cache
+// ==========================================
+//
+// Maps XXH64(source bytes, seeded with the compiler version and the options
+// that affect the output) to the dump files that source produced. A hit
+// costs one hash of the source and one file copy per dump.
+//
+// Layout: <dir>/<first 2 hex digits>/<16 hex digits>.<part>, one file per
+// dump. Entries are content-addressed, so any two files with the same name
+// are identical no matter which process wrote them; several processes may
+// therefore share a directory:
+// - writers copy into a unique temporary file and rename it into place,
+//   which is atomic, so readers see a whole file or none;
+// - a part missing for any reason (eviction, a writer still busy) is a miss.
+// Hits refresh the modification time; trim() evicts the least recently
+// used files once the directory outgrows its size limit.
+
+// Part of every cache key. Bump it whenever the dump formats change.
+inline constexpr string_view compiler_version = "MiniCompiler 0.1 (dumps 2)";
+
+class DiskCache {
+  public:
+    static constexpr uintmax_t default_max_bytes = uintmax_t{1} << 30;
+
+    explicit DiskCache(fs::path dir, uintmax_t max_bytes = default_max_bytes)
+        : dir(std::move(dir)), max_bytes(max_bytes) {}
+
+    fs::path const& directory() const { return dir; }
+
+    // `options` names whatever besides the source changes the outputs.
+    static uint64_t key_of(string_view source, string_view options) {
+        uint64_t const seed = xxh64(options, xxh64(compiler_version));
+        return xxh64(source, seed);
+    }
+
+    // Copies the cached parts of `key` to `outputs` (part i to outputs[i]).
+    // Returns false on a miss; outputs may then be partially overwritten.
+    bool fetch(uint64_t key, std::span<fs::path const> outputs) const {
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            if (!copy_over(entry_path(key, i), outputs[i])) {
+                return false;
+            }
+        }
+        auto const now = fs::file_time_type::clock::now();
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            std::error_code ec; // LRU stamp; losing it is harmless
+            fs::last_write_time(entry_path(key, i), now, ec);
+        }
+        return true;
+    }
+
+    // Publishes `outputs` under `key`. Failures only cost a future miss.
+    void store(uint64_t key, std::span<fs::path const> outputs) {
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            fs::path const entry = entry_path(key, i);
+            fs::path const temp = fs::path(entry) += temp_suffix();
+            std::error_code ec;
+            if (!copy_over(outputs[i], temp)) {
+                return;
+            }
+            fs::rename(temp, entry, ec);
+            if (ec) {
+                fs::remove(temp, ec);
+                return;
+            }
+            stored.fetch_add(
+                fs::file_size(entry, ec), std::memory_order_relaxed);
+        }
+    }
+
+    // Bytes published by this object since construction.
+    uintmax_t bytes_stored() const {
+        return stored.load(std::memory_order_relaxed);
+    }
+
+    // Evicts least recently used files until the directory is at most 90%
+    // of the limit, so trimming does not run again on every store.
+    // Temporary files left behind by crashed writers are removed after an
+    // hour.
+    void trim() const {
+        struct File {
+            fs::file_time_type mtime;
+            uintmax_t size;
+            fs::path path;
+        };
+        vector<File> files;
+        uintmax_t total = 0;
+        auto const stale = fs::file_time_type::clock::now() - hour;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(
+                 dir, fs::directory_options::skip_permission_denied, ec);
+             !ec && it != fs::recursive_directory_iterator();
+             it.increment(ec)) {
+            std::error_code file_ec;
+            if (!it->is_regular_file(file_ec)) {
+                continue;
+            }
+            auto const mtime = it->last_write_time(file_ec);
+            uintmax_t const size = it->file_size(file_ec);
+            if (file_ec) {
+                continue; // evicted by someone else meanwhile
+            }
+            if (it->path().filename().string().contains(temp_marker)) {
+                if (mtime < stale) {
+                    fs::remove(it->path(), file_ec);
+                }
+                continue;
+            }
+            total += size;
+            files.push_back({mtime, size, it->path()});
+        }
+        if (total <= max_bytes) {
+            return;
+        }
+        std::ranges::sort(files, {}, &File::mtime);
+        uintmax_t const target = max_bytes / 10 * 9;
+        for (auto const& file : files) {
+            if (total <= target) {
+                break;
+            }
+            fs::remove(file.path, ec);
+            total -= file.size;
+        }
+    }
+
+  private:
+    static constexpr auto hour = std::chrono::hours(1);
+    static constexpr char temp_marker[] = ".tmp-";
+
+    fs::path dir;
+    uintmax_t max_bytes;
+    std::atomic<uintmax_t> stored{0};
+
+    fs::path entry_path(uint64_t key, size_t part) const {
+        string const hex = format("{:016x}", key);
+        return dir / hex.substr(0, 2) / format("{}.{}", hex, part);
+    }
+
+    // Unique per process (a random nonce) and thread (the thread id and a
+    // process-wide counter).
+    static string temp_suffix() {
+        static uint64_t const nonce = [] {
+            std::random_device device;
+            return (uint64_t{device()} << 32) | device();
+        }();
+        static std::atomic<uint64_t> counter{0};
+        return format(
+            "{}{:x}-{:x}-{:x}",
+            temp_marker,
+            nonce,
+            std::hash<std::thread::id>{}(std::this_thread::get_id()),
+            counter.fetch_add(1, std::memory_order_relaxed));
+    }
+
+    // Copies `from` over `to`, creating the parent of `to` if needed.
+    static bool copy_over(fs::path const& from, fs::path const& to) {
+        auto const options = fs::copy_options::overwrite_existing;
+        std::error_code ec;
+        if (fs::copy_file(from, to, options, ec)) {
+            return true;
+        }
+        if (!fs::exists(from, ec)) {
+            return false;
+        }
+        fs::create_directories(to.parent_path(), ec);
+        return fs::copy_file(from, to, options, ec);
+    }
+};
+
+} // namespace mini_compiler
@@ -0,0 +1,1058 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// driver.h
+
+#pragma once
+
+#include "ast_file.h"
+#include "bytecode.h"
+#include "disk_cache.h"
+#include "flat_ast.h"
+#include "instrument.h"
+#include "interpreter.h"
+#include "output_writer.h"
+#include "lexer.h"
+#include "parallel_lexer.h"
+#include "parallel_parser.h"
+#include "parser.h"
+#include "register_bytecode.h"
+#include "register_vm.h"
+#include "sample_program.h"
+#include "semantic.h"
+#include "source_file.h"
+#include "stack_vm.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace fs = std::filesystem;
+
+// ==========================================
+// Command line
+// ==========================================
+
+inline constexpr string_view usage_text =
+    R"(Usage: MiniCompiler [options] [inputs...]
+
+Inputs are source files, directories (searched recursively for files with
+the source extension) and @response-files (one argument per whitespace-
+separated word, "quotes" group words). Without inputs the built-in sample
+program is compiled.
+
+Options:
+  -j N            compile with N worker threads (default: all cores)
+  -o DIR          write <DIR>/<input path>.lex.txt and .parser.txt
+  --no-output     lex and parse only; write no dump files
+  --no-mmap       read inputs into memory instead of mapping them
+  --ext EXT       source extension for directory inputs (default: .mc)
+  --flat-ast      print parser.txt from the flat (index-based) AST
+  --emit-ast      also write <input path>.ast, the binary flat AST
+  --dump-bytecode also write <input path>.bytecode.txt, the stack VM code,
+                  for inputs that check
+  --no-check      skip semantic analysis (name resolution, type checking)
+  --cache-dir DIR reuse dump files of byte-identical inputs from DIR
+  --cache-max-size SIZE
+                  evict least recently used entries beyond SIZE bytes
+                  (K, M, G suffixes; default: 1G)
+  --time-report   print time, allocations and throughput per phase to
+                  stderr (also when MINICOMPILER_TIME_REPORT is set)
+  --time-report-json FILE
+                  write the per-phase figures to FILE as JSON
+  --trace FILE    write every phase of every file to FILE in Chrome
+                  trace-event format (chrome://tracing, Perfetto)
+  -h, --help      print this help
+
+Subcommands:
+  run             check and execute a program (see `MiniCompiler run -h`)
+  serve, client   run or use a compile server (see `MiniCompiler serve -h`)
+)";
+
+// Which AST representation parser.txt is printed from.
+enum class AstLayout : uint8_t { Tree, Flat };
+
+struct DriverOptions {
+    vector<fs::path> inputs; // expanded: files only, in command-line order
+    size_t jobs = ThreadPool::default_thread_count();
+    fs::path out_dir;
+    bool write_outputs = true;
+    bool help = false;
+    LoadMode load_mode = LoadMode::Map;
+    string extension = ".mc";
+    AstLayout ast_layout = AstLayout::Tree;
+    bool emit_ast = false;
+    bool dump_bytecode = false;
+    bool check = true; // run semantic analysis after parsing
+    fs::path cache_dir; // empty: no on-disk cache
+    uintmax_t cache_max_bytes = DiskCache::default_max_bytes;
+    bool time_report = false;
+    fs::path time_report_json; // empty: none
+    fs::path trace_file;       // empty: none
+    // Relative inputs, response files and -o are resolved against this
+    // (the client's working directory in the compile server). Inputs keep
+    // their spelling for diagnostics and output names.
+    fs::path base_dir;
+};
+
+namespace detail {
+
+inline vector<string> read_response_file(fs::path const& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        throw runtime_error("Failed to open response file " + path.string());
+    }
+    vector<string> words;
+    string word;
+    bool in_word = false;
+    bool quoted = false;
+    char c = '\0';
+    while (file.get(c)) {
+        if (c == '"') {
+            quoted = !quoted;
+            in_word = true;
+        } else if (!quoted && has_char_class(c, char_class::space)) {
+            if (in_word) {
+                words.push_back(std::move(word));
+                word.clear();
+                in_word = false;
+            }
+        } else {
+            word += c;
+            in_word = true;
+        }
+    }
+    if (in_word) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+// Expands @response-files in place; they may nest.
+inline void expand_response_files(
+    vector<string> const& args,
+    vector<string>& out,
+    fs::path const& base_dir,
+    int depth = 0) {
+    if (depth > 16) {
+        throw runtime_error("Response files nested too deeply");
+    }
+    for (auto const& arg : args) {
+        if (arg.size() > 1 && arg.front() == '@') {
+            expand_response_files(
+                read_response_file(base_dir / arg.substr(1)),
+                out,
+                base_dir,
+                depth + 1);
+        } else {
+            out.push_back(arg);
+        }
+    }
+}
+
+inline void add_input(DriverOptions& options, fs::path const& path) {
+    fs::path const resolved = options.base_dir / path;
+    if (!fs::is_directory(resolved)) {
+        options.inputs.push_back(path);
+        return;
+    }
+    vector<fs::path> found;
+    for (auto const& entry : fs::recursive_directory_iterator(resolved)) {
+        if (entry.is_regular_file() &&
+            entry.path().extension() == options.extension) {
+            found.push_back(path / entry.path().lexically_relative(resolved));
+        }
+    }
+    std::ranges::sort(found); // deterministic order across file systems
+    options.inputs.insert(options.inputs.end(), found.begin(), found.end());
+}
+
+// "512", "64K", "100M", "2G" (binary multiples).
+inline uintmax_t parse_size(string const& text) {
+    size_t end = 0;
+    uintmax_t value = 0;
+    try {
+        value = std::stoull(text, &end);
+    } catch (std::exception const&) {
+        throw runtime_error("Invalid size: " + text);
+    }
+    string_view const suffix = string_view(text).substr(end);
+    int shift = 0;
+    if (suffix == "K" || suffix == "k") {
+        shift = 10;
+    } else if (suffix == "M" || suffix == "m") {
+        shift = 20;
+    } else if (suffix == "G" || suffix == "g") {
+        shift = 30;
+    } else if (!suffix.empty()) {
+        throw runtime_error("Invalid size: " + text);
+    }
+    if (value > std::numeric_limits<uintmax_t>::max() >> shift) {
+        throw runtime_error("Invalid size: " + text);
+    }
+    return value << shift;
+}
+
+} // namespace detail
+
+inline DriverOptions parse_command_line(
+    vector<string> const& raw_args,
+    fs::path default_out_dir,
+    fs::path base_dir = {}) {
+    vector<string> args;
+    detail::expand_response_files(raw_args, args, base_dir);
+
+    DriverOptions options;
+    options.out_dir = std::move(default_out_dir);
+    options.base_dir = std::move(base_dir);
+    vector<fs::path> paths;
+    auto value_of = [&](size_t& i, string_view option) -> string const& {
+        if (i + 1 >= args.size()) {
+            throw runtime_error(format("Missing value for {}", option));
+        }
+        return args[++i];
+    };
+    for (size_t i = 0; i < args.size(); ++i) {
+        string const& arg = args[i];
+        if (arg == "-h" || arg == "--help") {
+            options.help = true;
+        } else if (arg == "-j" || (arg.starts_with("-j") && arg.size() > 2)) {
+            string const n = arg == "-j" ? value_of(i, "-j") : arg.substr(2);
+            try {
+                options.jobs = std::stoul(n);
+            } catch (std::exception const&) {
+                throw runtime_error("Invalid job count: " + n);
+            }
+            if (options.jobs == 0) {
+                throw runtime_error("Job count must be at least 1");
+            }
+        } else if (arg == "-o") {
+            options.out_dir = options.base_dir / value_of(i, "-o");
+        } else if (arg == "--no-output") {
+            options.write_outputs = false;
+        } else if (arg == "--no-mmap") {
+            options.load_mode = LoadMode::Read;
+        } else if (arg == "--ext") {
+            options.extension = value_of(i, "--ext");
+            if (!options.extension.starts_with('.')) {
+                options.extension.insert(0, 1, '.');
+            }
+        } else if (arg == "--flat-ast") {
+            options.ast_layout = AstLayout::Flat;
+        } else if (arg == "--emit-ast") {
+            options.emit_ast = true;
+        } else if (arg == "--dump-bytecode") {
+            options.dump_bytecode = true;
+        } else if (arg == "--no-check") {
+            options.check = false;
+        } else if (arg == "--cache-dir") {
+            options.cache_dir = options.base_dir / value_of(i, "--cache-dir");
+        } else if (arg == "--cache-max-size") {
+            options.cache_max_bytes =
+                detail::parse_size(value_of(i, "--cache-max-size"));
+        } else if (arg == "--time-report") {
+            options.time_report = true;
+        } else if (arg == "--time-report-json") {
+            options.time_report_json =
+                options.base_dir / value_of(i, "--time-report-json");
+        } else if (arg == "--trace") {
+            options.trace_file = options.base_dir / value_of(i, "--trace");
+        } else if (arg.starts_with('-') && arg != "-") {
+            throw runtime_error("Unknown option " + arg);
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+    // directories are expanded after all options, so --ext may come last
+    for (auto const& path : paths) {
+        detail::add_input(options, path);
+    }
+    return options;
+}
+
+// ==========================================
+// Compilation of one input
+// ==========================================
+
+struct OutputPaths {
+    fs::path lex;
+    fs::path parser;
+    fs::path bytecode; // empty: no bytecode dump
+    fs::path ast;      // empty: no binary AST
+
+    // The files written for an input that checks, in a fixed order.
+    vector<fs::path> files() const {
+        vector<fs::path> paths{lex, parser};
+        if (!bytecode.empty()) {
+            paths.push_back(bytecode);
+        }
+        if (!ast.empty()) {
+            paths.push_back(ast);
+        }
+        return paths;
+    }
+};
+
+// <out_dir>/<input path without root and ".." parts>.{lex,parser}.txt,
+// .bytecode.txt with `dump_bytecode` and .ast with `emit_ast`
+inline OutputPaths output_paths_for(
+    fs::path const& out_dir,
+    fs::path const& input,
+    bool emit_ast = false,
+    bool dump_bytecode = false) {
+    fs::path relative;
+    for (auto const& part : input.relative_path()) {
+        if (part != ".." && part != ".") {
+            relative /= part;
+        }
+    }
+    fs::path const stem = out_dir / relative;
+    return {
+        .lex = fs::path(stem) += ".lex.txt",
+        .parser = fs::path(stem) += ".parser.txt",
+        .bytecode =
+            dump_bytecode ? fs::path(stem) += ".bytecode.txt" : fs::path(),
+        .ast = emit_ast ? fs::path(stem) += ".ast" : fs::path()};
+}
+
+// One line per token: "{:>2}:{:>2}    {}" of line, column and the kind, or
+// of "{:>10}    ({})" of lexeme and kind for tokens with a lexeme.
+inline void write_lex_dump(TokenBuffer const& tokens, std::ostream& o) {
+    LineTable const lines(tokens.source());
+    OutputWriter out(o);
+    size_t line = 0;
+    for (auto const& token : tokens) {
+        SourcePosition const pos = lines.resolve_next(token.offset, line);
+        out.write_right(pos.lineno, 2);
+        out.put(':');
+        out.write_right(pos.colno, 2);
+        out.write("    ");
+        if (token.lexeme.empty()) {
+            out.write(to_string(token.kind));
+        } else {
+            out.write_right(token.lexeme, 10);
+            out << "    (" << to_string(token.kind) << ')';
+        }
+        out.put('\n');
+    }
+}
+
+namespace detail {
+
+// Directories are only created when the file cannot be opened, so repeated
+// compiles into an existing tree do not touch the file system for them.
+inline std::ofstream open_output(fs::path const& path) {
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    if (out) {
+        return out;
+    }
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    // a concurrent compile may have created it first
+    if (ec && !fs::is_directory(path.parent_path())) {
+        throw runtime_error(
+            format("Failed to create {}: {}", path.string(), ec.message()));
+    }
+    out.open(path, std::ios::out | std::ios::binary);
+    if (!out) {
+        throw runtime_error("Failed to open output file " + path.string());
+    }
+    return out;
+}
+
+} // namespace detail
+
+// Sources at least this large are lexed and parsed with tokenize_parallel()
+// and parse_parallel() when a pool is available.
+inline constexpr size_t parallel_parse_min_bytes = size_t{1} << 20;
+
+// Lexes, parses and (with `check`) analyzes `source`. With `outputs` the
+// lex.txt and parser.txt dumps (and the bytecode.txt dump and the .ast file
+// if their paths are set) are written; without, tokens are streamed into
+// the parser and never materialized. Large sources are processed on `pool`
+// if one is given.
+// Names are interned into an interner of this compilation, so a batch or a
+// server does not keep every name it ever compiled.
+// Returns the number of top-level statements; throws SemanticError after
+// writing the dumps if the program does not check.
+inline size_t compile_source(
+    string_view source,
+    OutputPaths const* outputs = nullptr,
+    AstLayout layout = AstLayout::Tree,
+    ThreadPool* pool = nullptr,
+    bool check = true) {
+    bool const parallel =
+        pool != nullptr && source.size() >= parallel_parse_min_bytes;
+    Interner interner(predefined_spellings);
+    auto tokenize = [&] {
+        return parallel ? tokenize_parallel(source, *pool, interner)
+                        : Lexer(source, interner).tokenize();
+    };
+    auto parse = [&](TokenBuffer const& tokens) {
+        return parallel ? parse_parallel(tokens, *pool)
+                        : Parser(tokens).parse();
+    };
+    auto lex_phase = [&] {
+        PROFILE_SCOPE(scope, "lex");
+        auto tokens = tokenize();
+        scope.set_work(source.size(), tokens.size(), "tokens");
+        return tokens;
+    };
+    auto parse_phase = [&](TokenBuffer const& tokens) {
+        PROFILE_SCOPE(scope, "parse");
+        Program prog = parse(tokens);
+        scope.set_work(source.size(), prog.arena->node_count(), "nodes");
+        return prog;
+    };
+    auto check_phase = [&](Program const& prog) {
+        CheckResult result;
+        if (check) {
+            PROFILE_SCOPE(scope, "check");
+            result = check_program(prog, source, interner);
+            scope.set_work(source.size(), prog.arena->node_count(), "nodes");
+        }
+        return result;
+    };
+    auto checked = [&](CheckResult const& result, Program const& prog) {
+        if (!result.ok()) {
+            throw SemanticError(result, source);
+        }
+        return prog.statements.size();
+    };
+    if (outputs == nullptr) {
+        if (parallel) {
+            Program const prog = parse_phase(lex_phase());
+            return checked(check_phase(prog), prog);
+        }
+        Program const prog = [&] {
+            // tokens are never materialized, so the phases are not separable
+            PROFILE_SCOPE(scope, "lex+parse");
+            StreamingParser parser(source, interner);
+            Program parsed = parser.parse();
+            scope.set_work(
+                source.size(), parsed.arena->node_count(), "nodes");
+            return parsed;
+        }();
+        return checked(check_phase(prog), prog);
+    }
+    std::ofstream out_lex_file = detail::open_output(outputs->lex);
+    auto const tokens = lex_phase();
+    {
+        PROFILE_SCOPE(scope, "lex dump");
+        write_lex_dump(tokens, out_lex_file);
+        scope.set_work(0, tokens.size(), "tokens");
+    }
+
+    Program const prog = parse_phase(tokens);
+    CheckResult const result = check_phase(prog);
+    std::optional<FlatAst> flat;
+    if (layout == AstLayout::Flat || !outputs->ast.empty()) {
+        PROFILE_SCOPE(scope, "flatten");
+        flat = flatten(prog, source);
+        scope.set_work(0, flat->nodes.size(), "nodes");
+    }
+    std::ofstream out_parser_file = detail::open_output(outputs->parser);
+    {
+        PROFILE_SCOPE(scope, "parser dump");
+        if (layout == AstLayout::Flat) {
+            flat_ast_debug_print(flat->view(), out_parser_file);
+        } else {
+            parser_debug_print(prog, out_parser_file);
+        }
+    }
+    if (!outputs->bytecode.empty() && result.ok()) {
+        BytecodeModule const module = [&] {
+            PROFILE_SCOPE(scope, "bytecode");
+            return compile_bytecode(prog, interner);
+        }();
+        PROFILE_SCOPE(scope, "bytecode dump");
+        std::ofstream out_bytecode_file =
+            detail::open_output(outputs->bytecode);
+        OutputWriter writer(out_bytecode_file);
+        disassemble(module, writer);
+    } else if (!outputs->bytecode.empty()) {
+        // no code for a program that does not check, nor the code of an
+        // earlier version of it
+        std::error_code ignored;
+        fs::remove(outputs->bytecode, ignored);
+    }
+    if (!outputs->ast.empty()) {
+        PROFILE_SCOPE(scope, "ast write");
+        std::ofstream out_ast_file = detail::open_output(outputs->ast);
+        write_ast_file(flat->view(), xxh64(source), out_ast_file);
+        if (!out_ast_file) {
+            throw runtime_error(
+                "Failed to write " + outputs->ast.string());
+        }
+    }
+    return checked(result, prog);
+}
+
+// ==========================================
+// Batch compilation
+// ==========================================
+
+struct BatchReport {
+    size_t files = 0;
+    size_t failed = 0;
+    size_t cached = 0; // served from the on-disk cache
+    size_t bytes = 0;
+    double seconds = 0;
+
+    void print(std::ostream& out) const {
+        double const secs = seconds > 0 ? seconds : 1e-9;
+        std::println(
+            out,
+            "Compiled {} files ({} failed{}), {:.2f} MB in {:.3f} s: "
+            "{:.1f} files/s, {:.2f} MB/s",
+            files,
+            failed,
+            cached > 0 ? format(", {} cached", cached) : "",
+            static_cast<double>(bytes) / 1e6,
+            seconds,
+            static_cast<double>(files) / secs,
+            static_cast<double>(bytes) / 1e6 / secs);
+    }
+};
+
+// Results of earlier compiles, kept by the compile server: a file whose
+// size and modification time are unchanged and whose outputs (if any) still
+// exist is not compiled again under the same options.
+class ResultCache {
+  public:
+    struct Stamp {
+        fs::file_time_type mtime;
+        uintmax_t size = 0;
+    };
+
+    static std::optional<Stamp> stamp_of(fs::path const& file) {
+        std::error_code ec;
+        auto const mtime = fs::last_write_time(file, ec);
+        if (ec) {
+            return std::nullopt;
+        }
+        uintmax_t const size = fs::file_size(file, ec);
+        if (ec) {
+            return std::nullopt;
+        }
+        return Stamp{.mtime = mtime, .size = size};
+    }
+
+    // Whether `file` compiled cleanly under `options_key` at `stamp`.
+    bool fresh(
+        fs::path const& file,
+        string_view options_key,
+        Stamp const& stamp,
+        OutputPaths const* outputs) const {
+        {
+            std::scoped_lock const lock(mutex);
+            auto const it = entries.find(key_of(file, options_key));
+            if (it == entries.end() || it->second.mtime != stamp.mtime ||
+                it->second.size != stamp.size) {
+                return false;
+            }
+        }
+        return outputs == nullptr ||
+               std::ranges::all_of(outputs->files(), [](fs::path const& p) {
+                   return fs::exists(p);
+               });
+    }
+
+    void store(
+        fs::path const& file, string_view options_key, Stamp const& stamp) {
+        std::scoped_lock const lock(mutex);
+        entries.insert_or_assign(key_of(file, options_key), stamp);
+    }
+
+  private:
+    mutable std::mutex mutex;
+    std::unordered_map<string, Stamp> entries;
+
+    static string key_of(fs::path const& file, string_view options_key) {
+        std::error_code ec;
+        fs::path const absolute = fs::absolute(file, ec);
+        return format(
+            "{}\n{}", options_key, (ec ? file : absolute).generic_string());
+    }
+};
+
+// State a driver run may share with others (compile server) and where it
+// reports what it wrote.
+struct DriverContext {
+    ThreadPool* pool = nullptr;   // else run_batch makes one of jobs threads
+    ResultCache* cache = nullptr; // skip unchanged inputs
+    // Compiled instead of the sample program when there are no inputs; the
+    // dumps go to <out>/<source_name>.{lex,parser}.txt.
+    std::optional<string_view> source;
+    string source_name;
+    vector<fs::path>* written = nullptr; // receives the dump files written
+};
+
+// Compiles every input on a work-stealing pool of options.jobs threads.
+// Failures are reported to `diagnostics` as "<path>: error: <message>".
+inline BatchReport run_batch(
+    DriverOptions const& options,
+    std::ostream& diagnostics,
+    DriverContext const& context = {}) {
+    auto const start = std::chrono::steady_clock::now();
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> failed{0};
+    std::mutex diagnostics_mutex;
+    // the calling thread works too, so jobs - 1 pool threads; large files
+    // additionally parse their top-level items on the same pool
+    std::optional<ThreadPool> own_pool;
+    if (context.pool == nullptr && options.jobs > 1) {
+        own_pool.emplace(options.jobs - 1);
+    }
+    ThreadPool* const pool = own_pool ? &*own_pool : context.pool;
+    string const options_key = format(
+        "{}|{}|{}|{}|{}|{}",
+        options.write_outputs,
+        options.out_dir.generic_string(),
+        static_cast<int>(options.ast_layout),
+        options.emit_ast,
+        options.dump_bytecode,
+        options.check);
+    vector<char> compiled(options.inputs.size(), 0);
+    std::optional<DiskCache> disk_cache;
+    if (!options.cache_dir.empty() && options.write_outputs) {
+        disk_cache.emplace(options.cache_dir, options.cache_max_bytes);
+    }
+    std::atomic<size_t> cache_hits{0};
+
+    auto compile_one = [&](size_t i) {
+        fs::path const& input = options.inputs[i];
+        fs::path const file_path = options.base_dir / input;
+        PROFILE_SCOPE(compile_scope, "compile", input.string());
+        try {
+            std::optional<OutputPaths> outputs;
+            if (options.write_outputs) {
+                outputs = output_paths_for(
+                    options.out_dir,
+                    input,
+                    options.emit_ast,
+                    options.dump_bytecode);
+            }
+            OutputPaths const* const out = outputs ? &*outputs : nullptr;
+            std::optional<ResultCache::Stamp> stamp;
+            if (context.cache != nullptr) {
+                stamp = ResultCache::stamp_of(file_path);
+                if (stamp &&
+                    context.cache->fresh(file_path, options_key, *stamp, out)) {
+                    bytes.fetch_add(stamp->size, std::memory_order_relaxed);
+                    compiled[i] = 1;
+                    return;
+                }
+            }
+            SourceFile const file = [&] {
+                PROFILE_SCOPE(scope, "read");
+                SourceFile opened =
+                    SourceFile::open(file_path, options.load_mode);
+                scope.set_work(opened.text().size());
+                return opened;
+            }();
+            bytes.fetch_add(file.text().size(), std::memory_order_relaxed);
+            compile_scope.set_work(file.text().size(), 1, "files");
+            uint64_t key = 0;
+            vector<fs::path> dumps;
+            if (disk_cache) {
+                key = DiskCache::key_of(
+                    file.text(),
+                    format(
+                        "{}|{}|{}|{}",
+                        static_cast<int>(options.ast_layout),
+                        options.emit_ast,
+                        options.dump_bytecode,
+                        options.check));
+                dumps = out->files();
+            }
+            bool const hit = disk_cache && [&] {
+                PROFILE_SCOPE(scope, "cache fetch");
+                return disk_cache->fetch(key, dumps);
+            }();
+            if (hit) {
+                cache_hits.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                compile_source(
+                    file.text(),
+                    out,
+                    out != nullptr ? options.ast_layout : AstLayout::Tree,
+                    pool,
+                    options.check);
+                if (disk_cache) {
+                    PROFILE_SCOPE(scope, "cache store");
+                    disk_cache->store(key, dumps);
+                }
+            }
+            if (stamp) {
+                context.cache->store(file_path, options_key, *stamp);
+            }
+            compiled[i] = 1;
+        } catch (SemanticError const& e) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            std::scoped_lock const lock(diagnostics_mutex);
+            for (string const& message : e.messages(input.string())) {
+                std::println(diagnostics, "{}", message);
+            }
+        } catch (std::exception const& e) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            std::scoped_lock const lock(diagnostics_mutex);
+            std::println(
+                diagnostics, "{}: error: {}", input.string(), e.what());
+        }
+    };
+
+    if (pool != nullptr) {
+        pool->parallel_for(options.inputs.size(), compile_one);
+    } else {
+        for (size_t i = 0; i < options.inputs.size(); ++i) {
+            compile_one(i);
+        }
+    }
+    if (disk_cache && disk_cache->bytes_stored() > 0) {
+        disk_cache->trim();
+    }
+
+    if (context.written != nullptr && options.write_outputs) {
+        for (size_t i = 0; i < options.inputs.size(); ++i) {
+            if (!compiled[i]) {
+                continue;
+            }
+            OutputPaths const paths = output_paths_for(
+                options.out_dir,
+                options.inputs[i],
+                options.emit_ast,
+                options.dump_bytecode);
+            for (auto const& file : paths.files()) {
+                context.written->push_back(file);
+            }
+        }
+    }
+
+    std::chrono::duration<double> const elapsed =
+        std::chrono::steady_clock::now() - start;
+    return {
+        .files = options.inputs.size(),
+        .failed = failed.load(),
+        .cached = cache_hits.load(),
+        .bytes = bytes.load(),
+        .seconds = elapsed.count()};
+}
+
+namespace detail {
+
+inline bool time_report_from_environment() {
+    char const* const value = std::getenv("MINICOMPILER_TIME_REPORT");
+    return value != nullptr && *value != '\0' && string_view(value) != "0";
+}
+
+inline int compile_inputs(
+    DriverOptions const& options,
+    std::ostream& out,
+    std::ostream& err,
+    DriverContext const& context) {
+    if (!options.inputs.empty()) {
+        BatchReport const report = run_batch(options, err, context);
+        report.print(out);
+        return report.failed == 0 ? 0 : 1;
+    }
+
+    OutputPaths outputs{
+        .lex = options.out_dir / "lex.txt",
+        .parser = options.out_dir / "parser.txt",
+        .bytecode = options.dump_bytecode ? options.out_dir / "bytecode.txt"
+                                          : fs::path(),
+        .ast = options.emit_ast ? options.out_dir / "program.ast" : fs::path()};
+    if (context.source) {
+        outputs = output_paths_for(
+            options.out_dir,
+            context.source_name,
+            options.emit_ast,
+            options.dump_bytecode);
+    }
+    auto record_outputs = [&] {
+        if (context.written != nullptr && options.write_outputs) {
+            for (auto const& file : outputs.files()) {
+                context.written->push_back(file);
+            }
+        }
+    };
+    size_t statements = 0;
+    try {
+        statements = compile_source(
+            context.source.value_or(sample_program),
+            options.write_outputs ? &outputs : nullptr,
+            options.ast_layout,
+            context.pool,
+            options.check);
+    } catch (SemanticError const& e) {
+        // the dumps were written all the same, except bytecode.txt
+        outputs.bytecode.clear();
+        record_outputs();
+        string const name =
+            context.source ? context.source_name : string("<sample>");
+        for (string const& message : e.messages(name)) {
+            std::println(err, "{}", message);
+        }
+        return 1;
+    }
+    record_outputs();
+    out << "Parsed OK. Statements=" << statements << "\n";
+    return 0;
+}
+
+} // namespace detail
+
+// What `MiniCompiler [options] [inputs...]` does; returns the exit status.
+// Without inputs the context's source, or else the sample program, is
+// compiled.
+//
+// The profiler is process-wide: in the compile server, reports of requests
+// that overlap in time include each other's phases.
+inline int run_driver(
+    DriverOptions const& options,
+    std::ostream& out,
+    std::ostream& err,
+    DriverContext const& context = {}) {
+    if (options.help) {
+        out << usage_text;
+        return 0;
+    }
+    bool const table =
+        options.time_report || detail::time_report_from_environment();
+    if (!table && options.time_report_json.empty() &&
+        options.trace_file.empty()) {
+        return detail::compile_inputs(options, out, err, context);
+    }
+#if MINI_COMPILER_INSTRUMENTATION
+    profiler().enable();
+    int status = 0;
+    try {
+        PROFILE_SCOPE(scope, "total");
+        status = detail::compile_inputs(options, out, err, context);
+    } catch (...) {
+        profiler().disable();
+        throw;
+    }
+    profiler().disable();
+    if (table) {
+        profiler().print_table(err);
+    }
+    if (!options.time_report_json.empty()) {
+        profiler().write_json(options.time_report_json);
+    }
+    if (!options.trace_file.empty()) {
+        profiler().write_trace(options.trace_file);
+    }
+    return status;
+#else
+    std::println(
+        err,
+        "warning: built without MINI_COMPILER_INSTRUMENTATION; "
+        "no time report");
+    return detail::compile_inputs(options, out, err, context);
+#endif
+}
+
+// ==========================================
+// Running programs
+// ==========================================
+
+inline constexpr string_view run_usage_text =
+    R"(Usage: MiniCompiler run [options] FILE
+
+Checks FILE and executes it: its top-level statements in order, then
+main() if it declares one. print() writes to standard output. With FILE
+"-" the program is read from standard input.
+
+Options:
+  --engine E      what executes the program: "register" compiles it to
+                  type-specialized code for the register VM (default),
+                  "stack" to bytecode for the stack VM, "ast" walks the
+                  syntax tree
+  --time-report   print time and allocations per phase to stderr (also
+                  when MINICOMPILER_TIME_REPORT is set)
+  -h, --help      print this help
+)";
+
+enum class Engine : uint8_t { Ast, Stack, Register };
+
+namespace detail {
+
+// Parses, checks and runs one program; errors go to `err` prefixed with
+// `name`. Returns the exit status.
+inline int run_source(
+    string_view source,
+    string const& name,
+    Engine engine,
+    std::ostream& out,
+    std::ostream& err) {
+    try {
+        Interner interner(predefined_spellings);
+        Program const program = [&] {
+            PROFILE_SCOPE(scope, "lex+parse");
+            Program parsed = StreamingParser(source, interner).parse();
+            scope.set_work(
+                source.size(), parsed.arena->node_count(), "nodes");
+            return parsed;
+        }();
+        CheckResult const result = [&] {
+            PROFILE_SCOPE(scope, "check");
+            return check_program(program, source, interner);
+        }();
+        if (!result.ok()) {
+            for (string const& message :
+                 SemanticError(result, source).messages(name)) {
+                std::println(err, "{}", message);
+            }
+            return 1;
+        }
+        if (engine == Engine::Ast) {
+            PROFILE_SCOPE(scope, "run");
+            Interpreter(out, interner).run(program);
+            return 0;
+        }
+        if (engine == Engine::Register) {
+            RegisterModule const module = [&] {
+                PROFILE_SCOPE(scope, "bytecode");
+                return compile_register_code(program, interner);
+            }();
+            PROFILE_SCOPE(scope, "run");
+            RegisterVM(out).run(module);
+            return 0;
+        }
+        BytecodeModule const module = [&] {
+            PROFILE_SCOPE(scope, "bytecode");
+            return compile_bytecode(program, interner);
+        }();
+        PROFILE_SCOPE(scope, "run");
+        StackVM(out).run(module);
+    } catch (RuntimeError const& e) {
+        out.flush();
+        std::println(err, "{}: runtime error: {}", name, e.what());
+        return 1;
+    } catch (std::exception const& e) {
+        std::println(err, "{}: error: {}", name, e.what());
+        return 1;
+    }
+    return 0;
+}
+
+inline int run_file(
+    string const& path,
+    Engine engine,
+    std::istream& in,
+    std::ostream& out,
+    std::ostream& err) {
+    if (path == "-") {
+        string const source(
+            (std::istreambuf_iterator<char>(in)),
+            std::istreambuf_iterator<char>());
+        return run_source(source, "<stdin>", engine, out, err);
+    }
+    SourceFile const file = [&] {
+        PROFILE_SCOPE(scope, "read");
+        return SourceFile::open(path);
+    }();
+    return run_source(file.text(), path, engine, out, err);
+}
+
+} // namespace detail
+
+// `MiniCompiler run ...`; returns the exit status.
+inline int run_program(
+    vector<string> const& args,
+    std::istream& in,
+    std::ostream& out,
+    std::ostream& err) {
+    std::optional<string> path;
+    Engine engine = Engine::Register;
+    bool time_report = detail::time_report_from_environment();
+    for (size_t i = 0; i < args.size(); ++i) {
+        string const& arg = args[i];
+        if (arg == "-h" || arg == "--help") {
+            out << run_usage_text;
+            return 0;
+        }
+        if (arg == "--engine") {
+            if (i + 1 == args.size()) {
+                throw runtime_error("Missing value for --engine");
+            }
+            string const& value = args[++i];
+            if (value == "ast") {
+                engine = Engine::Ast;
+            } else if (value == "stack") {
+                engine = Engine::Stack;
+            } else if (value == "register") {
+                engine = Engine::Register;
+            } else {
+                throw runtime_error("Unknown engine " + value);
+            }
+        } else if (arg == "--time-report") {
+            time_report = true;
+        } else if (arg.starts_with('-') && arg != "-") {
+            throw runtime_error("Unknown run option " + arg);
+        } else if (path) {
+            throw runtime_error("run takes one program");
+        } else {
+            path = arg;
+        }
+    }
+    if (!path) {
+        throw runtime_error("run needs a program (see MiniCompiler run -h)");
+    }
+    if (!time_report) {
+        return detail::run_file(*path, engine, in, out, err);
+    }
+#if MINI_COMPILER_INSTRUMENTATION
+    profiler().enable();
+    int status = 0;
+    try {
+        PROFILE_SCOPE(scope, "total");
+        status = detail::run_file(*path, engine, in, out, err);
+    } catch (...) {
+        profiler().disable();
+        throw;
+    }
+    profiler().disable();
+    out.flush();
+    profiler().print_table(err);
+    return status;
+#else
+    std::println(
+        err,
+        "warning: built without MINI_COMPILER_INSTRUMENTATION; "
+        "no time report");
+    return detail::run_file(*path, engine, in, out, err);
+#endif
+}
+
+} // namespace mini_compiler
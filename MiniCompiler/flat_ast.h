@@ -0,0 +1,811 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// flat_ast.h
+
+#pragma once
+
+#include "lexer.h"
+#include "output_writer.h"
+#include "parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Flat AST
+// ==========================================
+//
+// Data-oriented alternative to the pointer AST: one contiguous array of
+// 16-byte nodes addressed by 32-bit indices, an `extra` array for
+// variable-length child lists and a string table. Nodes are stored in
+// post-order (children before parents), so a pass that only needs to see
+// every node can walk the array linearly.
+//
+// Node layout by kind (a, b, c are NodeId unless noted; "str" is a string
+// table index, "list" an index into `extra` where a count is followed by
+// that many words):
+//   Identifier    a = str
+//   Literal       tag = BuiltInType, a = str (value)
+//   Call          a = str (callee), b = list of args
+//   Binary        tag = op, a = lhs, b = rhs
+//   Prefix        tag = op, a = operand
+//   Postfix       tag = op, a = operand
+//   Return        a = value | no_node
+//   Assign        a = lhs, b = rhs
+//   Block         a = list of statements, b = final expr | no_node
+//   If            a = condition, b = then Block, c = else | no_node
+//   While         a = condition, b = body Block
+//   Break         a = str (keyword)
+//   Continue      a = str (keyword)
+//   For           a = str (loop variable), b = iterable, c = body Block
+//   ExprStmt      a = expr
+//   VarDecl       tag = type code, a = str (name), b = str (type name),
+//                 c = init | no_node
+//   FunctionDecl  tag = return type code, a = str (name), c = body Block,
+//                 b = list: [n, return type name str,
+//                            n x (param name str, type name str, type code)]
+// A type code is 0 for a named type and 1 + BuiltInType for a built-in one.
+//
+// When flattened together with its source, `offsets` holds for every node
+// the source offset of its name, keyword or literal text (Identifier,
+// Literal, Call, Break, Continue, VarDecl, FunctionDecl, For) and no_offset
+// for the other kinds.
+
+enum class FlatKind : uint8_t {
+    Identifier,
+    Literal,
+    Call,
+    Binary,
+    Prefix,
+    Postfix,
+    Return,
+    Assign,
+    Block,
+    If,
+    While,
+    Break,
+    Continue,
+    For,
+    ExprStmt,
+    VarDecl,
+    FunctionDecl
+};
+
+using NodeId = uint32_t;
+
+inline constexpr NodeId no_node = ~NodeId{0};
+inline constexpr uint32_t no_offset = ~uint32_t{0};
+
+struct FlatNode {
+    FlatKind kind;
+    uint8_t tag = 0;
+    uint16_t reserved = 0;
+    uint32_t a = no_node;
+    uint32_t b = no_node;
+    uint32_t c = no_node;
+};
+
+static_assert(sizeof(FlatNode) == 16);
+
+struct StrRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+constexpr uint8_t type_code(Type const& type) {
+    if (!type.built_in_type) {
+        return 0;
+    }
+    return static_cast<uint8_t>(static_cast<uint8_t>(*type.built_in_type) + 1);
+}
+
+constexpr optional<BuiltInType> built_in_of(uint8_t code) {
+    if (code == 0) {
+        return std::nullopt;
+    }
+    return static_cast<BuiltInType>(code - 1);
+}
+
+// Read-only view over flat AST storage. Holds no memory of its own, so it can
+// sit on top of FlatAst's vectors or on top of a mapped file.
+class FlatAstView {
+  public:
+    FlatAstView() = default;
+
+    FlatAstView(
+        std::span<FlatNode const> nodes,
+        std::span<uint32_t const> extra,
+        std::span<StrRef const> strings,
+        string_view chars,
+        uint32_t root_list,
+        std::span<uint32_t const> offsets = {})
+        : node_span(nodes), extra_span(extra), string_span(strings),
+          offset_span(offsets), chars(chars), root_list(root_list) {}
+
+    std::span<FlatNode const> nodes() const { return node_span; }
+
+    FlatNode const& node(NodeId id) const { return node_span[id]; }
+
+    string_view str(uint32_t id) const {
+        StrRef const ref = string_span[id];
+        return chars.substr(ref.offset, ref.length);
+    }
+
+    // The count-prefixed list starting at extra[index], without the count.
+    std::span<uint32_t const> list(uint32_t index) const {
+        return extra_span.subspan(index + 1, extra_span[index]);
+    }
+
+    uint32_t extra_at(uint32_t index) const { return extra_span[index]; }
+
+    // Top-level statements of the program.
+    std::span<uint32_t const> roots() const { return list(root_list); }
+
+    // Source offset of the node's name, keyword or literal text, or
+    // no_offset.
+    uint32_t offset(NodeId id) const {
+        return offset_span.empty() ? no_offset : offset_span[id];
+    }
+
+    // The raw storage, for serialization.
+    std::span<uint32_t const> extra() const { return extra_span; }
+    std::span<StrRef const> strings() const { return string_span; }
+    std::span<uint32_t const> offsets() const { return offset_span; }
+    string_view string_chars() const { return chars; }
+    uint32_t root_list_index() const { return root_list; }
+
+  private:
+    std::span<FlatNode const> node_span;
+    std::span<uint32_t const> extra_span;
+    std::span<StrRef const> string_span;
+    std::span<uint32_t const> offset_span;
+    string_view chars;
+    uint32_t root_list = 0;
+};
+
+// Owning flat AST; build one with flatten().
+struct FlatAst {
+    vector<FlatNode> nodes;
+    vector<uint32_t> extra;
+    vector<StrRef> strings;
+    string chars; // string table bytes, deduplicated
+    uint32_t root_list = 0;
+    vector<uint32_t> offsets; // per node; empty if flattened without source
+
+    FlatAstView view() const {
+        return {nodes, extra, strings, chars, root_list, offsets};
+    }
+};
+
+namespace detail {
+
+// Flattens without recursion: a stack of tasks visits the pointer tree in
+// post-order, and a node is pushed once the ids of its children are on the
+// result stack. Nodes, strings and lists come out in the same order as
+// from a recursive walk.
+class Flattener {
+  public:
+    explicit Flattener(string_view source = {}) : source(source) {}
+
+    FlatAst flatten(Program const& program) {
+        for (auto const& stmt : program.statements) {
+            add(stmt);
+        }
+        ast.root_list = add_list(results);
+        return std::move(ast);
+    }
+
+  private:
+    using Item = std::variant<Stmt const*, Expr const*, BlockExpr const*>;
+
+    struct Task {
+        Item item;
+        bool expanded; // its children have been scheduled
+    };
+
+    FlatAst ast;
+    std::unordered_map<string_view, uint32_t> string_ids;
+    string_view source;
+    vector<Task> tasks;
+    vector<NodeId> results; // ids of finished nodes not yet taken by a parent
+
+    uint32_t intern(string_view s) {
+        auto const next = static_cast<uint32_t>(ast.strings.size());
+        auto [it, inserted] = string_ids.try_emplace(s, next);
+        if (inserted) {
+            ast.strings.push_back(
+                {static_cast<uint32_t>(ast.chars.size()),
+                 static_cast<uint32_t>(s.size())});
+            ast.chars += s;
+        }
+        return it->second;
+    }
+
+    uint32_t add_list(std::span<uint32_t const> items) {
+        auto const index = static_cast<uint32_t>(ast.extra.size());
+        ast.extra.push_back(static_cast<uint32_t>(items.size()));
+        ast.extra.insert(ast.extra.end(), items.begin(), items.end());
+        return index;
+    }
+
+    // `text` is the name or literal the node was parsed from, if any.
+    NodeId push(FlatNode node, string_view text = {}) {
+        ast.nodes.push_back(node);
+        if (!source.empty()) {
+            ast.offsets.push_back(offset_of(text));
+        }
+        return static_cast<NodeId>(ast.nodes.size() - 1);
+    }
+
+    uint32_t offset_of(string_view text) const {
+        auto const begin = reinterpret_cast<uintptr_t>(source.data());
+        auto const at = reinterpret_cast<uintptr_t>(text.data());
+        if (text.data() == nullptr || at < begin ||
+            at + text.size() > begin + source.size()) {
+            return no_offset;
+        }
+        return static_cast<uint32_t>(at - begin);
+    }
+
+    // Flattens the subtree of `root`, leaving its id on `results`.
+    void add(Item root) {
+        size_t const base = tasks.size();
+        tasks.push_back({root, false});
+        while (tasks.size() > base) {
+            Task const task = tasks.back();
+            tasks.pop_back();
+            if (task.expanded) {
+                results.push_back(std::visit(
+                    [this](auto const* item) { return finish(*item); },
+                    task.item));
+            } else {
+                tasks.push_back({task.item, true});
+                std::visit(
+                    [this](auto const* item) { expand(*item); }, task.item);
+            }
+        }
+    }
+
+    // ------------------------------------------
+    // Scheduling children. The stack runs last in, first out, so children
+    // are scheduled last first and finish in source order.
+    // ------------------------------------------
+
+    void schedule(Item item) { tasks.push_back({item, false}); }
+
+    void schedule(Expr const* expr) { schedule(Item(expr)); }
+
+    void schedule(optional<ExprPtr> const& expr) {
+        if (expr) {
+            schedule(*expr);
+        }
+    }
+
+    void expand(Stmt const& stmt) {
+        std::visit([this](auto const& node) { expand(node); }, stmt.node);
+    }
+
+    void expand(Expr const& expr) {
+        std::visit([this](auto const& node) { expand(node); }, expr.node);
+    }
+
+    void expand(ExprStmt const& node) { schedule(node.expr); }
+
+    void expand(VarDecl const& node) { schedule(node.init); }
+
+    void expand(FunctionDecl const& node) { schedule(&node.body); }
+
+    void expand(Identifier const&) {}
+
+    void expand(LiteralExpr const&) {}
+
+    void expand(CallExpr const& node) {
+        for (auto it = node.args.rbegin(); it != node.args.rend(); ++it) {
+            schedule(*it);
+        }
+    }
+
+    void expand(BinaryExpr const& node) {
+        schedule(node.rhs);
+        schedule(node.lhs);
+    }
+
+    void expand(PrefixExpr const& node) { schedule(node.operand); }
+
+    void expand(PostfixExpr const& node) { schedule(node.operand); }
+
+    void expand(ReturnExpr const& node) { schedule(node.value); }
+
+    void expand(AssignExpr const& node) {
+        schedule(node.rhs);
+        schedule(node.lhs);
+    }
+
+    void expand(BlockExpr const& node) {
+        schedule(node.final_expr);
+        for (auto it = node.statements.rbegin(); it != node.statements.rend();
+             ++it) {
+            schedule(*it);
+        }
+    }
+
+    void expand(IfExpr const& node) {
+        schedule(node.else_expr);
+        schedule(&node.then_block);
+        schedule(node.condition);
+    }
+
+    void expand(WhileExpr const& node) {
+        schedule(&node.body);
+        schedule(node.condition);
+    }
+
+    void expand(BreakExpr const&) {}
+
+    void expand(ContinueExpr const&) {}
+
+    void expand(ForExpr const& node) {
+        schedule(&node.body);
+        schedule(node.iter_expr);
+    }
+
+    // ------------------------------------------
+    // Finishing a node whose children are done. Their ids are taken off
+    // `results` last first.
+    // ------------------------------------------
+
+    NodeId take() {
+        NodeId const id = results.back();
+        results.pop_back();
+        return id;
+    }
+
+    NodeId take(optional<ExprPtr> const& expr) {
+        return expr ? take() : no_node;
+    }
+
+    // The ids of the last `count` children, as a list in `extra`.
+    uint32_t take_list(size_t count) {
+        auto const first = results.end() - static_cast<std::ptrdiff_t>(count);
+        uint32_t const list = add_list({first, results.end()});
+        results.erase(first, results.end());
+        return list;
+    }
+
+    NodeId finish(Stmt const& stmt) {
+        return std::visit(
+            [this](auto const& node) { return finish(node); }, stmt.node);
+    }
+
+    NodeId finish(Expr const& expr) {
+        return std::visit(
+            [this](auto const& node) { return finish(node); }, expr.node);
+    }
+
+    NodeId finish(ExprStmt const&) {
+        return push({.kind = FlatKind::ExprStmt, .a = take()});
+    }
+
+    NodeId finish(VarDecl const& node) {
+        NodeId const init = take(node.init);
+        return push(
+            {.kind = FlatKind::VarDecl,
+             .tag = type_code(node.type),
+             .a = intern(node.name.name),
+             .b = intern(node.type.name.name),
+             .c = init},
+            node.name.name);
+    }
+
+    NodeId finish(FunctionDecl const& node) {
+        NodeId const body = take();
+        vector<uint32_t> params;
+        params.reserve(1 + node.params.size() * 3);
+        params.push_back(intern(node.return_type.name.name));
+        for (auto const& param : node.params) {
+            params.push_back(intern(param.name.name));
+            params.push_back(intern(param.type.name.name));
+            params.push_back(type_code(param.type));
+        }
+        // the list count is the parameter count, not the word count
+        auto const list = static_cast<uint32_t>(ast.extra.size());
+        ast.extra.push_back(static_cast<uint32_t>(node.params.size()));
+        ast.extra.insert(ast.extra.end(), params.begin(), params.end());
+        return push(
+            {.kind = FlatKind::FunctionDecl,
+             .tag = type_code(node.return_type),
+             .a = intern(node.name.name),
+             .b = list,
+             .c = body},
+            node.name.name);
+    }
+
+    NodeId finish(Identifier const& node) {
+        return push(
+            {.kind = FlatKind::Identifier, .a = intern(node.name)}, node.name);
+    }
+
+    NodeId finish(LiteralExpr const& node) {
+        return push(
+            {.kind = FlatKind::Literal,
+             .tag = static_cast<uint8_t>(node.type),
+             .a = intern(node.value)},
+            node.value);
+    }
+
+    NodeId finish(CallExpr const& node) {
+        uint32_t const args = take_list(node.args.size());
+        return push(
+            {.kind = FlatKind::Call,
+             .a = intern(node.callee.name),
+             .b = args},
+            node.callee.name);
+    }
+
+    NodeId finish(BinaryExpr const& node) {
+        NodeId const rhs = take();
+        NodeId const lhs = take();
+        return push(
+            {.kind = FlatKind::Binary,
+             .tag = static_cast<uint8_t>(node.op),
+             .a = lhs,
+             .b = rhs});
+    }
+
+    NodeId finish(PrefixExpr const& node) {
+        return push(
+            {.kind = FlatKind::Prefix,
+             .tag = static_cast<uint8_t>(node.op),
+             .a = take()});
+    }
+
+    NodeId finish(PostfixExpr const& node) {
+        return push(
+            {.kind = FlatKind::Postfix,
+             .tag = static_cast<uint8_t>(node.op),
+             .a = take()});
+    }
+
+    NodeId finish(ReturnExpr const& node) {
+        return push({.kind = FlatKind::Return, .a = take(node.value)});
+    }
+
+    NodeId finish(AssignExpr const&) {
+        NodeId const rhs = take();
+        NodeId const lhs = take();
+        return push({.kind = FlatKind::Assign, .a = lhs, .b = rhs});
+    }
+
+    NodeId finish(BlockExpr const& node) {
+        NodeId const final_expr = take(node.final_expr);
+        uint32_t const stmts = take_list(node.statements.size());
+        return push(
+            {.kind = FlatKind::Block, .a = stmts, .b = final_expr});
+    }
+
+    NodeId finish(IfExpr const& node) {
+        NodeId const else_expr = take(node.else_expr);
+        NodeId const then_block = take();
+        NodeId const condition = take();
+        return push(
+            {.kind = FlatKind::If,
+             .a = condition,
+             .b = then_block,
+             .c = else_expr});
+    }
+
+    NodeId finish(WhileExpr const&) {
+        NodeId const body = take();
+        NodeId const condition = take();
+        return push({.kind = FlatKind::While, .a = condition, .b = body});
+    }
+
+    NodeId finish(BreakExpr const& node) {
+        return push(
+            {.kind = FlatKind::Break, .a = intern(node.keyword)},
+            node.keyword);
+    }
+
+    NodeId finish(ContinueExpr const& node) {
+        return push(
+            {.kind = FlatKind::Continue, .a = intern(node.keyword)},
+            node.keyword);
+    }
+
+    NodeId finish(ForExpr const& node) {
+        NodeId const body = take();
+        NodeId const iter = take();
+        return push(
+            {.kind = FlatKind::For,
+             .a = intern(node.loop_var.name),
+             .b = iter,
+             .c = body},
+            node.loop_var.name);
+    }
+};
+
+} // namespace detail
+
+// With `source` (the text `program` was parsed from) node offsets are
+// recorded too.
+inline FlatAst flatten(Program const& program, string_view source = {}) {
+    return detail::Flattener{source}.flatten(program);
+}
+
+// ==========================================
+// Flat AST printer
+// ==========================================
+
+// Prints a flat AST in exactly the format of ParseTreePrinter.
+class FlatTreePrinter {
+  public:
+    FlatTreePrinter(FlatAstView ast, std::ostream& o) : ast(ast), out(o) {}
+
+    void print_program() {
+        out << "Program\n";
+        indent();
+        for (NodeId const stmt : ast.roots()) {
+            print(stmt);
+        }
+        dedent();
+    }
+
+    // Prints the subtree of `root` without recursion: what a node prints
+    // after one of its children is pushed on a stack of steps, which runs
+    // until the subtree is done.
+    void print(NodeId root) {
+        size_t const base = steps.size();
+        steps.push_back(child(root));
+        while (steps.size() > base) {
+            Step const step = steps.back();
+            steps.pop_back();
+            switch (step.kind) {
+            case Step::Kind::Node:
+                print_node(ast.node(step.node));
+                break;
+            case Step::Kind::Text:
+                out << step.text;
+                break;
+            case Step::Kind::Margin:
+                print_indent();
+                break;
+            case Step::Kind::Dedent:
+                dedent();
+                break;
+            }
+        }
+    }
+
+  private:
+    struct Step {
+        enum class Kind : uint8_t { Node, Text, Margin, Dedent };
+        Kind kind;
+        NodeId node = no_node;
+        string_view text;
+    };
+
+    static Step child(NodeId id) {
+        return {.kind = Step::Kind::Node, .node = id};
+    }
+
+    static Step text(string_view s) {
+        return {.kind = Step::Kind::Text, .text = s};
+    }
+
+    static Step margin() { return {.kind = Step::Kind::Margin}; }
+
+    static Step outdent() { return {.kind = Step::Kind::Dedent}; }
+
+    // Runs `later` in order once the current step is done.
+    void then(std::initializer_list<Step> later) {
+        steps.insert(steps.end(), std::rbegin(later), std::rend(later));
+    }
+
+    // Writes what precedes the node's first child and schedules the rest.
+    void print_node(FlatNode const& n) {
+        switch (n.kind) {
+        case FlatKind::ExprStmt:
+            print_indent();
+            out << "ExprStmt ";
+            then({child(n.a), text("\n")});
+            break;
+        case FlatKind::VarDecl:
+            print_indent();
+            out << "VarDecl " << ast.str(n.a) << ": " << type_name(n.tag, n.b);
+            if (n.c != no_node) {
+                out << " = ";
+                then({child(n.c), text("\n")});
+            } else {
+                out << "\n";
+            }
+            break;
+        case FlatKind::FunctionDecl:
+            print_function(n);
+            break;
+        case FlatKind::Return:
+            out << "return";
+            if (n.a != no_node) {
+                out << " ";
+                then({child(n.a)});
+            } else {
+                out << " (void)";
+            }
+            break;
+        case FlatKind::If:
+            out << "if ";
+            if (n.c != no_node) {
+                then(
+                    {child(n.a),
+                     text(" "),
+                     child(n.b),
+                     text(" else "),
+                     child(n.c)});
+            } else {
+                then({child(n.a), text(" "), child(n.b)});
+            }
+            break;
+        case FlatKind::While:
+            out << "while ";
+            then({child(n.a), text(" "), child(n.b)});
+            break;
+        case FlatKind::Break:
+            out << "break";
+            break;
+        case FlatKind::Continue:
+            out << "continue";
+            break;
+        case FlatKind::For:
+            out << "for " << ast.str(n.a) << " in ";
+            then({child(n.b), text(" "), child(n.c)});
+            break;
+        case FlatKind::Assign:
+            then({child(n.a), text(" = "), child(n.b)});
+            break;
+        case FlatKind::Block:
+            print_block(n);
+            break;
+        case FlatKind::Identifier:
+            out << ast.str(n.a);
+            break;
+        case FlatKind::Literal:
+            print_literal(n);
+            break;
+        case FlatKind::Call: {
+            out << ast.str(n.a) << " (";
+            // scheduled last first: " )", then each argument from the end
+            steps.push_back(text(" )"));
+            auto const args = ast.list(n.b);
+            for (size_t i = args.size(); i-- > 0;) {
+                steps.push_back(child(args[i]));
+                steps.push_back(text(" "));
+                if (i > 0) {
+                    steps.push_back(text(", "));
+                }
+            }
+            break;
+        }
+        case FlatKind::Prefix:
+            out << "(" << to_string(static_cast<TokenKind>(n.tag));
+            then({child(n.a), text(")")});
+            break;
+        case FlatKind::Binary:
+            out << "(";
+            then(
+                {child(n.a),
+                 text(" "),
+                 text(to_string(static_cast<TokenKind>(n.tag))),
+                 text(" "),
+                 child(n.b),
+                 text(")")});
+            break;
+        case FlatKind::Postfix:
+            out << "(";
+            then(
+                {child(n.a),
+                 text(to_string(static_cast<TokenKind>(n.tag))),
+                 text(")")});
+            break;
+        }
+    }
+
+    FlatAstView ast;
+    OutputWriter out; // flushed when the printer is destroyed
+    int level = 0;
+    vector<Step> steps;
+
+    void indent() { level++; }
+
+    void dedent() { level--; }
+
+    void print_indent() { out.spaces(static_cast<size_t>(level) * 2); }
+
+    string_view type_name(uint8_t code, uint32_t name) const {
+        if (auto const built_in = built_in_of(code)) {
+            return to_string(*built_in);
+        }
+        return ast.str(name);
+    }
+
+    void print_function(FlatNode const& n) {
+        uint32_t const list = n.b;
+        uint32_t const param_count = ast.extra_at(list);
+        print_indent();
+        out << "FunctionDecl " << ast.str(n.a) << " -> "
+            << type_name(n.tag, ast.extra_at(list + 1)) << "\n";
+        indent();
+        print_indent();
+        out << "Params:\n";
+        indent();
+        for (uint32_t i = 0; i < param_count; ++i) {
+            uint32_t const param = list + 2 + i * 3;
+            print_indent();
+            out << "Param " << ast.str(ast.extra_at(param)) << ": "
+                << type_name(
+                       static_cast<uint8_t>(ast.extra_at(param + 2)),
+                       ast.extra_at(param + 1))
+                << "\n";
+        }
+        dedent();
+        print_indent();
+        out << "Body:\n";
+        then({child(n.c), outdent()});
+    }
+
+    void print_block(FlatNode const& n) {
+        out << "{\n";
+        indent();
+        then({outdent(), margin(), text("}")});
+        if (n.b != no_node) {
+            then({margin(), text("final: "), child(n.b), text("\n")});
+        }
+        auto const stmts = ast.list(n.a);
+        for (auto it = stmts.rbegin(); it != stmts.rend(); ++it) {
+            steps.push_back(child(*it));
+        }
+    }
+
+    void print_literal(FlatNode const& n) {
+        string_view const value = ast.str(n.a);
+        switch (static_cast<BuiltInType>(n.tag)) {
+        case BuiltInType::Int:
+            out << value << "d";
+            break;
+        case BuiltInType::Float:
+            out << value << "f";
+            break;
+        case BuiltInType::Bool:
+            out << value;
+            break;
+        case BuiltInType::Char:
+            out << "'" << value << "'";
+            break;
+        case BuiltInType::String:
+            out << '"' << value << '"';
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+inline auto flat_ast_debug_print(FlatAstView ast, std::ostream& o) -> void {
+    FlatTreePrinter{ast, o}.print_program();
+}
+
+} // namespace mini_compiler
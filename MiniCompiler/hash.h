@@ -0,0 +1,102 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// hash.h
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace mini_compiler {
+
+using std::string_view;
+
+// ==========================================
+// XXH64
+// ==========================================
+//
+// The 64-bit xxHash of Yann Collet: a non-cryptographic hash running at
+// memory speed, used for content-addressed cache keys. Matches the reference
+// implementation (XXH64("", 0) == 0xEF46DB3751D8E999).
+
+namespace detail {
+
+inline constexpr uint64_t xxh_prime1 = 0x9E3779B185EBCA87ULL;
+inline constexpr uint64_t xxh_prime2 = 0xC2B2AE3D27D4EB4FULL;
+inline constexpr uint64_t xxh_prime3 = 0x165667B19E3779F9ULL;
+inline constexpr uint64_t xxh_prime4 = 0x85EBCA77C2B2AE63ULL;
+inline constexpr uint64_t xxh_prime5 = 0x27D4EB2F165667C5ULL;
+
+template <typename T> T read_le(char const* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) {
+        v = std::byteswap(v);
+    }
+    return v;
+}
+
+inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * xxh_prime2;
+    return std::rotl(acc, 31) * xxh_prime1;
+}
+
+inline uint64_t xxh64_merge(uint64_t acc, uint64_t v) {
+    acc ^= xxh64_round(0, v);
+    return acc * xxh_prime1 + xxh_prime4;
+}
+
+} // namespace detail
+
+inline uint64_t xxh64(string_view data, uint64_t seed = 0) {
+    using namespace detail;
+    char const* p = data.data();
+    char const* const end = p + data.size();
+    uint64_t h = 0;
+    if (data.size() >= 32) {
+        uint64_t v1 = seed + xxh_prime1 + xxh_prime2;
+        uint64_t v2 = seed + xxh_prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - xxh_prime1;
+        for (; end - p >= 32; p += 32) {
+            v1 = xxh64_round(v1, read_le<uint64_t>(p));
+            v2 = xxh64_round(v2, read_le<uint64_t>(p + 8));
+            v3 = xxh64_round(v3, read_le<uint64_t>(p + 16));
+            v4 = xxh64_round(v4, read_le<uint64_t>(p + 24));
+        }
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+            std::rotl(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    } else {
+        h = seed + xxh_prime5;
+    }
+    h += data.size();
+
+    for (; end - p >= 8; p += 8) {
+        h ^= xxh64_round(0, read_le<uint64_t>(p));
+        h = std::rotl(h, 27) * xxh_prime1 + xxh_prime4;
+    }
+    if (end - p >= 4) {
+        h ^= uint64_t{read_le<uint32_t>(p)} * xxh_prime1;
+        h = std::rotl(h, 23) * xxh_prime2 + xxh_prime3;
+        p += 4;
+    }
+    for (; p != end; ++p) {
+        h ^= uint64_t{static_cast<unsigned char>(*p)} * xxh_prime5;
+        h = std::rotl(h, 11) * xxh_prime1;
+    }
+
+    h ^= h >> 33;
+    h *= xxh_prime2;
+    h ^= h >> 29;
+    h *= xxh_prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace mini_compiler
@@ -0,0 +1,568 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// incremental.h
+
+#pragma once
+
+#include "ast_arena.h"
+#include "lexer.h"
+#include "line_table.h"
+#include "parallel_parser.h"
+#include "parser.h"
+#include "token_stream.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::optional;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Incremental re-lexing and re-parsing
+// ==========================================
+//
+// A Document keeps the text, its tokens and its AST across edits:
+//   1. Lexing restarts at the last token that begins before the edit and
+//      stops as soon as a new token starts, past the inserted text, exactly
+//      where an old token started (shifted by the edit): from there on both
+//      token streams must agree. The new tokens are spliced into the buffer
+//      and the offsets behind them moved.
+//   2. The top-level items (see split_top_level_items()) around the damaged
+//      tokens are re-split until an old item boundary comes back at brace
+//      depth 0; only items whose token range changed are parsed again,
+//      every other subtree is reused as is.
+// Nested blocks are not re-parsed on their own: they are stored by value in
+// their parent nodes, so the top-level item is the unit of reuse.
+//
+// A reused item must not point into a text buffer that an edit replaced, so
+// every parsed item copies its slice of the text into its own arena and the
+// names and literals of its AST are moved onto that copy.
+
+namespace detail {
+
+// Moves every name and literal of `statements` that points into `from` to
+// the same position in `to`, a copy of `from`. Walks the tree with explicit
+// stacks, as expression chains can be arbitrarily deep.
+inline void rebase_strings(
+    vector<StmtPtr> const& statements, string_view from, char const* to) {
+    auto fix = [&](string_view& s) {
+        if (s.data() >= from.data() &&
+            s.data() <= from.data() + from.size()) {
+            s = {to + (s.data() - from.data()), s.size()};
+        }
+    };
+    vector<Stmt*> stmts(statements.rbegin(), statements.rend());
+    vector<Expr*> exprs;
+    auto push_block = [&](BlockExpr& block) {
+        stmts.insert(
+            stmts.end(), block.statements.rbegin(), block.statements.rend());
+        if (block.final_expr) {
+            exprs.push_back(*block.final_expr);
+        }
+    };
+    auto visit_expr = [&](auto& node) {
+        using T = std::decay_t<decltype(node)>;
+        if constexpr (std::is_same_v<T, Identifier>) {
+            fix(node.name);
+        } else if constexpr (std::is_same_v<T, LiteralExpr>) {
+            fix(node.value);
+        } else if constexpr (
+            std::is_same_v<T, BreakExpr> || std::is_same_v<T, ContinueExpr>) {
+            fix(node.keyword);
+        } else if constexpr (std::is_same_v<T, CallExpr>) {
+            fix(node.callee.name);
+            exprs.insert(exprs.end(), node.args.begin(), node.args.end());
+        } else if constexpr (
+            std::is_same_v<T, PrefixExpr> || std::is_same_v<T, PostfixExpr>) {
+            exprs.push_back(node.operand);
+        } else if constexpr (
+            std::is_same_v<T, BinaryExpr> || std::is_same_v<T, AssignExpr>) {
+            exprs.push_back(node.lhs);
+            exprs.push_back(node.rhs);
+        } else if constexpr (std::is_same_v<T, ReturnExpr>) {
+            if (node.value) {
+                exprs.push_back(*node.value);
+            }
+        } else if constexpr (std::is_same_v<T, BlockExpr>) {
+            push_block(node);
+        } else if constexpr (std::is_same_v<T, IfExpr>) {
+            exprs.push_back(node.condition);
+            push_block(node.then_block);
+            if (node.else_expr) {
+                exprs.push_back(*node.else_expr);
+            }
+        } else if constexpr (std::is_same_v<T, WhileExpr>) {
+            exprs.push_back(node.condition);
+            push_block(node.body);
+        } else if constexpr (std::is_same_v<T, ForExpr>) {
+            fix(node.loop_var.name);
+            exprs.push_back(node.iter_expr);
+            push_block(node.body);
+        }
+    };
+    auto visit_stmt = [&](auto& node) {
+        using T = std::decay_t<decltype(node)>;
+        if constexpr (std::is_same_v<T, ExprStmt>) {
+            exprs.push_back(node.expr);
+        } else if constexpr (std::is_same_v<T, VarDecl>) {
+            fix(node.name.name);
+            fix(node.type.name.name);
+            if (node.init) {
+                exprs.push_back(*node.init);
+            }
+        } else if constexpr (std::is_same_v<T, FunctionDecl>) {
+            fix(node.name.name);
+            fix(node.return_type.name.name);
+            for (auto& param : node.params) {
+                fix(param.name.name);
+                fix(param.type.name.name);
+            }
+            push_block(node.body);
+        }
+    };
+    while (!stmts.empty() || !exprs.empty()) {
+        if (!exprs.empty()) {
+            Expr* const expr = exprs.back();
+            exprs.pop_back();
+            std::visit(visit_expr, expr->node);
+        } else {
+            Stmt* const stmt = stmts.back();
+            stmts.pop_back();
+            std::visit(visit_stmt, stmt->node);
+        }
+    }
+}
+
+} // namespace detail
+
+struct TextEdit {
+    offset_t offset = 0;  // where the edit starts in the current text
+    offset_t removed = 0; // bytes removed from there
+    string_view inserted; // text inserted in their place
+};
+
+// What an edit cost, for tests of the incremental path and benchmarks.
+struct EditStats {
+    size_t relexed_tokens = 0;
+    size_t reparsed_items = 0;
+    size_t reused_items = 0;
+};
+
+class Document {
+  public:
+    explicit Document(string text)
+        : source(std::move(text)), symbols(predefined_spellings) {
+        rebuild();
+    }
+
+    Document(Document const&) = delete;
+    Document& operator=(Document const&) = delete;
+
+    string_view text() const { return source; }
+
+    TokenBuffer const& tokens() const { return token_buffer; }
+
+    // Statements of every top-level item that parsed.
+    Program const& program() const { return merged; }
+
+    // The document's own interner, which its symbols come from and which
+    // goes away with it; check_program() and the back ends need it too.
+    Interner& interner() { return symbols; }
+
+    bool ok() const {
+        return lex_errors.empty() &&
+               std::ranges::none_of(items, [](Item const& item) {
+                   return item.error.has_value();
+               });
+    }
+
+    // Lex errors in source order, then parse errors in item order.
+    vector<string> errors() const {
+        vector<string> out;
+        optional<LineTable> lines;
+        for (auto const& e : lex_errors) {
+            if (!e.unexpected) {
+                out.push_back(e.message);
+                continue;
+            }
+            if (!lines) {
+                lines.emplace(text());
+            }
+            out.push_back(
+                "Unexpected character: " + string(text().substr(e.offset, 1)) +
+                " at pos " + lines->resolve(e.offset).to_string());
+        }
+        for (auto const& item : items) {
+            if (item.error) {
+                out.push_back(*item.error);
+            }
+        }
+        return out;
+    }
+
+    EditStats apply(TextEdit const& edit) {
+        string_view const old_text = text();
+        if (edit.offset > old_text.size() ||
+            edit.removed > old_text.size() - edit.offset) {
+            throw runtime_error("Edit range outside the document");
+        }
+        string new_text;
+        new_text.reserve(
+            old_text.size() - edit.removed + edit.inserted.size());
+        new_text += old_text.substr(0, edit.offset);
+        new_text += edit.inserted;
+        new_text += old_text.substr(edit.offset + edit.removed);
+        if (new_text.size() > std::numeric_limits<offset_t>::max()) {
+            throw runtime_error("Source too large: offsets are 32-bit");
+        }
+        auto const delta = static_cast<int64_t>(edit.inserted.size()) -
+                           static_cast<int64_t>(edit.removed);
+        source = std::move(new_text);
+
+        EditStats stats;
+        auto const [first, old_last, new_last] = relex(edit, delta, stats);
+        reparse(first, old_last, new_last, stats);
+        merge();
+        return stats;
+    }
+
+  private:
+    // An unexpected character is the one lex error whose message holds a
+    // position; it is formatted when reported, as the position moves with
+    // edits before it.
+    struct LexError {
+        offset_t offset;
+        string message;
+        bool unexpected = false;
+    };
+
+    // A top-level item: tokens [first, first + count) and what they parsed
+    // to. The arena also holds the item's copy of its text.
+    struct Item {
+        size_t first = 0;
+        size_t count = 0;
+        vector<StmtPtr> statements;
+        std::unique_ptr<AstArena> arena;
+        optional<string> error;
+    };
+
+    struct Damage {
+        size_t first;    // first replaced token
+        size_t old_last; // end of the replaced tokens in the old buffer
+        size_t new_last; // end of their replacement in the new buffer
+    };
+
+    string source;
+    Interner symbols;
+    TokenBuffer token_buffer;
+    vector<LexError> lex_errors; // sorted by offset
+    vector<Item> items;
+    Program merged;
+
+    // Start of the text of token i; string and char lexemes begin after
+    // their opening quote.
+    offset_t token_start(size_t i) const {
+        TokenKind const kind = token_buffer.kind(i);
+        bool const quoted = kind == TokenKind::StringLiteral ||
+                            kind == TokenKind::CharLiteral;
+        return token_buffer.offset(i) - (quoted ? 1 : 0);
+    }
+
+    static offset_t token_start(Token const& token) {
+        bool const quoted = token.kind == TokenKind::StringLiteral ||
+                            token.kind == TokenKind::CharLiteral;
+        return token.offset - (quoted ? 1 : 0);
+    }
+
+    // Lexes [offset, ...) of the current text into `out` until `stop`
+    // returns true for a token (which is not appended) or the text ends.
+    template <typename Stop>
+    void lex_from(
+        offset_t offset,
+        TokenBuffer& out,
+        vector<LexError>& errors,
+        Stop const& stop) {
+        Lexer lexer(text(), symbols);
+        string error;
+        while (offset < text().size()) {
+            Token const tok = lexer.scan_at(offset, error);
+            if (tok.kind == TokenKind::Error) {
+                // only lex_symbol() errors keep the rejected character
+                errors.push_back(
+                    {.offset = tok.offset,
+                     .message = std::move(error),
+                     .unexpected = !tok.lexeme.empty()});
+                continue;
+            }
+            if (stop(tok)) {
+                return;
+            }
+            out.push_back(tok);
+        }
+    }
+
+    void rebuild() {
+        TokenBuffer tokens(text());
+        vector<LexError> errors;
+        tokens.reserve(text().size() / 4);
+        lex_from(0, tokens, errors, [](Token const&) { return false; });
+        tokens.push_back(
+            {.kind = TokenKind::End,
+             .lexeme = "",
+             .offset = static_cast<offset_t>(text().size())});
+        token_buffer = std::move(tokens);
+        lex_errors = std::move(errors);
+
+        items.clear();
+        vector<size_t> const starts = split_top_level_items(token_buffer);
+        size_t const end = token_buffer.size() - 1;
+        for (size_t i = 0; i < starts.size(); ++i) {
+            size_t const last = i + 1 < starts.size() ? starts[i + 1] : end;
+            if (last > starts[i]) {
+                items.push_back(parse_item(starts[i], last - starts[i]));
+            }
+        }
+        merge();
+    }
+
+    Damage relex(TextEdit const& edit, int64_t delta, EditStats& stats) {
+        size_t const old_count = token_buffer.size();
+        // the last token starting before the edit may grow into it; with no
+        // token before it, the edit may sit in a comment, so start at 0
+        auto const after = *std::ranges::partition_point(
+            std::views::iota(size_t{0}, old_count - 1),
+            [&](size_t i) { return token_start(i) < edit.offset; });
+        size_t const first = after > 0 ? after - 1 : 0;
+        offset_t const restart_at = after > 0 ? token_start(first) : 0;
+        auto const new_edit_end =
+            static_cast<size_t>(edit.offset) + edit.inserted.size();
+
+        TokenBuffer fresh(text());
+        vector<LexError> errors;
+        size_t old_last = first; // walks the old tokens to resynchronize
+        bool synced = false;
+        lex_from(restart_at, fresh, errors, [&](Token const& tok) {
+            offset_t const start = token_start(tok);
+            if (start < new_edit_end) {
+                return false;
+            }
+            auto const old_start = static_cast<offset_t>(start - delta);
+            while (old_last < old_count - 1 &&
+                   token_start(old_last) < old_start) {
+                ++old_last;
+            }
+            synced = old_last < old_count - 1 &&
+                     token_start(old_last) == old_start &&
+                     token_buffer.kind(old_last) == tok.kind;
+            return synced;
+        });
+        if (!synced) {
+            old_last = old_count; // including the final End token
+            fresh.push_back(
+                {.kind = TokenKind::End,
+                 .lexeme = "",
+                 .offset = static_cast<offset_t>(text().size())});
+        }
+        stats.relexed_tokens = fresh.size();
+
+        // lex errors: drop the damaged range, move the rest, add the new
+        offset_t const damage_end =
+            synced ? token_start(old_last) : ~offset_t{0};
+        std::erase_if(lex_errors, [&](LexError const& e) {
+            return e.offset >= restart_at && e.offset < damage_end;
+        });
+        for (auto& e : lex_errors) {
+            if (e.offset >= damage_end) {
+                e.offset += static_cast<offset_t>(delta);
+            }
+        }
+        lex_errors.insert(
+            std::ranges::upper_bound(
+                lex_errors, restart_at, {}, &LexError::offset),
+            std::make_move_iterator(errors.begin()),
+            std::make_move_iterator(errors.end()));
+
+        size_t const new_last = first + fresh.size() - (synced ? 0 : 1);
+        token_buffer.replace(first, old_last, fresh, text(), delta);
+        return {
+            .first = first,
+            .old_last = synced ? old_last : old_count - 1,
+            .new_last = new_last};
+    }
+
+    Item parse_item(size_t first, size_t count) {
+        Item item{.first = first, .count = count};
+        try {
+            Parser parser(token_buffer, first, first + count);
+            Program part = parser.parse();
+            item.statements.assign(
+                part.statements.begin(), part.statements.end());
+            item.arena = std::move(part.arena);
+        } catch (std::exception const& e) {
+            item.error = e.what();
+            return item;
+        }
+
+        // the item's lexemes all lie before the next item's first token
+        size_t const last = first + count;
+        offset_t const begin = count > 0 ? token_start(first) : 0;
+        offset_t const end = last + 1 < token_buffer.size()
+                                 ? token_start(last)
+                                 : static_cast<offset_t>(source.size());
+        auto* const copy = static_cast<char*>(
+            item.arena->resource()->allocate(end - begin, 1));
+        std::ranges::copy(source.substr(begin, end - begin), copy);
+        detail::rebase_strings(
+            item.statements,
+            string_view(source).substr(begin, end - begin),
+            copy);
+        return item;
+    }
+
+    // Re-splits and re-parses the items around the damaged tokens
+    // [first, old_last) of the old buffer, now [first, new_last).
+    void reparse(
+        size_t first, size_t old_last, size_t new_last, EditStats& stats) {
+        auto const shift = static_cast<ptrdiff_t>(new_last) -
+                           static_cast<ptrdiff_t>(old_last);
+        // the item holding the first damaged token, and the one before it,
+        // whose end moves if the damaged item's `fn`/`let` goes away
+        size_t a = 0;
+        while (a + 1 < items.size() && items[a + 1].first <= first) {
+            ++a;
+        }
+        a = a > 0 ? a - 1 : 0;
+        size_t const scan_from = items.empty() ? 0 : items[a].first;
+
+        // old items from `b` on start behind the damage and are kept
+        size_t b = a;
+        while (b < items.size() && items[b].first < old_last) {
+            ++b;
+        }
+        auto new_first_of = [&](size_t item) {
+            return static_cast<size_t>(
+                static_cast<ptrdiff_t>(items[item].first) + shift);
+        };
+
+        // split from scan_from until an item boundary at depth 0 lines up
+        // with a kept old item
+        TokenKind const* const kinds = token_buffer.kind_data();
+        size_t const end = token_buffer.size() - 1;
+        vector<size_t> starts{scan_from};
+        ptrdiff_t depth = 0;
+        size_t stop = end;
+        size_t keep = items.size();
+        for (size_t i = scan_from; i < end; ++i) {
+            switch (kinds[i]) {
+            case TokenKind::LeftBrace:
+            case TokenKind::LeftParen:
+                ++depth;
+                break;
+            case TokenKind::RightBrace:
+            case TokenKind::RightParen:
+                --depth;
+                break;
+            case TokenKind::KwFn:
+            case TokenKind::KwLet:
+                if (depth != 0 || i == scan_from) {
+                    break;
+                }
+                while (b < items.size() && new_first_of(b) < i) {
+                    ++b;
+                }
+                if (i >= new_last && b < items.size() && new_first_of(b) == i) {
+                    stop = i;
+                    keep = b;
+                } else {
+                    starts.push_back(i);
+                }
+                break;
+            default:
+                break;
+            }
+            if (stop != end) {
+                break;
+            }
+        }
+
+        // reuse untouched old items in [a, keep) by their old ranges
+        vector<Item> middle;
+        size_t old = a;
+        for (size_t k = 0; k < starts.size(); ++k) {
+            size_t const from = starts[k];
+            size_t const to = k + 1 < starts.size() ? starts[k + 1] : stop;
+            if (to <= from) {
+                continue;
+            }
+            while (old < keep && items[old].first < from) {
+                ++old;
+            }
+            bool const before_damage = to <= first;
+            if (old < keep && before_damage && items[old].first == from &&
+                items[old].count == to - from) {
+                middle.push_back(std::move(items[old]));
+                ++stats.reused_items;
+            } else {
+                middle.push_back(parse_item(from, to - from));
+                ++stats.reparsed_items;
+            }
+        }
+        for (size_t k = keep; k < items.size(); ++k) {
+            items[k].first = new_first_of(k);
+        }
+        stats.reused_items += items.size() - keep + a;
+
+        // retry items that failed before: their messages carry positions
+        for (size_t k = keep; k < items.size(); ++k) {
+            if (items[k].error) {
+                items[k] = parse_item(items[k].first, items[k].count);
+                ++stats.reparsed_items;
+                --stats.reused_items;
+            }
+        }
+        for (size_t k = 0; k < a; ++k) {
+            if (items[k].error) {
+                items[k] = parse_item(items[k].first, items[k].count);
+                ++stats.reparsed_items;
+                --stats.reused_items;
+            }
+        }
+
+        items.erase(
+            items.begin() + static_cast<ptrdiff_t>(a),
+            items.begin() + static_cast<ptrdiff_t>(keep));
+        items.insert(
+            items.begin() + static_cast<ptrdiff_t>(a),
+            std::make_move_iterator(middle.begin()),
+            std::make_move_iterator(middle.end()));
+    }
+
+    void merge() {
+        merged.statements.clear();
+        for (auto const& item : items) {
+            merged.statements.insert(
+                merged.statements.end(),
+                item.statements.begin(),
+                item.statements.end());
+        }
+    }
+};
+
+} // namespace mini_compiler
@@ -0,0 +1,481 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// instrument.h
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Phase instrumentation is compiled in unless this is 0 (CMake option
+// MINI_COMPILER_INSTRUMENTATION). Compiled out, PROFILE_SCOPE declares an
+// empty object and every call on it is an inline no-op.
+#ifndef MINI_COMPILER_INSTRUMENTATION
+#define MINI_COMPILER_INSTRUMENTATION 1
+#endif
+
+namespace mini_compiler {
+
+using std::format;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Phase instrumentation
+// ==========================================
+//
+// A ProfileScope measures the code between its construction and
+// destruction on the current thread: wall time, thread CPU time and the
+// number and bytes of heap allocations. Code inside can attach the work it
+// did (input bytes and a count of tokens, nodes, ...) for throughput
+// figures. Scopes nest; every finished scope becomes one event of the
+// global Profiler, which prints a per-phase table and writes JSON and
+// Chrome trace-event files (chrome://tracing, Perfetto).
+//
+// While the profiler is disabled a scope costs one relaxed atomic load.
+// Allocations are counted only in programs that expand
+// MINI_COMPILER_ALLOCATION_HOOKS() once (it replaces the global operator
+// new); elsewhere the allocation columns are omitted. Work a phase hands to
+// other threads is attributed to those threads' scopes, not to the phase.
+
+struct AllocationCounters {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+namespace detail {
+
+inline thread_local AllocationCounters thread_allocations;
+inline std::atomic<bool> allocation_hooks_installed{false};
+
+inline uint64_t thread_cpu_ns() {
+#if defined(_WIN32)
+    FILETIME creation;
+    FILETIME exit;
+    FILETIME kernel;
+    FILETIME user;
+    if (!GetThreadTimes(
+            GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    auto const ticks = [](FILETIME t) {
+        return (uint64_t{t.dwHighDateTime} << 32) | t.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) * 100;
+#else
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000U +
+           static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+// Small sequential thread ids for traces.
+inline uint32_t trace_thread_id() {
+    static std::atomic<uint32_t> next{1};
+    thread_local uint32_t const id = next.fetch_add(1);
+    return id;
+}
+
+inline string json_escape(string_view text) {
+    string out;
+    out.reserve(text.size());
+    for (char const c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out += format("\\u{:04x}", static_cast<unsigned>(c));
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace detail
+
+struct ProfileEvent {
+    string_view name; // a string literal
+    string detail;    // e.g. the file being compiled
+    uint32_t thread = 0;
+    uint32_t depth = 0;
+    uint64_t start_ns = 0; // since the profiler was enabled
+    uint64_t wall_ns = 0;
+    uint64_t cpu_ns = 0;
+    AllocationCounters allocations;
+    uint64_t bytes = 0;
+    uint64_t items = 0;
+    string_view unit; // what `items` counts
+};
+
+class Profiler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    bool enabled() const { return on.load(std::memory_order_relaxed); }
+
+    // Starts recording from a clean slate.
+    void enable() {
+        std::scoped_lock const lock(mutex);
+        events.clear();
+        epoch = Clock::now();
+        on.store(true, std::memory_order_relaxed);
+    }
+
+    void disable() { on.store(false, std::memory_order_relaxed); }
+
+    uint64_t now_ns() const {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - epoch)
+                .count());
+    }
+
+    void record(ProfileEvent event) {
+        std::scoped_lock const lock(mutex);
+        events.push_back(std::move(event));
+    }
+
+    vector<ProfileEvent> snapshot() const {
+        std::scoped_lock const lock(mutex);
+        return events;
+    }
+
+    // One row per scope name, in order of first completion.
+    void print_table(std::ostream& out) const {
+        vector<Row> const rows = summarize();
+        bool const allocs = detail::allocation_hooks_installed.load();
+        std::println(
+            out,
+            "{:<16} {:>6} {:>10} {:>10} {:>10} {:>10} {:>18} {:>9} {:>14}",
+            "phase",
+            "calls",
+            "wall ms",
+            "cpu ms",
+            allocs ? "alloc MB" : "",
+            allocs ? "allocs" : "",
+            "items",
+            "MB/s",
+            "items/s");
+        for (Row const& row : rows) {
+            double const secs = static_cast<double>(row.wall_ns) / 1e9;
+            auto rate = [&](double amount) {
+                return row.wall_ns == 0 || amount == 0
+                           ? string("-")
+                           : format("{:.1f}", amount / secs);
+            };
+            std::println(
+                out,
+                "{:<16} {:>6} {:>10.2f} {:>10.2f} {:>10} {:>10} {:>18} "
+                "{:>9} {:>14}",
+                row.name,
+                row.calls,
+                static_cast<double>(row.wall_ns) / 1e6,
+                static_cast<double>(row.cpu_ns) / 1e6,
+                allocs ? format(
+                             "{:.2f}",
+                             static_cast<double>(row.allocations.bytes) / 1e6)
+                       : "",
+                allocs ? format("{}", row.allocations.count) : "",
+                row.items == 0 ? string("-")
+                               : format("{} {}", row.items, row.unit),
+                rate(static_cast<double>(row.bytes) / 1e6),
+                rate(static_cast<double>(row.items)));
+        }
+    }
+
+    void write_json(std::filesystem::path const& path) const {
+        std::ofstream out = open(path);
+        bool const allocs = detail::allocation_hooks_installed.load();
+        out << "{\n  \"phases\": [";
+        bool first = true;
+        for (Row const& row : summarize()) {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << format(
+                "    {{\"name\": \"{}\", \"calls\": {}, \"wall_ns\": {}, "
+                "\"cpu_ns\": {}, ",
+                detail::json_escape(row.name),
+                row.calls,
+                row.wall_ns,
+                row.cpu_ns);
+            if (allocs) {
+                out << format(
+                    "\"alloc_count\": {}, \"alloc_bytes\": {}, ",
+                    row.allocations.count,
+                    row.allocations.bytes);
+            }
+            out << format(
+                "\"bytes\": {}, \"items\": {}, \"unit\": \"{}\"}}",
+                row.bytes,
+                row.items,
+                detail::json_escape(row.unit));
+        }
+        out << "\n  ]\n}\n";
+        check(out, path);
+    }
+
+    // Chrome trace-event format: one complete ("X") event per scope.
+    void write_trace(std::filesystem::path const& path) const {
+        std::ofstream out = open(path);
+        out << "{\"traceEvents\": [";
+        bool first = true;
+        for (ProfileEvent const& e : snapshot()) {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << format(
+                "{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, "
+                "\"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}, \"args\": "
+                "{{\"cpu_us\": {:.3f}, \"alloc_count\": {}, "
+                "\"alloc_bytes\": {}, \"bytes\": {}, \"items\": {}",
+                detail::json_escape(e.name),
+                e.thread,
+                static_cast<double>(e.start_ns) / 1e3,
+                static_cast<double>(e.wall_ns) / 1e3,
+                static_cast<double>(e.cpu_ns) / 1e3,
+                e.allocations.count,
+                e.allocations.bytes,
+                e.bytes,
+                e.items);
+            if (!e.detail.empty()) {
+                out << format(
+                    ", \"detail\": \"{}\"", detail::json_escape(e.detail));
+            }
+            out << "}}";
+        }
+        out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+        check(out, path);
+    }
+
+  private:
+    struct Row {
+        string_view name;
+        uint64_t calls = 0;
+        uint64_t wall_ns = 0;
+        uint64_t cpu_ns = 0;
+        AllocationCounters allocations;
+        uint64_t bytes = 0;
+        uint64_t items = 0;
+        string_view unit;
+    };
+
+    std::atomic<bool> on{false};
+    mutable std::mutex mutex;
+    vector<ProfileEvent> events;
+    Clock::time_point epoch = Clock::now();
+
+    vector<Row> summarize() const {
+        vector<Row> rows;
+        for (ProfileEvent const& e : snapshot()) {
+            auto it = std::ranges::find(rows, e.name, &Row::name);
+            if (it == rows.end()) {
+                rows.push_back({.name = e.name, .unit = e.unit});
+                it = rows.end() - 1;
+            }
+            it->calls += 1;
+            it->wall_ns += e.wall_ns;
+            it->cpu_ns += e.cpu_ns;
+            it->allocations.count += e.allocations.count;
+            it->allocations.bytes += e.allocations.bytes;
+            it->bytes += e.bytes;
+            it->items += e.items;
+        }
+        return rows;
+    }
+
+    static std::ofstream open(std::filesystem::path const& path) {
+        std::ofstream out(path, std::ios::out | std::ios::binary);
+        if (!out) {
+            throw runtime_error("Failed to open output file " + path.string());
+        }
+        return out;
+    }
+
+    static void
+    check(std::ofstream const& out, std::filesystem::path const& path) {
+        if (!out) {
+            throw runtime_error("Failed to write " + path.string());
+        }
+    }
+};
+
+inline Profiler& profiler() {
+    static Profiler instance;
+    return instance;
+}
+
+class ProfileScope {
+  public:
+    explicit ProfileScope(string_view name, string_view detail = {}) {
+        if (!profiler().enabled()) {
+            return;
+        }
+        active = true;
+        event.name = name;
+        event.detail = detail;
+        event.thread = detail::trace_thread_id();
+        event.depth = depth()++;
+        event.allocations = detail::thread_allocations;
+        event.cpu_ns = detail::thread_cpu_ns();
+        event.start_ns = profiler().now_ns();
+    }
+
+    ProfileScope(ProfileScope const&) = delete;
+    ProfileScope& operator=(ProfileScope const&) = delete;
+
+    ~ProfileScope() {
+        if (!active) {
+            return;
+        }
+        event.wall_ns = profiler().now_ns() - event.start_ns;
+        event.cpu_ns = detail::thread_cpu_ns() - event.cpu_ns;
+        AllocationCounters const now = detail::thread_allocations;
+        event.allocations = {
+            .count = now.count - event.allocations.count,
+            .bytes = now.bytes - event.allocations.bytes};
+        --depth();
+        profiler().record(std::move(event));
+    }
+
+    // The input bytes this phase processed and what else it produced.
+    void set_work(uint64_t bytes, uint64_t items = 0, string_view unit = {}) {
+        event.bytes = bytes;
+        event.items = items;
+        event.unit = unit;
+    }
+
+  private:
+    bool active = false;
+    ProfileEvent event;
+
+    static uint32_t& depth() {
+        thread_local uint32_t value = 0;
+        return value;
+    }
+};
+
+// Stand-in for ProfileScope when instrumentation is compiled out.
+struct NullProfileScope {
+    explicit constexpr NullProfileScope(string_view, string_view = {}) {}
+    constexpr void set_work(uint64_t, uint64_t = 0, string_view = {}) {}
+};
+
+} // namespace mini_compiler
+
+#if MINI_COMPILER_INSTRUMENTATION
+#define PROFILE_SCOPE(var, ...) ::mini_compiler::ProfileScope var(__VA_ARGS__)
+#else
+#define PROFILE_SCOPE(var, ...)                                                \
+    ::mini_compiler::NullProfileScope var(__VA_ARGS__)
+#endif
+
+// Expand once, at namespace scope of one translation unit, to count heap
+// allocations for the profiler. Compiled out it expands to nothing.
+#if MINI_COMPILER_INSTRUMENTATION
+#if defined(_WIN32)
+#define MINI_COMPILER_ALIGNED_ALLOC(size, align) _aligned_malloc(size, align)
+#define MINI_COMPILER_ALIGNED_FREE(p) _aligned_free(p)
+#else
+#define MINI_COMPILER_ALIGNED_ALLOC(size, align)                               \
+    std::aligned_alloc(align, ((size) + (align) - 1) / (align) * (align))
+#define MINI_COMPILER_ALIGNED_FREE(p) std::free(p)
+#endif
+#define MINI_COMPILER_ALLOCATION_HOOKS()                                       \
+    namespace mini_compiler::detail {                                          \
+    inline void* counted_alloc(std::size_t size) {                             \
+        thread_allocations.count += 1;                                         \
+        thread_allocations.bytes += size;                                      \
+        void* const p = std::malloc(size == 0 ? 1 : size);                     \
+        if (p == nullptr) {                                                    \
+            throw std::bad_alloc();                                            \
+        }                                                                      \
+        return p;                                                              \
+    }                                                                          \
+    inline void* counted_aligned_alloc(std::size_t size, std::size_t align) {  \
+        thread_allocations.count += 1;                                         \
+        thread_allocations.bytes += size;                                      \
+        void* const p =                                                        \
+            MINI_COMPILER_ALIGNED_ALLOC(size == 0 ? 1 : size, align);          \
+        if (p == nullptr) {                                                    \
+            throw std::bad_alloc();                                            \
+        }                                                                      \
+        return p;                                                              \
+    }                                                                          \
+    inline bool const allocation_hooks_registered =                            \
+        (allocation_hooks_installed = true);                                   \
+    }                                                                          \
+    void* operator new(std::size_t size) {                                     \
+        return mini_compiler::detail::counted_alloc(size);                     \
+    }                                                                          \
+    void* operator new[](std::size_t size) {                                   \
+        return mini_compiler::detail::counted_alloc(size);                     \
+    }                                                                          \
+    void* operator new(std::size_t size, std::align_val_t align) {             \
+        return mini_compiler::detail::counted_aligned_alloc(                   \
+            size, static_cast<std::size_t>(align));                            \
+    }                                                                          \
+    void* operator new[](std::size_t size, std::align_val_t align) {           \
+        return mini_compiler::detail::counted_aligned_alloc(                   \
+            size, static_cast<std::size_t>(align));                            \
+    }                                                                          \
+    void operator delete(void* p) noexcept { std::free(p); }                   \
+    void operator delete[](void* p) noexcept { std::free(p); }                 \
+    void operator delete(void* p, std::size_t) noexcept { std::free(p); }      \
+    void operator delete[](void* p, std::size_t) noexcept { std::free(p); }    \
+    void operator delete(void* p, std::align_val_t) noexcept {                 \
+        MINI_COMPILER_ALIGNED_FREE(p);                                         \
+    }                                                                          \
+    void operator delete[](void* p, std::align_val_t) noexcept {               \
+        MINI_COMPILER_ALIGNED_FREE(p);                                         \
+    }                                                                          \
+    void operator delete(void* p, std::size_t, std::align_val_t) noexcept {    \
+        MINI_COMPILER_ALIGNED_FREE(p);                                         \
+    }                                                                          \
+    void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {  \
+        MINI_COMPILER_ALIGNED_FREE(p);                                         \
+    }
+#else
+#define MINI_COMPILER_ALLOCATION_HOOKS()
+#endif
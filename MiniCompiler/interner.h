@@ -0,0 +1,250 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// interner.h
+
+#pragma once
+
+#include "hash.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::optional;
+using std::runtime_error;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// String interner
+// ==========================================
+//
+// Maps every distinct identifier spelling to a dense 32-bit Symbol, so name
+// equality is an integer compare and later passes can index tables by
+// symbol instead of hashing strings again.
+//
+// The interner owns copies of the strings, so symbols stay valid after the
+// source they were lexed from is gone. It is safe to use from many threads:
+// - the spelling -> symbol tables are split into shards by hash. Lookups of
+//   known names (the common case) take no lock and write no shared memory,
+//   so threads interning the same hot names do not contend: a table entry
+//   is written once and published with a release store, and a table that
+//   is outgrown is replaced but kept until the interner is destroyed, so a
+//   reader still in it stays valid. Only a miss takes the shard's mutex;
+// - symbols are allocated from one atomic counter and their spellings live
+//   in a segmented array that never moves, so name() takes no lock.
+//
+// An interner starts out with a fixed list of predefined spellings whose
+// symbols are their indices in that list; global_interner() (lexer.h)
+// predefines the built-in type names in BuiltInType order, then the
+// keywords.
+
+using Symbol = uint32_t;
+
+inline constexpr Symbol no_symbol = ~Symbol{0};
+
+class Interner {
+  public:
+    // `predefined[i]` becomes symbol i; the spellings must be distinct.
+    explicit Interner(std::span<string_view const> predefined = {}) {
+        for (string_view const name : predefined) {
+            intern(name);
+        }
+    }
+
+    Interner(Interner const&) = delete;
+    Interner& operator=(Interner const&) = delete;
+
+    ~Interner() {
+        for (auto& segment : segments) {
+            delete[] segment.load(std::memory_order_relaxed);
+        }
+    }
+
+    Symbol intern(string_view text) {
+        uint64_t const hash = xxh64(text);
+        Shard& shard = shards[hash >> (64 - shard_bits)];
+        if (Symbol const found = find(shard, text, hash); found != no_symbol) {
+            return found;
+        }
+        std::lock_guard const lock(shard.mutex);
+        if (Symbol const found = find(shard, text, hash); found != no_symbol) {
+            return found; // another thread interned it meanwhile
+        }
+        Symbol const symbol = allocate();
+        auto* const chars = static_cast<char*>(shard.chars.allocate(
+            std::max<size_t>(text.size(), 1), alignof(char)));
+        std::memcpy(chars, text.data(), text.size());
+        slot_of(symbol) = string_view(chars, text.size());
+        insert(shard, hash, symbol);
+        return symbol;
+    }
+
+    // The symbol of `text` if it was interned, without interning it.
+    optional<Symbol> lookup(string_view text) const {
+        uint64_t const hash = xxh64(text);
+        Shard const& shard = shards[hash >> (64 - shard_bits)];
+        Symbol found = find(shard, text, hash);
+        if (found == no_symbol) {
+            // the table read may have been outgrown by a concurrent insert
+            std::lock_guard const lock(shard.mutex);
+            found = find(shard, text, hash);
+        }
+        if (found == no_symbol) {
+            return std::nullopt;
+        }
+        return found;
+    }
+
+    // The spelling of a symbol this interner returned.
+    string_view name(Symbol symbol) const {
+        auto const [segment, index] = locate(symbol);
+        return segments[segment].load(std::memory_order_acquire)[index];
+    }
+
+    size_t size() const { return next.load(std::memory_order_relaxed); }
+
+  private:
+    static constexpr unsigned shard_bits = 6;
+    static constexpr size_t shard_count = size_t{1} << shard_bits;
+    // segment k holds 1 << (first_segment_bits + k) symbols
+    static constexpr unsigned first_segment_bits = 10;
+    static constexpr size_t segment_count = 33 - first_segment_bits;
+
+    // Written once, under the shard's mutex: the hash, then the symbol
+    // with release. A reader that sees the symbol sees the hash and the
+    // spelling too.
+    struct Entry {
+        std::atomic<uint64_t> hash{0};
+        std::atomic<Symbol> symbol{no_symbol};
+    };
+
+    // Open addressing, power-of-two size.
+    struct Table {
+        explicit Table(size_t size)
+            : mask(size - 1), entries(std::make_unique<Entry[]>(size)) {}
+
+        size_t mask;
+        std::unique_ptr<Entry[]> entries;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex; // taken by writers only
+        std::atomic<Table*> table{nullptr};
+        // the current table and the ones it replaced, which readers may
+        // still be probing
+        vector<std::unique_ptr<Table>> tables;
+        size_t used = 0;
+        std::pmr::monotonic_buffer_resource chars{size_t{4} << 10};
+    };
+
+    std::array<Shard, shard_count> shards;
+    std::array<std::atomic<string_view*>, segment_count> segments{};
+    std::atomic<Symbol> next{0};
+
+    static std::pair<size_t, size_t> locate(Symbol symbol) {
+        uint64_t const biased =
+            uint64_t{symbol} + (uint64_t{1} << first_segment_bits);
+        auto const segment = static_cast<size_t>(
+            std::bit_width(biased) - 1 - first_segment_bits);
+        return {
+            segment,
+            static_cast<size_t>(
+                biased - (uint64_t{1} << (segment + first_segment_bits)))};
+    }
+
+    string_view& slot_of(Symbol symbol) {
+        auto const [segment, index] = locate(symbol);
+        std::atomic<string_view*>& slot = segments[segment];
+        string_view* storage = slot.load(std::memory_order_acquire);
+        if (storage == nullptr) {
+            auto* const fresh =
+                new string_view[size_t{1} << (segment + first_segment_bits)];
+            if (slot.compare_exchange_strong(
+                    storage, fresh, std::memory_order_acq_rel)) {
+                storage = fresh;
+            } else {
+                delete[] fresh; // another shard's writer was first
+            }
+        }
+        return storage[index];
+    }
+
+    Symbol allocate() {
+        Symbol const symbol = next.fetch_add(1, std::memory_order_relaxed);
+        if (symbol == no_symbol) {
+            throw runtime_error("Too many distinct identifiers");
+        }
+        return symbol;
+    }
+
+    Symbol find(Shard const& shard, string_view text, uint64_t hash) const {
+        Table const* const table = shard.table.load(std::memory_order_acquire);
+        if (table == nullptr) {
+            return no_symbol;
+        }
+        for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+            Entry const& entry = table->entries[i];
+            Symbol const symbol = entry.symbol.load(std::memory_order_acquire);
+            if (symbol == no_symbol) {
+                return no_symbol;
+            }
+            if (entry.hash.load(std::memory_order_relaxed) == hash &&
+                name(symbol) == text) {
+                return symbol;
+            }
+        }
+    }
+
+    // Called with the shard's mutex held.
+    static void insert(Shard& shard, uint64_t hash, Symbol symbol) {
+        Table* table = shard.table.load(std::memory_order_relaxed);
+        size_t const size = table == nullptr ? 0 : table->mask + 1;
+        // keep the load factor at most 1/2
+        if ((shard.used + 1) * 2 > size) {
+            auto grown =
+                std::make_unique<Table>(std::max<size_t>(size * 2, 64));
+            for (size_t i = 0; i < size; ++i) {
+                Entry const& entry = table->entries[i];
+                Symbol const old = entry.symbol.load(std::memory_order_relaxed);
+                if (old != no_symbol) {
+                    place(
+                        *grown,
+                        entry.hash.load(std::memory_order_relaxed),
+                        old);
+                }
+            }
+            table = grown.get();
+            shard.tables.push_back(std::move(grown));
+            shard.table.store(table, std::memory_order_release);
+        }
+        place(*table, hash, symbol);
+        ++shard.used;
+    }
+
+    static void place(Table& table, uint64_t hash, Symbol symbol) {
+        size_t i = hash & table.mask;
+        while (table.entries[i].symbol.load(std::memory_order_relaxed) !=
+               no_symbol) {
+            i = (i + 1) & table.mask;
+        }
+        table.entries[i].hash.store(hash, std::memory_order_relaxed);
+        table.entries[i].symbol.store(symbol, std::memory_order_release);
+    }
+};
+
+} // namespace mini_compiler
@@ -0,0 +1,1062 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// interpreter.h
+
+#pragma once
+
+#include "interner.h"
+#include "lexer.h"
+#include "output_writer.h"
+#include "parser.h"
+#include "semantic.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::optional;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Runtime values
+// ==========================================
+//
+// 16 bytes: a BuiltInType tag and one word of payload. Strings are
+// immutable and owned by whoever made them (the decoded literals of a
+// program), so a value only points at one.
+
+struct Value {
+    BuiltInType type = BuiltInType::Unit;
+    union {
+        int64_t int_value = 0;
+        double float_value;
+        bool bool_value;
+        char char_value;
+        string const* string_value;
+    };
+
+    static constexpr Value of_int(int64_t v) {
+        Value value;
+        value.type = BuiltInType::Int;
+        value.int_value = v;
+        return value;
+    }
+
+    static constexpr Value of_float(double v) {
+        Value value;
+        value.type = BuiltInType::Float;
+        value.float_value = v;
+        return value;
+    }
+
+    static constexpr Value of_bool(bool v) {
+        Value value;
+        value.type = BuiltInType::Bool;
+        value.bool_value = v;
+        return value;
+    }
+
+    static constexpr Value of_char(char v) {
+        Value value;
+        value.type = BuiltInType::Char;
+        value.char_value = v;
+        return value;
+    }
+
+    static constexpr Value of_string(string const* v) {
+        Value value;
+        value.type = BuiltInType::String;
+        value.string_value = v;
+        return value;
+    }
+
+    // Held by a variable that has not been initialized yet (a global read
+    // by a function called before its declaration ran).
+    static constexpr Value uninitialized() {
+        Value value;
+        value.type = BuiltInType::Never;
+        return value;
+    }
+};
+
+static_assert(sizeof(Value) == 16);
+
+// Both values have the same type (the program was checked).
+inline bool values_equal(Value a, Value b) {
+    switch (a.type) {
+    case BuiltInType::Int:
+        return a.int_value == b.int_value;
+    case BuiltInType::Float:
+        return a.float_value == b.float_value;
+    case BuiltInType::Bool:
+        return a.bool_value == b.bool_value;
+    case BuiltInType::Char:
+        return a.char_value == b.char_value;
+    case BuiltInType::String:
+        return *a.string_value == *b.string_value;
+    default:
+        return true; // unit
+    }
+}
+
+// How print() shows a value.
+inline void write_value(OutputWriter& out, Value value) {
+    switch (value.type) {
+    case BuiltInType::Int:
+        out.write_right(value.int_value, 0);
+        break;
+    case BuiltInType::Float:
+        // the sign of a NaN depends on how it was computed; print one "nan"
+        if (std::isnan(value.float_value)) {
+            out << "nan";
+        } else {
+            out.print("{}", value.float_value);
+        }
+        break;
+    case BuiltInType::Bool:
+        out << (value.bool_value ? "true" : "false");
+        break;
+    case BuiltInType::Char:
+        out.put(value.char_value);
+        break;
+    case BuiltInType::String:
+        out << *value.string_value;
+        break;
+    default:
+        out << "()";
+        break;
+    }
+}
+
+// The text of a string or char literal with \n, \t, \\, \' and \"
+// replaced; any other escaped character stands for itself.
+inline string decode_escapes(string_view text) {
+    string decoded;
+    decoded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '\\' && i + 1 < text.size()) {
+            c = text[++i];
+            if (c == 'n') {
+                c = '\n';
+            } else if (c == 't') {
+                c = '\t';
+            }
+        }
+        decoded += c;
+    }
+    return decoded;
+}
+
+// The value of a literal; throws for an out-of-range number.
+inline Value literal_value(
+    LiteralExpr const& literal, std::deque<string>& strings) {
+    string_view const text = literal.value;
+    auto parse = [&](auto& number) {
+        auto const [end, ec] =
+            std::from_chars(text.data(), text.data() + text.size(), number);
+        if (ec != std::errc() || end != text.data() + text.size()) {
+            throw runtime_error(
+                format("invalid numeric literal {}", string(text)));
+        }
+    };
+    switch (literal.type) {
+    case BuiltInType::Int: {
+        int64_t value = 0;
+        parse(value);
+        return Value::of_int(value);
+    }
+    case BuiltInType::Float: {
+        double value = 0;
+        parse(value);
+        return Value::of_float(value);
+    }
+    case BuiltInType::Char:
+        return Value::of_char(decode_escapes(text).front());
+    case BuiltInType::String:
+        return Value::of_string(&strings.emplace_back(decode_escapes(text)));
+    case BuiltInType::Bool:
+        return Value::of_bool(text == "true");
+    default:
+        return {};
+    }
+}
+
+// Integer arithmetic wraps around: it is computed on the unsigned
+// representation. Shift counts are taken modulo 64; the divisor of
+// int_divide() and int_modulo() is not zero.
+
+inline int64_t wrapping_add(int64_t a, int64_t b) {
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+inline int64_t wrapping_sub(int64_t a, int64_t b) {
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+
+inline int64_t wrapping_mul(int64_t a, int64_t b) {
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+
+inline int64_t wrapping_negate(int64_t a) { return wrapping_sub(0, a); }
+
+inline int64_t shift_left(int64_t a, int64_t count) {
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(a) << (static_cast<uint64_t>(count) & 63));
+}
+
+inline int64_t shift_right(int64_t a, int64_t count) {
+    return a >> (static_cast<uint64_t>(count) & 63);
+}
+
+inline int64_t int_divide(int64_t lhs, int64_t rhs) {
+    return rhs == -1 ? wrapping_negate(lhs) : lhs / rhs; // INT64_MIN / -1
+}
+
+inline int64_t int_modulo(int64_t lhs, int64_t rhs) {
+    return rhs == -1 ? 0 : lhs % rhs;
+}
+
+// ==========================================
+// Tree-walking interpreter
+// ==========================================
+
+// Raised by a program at run time (division by zero, runaway recursion).
+class RuntimeError : public runtime_error {
+  public:
+    using runtime_error::runtime_error;
+};
+
+// Evaluates a checked Program (see check_program()) directly on its AST.
+//
+// Before running, a resolver walks the program once, with the scoping
+// rules of the checker, and records in a side table what each identifier,
+// literal, call and declaration denotes: a variable slot, a decoded
+// constant, a function. Variables live in frames on one value stack:
+// function locals at the frame base plus their slot (slots are reused by
+// sibling scopes), globals in the bottom frame, where the top-level code
+// runs.
+//
+// break, continue and return set a flag that every statement and operand
+// checks on the way out; no C++ exception is thrown for them. Integer
+// arithmetic wraps, shift counts are taken modulo 64, and dividing by zero
+// raises a RuntimeError.
+class Interpreter {
+  public:
+    // Deeper calls raise RuntimeError instead of exhausting the C++ stack.
+    static constexpr size_t max_call_depth = 2000;
+
+    explicit Interpreter(
+        std::ostream& out, Interner& interner = global_interner())
+        : out(out), interner(interner),
+          print_symbol(interner.intern("print")),
+          true_symbol(interner.intern("true")),
+          false_symbol(interner.intern("false")) {}
+
+    // Runs the top-level statements, then `main()` if the program declares
+    // one at top level. print() output is flushed before returning or
+    // throwing.
+    void run(Program const& program) {
+        struct FlushOnExit {
+            OutputWriter& out;
+            ~FlushOnExit() { out.flush(); }
+        } const flush_on_exit{out};
+
+        resolve_program(program);
+        stack.assign(main_frame_size, Value::uninitialized());
+        frame_base = 0;
+        call_depth = 0;
+        current = nullptr;
+        flow = Flow::Normal;
+        for (StmtPtr const stmt : program.statements) {
+            execute(*stmt);
+        }
+        if (main_function) {
+            invoke(functions[*main_function]);
+        }
+    }
+
+  private:
+    enum class Flow : uint8_t { Normal, Break, Continue, Return };
+
+    struct Function {
+        FunctionDecl const* decl;
+        uint32_t frame_size = 0; // parameters first
+        bool returns_unit = false;
+    };
+
+    // What the resolver found out about a node, keyed by the node's
+    // address: an open-addressing table, looked up once per evaluation.
+    class NodeTable {
+      public:
+        void clear() {
+            entries.assign(initial_capacity, {});
+            count = 0;
+        }
+
+        void insert(void const* node, uint32_t value) {
+            if ((count + 1) * 2 > entries.size()) {
+                grow();
+            }
+            Entry& entry = entries[index_of(node)];
+            count += entry.node == nullptr;
+            entry = {node, value};
+        }
+
+        uint32_t at(void const* node) const {
+            return entries[index_of(node)].value;
+        }
+
+      private:
+        static constexpr size_t initial_capacity = 1024; // a power of two
+
+        struct Entry {
+            void const* node = nullptr;
+            uint32_t value = 0;
+        };
+
+        vector<Entry> entries = vector<Entry>(initial_capacity);
+        size_t count = 0;
+
+        size_t index_of(void const* node) const {
+            size_t const mask = entries.size() - 1;
+            auto const key = static_cast<uint64_t>(
+                reinterpret_cast<uintptr_t>(node));
+            size_t i =
+                static_cast<size_t>((key * 0x9E3779B97F4A7C15) >> 32) & mask;
+            while (entries[i].node != node && entries[i].node != nullptr) {
+                i = (i + 1) & mask;
+            }
+            return i;
+        }
+
+        void grow() {
+            vector<Entry> old = std::move(entries);
+            entries.assign(old.size() * 2, {});
+            for (Entry const& entry : old) {
+                if (entry.node != nullptr) {
+                    entries[index_of(entry.node)] = entry;
+                }
+            }
+        }
+    };
+
+    // A variable reference: slot << 2 | where.
+    enum Where : uint32_t { Local = 0, Global = 1, Constant = 2 };
+    static constexpr uint32_t print_callee = ~uint32_t{0};
+
+    OutputWriter out;
+    Interner& interner;
+    Symbol print_symbol;
+    Symbol true_symbol;
+    Symbol false_symbol;
+
+    NodeTable nodes;
+    vector<Function> functions;
+    vector<Value> constants;
+    std::deque<string> strings; // of the string constants
+    uint32_t main_frame_size = 0;
+    optional<uint32_t> main_function;
+
+    vector<Value> stack;
+    size_t frame_base = 0;
+    size_t call_depth = 0;
+    Function const* current = nullptr; // null at top level
+    Flow flow = Flow::Normal;
+    Value return_value;
+
+    // explicit stacks of the chain evaluations, shared by nested ones above
+    // their own base
+    vector<BinaryExpr const*> binary_stack;
+    vector<TokenKind> unary_stack;
+    vector<uint32_t> target_stack;
+
+    // ------------------------------------------
+    // Resolver
+    // ------------------------------------------
+
+    struct Name {
+        enum class Kind : uint8_t { Variable, Constant, Function, Print };
+        Kind kind = Kind::Variable;
+        uint32_t index = 0; // slot, constant or function
+        uint32_t frame = 0; // of a variable: 0 top level, else function + 1
+    };
+
+    static constexpr uint32_t global_depth = 2; // built-ins are depth 1
+
+    ScopedSymbolTable<Name> names;
+    uint32_t frame = 0;
+    uint32_t next_slot = 0;
+    uint32_t frame_size = 0;
+    vector<Expr const*> pending;
+
+    void resolve_program(Program const& program) {
+        nodes.clear();
+        functions.clear();
+        constants.clear();
+        strings.clear();
+        main_function.reset();
+        frame = 0;
+        next_slot = 0;
+        frame_size = 0;
+
+        names.enter();
+        names.declare(print_symbol, {.kind = Name::Kind::Print});
+        for (bool const value : {true, false}) {
+            constants.push_back(Value::of_bool(value));
+            names.declare(
+                value ? true_symbol : false_symbol,
+                {.kind = Name::Kind::Constant,
+                 .index = static_cast<uint32_t>(constants.size() - 1)});
+        }
+        names.enter();
+        resolve_statements(program.statements);
+        for (StmtPtr const stmt : program.statements) {
+            auto const* decl = std::get_if<FunctionDecl>(&stmt->node);
+            if (decl != nullptr && decl->name.name == "main" &&
+                decl->params.empty()) {
+                main_function = nodes.at(decl);
+            }
+        }
+        names.leave();
+        names.leave();
+        main_frame_size = frame_size;
+    }
+
+    Symbol symbol_of(Identifier const& name) {
+        return name.symbol != no_symbol ? name.symbol
+                                        : interner.intern(name.name);
+    }
+
+    uint32_t allocate_slot() {
+        frame_size = std::max(frame_size, next_slot + 1);
+        return next_slot++;
+    }
+
+    void declare_variable(Identifier const& name, uint32_t slot) {
+        names.declare(
+            symbol_of(name),
+            {.kind = Name::Kind::Variable, .index = slot, .frame = frame});
+    }
+
+    ScopedSymbolTable<Name>::Binding const& lookup(Identifier const& name) {
+        auto const* binding = names.find(symbol_of(name));
+        if (binding == nullptr) {
+            throw runtime_error(
+                format("undeclared identifier '{}'", string(name.name)));
+        }
+        return *binding;
+    }
+
+    template <typename Statements>
+    void resolve_statements(Statements const& statements) {
+        for (StmtPtr const stmt : statements) {
+            if (auto const* decl = std::get_if<FunctionDecl>(&stmt->node)) {
+                auto const index = static_cast<uint32_t>(functions.size());
+                functions.push_back(
+                    {.decl = decl,
+                     .returns_unit =
+                         decl->return_type.built_in_type == BuiltInType::Unit});
+                nodes.insert(decl, index);
+                names.declare(
+                    symbol_of(decl->name),
+                    {.kind = Name::Kind::Function, .index = index});
+            }
+        }
+        for (StmtPtr const stmt : statements) {
+            if (auto const* expr_stmt = std::get_if<ExprStmt>(&stmt->node)) {
+                resolve(*expr_stmt->expr);
+            } else if (auto const* decl = std::get_if<VarDecl>(&stmt->node)) {
+                if (decl->init) {
+                    resolve(**decl->init);
+                }
+                uint32_t const slot = allocate_slot();
+                nodes.insert(decl, slot);
+                declare_variable(decl->name, slot);
+            } else {
+                resolve_function(std::get<FunctionDecl>(stmt->node));
+            }
+        }
+    }
+
+    void resolve_function(FunctionDecl const& decl) {
+        uint32_t const index = nodes.at(&decl);
+        uint32_t const outer_frame = frame;
+        uint32_t const outer_next = next_slot;
+        uint32_t const outer_size = frame_size;
+        frame = index + 1;
+        next_slot = 0;
+        frame_size = 0;
+        names.enter();
+        for (Param const& param : decl.params) {
+            declare_variable(param.name, allocate_slot());
+        }
+        resolve_block(decl.body);
+        names.leave();
+        functions[index].frame_size = frame_size;
+        frame = outer_frame;
+        next_slot = outer_next;
+        frame_size = outer_size;
+    }
+
+    void resolve_block(BlockExpr const& block) {
+        names.enter();
+        uint32_t const first_slot = next_slot;
+        resolve_statements(block.statements);
+        if (block.final_expr) {
+            resolve(**block.final_expr);
+        }
+        next_slot = first_slot; // sibling scopes reuse the slots
+        names.leave();
+    }
+
+    // Declarations only occur in blocks, which resolve_block() scopes, so
+    // the operands of an expression can be visited in any order: a work
+    // list instead of recursion keeps long operator chains flat.
+    void resolve(Expr const& root) {
+        size_t const base = pending.size();
+        pending.push_back(&root);
+        while (pending.size() > base) {
+            Expr const& expr = *pending.back();
+            pending.pop_back();
+            std::visit(
+                [this](auto const& node) { resolve_node(node); }, expr.node);
+        }
+    }
+
+    void resolve_node(Identifier const& name) {
+        auto const& binding = lookup(name);
+        Name const& found = binding.value;
+        switch (found.kind) {
+        case Name::Kind::Variable:
+            if (binding.depth == global_depth) {
+                nodes.insert(&name, found.index << 2 | Global);
+            } else if (found.frame == frame) {
+                nodes.insert(&name, found.index << 2 | Local);
+            } else {
+                throw runtime_error(format(
+                    "'{}' is not visible here", string(name.name)));
+            }
+            break;
+        case Name::Kind::Constant:
+            nodes.insert(&name, found.index << 2 | Constant);
+            break;
+        default:
+            throw runtime_error(
+                format("function '{}' used as a value", string(name.name)));
+        }
+    }
+
+    void resolve_node(LiteralExpr const& literal) {
+        constants.push_back(literal_value(literal, strings));
+        nodes.insert(&literal, static_cast<uint32_t>(constants.size() - 1));
+    }
+
+    void resolve_node(CallExpr const& call) {
+        Name const& found = lookup(call.callee).value;
+        if (found.kind == Name::Kind::Print) {
+            nodes.insert(&call, print_callee);
+        } else if (found.kind == Name::Kind::Function) {
+            nodes.insert(&call, found.index);
+        } else {
+            throw runtime_error(format(
+                "'{}' is not a function", string(call.callee.name)));
+        }
+        for (auto it = call.args.rbegin(); it != call.args.rend(); ++it) {
+            pending.push_back(*it);
+        }
+    }
+
+    void resolve_node(BinaryExpr const& node) {
+        pending.push_back(node.rhs);
+        pending.push_back(node.lhs);
+    }
+
+    void resolve_node(PrefixExpr const& node) {
+        pending.push_back(node.operand);
+    }
+
+    void resolve_node(PostfixExpr const& node) {
+        pending.push_back(node.operand);
+    }
+
+    void resolve_node(ReturnExpr const& node) {
+        if (node.value) {
+            pending.push_back(*node.value);
+        }
+    }
+
+    void resolve_node(AssignExpr const& node) {
+        if (!std::holds_alternative<Identifier>(node.lhs->node)) {
+            throw runtime_error("left side of '=' is not a variable");
+        }
+        pending.push_back(node.rhs);
+        pending.push_back(node.lhs);
+    }
+
+    void resolve_node(BlockExpr const& block) { resolve_block(block); }
+
+    void resolve_node(IfExpr const& node) {
+        resolve_block(node.then_block);
+        pending.push_back(node.condition);
+        if (node.else_expr) {
+            pending.push_back(*node.else_expr);
+        }
+    }
+
+    void resolve_node(WhileExpr const& node) {
+        resolve_block(node.body);
+        pending.push_back(node.condition);
+    }
+
+    void resolve_node(ForExpr const& node) {
+        names.enter();
+        uint32_t const slot = allocate_slot();
+        nodes.insert(&node, slot);
+        declare_variable(node.loop_var, slot);
+        resolve_block(node.body);
+        --next_slot;
+        names.leave();
+        pending.push_back(node.iter_expr); // outside the loop variable's scope
+    }
+
+    void resolve_node(BreakExpr const&) {}
+
+    void resolve_node(ContinueExpr const&) {}
+
+    // ------------------------------------------
+    // Evaluation
+    // ------------------------------------------
+
+    RuntimeError error(string_view message) const {
+        if (current == nullptr) {
+            return RuntimeError(string(message));
+        }
+        return RuntimeError(format(
+            "{} (in function '{}')",
+            message,
+            string(current->decl->name.name)));
+    }
+
+    Value& variable(uint32_t ref) {
+        size_t const base = (ref & Global) != 0 ? 0 : frame_base;
+        return stack[base + (ref >> 2)];
+    }
+
+    Value execute(Stmt const& stmt) {
+        if (auto const* expr_stmt = std::get_if<ExprStmt>(&stmt.node)) {
+            return eval(*expr_stmt->expr);
+        }
+        if (auto const* decl = std::get_if<VarDecl>(&stmt.node)) {
+            Value value;
+            if (decl->init) {
+                value = eval(**decl->init);
+                if (flow != Flow::Normal) {
+                    return {};
+                }
+            }
+            stack[frame_base + nodes.at(decl)] = value;
+        }
+        return {}; // a function declaration does nothing
+    }
+
+    Value eval(Expr const& expr) {
+        return std::visit(
+            [this](auto const& node) { return eval_node(node); }, expr.node);
+    }
+
+    Value eval_node(Identifier const& name) {
+        uint32_t const ref = nodes.at(&name);
+        if ((ref & Constant) != 0) {
+            return constants[ref >> 2];
+        }
+        Value const value = variable(ref);
+        if (value.type == BuiltInType::Never) {
+            throw error(format(
+                "'{}' is used before it is initialized", string(name.name)));
+        }
+        return value;
+    }
+
+    Value eval_node(LiteralExpr const& literal) {
+        return constants[nodes.at(&literal)];
+    }
+
+    Value eval_node(CallExpr const& call) {
+        uint32_t const callee = nodes.at(&call);
+        if (callee == print_callee) {
+            return print(call);
+        }
+        Function const& function = functions[callee];
+        size_t const base = stack.size();
+        stack.resize(base + function.frame_size);
+        for (size_t i = 0; i < call.args.size(); ++i) {
+            Value const arg = eval(*call.args[i]);
+            if (flow != Flow::Normal) {
+                stack.resize(base);
+                return {};
+            }
+            stack[base + i] = arg;
+        }
+        return invoke(function, base);
+    }
+
+    // Calls `function` on the frame at `base` (the arguments in place), or
+    // on a new frame without arguments.
+    Value invoke(Function const& function, optional<size_t> base = {}) {
+        if (!base) {
+            base = stack.size();
+            stack.resize(*base + function.frame_size);
+        }
+        if (call_depth == max_call_depth) {
+            throw error(format(
+                "stack overflow: more than {} nested calls", max_call_depth));
+        }
+        size_t const caller_base = frame_base;
+        Function const* const caller = current;
+        frame_base = *base;
+        current = &function;
+        ++call_depth;
+        Value result = eval_block(function.decl->body);
+        --call_depth;
+        current = caller;
+        frame_base = caller_base;
+        stack.resize(*base);
+        if (flow == Flow::Return) {
+            flow = Flow::Normal;
+            result = return_value;
+        }
+        return function.returns_unit ? Value{} : result;
+    }
+
+    Value print(CallExpr const& call) {
+        for (ExprPtr const arg : call.args) {
+            Value const value = eval(*arg);
+            if (flow != Flow::Normal) {
+                return {};
+            }
+            write_value(out, value);
+        }
+        out.put('\n');
+        return {};
+    }
+
+    // Left-deep chains "a + b + c + ...": the spine is collected on a stack
+    // and folded from the leftmost operation out.
+    Value eval_node(BinaryExpr const& root) {
+        if (!std::holds_alternative<BinaryExpr>(root.lhs->node)) {
+            Value const lhs = eval(*root.lhs);
+            if (flow != Flow::Normal) {
+                return {};
+            }
+            return eval_rhs(root, lhs);
+        }
+        size_t const base = binary_stack.size();
+        for (BinaryExpr const* node = &root; node != nullptr;
+             node = std::get_if<BinaryExpr>(&node->lhs->node)) {
+            binary_stack.push_back(node);
+        }
+        Value value = eval(*binary_stack.back()->lhs);
+        while (binary_stack.size() > base && flow == Flow::Normal) {
+            BinaryExpr const& node = *binary_stack.back();
+            binary_stack.pop_back();
+            value = eval_rhs(node, value);
+        }
+        binary_stack.resize(base);
+        return value;
+    }
+
+    Value eval_rhs(BinaryExpr const& node, Value lhs) {
+        // && and || do not evaluate their right operand when lhs decides
+        if (node.op == TokenKind::LogicalAnd) {
+            return lhs.bool_value ? eval(*node.rhs) : lhs;
+        }
+        if (node.op == TokenKind::LogicalOr) {
+            return lhs.bool_value ? lhs : eval(*node.rhs);
+        }
+        Value const rhs = eval(*node.rhs);
+        if (flow != Flow::Normal) {
+            return {};
+        }
+        return apply_binary(node.op, lhs, rhs);
+    }
+
+    Value apply_binary(TokenKind op, Value lhs, Value rhs) const {
+        switch (op) {
+        case TokenKind::EqualComparison:
+            return Value::of_bool(values_equal(lhs, rhs));
+        case TokenKind::NotEqualComparison:
+            return Value::of_bool(!values_equal(lhs, rhs));
+        default:
+            break;
+        }
+        switch (lhs.type) {
+        case BuiltInType::Int:
+            return apply_int(op, lhs.int_value, rhs.int_value);
+        case BuiltInType::Float:
+            return apply_float(op, lhs.float_value, rhs.float_value);
+        case BuiltInType::Char:
+            return compare(op, lhs.char_value, rhs.char_value);
+        default:
+            throw error(format(
+                "operator '{}' cannot be applied to {}",
+                string(to_string(op)),
+                string(to_string(lhs.type))));
+        }
+    }
+
+    template <typename T> Value compare(TokenKind op, T lhs, T rhs) const {
+        switch (op) {
+        case TokenKind::Less:
+            return Value::of_bool(lhs < rhs);
+        case TokenKind::LessEq:
+            return Value::of_bool(lhs <= rhs);
+        case TokenKind::Greater:
+            return Value::of_bool(lhs > rhs);
+        case TokenKind::GreaterEq:
+            return Value::of_bool(lhs >= rhs);
+        default:
+            throw error(
+                format("unsupported operator '{}'", string(to_string(op))));
+        }
+    }
+
+    Value apply_int(TokenKind op, int64_t lhs, int64_t rhs) const {
+        switch (op) {
+        case TokenKind::Plus:
+            return Value::of_int(wrapping_add(lhs, rhs));
+        case TokenKind::Minus:
+            return Value::of_int(wrapping_sub(lhs, rhs));
+        case TokenKind::Multiply:
+            return Value::of_int(wrapping_mul(lhs, rhs));
+        case TokenKind::Slash:
+        case TokenKind::Modulo:
+            if (rhs == 0) {
+                throw error("division by zero");
+            }
+            return Value::of_int(
+                op == TokenKind::Slash ? int_divide(lhs, rhs)
+                                       : int_modulo(lhs, rhs));
+        case TokenKind::KwLeftShift:
+            return Value::of_int(shift_left(lhs, rhs));
+        case TokenKind::KwRightShift:
+            return Value::of_int(shift_right(lhs, rhs));
+        case TokenKind::KwBitAnd:
+            return Value::of_int(lhs & rhs);
+        case TokenKind::KwBitOr:
+            return Value::of_int(lhs | rhs);
+        case TokenKind::KwXor:
+            return Value::of_int(lhs ^ rhs);
+        default:
+            return compare(op, lhs, rhs);
+        }
+    }
+
+    Value apply_float(TokenKind op, double lhs, double rhs) const {
+        switch (op) {
+        case TokenKind::Plus:
+            return Value::of_float(lhs + rhs);
+        case TokenKind::Minus:
+            return Value::of_float(lhs - rhs);
+        case TokenKind::Multiply:
+            return Value::of_float(lhs * rhs);
+        case TokenKind::Slash:
+            return Value::of_float(lhs / rhs); // IEEE: inf or nan
+        default:
+            return compare(op, lhs, rhs);
+        }
+    }
+
+    Value eval_node(PrefixExpr const& root) { return eval_unary_chain(root); }
+
+    Value eval_node(PostfixExpr const& root) { return eval_unary_chain(root); }
+
+    // "- - x" or "x compl compl": the operators are collected on a stack and
+    // applied innermost first.
+    template <typename Node> Value eval_unary_chain(Node const& root) {
+        size_t const base = unary_stack.size();
+        Node const* node = &root;
+        while (true) {
+            unary_stack.push_back(node->op);
+            Node const* inner = std::get_if<Node>(&node->operand->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        Value value = eval(*node->operand);
+        while (unary_stack.size() > base && flow == Flow::Normal) {
+            value = apply_unary(unary_stack.back(), value);
+            unary_stack.pop_back();
+        }
+        unary_stack.resize(base);
+        return value;
+    }
+
+    Value apply_unary(TokenKind op, Value value) const {
+        switch (op) {
+        case TokenKind::Plus:
+            return value;
+        case TokenKind::Minus:
+            return value.type == BuiltInType::Float
+                       ? Value::of_float(-value.float_value)
+                       : Value::of_int(wrapping_negate(value.int_value));
+        case TokenKind::Not:
+            return Value::of_bool(!value.bool_value);
+        case TokenKind::KwCompl:
+            return Value::of_int(~value.int_value);
+        default:
+            throw error(format(
+                "unsupported unary operator '{}'", string(to_string(op))));
+        }
+    }
+
+    Value eval_node(ReturnExpr const& node) {
+        Value value;
+        if (node.value) {
+            value = eval(**node.value);
+            if (flow != Flow::Normal) {
+                return {};
+            }
+        }
+        return_value = value;
+        flow = Flow::Return;
+        return {};
+    }
+
+    // Right-deep chains "a = b = c = ...": the targets are collected, then
+    // the value is stored into each from the innermost out.
+    Value eval_node(AssignExpr const& root) {
+        size_t const base = target_stack.size();
+        AssignExpr const* node = &root;
+        while (true) {
+            target_stack.push_back(
+                nodes.at(&std::get<Identifier>(node->lhs->node)));
+            auto const* inner = std::get_if<AssignExpr>(&node->rhs->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        Value const value = eval(*node->rhs);
+        if (flow != Flow::Normal) {
+            target_stack.resize(base);
+            return {};
+        }
+        while (target_stack.size() > base) {
+            variable(target_stack.back()) = value;
+            target_stack.pop_back();
+        }
+        return value;
+    }
+
+    Value eval_node(BlockExpr const& block) { return eval_block(block); }
+
+    Value eval_block(BlockExpr const& block) {
+        Value last;
+        for (StmtPtr const stmt : block.statements) {
+            last = execute(*stmt);
+            if (flow != Flow::Normal) {
+                return {};
+            }
+        }
+        if (block.final_expr) {
+            return eval(**block.final_expr);
+        }
+        if (!block.statements.empty() &&
+            is_value_statement(*block.statements.back())) {
+            return last;
+        }
+        return {};
+    }
+
+    Value eval_node(IfExpr const& node) {
+        Value const condition = eval(*node.condition);
+        if (flow != Flow::Normal) {
+            return {};
+        }
+        if (condition.bool_value) {
+            Value const value = eval_block(node.then_block);
+            return node.else_expr ? value : Value{};
+        }
+        return node.else_expr ? eval(**node.else_expr) : Value{};
+    }
+
+    // After a loop body: whether the loop goes on. A break or continue is
+    // consumed here; a return keeps unwinding.
+    bool loop_continues() {
+        switch (flow) {
+        case Flow::Normal:
+            return true;
+        case Flow::Continue:
+            flow = Flow::Normal;
+            return true;
+        case Flow::Break:
+            flow = Flow::Normal;
+            return false;
+        default:
+            return false;
+        }
+    }
+
+    Value eval_node(WhileExpr const& node) {
+        while (true) {
+            Value const condition = eval(*node.condition);
+            if (flow != Flow::Normal || !condition.bool_value) {
+                return {};
+            }
+            eval_block(node.body);
+            if (!loop_continues()) {
+                return {};
+            }
+        }
+    }
+
+    // `for v in n` runs the body for v = 0, 1, ..., n - 1.
+    Value eval_node(ForExpr const& node) {
+        Value const count = eval(*node.iter_expr);
+        if (flow != Flow::Normal) {
+            return {};
+        }
+        uint32_t const slot = nodes.at(&node);
+        for (int64_t i = 0; i < count.int_value; ++i) {
+            stack[frame_base + slot] = Value::of_int(i);
+            eval_block(node.body);
+            if (!loop_continues()) {
+                break;
+            }
+        }
+        return {};
+    }
+
+    Value eval_node(BreakExpr const&) {
+        flow = Flow::Break;
+        return {};
+    }
+
+    Value eval_node(ContinueExpr const&) {
+        flow = Flow::Continue;
+        return {};
+    }
+};
+
+} // namespace mini_compiler
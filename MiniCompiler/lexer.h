@@ -3,14 +3,20 @@
 
 #pragma once
 
-#include <cctype>
+#include "interner.h"
+#include "line_table.h"
+#include "scan.h"
+
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <format>
+#include <limits>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 
 namespace mini_compiler {
@@ -157,6 +163,129 @@ constexpr std::vector<TokenKind> get_keywords() {
     return keywords;
 }
 
+// ==========================================
+// Keyword recognizer
+// ==========================================
+
+// Perfect hash over the keywords of TOKEN_LIST. The hash packs length, first,
+// middle and last character into one word and multiplies by a seed;
+// keyword_table searches for a collision-free seed at compile time, so adding
+// a keyword to TOKEN_LIST regenerates the table automatically.
+struct KeywordSlot {
+    string_view text;
+    TokenKind kind = TokenKind::Identifier; // Identifier marks an empty slot
+};
+
+struct KeywordTable {
+    static constexpr uint32_t bits = 6;
+    static constexpr size_t size = size_t{1} << bits;
+
+    std::array<KeywordSlot, size> slots{};
+    uint32_t seed = 0;
+    size_t min_length = 0;
+    size_t max_length = 0;
+
+    static constexpr uint32_t hash(string_view text, uint32_t seed) {
+        auto const len = static_cast<uint32_t>(text.size());
+        auto const first = uint32_t{static_cast<unsigned char>(text[0])};
+        auto const middle =
+            uint32_t{static_cast<unsigned char>(text[len / 2])};
+        auto const last = uint32_t{static_cast<unsigned char>(text[len - 1])};
+        uint32_t const h =
+            (first | (middle << 8U) | (last << 16U) | (len << 24U)) * seed;
+        return h >> (32 - bits);
+    }
+
+    constexpr TokenKind find(string_view text) const {
+        if (text.size() < min_length || text.size() > max_length) {
+            return TokenKind::Identifier;
+        }
+        KeywordSlot const& slot = slots[hash(text, seed)];
+        return slot.text == text ? slot.kind : TokenKind::Identifier;
+    }
+};
+
+inline constexpr KeywordTable keyword_table = [] {
+    auto const keywords = get_keywords();
+    KeywordTable table;
+    table.min_length = to_string(keywords.front()).size();
+    for (TokenKind const k : keywords) {
+        table.min_length = std::min(table.min_length, to_string(k).size());
+        table.max_length = std::max(table.max_length, to_string(k).size());
+    }
+    // odd multipliers only; the first collision-free one wins
+    for (uint32_t seed = 0x9E3779B1U;; seed += 2) {
+        std::array<KeywordSlot, KeywordTable::size> slots{};
+        bool collision = false;
+        for (TokenKind const k : keywords) {
+            auto& slot = slots[KeywordTable::hash(to_string(k), seed)];
+            if (slot.kind != TokenKind::Identifier) {
+                collision = true;
+                break;
+            }
+            slot = {.text = to_string(k), .kind = k};
+        }
+        if (!collision) {
+            table.slots = slots;
+            table.seed = seed;
+            return table;
+        }
+    }
+}();
+
+static_assert(keyword_table.find("while") == TokenKind::KwWhile);
+static_assert(keyword_table.find("whale") == TokenKind::Identifier);
+
+// Returns the keyword spelled by `text`, or TokenKind::Identifier.
+constexpr TokenKind lookup_keyword(string_view text) {
+    return keyword_table.find(text);
+}
+
+// ==========================================
+// Predefined symbols
+// ==========================================
+
+// Spellings of the built-in types, in BuiltInType order (parser.h checks).
+inline constexpr std::array<string_view, 7> builtin_type_names = {
+    "never", "unit", "bool", "int", "float", "char", "string"};
+
+inline constexpr size_t keyword_count = get_keywords().size();
+
+// Symbols 0, 1, ... of global_interner(): the built-in type names, then the
+// keywords in TOKEN_LIST order.
+inline constexpr auto predefined_spellings = [] {
+    std::array<string_view, builtin_type_names.size() + keyword_count> names;
+    std::ranges::copy(builtin_type_names, names.begin());
+    auto const keywords = get_keywords();
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        names[builtin_type_names.size() + i] = to_string(keywords[i]);
+    }
+    return names;
+}();
+
+// The predefined symbol of a keyword; no_symbol for other kinds.
+constexpr Symbol keyword_symbol(TokenKind kind) {
+    for (size_t i = builtin_type_names.size(); i < predefined_spellings.size();
+         ++i) {
+        if (lookup_keyword(predefined_spellings[i]) == kind) {
+            return static_cast<Symbol>(i);
+        }
+    }
+    return no_symbol;
+}
+
+static_assert(predefined_spellings[keyword_symbol(TokenKind::KwFn)] == "fn");
+
+// The interner the lexer uses unless given another. Shared by every thread,
+// so symbols from different files and chunks compare equal. It never frees
+// a name: long-running uses (the driver, the server, Document) give each
+// compilation or document its own Interner(predefined_spellings) instead,
+// which goes away with it.
+inline Interner& global_interner() {
+    static Interner interner(predefined_spellings);
+    return interner;
+}
+
 constexpr bool is_assign(TokenKind k) {
     switch (k) {
     case TokenKind::Assignment:
@@ -229,31 +358,183 @@ constexpr int get_precedence(TokenKind kind) {
     }
 }
 
-using lineno_t = int32_t;
-using colno_t = int32_t;
-using index_t = int32_t;
+struct Token {
+    TokenKind kind = TokenKind::Error;
+    string_view lexeme;
+    offset_t offset = 0; // resolve with LineTable for line/column
+    Symbol symbol = no_symbol; // identifiers only
+};
+
+// Lexeme of the End token that next_token() yields after trailing whitespace.
+inline constexpr string_view eof_lexeme = "<eof>";
+
+// Structure-of-arrays token storage: 13 bytes per token instead of a padded
+// Token. Lexemes are not stored; every non-empty lexeme other than eof_lexeme
+// is the source slice [offset, offset + length), so a Token is rebuilt on
+// demand.
+class TokenBuffer {
+  public:
+    class const_iterator {
+      public:
+        using value_type = Token;
+        using difference_type = std::ptrdiff_t;
+
+        const_iterator() = default;
+
+        const_iterator(TokenBuffer const* buffer, size_t index)
+            : buffer(buffer), index(index) {}
+
+        Token operator*() const { return (*buffer)[index]; }
+
+        const_iterator& operator++() {
+            ++index;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto const old = *this;
+            ++index;
+            return old;
+        }
 
-struct SourcePosition {
-    lineno_t lineno = 1; // one-based offset into program source
-    colno_t colno = 1;   // one-based offset into line
-    index_t index = 0;
+        bool operator==(const_iterator const&) const = default;
 
-    SourcePosition() = default;
+      private:
+        TokenBuffer const* buffer = nullptr;
+        size_t index = 0;
+    };
 
-    SourcePosition(lineno_t l, colno_t c, index_t i)
-        : lineno{l}, colno{c}, index(i) {}
+    TokenBuffer() = default;
 
-    auto operator<=>(SourcePosition const&) const = default;
+    explicit TokenBuffer(string_view source) : src(source) {}
 
-    auto to_string() const -> string {
-        return format("({}, {}) i={}", lineno, colno, index);
+    void reserve(size_t n) {
+        kinds.reserve(n);
+        offsets.reserve(n);
+        lengths.reserve(n);
+        symbols.reserve(n);
     }
-};
 
-struct Token {
-    TokenKind kind = TokenKind::Error;
-    string_view lexeme;
-    SourcePosition pos;
+    void push_back(Token const& token) {
+        uint32_t length = static_cast<uint32_t>(token.lexeme.size());
+        if (token.lexeme.data() == eof_lexeme.data()) {
+            length = eof_length;
+        } else if (
+            !token.lexeme.empty() &&
+            token.lexeme.data() != src.data() + token.offset) {
+            throw runtime_error(
+                "Internal error: token lexeme is not a slice at its offset");
+        }
+        kinds.push_back(token.kind);
+        offsets.push_back(token.offset);
+        lengths.push_back(length);
+        symbols.push_back(token.symbol);
+    }
+
+    // Appends every token of `other`, which must lex the same source.
+    void append(TokenBuffer const& other) {
+        if (other.src.data() != src.data()) {
+            throw runtime_error("Cannot append tokens of another source");
+        }
+        kinds.insert(kinds.end(), other.kinds.begin(), other.kinds.end());
+        offsets.insert(
+            offsets.end(), other.offsets.begin(), other.offsets.end());
+        lengths.insert(
+            lengths.end(), other.lengths.begin(), other.lengths.end());
+        symbols.insert(
+            symbols.end(), other.symbols.begin(), other.symbols.end());
+    }
+
+    // Replaces tokens [first, last) with `tokens` and moves the buffer onto
+    // `source`, an edited copy of the old source in which everything after
+    // the replaced range has moved by `delta` bytes.
+    void replace(
+        size_t first,
+        size_t last,
+        TokenBuffer const& tokens,
+        string_view source,
+        int64_t delta) {
+        if (tokens.src.data() != source.data()) {
+            throw runtime_error("Replacement tokens lex another source");
+        }
+        // unsigned wrap-around adds a negative delta as well
+        auto const shift = static_cast<offset_t>(delta);
+        for (size_t i = last; i < offsets.size(); ++i) {
+            offsets[i] += shift;
+        }
+        auto splice = [&](auto& dst, auto const& src_items) {
+            size_t const removed = last - first;
+            size_t const count = src_items.size();
+            auto const at = dst.begin() + static_cast<ptrdiff_t>(first);
+            if (count < removed) {
+                dst.erase(
+                    at + static_cast<ptrdiff_t>(count),
+                    at + static_cast<ptrdiff_t>(removed));
+            } else if (count > removed) {
+                dst.insert(
+                    at + static_cast<ptrdiff_t>(removed), count - removed, {});
+            }
+            std::ranges::copy(
+                src_items, dst.begin() + static_cast<ptrdiff_t>(first));
+        };
+        splice(kinds, tokens.kinds);
+        splice(offsets, tokens.offsets);
+        splice(lengths, tokens.lengths);
+        splice(symbols, tokens.symbols);
+        src = source;
+    }
+
+    size_t size() const { return kinds.size(); }
+
+    bool empty() const { return kinds.empty(); }
+
+    TokenKind kind(size_t i) const { return kinds[i]; }
+
+    offset_t offset(size_t i) const { return offsets[i]; }
+
+    string_view lexeme(size_t i) const {
+        if (lengths[i] == eof_length) {
+            return eof_lexeme;
+        }
+        return src.substr(offsets[i], lengths[i]);
+    }
+
+    Symbol symbol(size_t i) const { return symbols[i]; }
+
+    Token operator[](size_t i) const {
+        return {
+            .kind = kinds[i],
+            .lexeme = lexeme(i),
+            .offset = offsets[i],
+            .symbol = symbols[i]};
+    }
+
+    Token back() const { return (*this)[size() - 1]; }
+
+    const_iterator begin() const { return {this, 0}; }
+
+    const_iterator end() const { return {this, size()}; }
+
+    string_view source() const { return src; }
+
+    // The dense kind array, for scans that need nothing else.
+    TokenKind const* kind_data() const { return kinds.data(); }
+
+    size_t memory_bytes() const {
+        return kinds.capacity() * sizeof(TokenKind) +
+               offsets.capacity() * sizeof(offset_t) +
+               lengths.capacity() * sizeof(uint32_t) +
+               symbols.capacity() * sizeof(Symbol);
+    }
+
+  private:
+    static constexpr uint32_t eof_length = ~uint32_t{0};
+
+    string_view src;
+    vector<TokenKind> kinds; // one byte each
+    vector<offset_t> offsets;
+    vector<uint32_t> lengths;
+    vector<Symbol> symbols;
 };
 
 // ==========================================
@@ -261,39 +542,142 @@ struct Token {
 // ==========================================
 class Lexer {
   public:
-    explicit Lexer(string_view src) : source(src) {}
-
-    vector<Token> tokenize() {
-        vector<Token> tokens;
+    // Identifiers are interned in `interner`, which must have been created
+    // with predefined_spellings (the parser relies on the built-in types'
+    // symbols).
+    explicit Lexer(string_view src, Interner& interner = global_interner())
+        : source(src), interner(&interner) {}
+
+    TokenBuffer tokenize() {
+        check_source_size();
+        TokenBuffer tokens(source);
+        tokens.reserve(source.size() / 4);
         while (!is_at_end()) {
             Token const tok = next_token();
             if (tok.kind != TokenKind::Error) {
                 // 忽略错误 token 或保留特殊 token
-                tokens.emplace_back(tok);
+                tokens.push_back(tok);
             }
         }
         tokens.push_back({TokenKind::End, "", pos});
         if (!errors.empty()) {
-            string msg = "Lex errors:\n";
-            for (auto const& e : errors) {
-                msg += e + "\n";
-            }
-            throw runtime_error(msg);
+            throw_errors();
         }
 
         return tokens;
     }
 
+    // Pull interface for TokenStream: returns the next token, and End once
+    // the source is exhausted (repeatedly, if called again). Lex errors are
+    // handled as tokenize() handles them: the offending text is skipped and
+    // every error is thrown at once when the end is reached.
+    Token next() {
+        if (pos == 0) {
+            check_source_size();
+        }
+        while (!is_at_end()) {
+            Token const tok = next_token();
+            if (tok.kind != TokenKind::Error) {
+                return tok;
+            }
+        }
+        if (!errors.empty()) {
+            throw_errors();
+        }
+        return {TokenKind::End, "", pos};
+    }
+
+    // Lexes what next() has not reached yet and throws the lex errors of the
+    // whole source, if there are any.
+    void finish() {
+        while (!is_at_end()) {
+            next_token();
+        }
+        if (!errors.empty()) {
+            throw_errors();
+        }
+    }
+
+    struct RangeResult {
+        offset_t stop; // end of the last token appended
+        bool ok;       // false if lexing hit an error
+    };
+
+    // Appends to `out` the tokens that start in [begin, end), lexing from
+    // `begin` as if it were a token boundary; the last token may extend
+    // past `end`. Stops at the first lex error instead of collecting them.
+    // The final End token is not appended. Used by tokenize_parallel().
+    RangeResult tokenize_range(offset_t begin, size_t end, TokenBuffer& out) {
+        check_source_size();
+        pos = begin;
+        offset_t stop = begin;
+        while (!is_at_end()) {
+            Token const tok = next_token();
+            if (tok.offset >= end) {
+                break;
+            }
+            if (tok.kind == TokenKind::Error) {
+                return {.stop = stop, .ok = false};
+            }
+            out.push_back(tok);
+            stop = pos;
+        }
+        return {.stop = stop, .ok = true};
+    }
+
+    // Incremental interface: lexes the token at or after `offset`, which
+    // must be a token boundary, and moves `offset` past it. A lex error
+    // comes back as an Error token with its message in `error`.
+    Token scan_at(offset_t& offset, string& error) {
+        check_source_size();
+        pos = offset;
+        errors.clear();
+        Token const tok = next_token();
+        if (tok.kind == TokenKind::Error) {
+            error = errors.empty() ? string() : errors.back();
+            errors.clear();
+        }
+        offset = pos;
+        return tok;
+    }
+
+    string_view get_source() const { return source; }
+
   private:
     string_view source;
-    SourcePosition pos;
+    Interner* interner;
+    offset_t pos = 0;
 
     vector<string> errors;
+    std::optional<LineTable> lines; // built on the first positioned error
+
+    void check_source_size() const {
+        if (source.size() > std::numeric_limits<offset_t>::max()) {
+            throw runtime_error("Source too large: offsets are 32-bit");
+        }
+    }
+
+    [[noreturn]]
+    void throw_errors() const {
+        string msg = "Lex errors:\n";
+        for (auto const& e : errors) {
+            msg += e + "\n";
+        }
+        throw runtime_error(msg);
+    }
+
+    SourcePosition position_of(offset_t offset) {
+        if (!lines) {
+            lines.emplace(source);
+        }
+        return lines->resolve(offset);
+    }
 
     Token next_token() {
         skip_whitespace();
         if (is_at_end()) {
-            return {.kind = TokenKind::End, .lexeme = "<eof>", .pos = pos};
+            return {
+                .kind = TokenKind::End, .lexeme = eof_lexeme, .offset = pos};
         }
 
         char const c = peek();
@@ -315,19 +699,15 @@ class Lexer {
         return lex_symbol();
     }
 
-    bool is_at_end() const { return pos.index >= ssize(source); }
+    bool is_at_end() const { return pos >= source.size(); }
 
     static bool is_ident_start(char c) {
-        return (std::isalpha(c) != 0) || c == '_';
-    }
-
-    static bool is_ident_part(char c) {
-        return (std::isalnum(c) != 0) || c == '_';
+        return has_char_class(c, char_class::ident_start);
     }
 
-    char peek(int offset = 0) const {
-        int const p = pos.index + offset;
-        if (p >= ssize(source)) {
+    char peek(offset_t offset = 0) const {
+        size_t const p = size_t{pos} + offset;
+        if (p >= source.size()) {
             return '\0';
         }
         return source[p];
@@ -337,37 +717,37 @@ class Lexer {
         if (is_at_end()) {
             return '\0';
         }
-        pos.colno++;
-        return source[pos.index++];
+        return source[pos++];
     }
 
-    string_view get_substr_from_start(SourcePosition start_pos) {
-        if (start_pos.index >= ssize(source) || pos.index > ssize(source) ||
-            start_pos.index > pos.index) {
+    string_view get_substr_from_start(offset_t start) {
+        if (start >= source.size() || pos > source.size() || start > pos) {
             throw runtime_error(
                 "Invalid source position for substring extraction");
         }
-        return source.substr(
-            start_pos.index, static_cast<size_t>(pos.index - start_pos.index));
+        return source.substr(start, pos - start);
+    }
+
+    char const* cursor() const { return source.data() + pos; }
+
+    char const* source_end() const { return source.data() + source.size(); }
+
+    // Moves to `p`, which must be at or past the cursor.
+    void advance_to(char const* p) {
+        pos = static_cast<offset_t>(p - source.data());
     }
 
     void skip_whitespace() {
         while (!is_at_end()) {
             char const c = peek();
-            if (std::isspace(c) != 0) {
-                if (c == '\n') {
-                    pos.lineno++;
-                    pos.colno = 0;
-                }
-                advance();
+            if (has_char_class(c, char_class::space)) {
+                advance_to(scan_run<CharRun::Space>(cursor(), source_end()));
             } else if (c == '/') {
                 if (peek(1) == '/') {
                     // line comment //
-                    advance();
-                    advance(); // consume '//'
-                    while (!is_at_end() && peek() != '\n') {
-                        advance();
-                    }
+                    advance_to(cursor() + 2); // consume '//'
+                    advance_to(
+                        scan_run<CharRun::NotNewline>(cursor(), source_end()));
                 } else {
                     break;
                 }
@@ -378,35 +758,29 @@ class Lexer {
     }
 
     Token lex_identifier() {
-        static std::unordered_map<string_view, TokenKind> keyword_map = []() {
-            std::unordered_map<string_view, TokenKind> m;
-            for (TokenKind const k : get_keywords()) {
-                m[to_string(k)] = k;
-            }
-            return m;
-        }();
-
-        SourcePosition const start_pos = pos;
-        while (!is_at_end() && is_ident_part(peek())) {
-            advance();
-        }
-        string_view const text = get_substr_from_start(start_pos);
-        if (auto it = keyword_map.find(text); it != keyword_map.end()) {
-            return {.kind = it->second, .lexeme = "", .pos = start_pos};
+        offset_t const start = pos;
+        advance_to(scan_run<CharRun::IdentPart>(cursor(), source_end()));
+        string_view const text = get_substr_from_start(start);
+        if (TokenKind const kw = lookup_keyword(text);
+            kw != TokenKind::Identifier) {
+            return {.kind = kw, .lexeme = "", .offset = start};
         }
 
         return {
-            .kind = TokenKind::Identifier, .lexeme = text, .pos = start_pos};
+            .kind = TokenKind::Identifier,
+            .lexeme = text,
+            .offset = start,
+            .symbol = interner->intern(text)};
     }
 
-    static bool is_digit(char c) { return std::isdigit(c) != 0; }
+    static bool is_digit(char c) {
+        return has_char_class(c, char_class::digit);
+    }
 
     Token lex_number() {
-        SourcePosition const start_pos = pos;
+        offset_t const start = pos;
 
-        while (!is_at_end() && is_digit(peek())) {
-            advance();
-        }
+        advance_to(scan_run<CharRun::Digit>(cursor(), source_end()));
 
         TokenKind kind = TokenKind::Error;
 
@@ -414,29 +788,26 @@ class Lexer {
         if (peek() == '.') {
             kind = TokenKind::FloatLiteral;
             advance(); // Consume .
-            while (is_digit(peek())) {
-                advance();
-            }
+            advance_to(scan_run<CharRun::Digit>(cursor(), source_end()));
         } else {
             kind = TokenKind::IntLiteral;
         }
 
         return {
             .kind = kind,
-            .lexeme =
-                source.substr(start_pos.index, pos.index - start_pos.index),
-            .pos = start_pos};
+            .lexeme = source.substr(start, pos - start),
+            .offset = start};
     }
 
     Token lex_char_literal() {
         advance(); // 消费开头的 '
-        SourcePosition start_pos = pos;
+        offset_t const start = pos;
 
         // 检查空字符 ''
         if (peek() == '\'') {
             advance();
             errors.push_back("Empty character literal");
-            return {TokenKind::Error, "", start_pos};
+            return {TokenKind::Error, "", start};
         }
 
         // 处理转义字符
@@ -445,7 +816,7 @@ class Lexer {
             char escaped = peek();
             if (escaped == '\0' || escaped == '\n') {
                 errors.push_back("Unterminated escape sequence");
-                return {TokenKind::Error, "", start_pos};
+                return {TokenKind::Error, "", start};
             }
             // 支持常见转义：\n, \t, \\, \'
             if (escaped == 'n' || escaped == 't' || escaped == '\\' ||
@@ -454,7 +825,7 @@ class Lexer {
             } else {
                 errors.push_back(
                     std::format("Invalid escape sequence '\\{}'", escaped));
-                return {TokenKind::Error, "", start_pos};
+                return {TokenKind::Error, "", start};
             }
         } else {
             advance(); // 消费普通字符
@@ -463,19 +834,18 @@ class Lexer {
         // 确保后面是闭合的单引号
         if (peek() != '\'') {
             errors.push_back("Multi-character character literal not allowed");
-            return {TokenKind::Error, "", start_pos};
+            return {TokenKind::Error, "", start};
         }
         advance(); // 消费最后的 '
 
         // 提取字符内容（不包含引号）
-        string_view content =
-            source.substr(start_pos.index, pos.index - start_pos.index - 1);
-        return {TokenKind::CharLiteral, content, start_pos};
+        string_view content = source.substr(start, pos - start - 1);
+        return {TokenKind::CharLiteral, content, start};
     }
 
     Token lex_string_literal() {
         advance(); // consume "
-        SourcePosition const start_pos = pos;
+        offset_t const start = pos;
 
         while (!is_at_end()) {
             char const c = peek();
@@ -489,37 +859,38 @@ class Lexer {
                 continue;
             }
             if (c == '\n') {
-                SourcePosition const err_pos = pos; // 记录错误位置
-                advance();                          // 消费换行符
+                offset_t const err_pos = pos; // 记录错误位置
+                advance();                    // 消费换行符
                 errors.emplace_back("New line in string");
-                return {.kind = TokenKind::Error, .lexeme = "", .pos = err_pos};
+                return {
+                    .kind = TokenKind::Error, .lexeme = "", .offset = err_pos};
             }
             if (c == '"') {
                 // 提取字符串内容，不包括开头和结尾的引号
-                string_view const content = get_substr_from_start(start_pos);
+                string_view const content = get_substr_from_start(start);
                 advance(); // 消费闭引号
                 return {
                     .kind = TokenKind::StringLiteral,
                     .lexeme = content,
-                    .pos = start_pos};
+                    .offset = start};
             }
             advance();
         }
         errors.emplace_back("Unterminated string");
-        return {.kind = TokenKind::Error, .lexeme = "", .pos = start_pos};
+        return {.kind = TokenKind::Error, .lexeme = "", .offset = start};
     }
 
     Token lex_symbol() { // NOLINT(readability-function-cognitive-complexity)
         auto make_token = [&](TokenKind kind) {
-            SourcePosition const start_pos = pos;
-            for (int i = 0; i < ssize(to_string(kind)); ++i) {
+            offset_t const start = pos;
+            for (size_t i = 0; i < to_string(kind).size(); ++i) {
                 advance();
             }
-            if (get_substr_from_start(start_pos) != to_string(kind)) {
+            if (get_substr_from_start(start) != to_string(kind)) {
                 throw runtime_error(
                     "Internal error: lexed symbol does not match expected");
             }
-            return Token(kind, "", start_pos);
+            return Token(kind, "", start);
         };
 
         char const c = peek();
@@ -689,14 +1060,17 @@ class Lexer {
         case '$':
             return make_token(TokenKind::Dollar);
 
-        default:
+        default: {
+            offset_t const start = pos;
             errors.push_back(
-                "Unexpected character: " + string(source.substr(pos.index, 1)) +
-                " at pos " + pos.to_string());
+                "Unexpected character: " + string(source.substr(start, 1)) +
+                " at pos " + position_of(start).to_string());
+            advance(); // skip it, so that lexing always makes progress
             return {
                 .kind = TokenKind::Error,
-                .lexeme = source.substr(pos.index, 1),
-                .pos = pos};
+                .lexeme = source.substr(start, 1),
+                .offset = start};
+        }
         }
     }
 };
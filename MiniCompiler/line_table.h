@@ -0,0 +1,98 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// line_table.h
+
+#pragma once
+
+#include "scan.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::string;
+using std::string_view;
+using std::vector;
+
+using lineno_t = int32_t;
+using colno_t = int32_t;
+using index_t = int32_t;
+using offset_t = uint32_t; // byte offset into program source
+
+struct SourcePosition {
+    lineno_t lineno = 1; // one-based offset into program source
+    colno_t colno = 1;   // one-based offset into line
+    index_t index = 0;
+
+    SourcePosition() = default;
+
+    SourcePosition(lineno_t l, colno_t c, index_t i)
+        : lineno{l}, colno{c}, index(i) {}
+
+    auto operator<=>(SourcePosition const&) const = default;
+
+    auto to_string() const -> string {
+        return format("({}, {}) i={}", lineno, colno, index);
+    }
+};
+
+// Maps byte offsets to line/column on demand. Tokens only carry an offset;
+// the table is built when a diagnostic or a dump needs positions.
+class LineTable {
+  public:
+    explicit LineTable(string_view source) {
+        line_starts.push_back(0);
+        char const* const begin = source.data();
+        char const* const end = begin + source.size();
+        for (char const* p = scan_run<CharRun::NotNewline>(begin, end);
+             p != end;
+             p = scan_run<CharRun::NotNewline>(p + 1, end)) {
+            line_starts.push_back(static_cast<offset_t>(p + 1 - begin));
+        }
+    }
+
+    SourcePosition resolve(offset_t offset) const {
+        auto const it =
+            std::upper_bound(line_starts.begin(), line_starts.end(), offset);
+        auto const line = static_cast<lineno_t>(it - line_starts.begin());
+        offset_t const line_start = *(it - 1);
+        return {
+            line,
+            static_cast<colno_t>(offset - line_start + 1),
+            static_cast<index_t>(offset)};
+    }
+
+    // resolve() for offsets visited in nondecreasing order: `line` (start
+    // it at 0) remembers where the previous offset was found, so a dump of
+    // all tokens walks the table once instead of searching it per token.
+    SourcePosition resolve_next(offset_t offset, size_t& line) const {
+        if (line >= line_starts.size() || offset < line_starts[line]) {
+            // out of order after all
+            line = static_cast<size_t>(
+                std::upper_bound(
+                    line_starts.begin(), line_starts.end(), offset) -
+                line_starts.begin() - 1);
+        }
+        while (line + 1 < line_starts.size() &&
+               line_starts[line + 1] <= offset) {
+            ++line;
+        }
+        return {
+            static_cast<lineno_t>(line + 1),
+            static_cast<colno_t>(offset - line_starts[line] + 1),
+            static_cast<index_t>(offset)};
+    }
+
+    size_t line_count() const { return line_starts.size(); }
+
+  private:
+    vector<offset_t> line_starts; // offset of the first byte of each line
+};
+
+} // namespace mini_compiler
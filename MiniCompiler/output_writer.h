@@ -0,0 +1,178 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// output_writer.h
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace mini_compiler {
+
+using std::string;
+using std::string_view;
+
+// ==========================================
+// Buffered output writer
+// ==========================================
+//
+// Collects dump text in one large buffer and hands it to the stream a
+// buffer at a time, so printing a node costs a few memcpy()s instead of a
+// stream insertion per piece. Formatting goes straight into the buffer
+// (std::format_to_n), numbers through std::to_chars and indentation is
+// copied from a run of spaces.
+//
+// The buffer is recycled per thread, so writing a file allocates nothing
+// after the first. Output is flushed when the buffer fills, on flush() and
+// on destruction; until then nothing reaches the stream.
+
+class OutputWriter {
+  public:
+    static constexpr size_t default_capacity = size_t{256} << 10;
+
+    explicit OutputWriter(
+        std::ostream& out, size_t capacity = default_capacity)
+        : sink(&out), buffer(take_buffer(capacity)) {
+        end = buffer.data.get();
+        limit = end + buffer.size;
+    }
+
+    OutputWriter(OutputWriter const&) = delete;
+    OutputWriter& operator=(OutputWriter const&) = delete;
+
+    ~OutputWriter() {
+        flush();
+        Buffer& spare = spare_buffer();
+        if (spare.size < buffer.size) {
+            spare = std::move(buffer);
+        }
+    }
+
+    OutputWriter& operator<<(string_view text) {
+        write(text);
+        return *this;
+    }
+
+    OutputWriter& operator<<(char c) {
+        put(c);
+        return *this;
+    }
+
+    void put(char c) {
+        if (end == limit) {
+            flush();
+        }
+        *end++ = c;
+    }
+
+    void write(string_view text) {
+        if (text.size() > available()) {
+            flush();
+            if (text.size() > buffer.size) {
+                sink->write(
+                    text.data(), static_cast<std::streamsize>(text.size()));
+                return;
+            }
+        }
+        std::memcpy(end, text.data(), text.size());
+        end += text.size();
+    }
+
+    // std::format into the buffer.
+    template <typename... Args>
+    void print(std::format_string<Args const&...> fmt, Args const&... args) {
+        auto const result = std::format_to_n(
+            end, static_cast<std::ptrdiff_t>(available()), fmt, args...);
+        if (static_cast<size_t>(result.size) <= available()) {
+            end = result.out;
+            return;
+        }
+        // did not fit: the text is rare enough to format twice
+        write(std::format(fmt, args...));
+    }
+
+    void spaces(size_t count) {
+        static constexpr string_view run =
+            "                                                                ";
+        while (count > run.size()) {
+            write(run);
+            count -= run.size();
+        }
+        write(run.substr(0, count));
+    }
+
+    // `text` right-aligned in `width` columns, exactly like "{:>width}".
+    void write_right(string_view text, size_t width) {
+        if (!is_ascii(text)) {
+            // std::format measures display width, not bytes
+            print("{:>{}}", text, width);
+            return;
+        }
+        if (text.size() < width) {
+            spaces(width - text.size());
+        }
+        write(text);
+    }
+
+    void write_right(std::integral auto value, size_t width) {
+        char digits[24];
+        auto const result =
+            std::to_chars(digits, digits + sizeof(digits), value);
+        write_right(
+            string_view(digits, static_cast<size_t>(result.ptr - digits)),
+            width);
+    }
+
+    void flush() {
+        if (end != buffer.data.get()) {
+            sink->write(
+                buffer.data.get(), static_cast<std::streamsize>(used()));
+            end = buffer.data.get();
+        }
+    }
+
+  private:
+    struct Buffer {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+    };
+
+    std::ostream* sink;
+    Buffer buffer;
+    char* end = nullptr;
+    char* limit = nullptr;
+
+    size_t used() const { return static_cast<size_t>(end - buffer.data.get()); }
+
+    size_t available() const { return static_cast<size_t>(limit - end); }
+
+    static bool is_ascii(string_view text) {
+        return std::ranges::all_of(
+            text, [](char c) { return static_cast<unsigned char>(c) < 0x80; });
+    }
+
+    static Buffer& spare_buffer() {
+        thread_local Buffer spare;
+        return spare;
+    }
+
+    static Buffer take_buffer(size_t capacity) {
+        capacity = std::max<size_t>(capacity, 64);
+        Buffer& spare = spare_buffer();
+        if (spare.size >= capacity) {
+            return std::exchange(spare, {});
+        }
+        return {std::make_unique_for_overwrite<char[]>(capacity), capacity};
+    }
+};
+
+} // namespace mini_compiler
@@ -0,0 +1,125 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// parallel_lexer.h
+
+#pragma once
+
+#include "lexer.h"
+#include "line_table.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Parallel chunked lexing
+// ==========================================
+//
+// 1. The source is cut into chunks at line starts.
+// 2. Every chunk is lexed on the pool, starting at its line start and
+//    keeping the tokens that begin inside it.
+// 3. A line start is a token boundary unless the previous chunk's last
+//    token runs past it: there are no block comments and strings reject
+//    raw newlines, so only a backslash-escaped newline inside a string can
+//    do that. Such chunks are lexed again from where the previous one
+//    really stopped.
+// 4. The chunk buffers are concatenated. Tokens carry absolute offsets and
+//    positions are resolved through a LineTable, so no line fixups are
+//    needed.
+// If a (reconciled) chunk hits a lex error, the whole source is lexed again
+// sequentially so the errors are reported exactly as tokenize() reports
+// them.
+
+namespace detail {
+
+// Chunk starts: 0, then line starts near every multiple of size / chunks.
+inline vector<offset_t> chunk_starts(string_view source, size_t chunks) {
+    vector<offset_t> starts{0};
+    for (size_t i = 1; i < chunks; ++i) {
+        size_t const target = source.size() / chunks * i;
+        if (target <= starts.back()) {
+            continue;
+        }
+        void const* const nl = std::memchr(
+            source.data() + target, '\n', source.size() - target);
+        if (nl == nullptr) {
+            break;
+        }
+        size_t const start =
+            static_cast<char const*>(nl) - source.data() + 1;
+        if (start >= source.size()) {
+            break;
+        }
+        starts.push_back(static_cast<offset_t>(start));
+    }
+    return starts;
+}
+
+} // namespace detail
+
+// Same result as Lexer(source, interner).tokenize(), lexed on `pool`.
+// Sources shorter than two chunks of `min_chunk_bytes` are lexed
+// sequentially.
+inline TokenBuffer tokenize_parallel(
+    string_view source,
+    ThreadPool& pool,
+    Interner& interner = global_interner(),
+    size_t min_chunk_bytes = size_t{1} << 20) {
+    // a few chunks per thread balance uneven lines
+    size_t const chunks = std::min(
+        (pool.size() + 1) * 4,
+        source.size() / std::max<size_t>(min_chunk_bytes, 1));
+    if (chunks < 2) {
+        return Lexer(source, interner).tokenize();
+    }
+    vector<offset_t> const starts = detail::chunk_starts(source, chunks);
+    size_t const n = starts.size();
+    // the last chunk also keeps the End token at source.size()
+    auto chunk_end = [&](size_t i) {
+        return i + 1 < n ? size_t{starts[i + 1]} : source.size() + 1;
+    };
+
+    vector<TokenBuffer> parts(n, TokenBuffer(source));
+    vector<Lexer::RangeResult> results(n);
+    pool.parallel_for(n, [&](size_t i) {
+        parts[i].reserve((chunk_end(i) - starts[i]) / 4);
+        results[i] = Lexer(source, interner)
+                         .tokenize_range(starts[i], chunk_end(i), parts[i]);
+    });
+
+    offset_t stop = 0; // where the previous chunk's last token ended
+    size_t total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (stop > starts[i]) {
+            // the start was inside a token; lex the chunk from its real start
+            parts[i] = TokenBuffer(source);
+            results[i] = Lexer(source, interner)
+                             .tokenize_range(stop, chunk_end(i), parts[i]);
+        }
+        if (!results[i].ok) {
+            return Lexer(source, interner).tokenize(); // reports every error
+        }
+        stop = std::max(stop, results[i].stop);
+        total += parts[i].size();
+    }
+
+    TokenBuffer tokens(source);
+    tokens.reserve(total + 1);
+    for (auto const& part : parts) {
+        tokens.append(part);
+    }
+    tokens.push_back(
+        {.kind = TokenKind::End,
+         .lexeme = "",
+         .offset = static_cast<offset_t>(source.size())});
+    return tokens;
+}
+
+} // namespace mini_compiler
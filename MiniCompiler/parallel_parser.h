@@ -0,0 +1,134 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// parallel_parser.h
+
+#pragma once
+
+#include "ast_arena.h"
+#include "lexer.h"
+#include "parser.h"
+#include "thread_pool.h"
+#include "token_stream.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::vector;
+
+// ==========================================
+// Parallel parsing of top-level items
+// ==========================================
+//
+// Top-level `fn` and `let` statements are independent subtrees. A pre-pass
+// over the token kinds finds where they start (outside any braces or
+// parentheses, where `fn`/`let` can only begin a statement), consecutive
+// items are grouped into chunks of roughly equal token count, and every
+// chunk is parsed by its own Parser into its own arena. The statements are
+// then stitched together in source order.
+//
+// If any chunk fails, the whole buffer is parsed again sequentially so the
+// error is reported exactly as Parser::parse() would report it.
+
+// Token indices at which top-level items start; the first is always 0.
+inline vector<size_t> split_top_level_items(TokenBuffer const& tokens) {
+    vector<size_t> starts{0};
+    TokenKind const* const kinds = tokens.kind_data();
+    size_t const n = tokens.size();
+    ptrdiff_t depth = 0;
+    for (size_t i = 0; i < n; ++i) {
+        switch (kinds[i]) {
+        case TokenKind::LeftBrace:
+        case TokenKind::LeftParen:
+            ++depth;
+            break;
+        case TokenKind::RightBrace:
+        case TokenKind::RightParen:
+            --depth; // unbalanced input fails in some chunk
+            break;
+        case TokenKind::KwFn:
+        case TokenKind::KwLet:
+            if (depth == 0 && i != 0) {
+                starts.push_back(i);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return starts;
+}
+
+namespace detail {
+
+// Groups item starts into chunk boundaries [b0, b1, ..., end] of at least
+// `min_tokens` tokens each (except possibly the last).
+inline vector<size_t> chunk_boundaries(
+    vector<size_t> const& starts, size_t end, size_t min_tokens) {
+    vector<size_t> bounds{0};
+    for (size_t const start : starts) {
+        if (start - bounds.back() >= min_tokens) {
+            bounds.push_back(start);
+        }
+    }
+    if (bounds.back() != end) {
+        bounds.push_back(end);
+    }
+    return bounds;
+}
+
+} // namespace detail
+
+// Parses `tokens` on `pool`; the result is identical to
+// Parser(tokens).parse(), including the exception thrown on errors. Chunks
+// are at least `min_chunk_tokens` long so tiny items are not scheduled one
+// by one.
+inline Program parse_parallel(
+    TokenBuffer const& tokens,
+    ThreadPool& pool,
+    size_t min_chunk_tokens = 4096) {
+    if (tokens.empty()) {
+        return Parser(tokens).parse(); // throws the usual error
+    }
+    // ~8 chunks per thread balances uneven item sizes
+    size_t const end = tokens.size() - 1; // the End token
+    size_t const min_tokens =
+        std::max<size_t>(end / ((pool.size() + 1) * 8), min_chunk_tokens);
+    vector<size_t> const bounds = detail::chunk_boundaries(
+        split_top_level_items(tokens), end, min_tokens);
+    size_t const chunks = bounds.size() - 1;
+    if (chunks <= 1) {
+        return Parser(tokens).parse();
+    }
+
+    vector<Program> parts(chunks);
+    try {
+        pool.parallel_for(chunks, [&](size_t i) {
+            Parser parser(tokens, bounds[i], bounds[i + 1]);
+            parts[i] = parser.parse();
+        });
+    } catch (std::exception const&) {
+        // re-parse for an exact error message and position
+        return Parser(tokens).parse();
+    }
+
+    Program program;
+    size_t total = 0;
+    for (auto const& part : parts) {
+        total += part.statements.size();
+    }
+    program.statements.reserve(total);
+    for (auto& part : parts) {
+        program.statements.insert(
+            program.statements.end(),
+            part.statements.begin(),
+            part.statements.end());
+        program.arena->adopt(std::move(part.arena));
+    }
+    return program;
+}
+
+} // namespace mini_compiler
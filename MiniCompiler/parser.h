@@ -3,8 +3,12 @@
 
 #pragma once
 
+#include "ast_arena.h"
 #include "lexer.h"
+#include "output_writer.h"
+#include "token_stream.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstdint>
 #include <cstdlib>
@@ -35,11 +39,13 @@ using std::vector;
 struct Expr;
 struct Stmt;
 
-using ExprPtr = std::unique_ptr<Expr>;
-using StmtPtr = std::unique_ptr<Stmt>;
+// Nodes live in the AstArena of their Program; these pointers do not own.
+using ExprPtr = Expr*;
+using StmtPtr = Stmt*;
 
 struct Identifier {
     string_view name;
+    Symbol symbol = no_symbol; // in the interner the lexer used
 };
 
 enum class BuiltInType : uint8_t {
@@ -72,6 +78,20 @@ constexpr string_view to_string(BuiltInType const type) {
     throw runtime_error("Unknown type");
 }
 
+// Built-in types are predefined symbols 0, 1, ... (lexer.h).
+constexpr Symbol symbol_of(BuiltInType type) {
+    return static_cast<Symbol>(type);
+}
+
+static_assert([] {
+    for (size_t i = 0; i < builtin_type_names.size(); ++i) {
+        if (builtin_type_names[i] != to_string(static_cast<BuiltInType>(i))) {
+            return false;
+        }
+    }
+    return true;
+}());
+
 struct Type {
     std::optional<BuiltInType> built_in_type; // For built-in types
     Identifier name;                          // For custom types
@@ -100,7 +120,7 @@ struct BinaryExpr {
 
 struct CallExpr {
     Identifier callee;
-    vector<ExprPtr> args;
+    AstVector<ExprPtr> args;
 };
 
 struct ReturnExpr {
@@ -113,7 +133,7 @@ struct AssignExpr {
 };
 
 struct BlockExpr {
-    vector<StmtPtr> statements;
+    AstVector<StmtPtr> statements;
     optional<ExprPtr> final_expr;
 };
 
@@ -128,9 +148,13 @@ struct WhileExpr {
     BlockExpr body;
 };
 
-struct BreakExpr {};
+struct BreakExpr {
+    string_view keyword; // "break" in the source, for diagnostics
+};
 
-struct ContinueExpr {};
+struct ContinueExpr {
+    string_view keyword; // "continue" in the source, for diagnostics
+};
 
 struct ForExpr {
     Identifier loop_var;
@@ -151,7 +175,7 @@ struct Param {
 
 struct FunctionDecl {
     Identifier name;
-    vector<Param> params;
+    AstVector<Param> params;
     Type return_type;
     BlockExpr body;
 };
@@ -174,8 +198,8 @@ struct Expr {
         ForExpr>;
     Node node;
 
-    template <typename T> static ExprPtr make(T&& value) {
-        return std::make_unique<Expr>(std::forward<T>(value));
+    template <typename T> static ExprPtr make(AstArena& arena, T&& value) {
+        return arena.create<Expr>(std::forward<T>(value));
     }
 };
 
@@ -187,12 +211,13 @@ struct Stmt {
     using Node = std::variant<ExprStmt, VarDecl, FunctionDecl>;
     Node node;
 
-    template <typename T> static StmtPtr make(T&& value) {
-        return std::make_unique<Stmt>(std::forward<T>(value));
+    template <typename T> static StmtPtr make(AstArena& arena, T&& value) {
+        return arena.create<Stmt>(std::forward<T>(value));
     }
 };
 
 struct Program {
+    std::unique_ptr<AstArena> arena = std::make_unique<AstArena>();
     vector<StmtPtr> statements;
 };
 
@@ -200,14 +225,28 @@ struct Program {
 // 4. Parser
 // ==========================================
 
-class Parser {
+// `Tokens` is a token source (see token_stream.h): TokenCursor for a
+// materialized TokenBuffer, TokenStream for lexing on demand.
+template <typename Tokens> class BasicParser {
   public:
-    explicit Parser(vector<Token> tokens) : tokens(std::move(tokens)) {}
+    // The deepest peek()/match() offset the grammar needs; streaming sources
+    // size their window from it.
+    static constexpr index_t max_lookahead = 1;
+
+    template <typename... Args>
+    explicit BasicParser(Args&&... args)
+        : tokens(std::forward<Args>(args)...) {}
 
     Program parse() {
         Program program;
-        while (!match(TokenKind::End)) {
-            program.statements.push_back(parse_statement());
+        arena = program.arena.get();
+        try {
+            while (!match(TokenKind::End)) {
+                program.statements.push_back(parse_statement());
+            }
+        } catch (runtime_error const&) {
+            tokens.finish(); // lex errors come first
+            throw;
         }
         return program;
     }
@@ -215,29 +254,40 @@ class Parser {
     auto debug_print(std::ostream& o) const -> void;
 
   private:
-    vector<Token> tokens;
-    index_t pos = 0;
+    Tokens tokens;
+    AstArena* arena = nullptr; // of the Program being parsed
 
-    Token const& peek(index_t offset = 0) const {
+    // explicit stacks of the expression parser, reused across expressions
+    vector<ExprPtr> operand_stack;
+    vector<TokenKind> operator_stack;
+    vector<TokenKind> prefix_stack;
+
+    void check_lookahead(index_t offset) const {
         if (offset < 0) {
             throw error("Negative lookahead not supported");
         }
-        if (pos < 0) {
-            throw error("Negative position not supported");
-        }
-        if (pos + offset >= ssize(tokens)) {
-            return tokens.back();
+        if (offset > max_lookahead) {
+            throw error("Lookahead exceeds max_lookahead");
         }
-        return tokens[static_cast<size_t>(pos) + offset];
+    }
+
+    Token peek(index_t offset = 0) const {
+        check_lookahead(offset);
+        return tokens.peek(static_cast<size_t>(offset));
+    }
+
+    TokenKind peek_kind(index_t offset = 0) const {
+        check_lookahead(offset);
+        return tokens.kind(static_cast<size_t>(offset));
     }
 
     bool match(TokenKind kind, int offset = 0) const {
-        return peek(offset).kind == kind;
+        return peek_kind(offset) == kind;
     }
 
     Token advance() {
         Token token = peek();
-        pos++;
+        tokens.advance();
         return token;
     }
 
@@ -254,40 +304,40 @@ class Parser {
             throw error(format(
                 "expected {}, got {} {}",
                 string(to_string(kind)),
-                string(to_string(peek().kind)),
+                string(to_string(peek_kind())),
                 msg));
         }
         return advance();
     }
 
+    // Keyword tokens carry no lexeme; this returns the keyword's text in
+    // the source instead.
+    string_view expect_keyword(TokenKind kind) {
+        Token const token = expect(kind);
+        return tokens.source().substr(token.offset, to_string(kind).size());
+    }
+
     runtime_error error(string_view msg) const {
-        return runtime_error(string(msg) + " at pos " + peek().pos.to_string());
+        SourcePosition const at =
+            LineTable(tokens.source()).resolve(tokens.peek().offset);
+        return runtime_error(string(msg) + " at pos " + at.to_string());
     }
 
     Identifier parse_identifier() {
-        return {expect(TokenKind::Identifier).lexeme};
+        Token const token = expect(TokenKind::Identifier);
+        return {.name = token.lexeme, .symbol = token.symbol};
     }
 
     // type = "int" | "float" | "char" | "string" | "bool"
     Type parse_type() {
-        auto token = expect(TokenKind::Identifier);
+        Identifier const name = parse_identifier();
         optional<BuiltInType> type;
-        if (token.lexeme == "int") {
-            type = BuiltInType::Int;
-        }
-        if (token.lexeme == "float") {
-            type = BuiltInType::Float;
+        // the spellable built-in types have consecutive symbols
+        if (name.symbol >= symbol_of(BuiltInType::Bool) &&
+            name.symbol <= symbol_of(BuiltInType::String)) {
+            type = static_cast<BuiltInType>(name.symbol);
         }
-        if (token.lexeme == "char") {
-            type = BuiltInType::Char;
-        }
-        if (token.lexeme == "string") {
-            type = BuiltInType::String;
-        }
-        if (token.lexeme == "bool") {
-            type = BuiltInType::Bool;
-        }
-        return {.built_in_type = type, .name = {token.lexeme}};
+        return {.built_in_type = type, .name = name};
     }
 
     LiteralExpr parse_literal() {
@@ -321,17 +371,17 @@ class Parser {
 
         // function_call starts with Ident "(" ... ")"
         if (!accept(TokenKind::LeftParen)) {
-            return Expr::make(name);
+            return Expr::make(*arena, name);
         }
 
-        vector<ExprPtr> args;
+        AstVector<ExprPtr> args(arena->resource());
         if (!match(TokenKind::RightParen)) {
             do {
                 args.push_back(parse_expression());
             } while (accept(TokenKind::Comma));
         }
         expect(TokenKind::RightParen, "after arguments");
-        return Expr::make(CallExpr(name, std::move(args)));
+        return Expr::make(*arena, CallExpr(name, std::move(args)));
     }
 
     ExprPtr parse_if_expression() {
@@ -344,11 +394,12 @@ class Parser {
             if (match(TokenKind::KwIf)) {
                 else_block = parse_if_expression();
             } else {
-                else_block = Expr::make(parse_block_expression());
+                else_block = Expr::make(*arena, parse_block_expression());
             }
         }
 
         return Expr::make(
+            *arena,
             IfExpr{
                 .condition = std::move(condition),
                 .then_block = std::move(then_block),
@@ -360,18 +411,20 @@ class Parser {
         auto condition = parse_expression();
         auto body = parse_block_expression();
         return Expr::make(
+            *arena,
             WhileExpr{
                 .condition = std::move(condition), .body = std::move(body)});
     }
 
     ExprPtr parse_break_expression() {
-        expect(TokenKind::KwBreak);
-        return Expr::make(BreakExpr{});
+        return Expr::make(
+            *arena, BreakExpr{.keyword = expect_keyword(TokenKind::KwBreak)});
     }
 
     ExprPtr parse_continue_expression() {
-        expect(TokenKind::KwContinue);
-        return Expr::make(ContinueExpr{});
+        return Expr::make(
+            *arena,
+            ContinueExpr{.keyword = expect_keyword(TokenKind::KwContinue)});
     }
 
     ExprPtr parse_for_expression() {
@@ -388,6 +441,7 @@ class Parser {
         // 解析循环体（块）
         auto body = parse_block_expression();
         return Expr::make(
+            *arena,
             ForExpr{
                 .loop_var = loop_var,
                 .iter_expr = std::move(iter_expr),
@@ -405,7 +459,7 @@ class Parser {
 
         // 新增：块表达式作为 primary
         if (match(TokenKind::LeftBrace)) {
-            return Expr::make(parse_block_expression());
+            return Expr::make(*arena, parse_block_expression());
         }
 
         // 控制流表达式
@@ -434,63 +488,102 @@ class Parser {
             return parse_call_expression(); // 可能是标识符或函数调用
         }
 
-        return Expr::make(parse_literal());
+        return Expr::make(*arena, parse_literal());
     }
 
     // parse unary operators
+    // unary = { prefix_op } primary { postfix_op }
+    // Prefix operators are collected on an explicit stack and applied
+    // innermost first, so "- - - x" does not recurse once per operator.
     ExprPtr parse_unary_expression() {
-        // 前缀一元运算符（可连续）
-        if (is_prefix_unary(peek().kind)) {
-            TokenKind const op = advance().kind;
-            auto operand = parse_unary_expression();
-            return Expr::make(
-                PrefixExpr{.op = op, .operand = std::move(operand)});
+        size_t const prefix_base = prefix_stack.size();
+        while (is_prefix_unary(peek_kind())) {
+            prefix_stack.push_back(advance().kind);
         }
 
         // 基础表达式（primary）
         auto expr = parse_primary_expression();
 
         // 后缀一元运算符（可连续）
-        while (is_postfix_unary(peek().kind)) {
+        while (is_postfix_unary(peek_kind())) {
             TokenKind const op = advance().kind;
-            expr =
-                Expr::make(PostfixExpr{.op = op, .operand = std::move(expr)});
+            expr = Expr::make(
+                *arena, PostfixExpr{.op = op, .operand = std::move(expr)});
         }
 
+        // 前缀运算符作用于整个后缀表达式：-x++ 为 -(x++)
+        while (prefix_stack.size() > prefix_base) {
+            TokenKind const op = prefix_stack.back();
+            prefix_stack.pop_back();
+            expr = Expr::make(
+                *arena, PrefixExpr{.op = op, .operand = std::move(expr)});
+        }
         return expr;
     }
 
-    // The core precedence-climbing routine:
-    // parse expressions whose precedence is >= min_prec.
-    ExprPtr parse_binary_expression(int min_precedence) {
-        auto left = parse_unary_expression();
-
+    // Operator-precedence (shunting-yard) parse of a binary expression, all
+    // operators left-associative. Operands and pending operators live on
+    // explicit stacks, so long chains such as "a + b + c + ..." take
+    // constant stack depth. Nested calls (from parenthesized operands) share
+    // the stacks above their own base.
+    ExprPtr parse_binary_expression() {
+        size_t const operand_base = operand_stack.size();
+        size_t const operator_base = operator_stack.size();
+
+        // 弹出栈顶运算符及其两个操作数，合成 BinaryExpr
+        auto reduce = [&] {
+            TokenKind const op = operator_stack.back();
+            operator_stack.pop_back();
+            ExprPtr rhs = operand_stack.back();
+            operand_stack.pop_back();
+            ExprPtr& lhs = operand_stack.back();
+            lhs = Expr::make(
+                *arena, BinaryExpr{.op = op, .lhs = lhs, .rhs = rhs});
+        };
+
+        operand_stack.push_back(parse_unary_expression());
         while (true) {
-            TokenKind const op = peek().kind;
+            TokenKind const op = peek_kind();
             int const precedence = get_precedence(op);
-            // 如果当前运算符优先级低于门槛，或者不是运算符，则停止
-            if (precedence < min_precedence) {
+            // 不是二元运算符则停止
+            if (precedence < 0) {
                 break;
             }
             advance(); // consume operator
-            // 递归解析右操作数，使用当前优先级 + 1（左结合）
-            auto right = parse_binary_expression(precedence + 1);
-            left = Expr::make(
-                BinaryExpr{
-                    .op = op, .lhs = std::move(left), .rhs = std::move(right)});
+            // 左结合：先归约栈顶优先级不低于当前运算符的部分
+            while (operator_stack.size() > operator_base &&
+                   get_precedence(operator_stack.back()) >= precedence) {
+                reduce();
+            }
+            operator_stack.push_back(op);
+            operand_stack.push_back(parse_unary_expression());
         }
-        return left;
+        while (operator_stack.size() > operator_base) {
+            reduce();
+        }
+
+        ExprPtr const result = operand_stack.back();
+        operand_stack.resize(operand_base);
+        return result;
     }
 
-    // assignment_expr = expression "=" expression ";"
+    // assignment_expr = expression { "=" expression }
+    // Right-associative: the targets are collected first and folded from the
+    // right, so "a = b = c" is a = (b = c).
     ExprPtr parse_assignment_expression() {
-        auto lhs = parse_binary_expression(0);
-        if (accept(TokenKind::Assignment)) {
-            auto rhs = parse_assignment_expression();
-            return Expr::make(
-                AssignExpr{.lhs = std::move(lhs), .rhs = std::move(rhs)});
+        size_t const operand_base = operand_stack.size();
+        operand_stack.push_back(parse_binary_expression());
+        while (accept(TokenKind::Assignment)) {
+            operand_stack.push_back(parse_binary_expression());
         }
-        return lhs;
+        ExprPtr rhs = operand_stack.back();
+        operand_stack.pop_back();
+        while (operand_stack.size() > operand_base) {
+            ExprPtr const lhs = operand_stack.back();
+            operand_stack.pop_back();
+            rhs = Expr::make(*arena, AssignExpr{.lhs = lhs, .rhs = rhs});
+        }
+        return rhs;
     }
 
     // return_expr = "return" [ expression ] ";"
@@ -500,7 +593,7 @@ class Parser {
         if (!match(TokenKind::Semicolon)) {
             value = parse_expression();
         }
-        return Expr::make(ReturnExpr{std::move(value)});
+        return Expr::make(*arena, ReturnExpr{std::move(value)});
     }
 
     ExprPtr parse_expression() {
@@ -514,7 +607,7 @@ class Parser {
     // block_expression = "{" [statement*] [expression] "}"
     BlockExpr parse_block_expression() {
         expect(TokenKind::LeftBrace, "start of block");
-        vector<StmtPtr> stmts;
+        AstVector<StmtPtr> stmts(arena->resource());
         optional<ExprPtr> final_expr;
 
         while (!match(TokenKind::RightBrace) && !match(TokenKind::End)) {
@@ -528,7 +621,8 @@ class Parser {
                 auto expr = parse_expression();
                 if (accept(TokenKind::Semicolon)) {
                     // 消费分号，构成表达式语句
-                    stmts.push_back(Stmt::make(ExprStmt{std::move(expr)}));
+                    stmts.push_back(
+                        Stmt::make(*arena, ExprStmt{std::move(expr)}));
                 } else {
                     // 没有分号，则这是块的最终表达式
                     final_expr = std::move(expr);
@@ -554,7 +648,7 @@ class Parser {
         expect(TokenKind::Assignment, "in variable declaration");
         auto init = parse_expression();
         expect(TokenKind::Semicolon, "after variable declaration");
-        return Stmt::make(VarDecl(name, type, std::move(init)));
+        return Stmt::make(*arena, VarDecl(name, type, std::move(init)));
     }
 
     // function_declaration = "fn" ident "(" [param_list] ")" ["->" type] block
@@ -563,7 +657,7 @@ class Parser {
         Identifier const name = parse_identifier();
         expect(TokenKind::LeftParen, "after function name");
 
-        vector<Param> params;
+        AstVector<Param> params(arena->resource());
         if (!match(TokenKind::RightParen)) {
             do {
                 Identifier const paramName = parse_identifier();
@@ -574,13 +668,17 @@ class Parser {
         }
         expect(TokenKind::RightParen, "after parameters");
 
-        Type return_type{.built_in_type = BuiltInType::Unit, .name = {"unit"}};
+        Type return_type{
+            .built_in_type = BuiltInType::Unit,
+            .name = {
+                .name = to_string(BuiltInType::Unit),
+                .symbol = symbol_of(BuiltInType::Unit)}};
         if (accept(TokenKind::Arrow)) {
             return_type = parse_type();
         }
 
         auto body = parse_block_expression();
-        return Stmt::make(FunctionDecl(
+        return Stmt::make(*arena, FunctionDecl(
             name, std::move(params), return_type, std::move(body)));
     }
 
@@ -589,7 +687,7 @@ class Parser {
         auto expr = parse_expression();
         expect(TokenKind::Semicolon, "after expression statement");
         // 将表达式包装为语句，需要新增一个 ExprStmt 节点
-        return Stmt::make(ExprStmt{std::move(expr)});
+        return Stmt::make(*arena, ExprStmt{std::move(expr)});
     }
 
     // stmt = var_declaration | function_declaration | expression_statement
@@ -603,15 +701,21 @@ class Parser {
         if (match(TokenKind::KwIf) || match(TokenKind::KwWhile) ||
             match(TokenKind::KwFor)) {
             auto expr = parse_expression();
-            return Stmt::make(ExprStmt{std::move(expr)}); // 包装为语句，无分号
+            // 包装为语句，无分号
+            return Stmt::make(*arena, ExprStmt{std::move(expr)});
         }
         // 普通表达式语句，必须有分号
         auto expr = parse_expression();
         expect(TokenKind::Semicolon, "after expression statement");
-        return Stmt::make(ExprStmt{std::move(expr)});
+        return Stmt::make(*arena, ExprStmt{std::move(expr)});
     }
 };
 
+using Parser = BasicParser<TokenCursor>;
+
+using StreamingParser =
+    BasicParser<TokenStream<BasicParser<TokenCursor>::max_lookahead>>;
+
 class ParseTreePrinter {
   public:
     explicit ParseTreePrinter(std::ostream& o) : out(o) {}
@@ -634,18 +738,19 @@ class ParseTreePrinter {
     }
 
   private:
-    std::ostream& out;
+    OutputWriter out; // flushed when the printer is destroyed
     int level = 0;
 
+    // explicit stacks of the chain printers, so that long operator chains
+    // do not recurse
+    vector<BinaryExpr const*> binary_stack;
+    vector<TokenKind> postfix_stack;
+
     void indent() { level++; }
 
     void dedent() { level--; }
 
-    void print_indent() {
-        for (int i = 0; i < level; ++i) {
-            out << "  ";
-        }
-    }
+    void print_indent() { out.spaces(static_cast<size_t>(level) * 2); }
 
     void print(ReturnExpr const& node) {
         out << "return";
@@ -688,10 +793,19 @@ class ParseTreePrinter {
         print(node.body);
     }
 
-    void print(AssignExpr const& node) {
-        print(*node.lhs);
-        out << " = ";
-        print(*node.rhs);
+    // Right-deep chains "a = b = c = ..." are printed in a loop.
+    void print(AssignExpr const& root) {
+        AssignExpr const* node = &root;
+        while (true) {
+            print(*node->lhs);
+            out << " = ";
+            AssignExpr const* inner = std::get_if<AssignExpr>(&node->rhs->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        print(*node->rhs);
     }
 
     void print(ExprStmt const& node) {
@@ -784,24 +898,66 @@ class ParseTreePrinter {
         out << " )";
     }
 
-    void print(PrefixExpr const& un) {
-        out << "(" << to_string(un.op);
-        print(*un.operand);
-        out << ")";
+    // "- - x": each operator opens a parenthesis that is closed after the
+    // innermost operand.
+    void print(PrefixExpr const& root) {
+        PrefixExpr const* node = &root;
+        size_t depth = 0;
+        while (true) {
+            out << "(" << to_string(node->op);
+            ++depth;
+            PrefixExpr const* inner =
+                std::get_if<PrefixExpr>(&node->operand->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        print(*node->operand);
+        for (; depth > 0; --depth) {
+            out << ")";
+        }
     }
 
-    void print(BinaryExpr const& bin) {
-        out << "(";
-        print(*bin.lhs);
-        out << " " << to_string(bin.op) << " ";
-        print(*bin.rhs);
-        out << ")";
+    // Left-deep chains "a + b + c + ...": the spine is collected on a stack
+    // and printed from the leftmost operation out.
+    void print(BinaryExpr const& root) {
+        size_t const base = binary_stack.size();
+        for (BinaryExpr const* node = &root; node != nullptr;
+             node = std::get_if<BinaryExpr>(&node->lhs->node)) {
+            binary_stack.push_back(node);
+            out << "(";
+        }
+        print(*binary_stack.back()->lhs);
+        while (binary_stack.size() > base) {
+            BinaryExpr const& node = *binary_stack.back();
+            binary_stack.pop_back();
+            out << " " << to_string(node.op) << " ";
+            print(*node.rhs);
+            out << ")";
+        }
     }
 
-    void print(PostfixExpr const& node) {
-        out << "(";
-        print(*node.operand);
-        out << to_string(node.op) << ")";
+    // "x compl compl": the operators are collected on a stack and printed
+    // innermost first.
+    void print(PostfixExpr const& root) {
+        size_t const base = postfix_stack.size();
+        PostfixExpr const* node = &root;
+        while (true) {
+            postfix_stack.push_back(node->op);
+            out << "(";
+            PostfixExpr const* inner =
+                std::get_if<PostfixExpr>(&node->operand->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        print(*node->operand);
+        while (postfix_stack.size() > base) {
+            out << to_string(postfix_stack.back()) << ")";
+            postfix_stack.pop_back();
+        }
     }
 
     static std::string_view type_to_string(Type const& type) {
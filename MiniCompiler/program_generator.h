@@ -0,0 +1,703 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// program_generator.h
+
+#pragma once
+
+#include "lexer.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Synthetic program generator
+// ==========================================
+//
+// Writes random programs of any size that the parser accepts and that use
+// the whole grammar: typed `let`, `fn` with parameters and return types,
+// block expressions with final expressions, if / else if / else chains,
+// while and for loops with break and continue, calls, prefix operators and
+// every binary operator that get_precedence() ranks and the parser can
+// reach. (bitand, bitor and xor are consumed as postfix operators before
+// the binary-operator loop sees them, so they only appear in that role.)
+//
+// The programs are also well-formed beyond syntax, so later passes can run
+// them: every name is declared before use and not redeclared in a visible
+// scope, operands have matching types, divisors and shift counts are kept
+// in safe ranges, loops are bounded by counters nothing else assigns, and
+// functions only call "leaf" functions that call no user functions, so a
+// call costs bounded time however large the program is.
+//
+// Output is produced one top-level item at a time, so memory stays flat
+// from kilobytes to gigabytes. The same options always give the same text.
+
+struct GeneratorOptions {
+    uint64_t bytes = uint64_t{64} << 10; // approximate output size
+    uint64_t seed = 1;
+    int max_depth = 4;        // nesting of blocks, loops and expressions
+    size_t vocabulary = 1000; // distinct base spellings of names
+    double zipf = 1.0;        // skew of name choice; 0 is uniform
+    bool postfix_operators = false; // also emit bitand/bitor/xor/compl
+};
+
+class ProgramGenerator {
+  public:
+    explicit ProgramGenerator(GeneratorOptions options)
+        : options(options), rng(options.seed) {
+        make_vocabulary();
+    }
+
+    // Writes about options.bytes bytes of program text to `out`.
+    void generate(std::ostream& out) {
+        uint64_t written = 0;
+        while (written < options.bytes) {
+            buffer.clear();
+            top_level_item();
+            out << buffer;
+            written += buffer.size();
+        }
+    }
+
+  private:
+    using Type = BuiltInType;
+
+    struct Variable {
+        string name;
+        Type type;
+        bool assignable;
+    };
+
+    struct Function {
+        string name;
+        vector<Type> params;
+        Type result; // Unit: no value
+    };
+
+    struct Context {
+        Function const* function = nullptr; // null at top level
+        bool leaf = true;                    // may not call user functions
+        int loops = 0;                       // enclosing loops
+    };
+
+    // only this many recent globals and leaf functions are referenced
+    static constexpr size_t recent_limit = 32;
+    static constexpr int max_indent = 64;
+
+    GeneratorOptions options;
+    std::mt19937_64 rng;
+    vector<string> vocabulary;
+    vector<double> zipf_cdf;
+    std::deque<Variable> globals;
+    std::deque<Function> leaf_functions;
+    std::deque<Function> other_functions;
+    vector<vector<Variable>> scopes; // locals, innermost last
+    uint64_t next_suffix = 0;
+    int indent_level = 0;
+    string buffer;
+
+    // --- Random choices ---
+
+    size_t below(size_t n) { return static_cast<size_t>(rng() % n); }
+
+    bool chance(unsigned percent) { return below(100) < percent; }
+
+    Type value_type() {
+        constexpr std::array<Type, 10> weighted{
+            Type::Int,
+            Type::Int,
+            Type::Int,
+            Type::Int,
+            Type::Float,
+            Type::Float,
+            Type::Bool,
+            Type::Bool,
+            Type::Char,
+            Type::String};
+        return weighted[below(weighted.size())];
+    }
+
+    // --- Names ---
+
+    void make_vocabulary() {
+        constexpr std::array<string_view, 24> syllables{
+            "ka", "lo", "mi", "ne", "ru", "sa", "to", "vi",
+            "ba", "de", "fu", "gi", "ho", "ju", "pe", "qui",
+            "ri", "ste", "tra", "um", "val", "wo", "xe", "zo"};
+        constexpr std::array<string_view, 12> words{
+            "count", "total", "index", "value", "next", "size",
+            "limit", "left", "right", "sum", "item", "result"};
+        std::mt19937_64 names(options.seed ^ 0x9e3779b97f4a7c15U);
+        size_t const n = std::max<size_t>(options.vocabulary, 1);
+        while (vocabulary.size() < n) {
+            string name;
+            if (vocabulary.size() < words.size() && n >= words.size()) {
+                name = words[vocabulary.size()];
+            } else {
+                size_t const parts = 1 + names() % 3;
+                for (size_t i = 0; i < parts; ++i) {
+                    name += syllables[names() % syllables.size()];
+                }
+                if (names() % 4 == 0) {
+                    name += '_';
+                    name += words[names() % words.size()];
+                }
+            }
+            if (reserved(name) ||
+                std::ranges::find(vocabulary, name) != vocabulary.end()) {
+                name += format("{}", vocabulary.size());
+            }
+            vocabulary.push_back(std::move(name));
+        }
+        double total = 0;
+        for (size_t rank = 0; rank < n; ++rank) {
+            total += 1 / std::pow(static_cast<double>(rank + 1), options.zipf);
+            zipf_cdf.push_back(total);
+        }
+    }
+
+    static bool reserved(string_view name) {
+        return lookup_keyword(name) != TokenKind::Identifier ||
+               std::ranges::find(builtin_type_names, name) !=
+                   builtin_type_names.end() ||
+               name == "print" || name == "true" || name == "false";
+    }
+
+    string_view vocabulary_word() {
+        std::uniform_real_distribution<double> unit(0, zipf_cdf.back());
+        auto const it = std::ranges::upper_bound(zipf_cdf, unit(rng));
+        return vocabulary[std::min<size_t>(
+            static_cast<size_t>(it - zipf_cdf.begin()), vocabulary.size() - 1)];
+    }
+
+    bool visible(string_view name) const {
+        for (auto const& scope : scopes) {
+            for (Variable const& v : scope) {
+                if (v.name == name) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Locals reuse vocabulary words while they are free; top-level names
+    // are always made unique.
+    string fresh_name(bool top_level) {
+        string_view const word = vocabulary_word();
+        if (!top_level && !visible(word) && !any_global(word)) {
+            return string(word);
+        }
+        return format("{}_{}", word, next_suffix++);
+    }
+
+    bool any_global(string_view name) const {
+        auto const named = [&](auto const& item) { return item.name == name; };
+        return std::ranges::any_of(globals, named) ||
+               std::ranges::any_of(leaf_functions, named) ||
+               std::ranges::any_of(other_functions, named);
+    }
+
+    // --- Output ---
+
+    void line(string_view text) {
+        buffer.append(
+            static_cast<size_t>(std::min(indent_level, max_indent)) * 4, ' ');
+        buffer += text;
+        buffer += '\n';
+    }
+
+    void begin_scope() {
+        ++indent_level;
+        scopes.emplace_back();
+    }
+
+    void end_scope() {
+        scopes.pop_back();
+        --indent_level;
+    }
+
+    void open_block(string_view head) {
+        line(head);
+        begin_scope();
+    }
+
+    void close_block() {
+        end_scope();
+        line("}");
+    }
+
+    // --- Variables in scope ---
+
+    vector<Variable const*> variables_of(Type type, bool assignable) const {
+        vector<Variable const*> found;
+        for (auto const& scope : scopes) {
+            for (Variable const& v : scope) {
+                if (v.type == type && (!assignable || v.assignable)) {
+                    found.push_back(&v);
+                }
+            }
+        }
+        for (Variable const& v : globals) {
+            if (v.type == type && (!assignable || v.assignable)) {
+                found.push_back(&v);
+            }
+        }
+        return found;
+    }
+
+    void declare(Variable variable) {
+        if (scopes.empty()) {
+            globals.push_back(std::move(variable));
+            if (globals.size() > recent_limit) {
+                globals.pop_front();
+            }
+        } else {
+            scopes.back().push_back(std::move(variable));
+        }
+    }
+
+    // --- Expressions ---
+
+    string literal(Type type) {
+        switch (type) {
+        case Type::Int:
+            return format("{}", below(1000));
+        case Type::Float:
+            return format("{}.{}", below(100), 1 + below(99));
+        case Type::Bool:
+            return chance(50) ? "true" : "false";
+        case Type::Char: {
+            constexpr std::array<string_view, 6> chars{
+                "'a'", "'z'", "'0'", "'\\n'", "'\\t'", "'_'"};
+            return string(chars[below(chars.size())]);
+        }
+        case Type::String: {
+            constexpr std::array<string_view, 5> strings{
+                R"("hello")",
+                R"("x: ")",
+                R"("line\n")",
+                R"("tab\tseparated")",
+                R"("")"};
+            return string(strings[below(strings.size())]);
+        }
+        default:
+            return "0";
+        }
+    }
+
+    // A literal, variable or call; no operators.
+    string leaf(Type type, Context const& context, int depth) {
+        if (depth > 0 && chance(15)) {
+            if (string call = call_of(type, context, depth - 1);
+                !call.empty()) {
+                return call;
+            }
+        }
+        auto const vars = variables_of(type, false);
+        if (!vars.empty() && chance(65)) {
+            return vars[below(vars.size())]->name;
+        }
+        return literal(type);
+    }
+
+    // Calls a function returning `type` if one may be called here.
+    string call_of(Type type, Context const& context, int depth) {
+        if (context.leaf) {
+            return {};
+        }
+        vector<Function const*> candidates;
+        for (Function const& f : leaf_functions) {
+            if (f.result == type) {
+                candidates.push_back(&f);
+            }
+        }
+        if (candidates.empty()) {
+            return {};
+        }
+        return call_text(*candidates[below(candidates.size())], context, depth);
+    }
+
+    string call_text(Function const& f, Context const& context, int depth) {
+        string text = f.name + "(";
+        for (size_t i = 0; i < f.params.size(); ++i) {
+            if (i > 0) {
+                text += ", ";
+            }
+            text += expression(f.params[i], context, depth);
+        }
+        return text + ")";
+    }
+
+    // An operand of a binary operator: binary results are parenthesized,
+    // so mixing types never depends on precedence.
+    string operand(Type type, Context const& context, int depth) {
+        if (depth <= 0 || chance(70)) {
+            return leaf(type, context, depth);
+        }
+        switch (below(6)) {
+        case 0:
+        case 1:
+            return "(" + expression(type, context, depth - 1) + ")";
+        case 2:
+        case 3:
+            if (type == Type::Int || type == Type::Float) {
+                // "- -x", not the "--" token
+                string const inner = operand(type, context, depth - 1);
+                return (inner.starts_with('-') ? "- " : "-") + inner;
+            }
+            if (type == Type::Bool) {
+                return "!" + operand(type, context, depth - 1);
+            }
+            return leaf(type, context, depth);
+        case 4:
+            return "(" + if_expression(type, context, depth - 1) + ")";
+        default:
+            return "(" + block_expression(type, context, depth - 1) + ")";
+        }
+    }
+
+    // Right operand of / and %: between 2 and 14.
+    string divisor(Context const& context, int depth) {
+        return format("({} % 7 + 8)", operand(Type::Int, context, depth));
+    }
+
+    // Right operand of shl and shr: between 1 and 7.
+    string shift_count(Context const& context, int depth) {
+        return format("({} % 4 + 4)", operand(Type::Int, context, depth));
+    }
+
+    string arithmetic(Type type, Context const& context, int depth) {
+        string text = operand(type, context, depth - 1);
+        size_t const terms = 1 + below(3);
+        for (size_t i = 0; i < terms; ++i) {
+            if (type == Type::Int) {
+                constexpr std::array<string_view, 7> ops{
+                    " + ", " - ", " * ", " / ", " % ", " shl ", " shr "};
+                string_view const op = ops[below(ops.size())];
+                text += op;
+                if (op == " / " || op == " % ") {
+                    text += divisor(context, depth - 1);
+                } else if (op == " shl " || op == " shr ") {
+                    text += shift_count(context, depth - 1);
+                } else {
+                    text += operand(type, context, depth - 1);
+                }
+            } else {
+                constexpr std::array<string_view, 4> ops{
+                    " + ", " - ", " * ", " / "};
+                text += ops[below(ops.size())];
+                text += operand(type, context, depth - 1);
+            }
+        }
+        return text;
+    }
+
+    string comparison(Context const& context, int depth) {
+        constexpr std::array<string_view, 6> ops{
+            " < ", " <= ", " > ", " >= ", " == ", " != "};
+        Type const type = chance(70) ? Type::Int : Type::Float;
+        string const lhs = arithmetic(type, context, depth);
+        return lhs + string(ops[below(ops.size())]) +
+               arithmetic(type, context, depth);
+    }
+
+    string logical(Context const& context, int depth) {
+        string text = chance(60) ? comparison(context, depth - 1)
+                                 : operand(Type::Bool, context, depth - 1);
+        size_t const terms = 1 + below(2);
+        for (size_t i = 0; i < terms; ++i) {
+            text += chance(50) ? " && " : " || ";
+            text += chance(60) ? comparison(context, depth - 1)
+                               : operand(Type::Bool, context, depth - 1);
+        }
+        return text;
+    }
+
+    string expression(Type type, Context const& context, int depth) {
+        if (depth <= 0) {
+            return leaf(type, context, 0);
+        }
+        switch (type) {
+        case Type::Int:
+        case Type::Float:
+            if (chance(15)) {
+                return if_expression(type, context, depth - 1);
+            }
+            return chance(75) ? arithmetic(type, context, depth)
+                              : operand(type, context, depth);
+        case Type::Bool:
+            switch (below(3)) {
+            case 0:
+                return comparison(context, depth);
+            case 1:
+                return logical(context, depth);
+            default:
+                return operand(type, context, depth);
+            }
+        default:
+            if (chance(10)) {
+                return if_expression(type, context, depth - 1);
+            }
+            return leaf(type, context, depth);
+        }
+    }
+
+    // Arguments of one call are evaluated in no fixed order, so every
+    // random choice below is sequenced through a local first.
+    string if_expression(Type type, Context const& context, int depth) {
+        string const condition = expression(Type::Bool, context, depth);
+        string text = format(
+            "if {} {{ {} }}", condition, expression(type, context, depth));
+        if (chance(30)) {
+            string const other = expression(Type::Bool, context, depth);
+            text += format(
+                " else if {} {{ {} }}",
+                other,
+                expression(type, context, depth));
+        }
+        return text +
+               format(" else {{ {} }}", expression(type, context, depth));
+    }
+
+    // { let t: T = ...; t op ... }, all on one line
+    string block_expression(Type type, Context const& context, int depth) {
+        scopes.emplace_back();
+        string const name = fresh_name(false);
+        string const init = expression(type, context, depth);
+        scopes.back().push_back({name, type, true});
+        string const final_expr = expression(type, context, depth);
+        scopes.pop_back();
+        return format(
+            "{{ let {}: {} = {}; {} }}",
+            name,
+            to_string(type),
+            init,
+            final_expr);
+    }
+
+    // --- Statements ---
+
+    void let_statement(Context const& context, int depth) {
+        Type const type = value_type();
+        string const name = fresh_name(scopes.empty());
+        string const init = expression(type, context, depth);
+        line(format("let {}: {} = {};", name, to_string(type), init));
+        declare({name, type, true});
+    }
+
+    void statement(Context const& context, int depth) {
+        unsigned const roll = static_cast<unsigned>(below(100));
+        if (roll < 30 || depth <= 0) {
+            let_statement(context, depth);
+        } else if (roll < 48) {
+            Type const type = value_type();
+            auto const targets = variables_of(type, true);
+            if (targets.empty()) {
+                let_statement(context, depth);
+                return;
+            }
+            // a copy: expressions may add scopes and move the variables
+            string const target = targets[below(targets.size())]->name;
+            line(format("{} = {};", target, expression(type, context, depth)));
+        } else if (roll < 58) {
+            if_statement(context, depth - 1);
+        } else if (roll < 66 && context.loops < 2) {
+            while_statement(context, depth - 1);
+        } else if (roll < 72 && context.loops < 2) {
+            for_statement(context, depth - 1);
+        } else if (roll < 80) {
+            line(format(
+                "print({});", expression(value_type(), context, depth - 1)));
+        } else if (roll < 88 && !context.leaf && !leaf_functions.empty()) {
+            Function const& f = leaf_functions[below(leaf_functions.size())];
+            line(call_text(f, context, depth - 1) + ";");
+        } else if (roll < 94 && context.loops > 0) {
+            string const condition =
+                expression(Type::Bool, context, depth - 1);
+            line(format(
+                "if {} {{ {}; }}",
+                condition,
+                chance(50) ? "break" : "continue"));
+        } else if (roll < 97 && context.function != nullptr) {
+            Type const result = context.function->result;
+            string const condition =
+                expression(Type::Bool, context, depth - 1);
+            string const value =
+                result == Type::Unit
+                    ? string()
+                    : " " + expression(result, context, depth - 1);
+            line(format("if {} {{ return{}; }}", condition, value));
+        } else {
+            let_statement(context, depth);
+        }
+    }
+
+    void statements(Context const& context, int depth, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            statement(context, depth);
+        }
+    }
+
+    void if_statement(Context const& context, int depth) {
+        open_block(format("if {} {{", expression(Type::Bool, context, depth)));
+        statements(context, depth, 1 + below(3));
+        size_t const else_ifs = below(3);
+        for (size_t i = 0; i < else_ifs; ++i) {
+            end_scope(); // before the condition, which must not see it
+            line(format(
+                "}} else if {} {{", expression(Type::Bool, context, depth)));
+            begin_scope();
+            statements(context, depth, 1 + below(2));
+        }
+        if (chance(60)) {
+            end_scope();
+            line("} else {");
+            begin_scope();
+            statements(context, depth, 1 + below(2));
+        }
+        close_block();
+    }
+
+    // The counter is declared in the enclosing scope and incremented first,
+    // so continue cannot skip it.
+    void while_statement(Context const& context, int depth) {
+        string const counter = fresh_name(scopes.empty());
+        line(format("let {}: int = 0;", counter));
+        declare({counter, Type::Int, false});
+        Context inner = context;
+        ++inner.loops;
+        open_block(format("while {} < {} {{", counter, 1 + below(8)));
+        line(format("{0} = {0} + 1;", counter));
+        statements(inner, depth, 1 + below(3));
+        close_block();
+    }
+
+    // `for v in n` runs v over 0 .. n - 1
+    void for_statement(Context const& context, int depth) {
+        string const var = fresh_name(false);
+        Context inner = context;
+        ++inner.loops;
+        open_block(format("for {} in {} {{", var, 1 + below(8)));
+        scopes.back().push_back({var, Type::Int, false});
+        statements(inner, depth, 1 + below(3));
+        close_block();
+    }
+
+    // --- Top-level items ---
+
+    void function_declaration() {
+        Function f{
+            .name = fresh_name(true), .params = {}, .result = Type::Unit};
+        bool const leaf = leaf_functions.empty() || chance(50);
+        Context context{.function = &f, .leaf = leaf, .loops = 0};
+        int const depth = std::max(options.max_depth, 1);
+
+        scopes.emplace_back();
+        string head = "fn " + f.name + "(";
+        size_t const params = below(5);
+        for (size_t i = 0; i < params; ++i) {
+            Type const type = value_type();
+            string const name = fresh_name(false);
+            head += format(
+                "{}{}: {}", i == 0 ? "" : ", ", name, to_string(type));
+            f.params.push_back(type);
+            scopes.back().push_back({name, type, true});
+        }
+        head += ")";
+        if (chance(75)) {
+            f.result = value_type();
+            head += format(" -> {}", to_string(f.result));
+        }
+        line(head + " {");
+        ++indent_level;
+        scopes.emplace_back();
+        statements(context, depth, 2 + below(6));
+        if (f.result != Type::Unit) {
+            string const value = expression(f.result, context, depth);
+            if (chance(50)) {
+                line(format("return {};", value));
+            } else if (value.starts_with("if ") || value.starts_with('-')) {
+                // else an if statement, or "- x" continuing the if
+                // statement before it as a binary expression
+                line("(" + value + ")");
+            } else {
+                line(value);
+            }
+        }
+        scopes.pop_back();
+        scopes.pop_back();
+        --indent_level;
+        line("}");
+
+        auto& list = leaf ? leaf_functions : other_functions;
+        list.push_back(std::move(f));
+        if (list.size() > recent_limit) {
+            list.pop_front();
+        }
+    }
+
+    void top_level_item() {
+        unsigned const roll = static_cast<unsigned>(below(100));
+        Context const top{.function = nullptr, .leaf = false, .loops = 0};
+        int const depth = std::max(options.max_depth - 1, 0);
+        if (roll < 45 || leaf_functions.empty()) {
+            function_declaration();
+        } else if (roll < 65) {
+            let_statement(top, depth);
+        } else if (roll < 85) {
+            auto const& list =
+                !other_functions.empty() && chance(60) ? other_functions
+                                                       : leaf_functions;
+            Function const& f = list[below(list.size())];
+            string const call = call_text(f, top, depth);
+            line(f.result == Type::Unit || chance(50)
+                     ? call + ";"
+                     : format("print({});", call));
+        } else if (roll < 93) {
+            if_statement(top, depth);
+        } else {
+            while_statement(top, depth);
+        }
+        if (options.postfix_operators && chance(10)) {
+            postfix_statement();
+        }
+        if (chance(25)) {
+            line("");
+        }
+    }
+
+    // `print(x bitand);`: syntax only; the operators have no semantics yet
+    void postfix_statement() {
+        constexpr std::array<string_view, 4> ops{
+            "bitand", "bitor", "xor", "compl"};
+        string const value = literal(Type::Int);
+        line(format("print({} {});", value, ops[below(ops.size())]));
+    }
+};
+
+// The whole program as one string; for sizes that fit in memory.
+inline string generate_program(GeneratorOptions const& options) {
+    std::ostringstream out;
+    ProgramGenerator(options).generate(out);
+    return std::move(out).str();
+}
+
+} // namespace mini_compiler
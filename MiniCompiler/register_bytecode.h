@@ -0,0 +1,1322 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// register_bytecode.h
+
+#pragma once
+
+#include "interner.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::optional;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Register instruction set
+// ==========================================
+//
+// Code for a register machine. An instruction is one 64-bit word: the
+// opcode in the low byte, then three 16-bit fields a, b and c; b and c
+// together also form a signed 32-bit field bx. Registers are the slots of
+// the function's frame: its parameters, its variables and temporaries.
+//
+// The checker has fixed the type of every expression, so each instruction
+// works on one type (ADD_INT, ADD_FLOAT, LT_INT, ...) and registers carry
+// no type tag. Bools and chars are held as ints: the _INT comparisons
+// serve them too. The _K forms take a constant as their right operand:
+// "i = i + 1" is ADD_INT_K i, i, k.
+//
+//   MOVE a, b            a = b
+//   LOAD_INT a, bx       a = bx
+//   LOAD_CONST a, bx     a = constants[bx]
+//   GET_GLOBAL a, bx     a = global bx, which must be initialized
+//   SET_GLOBAL a, bx     global bx = a
+//   DEFINE_GLOBAL a      global a is initialized
+//   ADD_INT a, b, c      a = b + c                 (and all binary ops)
+//   ADD_INT_K a, b, c    a = b + constants[c]
+//   NEG_INT a, b         a = -b                    (and all unary ops)
+//   IF_LT_INT a, b, c    if (b < c) == a, take the JUMP that follows,
+//                        else skip it              (and all IF_ ops)
+//   JUMP bx              jump by bx (from the next instruction)
+//   JUMP_IF a, bx        jump if a                 (JUMP_IF_NOT: if not a)
+//   FOR_PREP a / FOR_LOOP a (a `for` loop, see below; a JUMP follows)
+//   CALL a, bx           call function bx with the arguments in a, a + 1,
+//                        ...; its result is left in a
+//   RETURN a / RETURN_UNIT
+//   PRINT a, b           write a, of BuiltInType b (PRINT_LINE: a newline)
+//   HALT
+//
+// Greater-than comparisons swap their operands; != is == with the other
+// jump sense. A `for` loop keeps its count, counter and variable in three
+// consecutive registers a, a + 1, a + 2. A call's registers are a window
+// of the caller's, starting at a.
+
+#define REGISTER_OPS(X)                                                        \
+    X(Move)                                                                    \
+    X(LoadInt)                                                                 \
+    X(LoadConst)                                                               \
+    X(GetGlobal)                                                               \
+    X(SetGlobal)                                                               \
+    X(DefineGlobal)                                                            \
+    X(AddInt)                                                                  \
+    X(SubInt)                                                                  \
+    X(MulInt)                                                                  \
+    X(DivInt)                                                                  \
+    X(ModInt)                                                                  \
+    X(AddIntK)                                                                 \
+    X(SubIntK)                                                                 \
+    X(MulIntK)                                                                 \
+    X(DivIntK)                                                                 \
+    X(ModIntK)                                                                 \
+    X(Shl)                                                                     \
+    X(Shr)                                                                     \
+    X(BitAnd)                                                                  \
+    X(BitOr)                                                                   \
+    X(BitXor)                                                                  \
+    X(AddFloat)                                                                \
+    X(SubFloat)                                                                \
+    X(MulFloat)                                                                \
+    X(DivFloat)                                                                \
+    X(NegInt)                                                                  \
+    X(NegFloat)                                                                \
+    X(Not)                                                                     \
+    X(Complement)                                                              \
+    X(LtInt)                                                                   \
+    X(LeInt)                                                                   \
+    X(EqInt)                                                                   \
+    X(NeInt)                                                                   \
+    X(LtIntK)                                                                  \
+    X(LeIntK)                                                                  \
+    X(GtIntK)                                                                  \
+    X(GeIntK)                                                                  \
+    X(EqIntK)                                                                  \
+    X(NeIntK)                                                                  \
+    X(LtFloat)                                                                 \
+    X(LeFloat)                                                                 \
+    X(EqFloat)                                                                 \
+    X(NeFloat)                                                                 \
+    X(EqString)                                                                \
+    X(NeString)                                                                \
+    X(IfLtInt)                                                                 \
+    X(IfLeInt)                                                                 \
+    X(IfEqInt)                                                                 \
+    X(IfLtIntK)                                                                \
+    X(IfLeIntK)                                                                \
+    X(IfGtIntK)                                                                \
+    X(IfGeIntK)                                                                \
+    X(IfEqIntK)                                                                \
+    X(IfLtFloat)                                                               \
+    X(IfLeFloat)                                                               \
+    X(IfEqFloat)                                                               \
+    X(IfEqString)                                                              \
+    X(Jump)                                                                    \
+    X(JumpIf)                                                                  \
+    X(JumpIfNot)                                                               \
+    X(ForPrep)                                                                 \
+    X(ForLoop)                                                                 \
+    X(Call)                                                                    \
+    X(Return)                                                                  \
+    X(ReturnUnit)                                                              \
+    X(Print)                                                                   \
+    X(PrintLine)                                                               \
+    X(Halt)
+
+#define AS_ENUM(name) name,
+enum class RegisterOp : uint8_t { REGISTER_OPS(AS_ENUM) };
+#undef AS_ENUM
+
+using RegisterInstruction = uint64_t;
+
+inline constexpr uint32_t max_register = 0xFFFF; // also the largest _K index
+
+constexpr RegisterInstruction encode(
+    RegisterOp op, uint32_t a, uint32_t b = 0, uint32_t c = 0) {
+    return uint64_t{c} << 40 | uint64_t{b} << 24 | uint64_t{a} << 8 |
+           static_cast<uint8_t>(op);
+}
+
+constexpr RegisterInstruction encode_wide(
+    RegisterOp op, uint32_t a, int32_t bx) {
+    return uint64_t{static_cast<uint32_t>(bx)} << 24 | uint64_t{a} << 8 |
+           static_cast<uint8_t>(op);
+}
+
+constexpr RegisterOp register_op_of(RegisterInstruction instruction) {
+    return static_cast<RegisterOp>(instruction & 0xFF);
+}
+
+constexpr uint32_t a_of(RegisterInstruction instruction) {
+    return static_cast<uint32_t>(instruction >> 8) & 0xFFFF;
+}
+
+constexpr uint32_t b_of(RegisterInstruction instruction) {
+    return static_cast<uint32_t>(instruction >> 24) & 0xFFFF;
+}
+
+constexpr uint32_t c_of(RegisterInstruction instruction) {
+    return static_cast<uint32_t>(instruction >> 40) & 0xFFFF;
+}
+
+constexpr int32_t bx_of(RegisterInstruction instruction) {
+    return static_cast<int32_t>(static_cast<uint32_t>(instruction >> 24));
+}
+
+static_assert(bx_of(encode_wide(RegisterOp::Jump, 0, -5)) == -5);
+static_assert(
+    c_of(encode(RegisterOp::AddInt, 1, 2, max_register)) == max_register);
+
+// ==========================================
+// Registers
+// ==========================================
+
+// 8 bytes and no tag: the code knows what each register holds. A bool is
+// 0 or 1, a char is sign-extended, so both compare like ints.
+union Register {
+    int64_t int_value = 0;
+    double float_value;
+    string const* string_value;
+};
+
+static_assert(sizeof(Register) == 8);
+
+inline Register to_register(Value value) {
+    Register reg;
+    switch (value.type) {
+    case BuiltInType::Float:
+        reg.float_value = value.float_value;
+        break;
+    case BuiltInType::String:
+        reg.string_value = value.string_value;
+        break;
+    case BuiltInType::Bool:
+        reg.int_value = value.bool_value ? 1 : 0;
+        break;
+    case BuiltInType::Char:
+        reg.int_value = value.char_value;
+        break;
+    default:
+        reg.int_value = value.int_value;
+        break;
+    }
+    return reg;
+}
+
+inline Value to_value(Register reg, BuiltInType type) {
+    switch (type) {
+    case BuiltInType::Int:
+        return Value::of_int(reg.int_value);
+    case BuiltInType::Float:
+        return Value::of_float(reg.float_value);
+    case BuiltInType::Bool:
+        return Value::of_bool(reg.int_value != 0);
+    case BuiltInType::Char:
+        return Value::of_char(static_cast<char>(reg.int_value));
+    case BuiltInType::String:
+        return Value::of_string(reg.string_value);
+    default:
+        return {};
+    }
+}
+
+// ==========================================
+// Compiled program
+// ==========================================
+
+struct RegisterFunction {
+    string name;
+    uint32_t params = 0;     // the first registers
+    uint32_t frame_size = 0; // registers, parameters included
+    vector<RegisterInstruction> code{};
+};
+
+// functions[0] is the top-level code; its registers hold the globals. It
+// ends by calling main() if the program declares one, then HALT.
+struct RegisterModule {
+    vector<Register> constants;
+    std::deque<string> strings; // of the string constants
+    vector<RegisterFunction> functions;
+    vector<string> global_names; // by register of functions[0]
+};
+
+// ==========================================
+// Compiler
+// ==========================================
+
+// Translates a Program that passed check_program() into a RegisterModule;
+// throws runtime_error for anything the checker rejects. Names are
+// resolved like in BytecodeCompiler, and types with the checker's rules:
+// variables get registers for their scope, temporaries the registers
+// above them. An expression is compiled into the register its value is
+// wanted in where it can be ("x = y + 1" is one instruction), and a
+// variable is read in place unless the rest of the expression could
+// assign it. Conditions compile to compare-and-branch instructions.
+//
+// The grammar gives every variable an initializer, but a Program built
+// otherwise may not: such a variable starts out as its type's zero (the
+// other engines give it unit).
+class RegisterCompiler {
+  public:
+    explicit RegisterCompiler(Interner& interner = global_interner())
+        : interner(interner), print_symbol(interner.intern("print")),
+          true_symbol(interner.intern("true")),
+          false_symbol(interner.intern("false")) {}
+
+    RegisterModule compile(Program const& program) {
+        module = {};
+        scalar_constants.clear();
+        string_constants.clear();
+        module.functions.push_back({.name = "<script>"});
+        fn = {};
+
+        names.enter();
+        names.declare(print_symbol, {.kind = Name::Kind::Print});
+        names.declare(
+            true_symbol,
+            {.kind = Name::Kind::Constant,
+             .index = 1,
+             .type = BuiltInType::Bool});
+        names.declare(
+            false_symbol,
+            {.kind = Name::Kind::Constant,
+             .index = 0,
+             .type = BuiltInType::Bool});
+        names.enter();
+        compile_statements(program.statements, std::nullopt);
+        for (StmtPtr const stmt : program.statements) {
+            auto const* decl = std::get_if<FunctionDecl>(&stmt->node);
+            if (decl != nullptr && decl->name.name == "main" &&
+                decl->params.empty()) {
+                Name const& found = names.find(symbol_of(decl->name))->value;
+                emit_wide(
+                    RegisterOp::Call,
+                    temp(),
+                    static_cast<int32_t>(found.index));
+            }
+        }
+        emit(RegisterOp::Halt, 0);
+        names.leave();
+        names.leave();
+        finish_function();
+        return std::move(module);
+    }
+
+  private:
+    struct Name {
+        enum class Kind : uint8_t { Variable, Constant, Function, Print };
+        Kind kind = Kind::Variable;
+        uint32_t index = 0; // register, function, or a constant's value
+        uint32_t frame = 0; // of a variable: the function (0 top level)
+        BuiltInType type = BuiltInType::Unit; // a function's: its result
+    };
+
+    static constexpr uint32_t global_depth = 2; // built-ins are depth 1
+
+    // Where an expression's value is.
+    struct Operand {
+        uint32_t reg = 0;
+        BuiltInType type = BuiltInType::Unit;
+        bool variable = false; // the register of a variable, not a copy
+    };
+
+    struct Loop {
+        vector<size_t> breaks{};
+        vector<size_t> continues{};
+    };
+
+    // The function being compiled; saved while a nested one is.
+    struct FunctionState {
+        uint32_t index = 0;
+        BuiltInType return_type = BuiltInType::Unit;
+        vector<RegisterInstruction> code{};
+        uint32_t next_reg = 0; // the lowest free register
+        uint32_t frame_size = 0;
+        vector<Loop> loops{};
+    };
+
+    // How a binary operator compiles for one operand type: `op` on two
+    // registers, with the operands swapped for > and >=, or `constant_op`
+    // with a constant right operand. A branch on `negate` jumps on the
+    // opposite result (!= as ==).
+    struct BinaryForm {
+        RegisterOp op;
+        optional<RegisterOp> constant_op = std::nullopt;
+        bool swap = false;
+        bool negate = false;
+    };
+
+    Interner& interner;
+    Symbol print_symbol;
+    Symbol true_symbol;
+    Symbol false_symbol;
+
+    RegisterModule module;
+    std::unordered_map<uint64_t, uint32_t> scalar_constants; // by bits
+    std::unordered_map<string_view, uint32_t> string_constants;
+    ScopedSymbolTable<Name> names;
+    FunctionState fn;
+
+    // explicit stacks of the chain compilations
+    vector<BinaryExpr const*> binary_stack;
+    vector<TokenKind> unary_stack;
+    vector<Identifier const*> target_stack;
+    vector<Expr const*> operand_stack;
+
+    // ------------------------------------------
+    // Emission
+    // ------------------------------------------
+
+    void emit(RegisterOp op, uint32_t a, uint32_t b = 0, uint32_t c = 0) {
+        fn.code.push_back(encode(op, a, b, c));
+    }
+
+    void emit_wide(RegisterOp op, uint32_t a, int32_t bx) {
+        fn.code.push_back(encode_wide(op, a, bx));
+    }
+
+    // A forward jump, patched by bind().
+    size_t emit_jump(RegisterOp op, uint32_t a = 0) {
+        emit_wide(op, a, 0);
+        return fn.code.size() - 1;
+    }
+
+    void bind(size_t jump) { patch(jump, fn.code.size()); }
+
+    void bind(vector<size_t> const& jumps) {
+        for (size_t const jump : jumps) {
+            bind(jump);
+        }
+    }
+
+    void patch(size_t jump, size_t target) {
+        int64_t const offset = static_cast<int64_t>(target) -
+                               static_cast<int64_t>(jump + 1);
+        if (offset < std::numeric_limits<int32_t>::min() ||
+            offset > std::numeric_limits<int32_t>::max()) {
+            throw runtime_error("register limit exceeded: jump too far");
+        }
+        RegisterInstruction const instruction = fn.code[jump];
+        fn.code[jump] = encode_wide(
+            register_op_of(instruction),
+            a_of(instruction),
+            static_cast<int32_t>(offset));
+    }
+
+    uint32_t temp() {
+        if (fn.next_reg > max_register) {
+            throw runtime_error(format(
+                "register limit exceeded: more than {} registers in '{}'",
+                max_register + 1,
+                module.functions[fn.index].name));
+        }
+        uint32_t const reg = fn.next_reg++;
+        fn.frame_size = std::max(fn.frame_size, fn.next_reg);
+        return reg;
+    }
+
+    // The register a result goes to: `target`, or a new temporary.
+    uint32_t destination(optional<uint32_t> target) {
+        return target ? *target : temp();
+    }
+
+    static bool has_payload(BuiltInType type) {
+        return type != BuiltInType::Unit && type != BuiltInType::Never;
+    }
+
+    // `value`, moved to `target` if there is one.
+    Operand place(Operand value, optional<uint32_t> target) {
+        if (!target || value.reg == *target) {
+            return value;
+        }
+        if (has_payload(value.type)) {
+            emit(RegisterOp::Move, *target, value.reg);
+        }
+        return {.reg = *target, .type = value.type};
+    }
+
+    // A register of `value` that may be overwritten: its own if it is a
+    // temporary, else a new one.
+    uint32_t scratch(Operand value) {
+        return value.variable ? temp() : value.reg;
+    }
+
+    uint32_t constant(Register value) {
+        auto const bits = std::bit_cast<uint64_t>(value);
+        auto const [it, inserted] = scalar_constants.try_emplace(
+            bits, static_cast<uint32_t>(module.constants.size()));
+        if (inserted) {
+            module.constants.push_back(value);
+        }
+        return it->second;
+    }
+
+    uint32_t string_constant(string text) {
+        if (auto const it = string_constants.find(text);
+            it != string_constants.end()) {
+            return it->second;
+        }
+        string const& stored = module.strings.emplace_back(std::move(text));
+        auto const index = static_cast<uint32_t>(module.constants.size());
+        module.constants.push_back({.string_value = &stored});
+        string_constants.emplace(stored, index);
+        return index;
+    }
+
+    void load(uint32_t reg, Value value) {
+        if (value.type == BuiltInType::Unit) {
+            return;
+        }
+        Register const bits = to_register(value);
+        if (value.type != BuiltInType::Float &&
+            value.type != BuiltInType::String &&
+            bits.int_value >= std::numeric_limits<int32_t>::min() &&
+            bits.int_value <= std::numeric_limits<int32_t>::max()) {
+            emit_wide(
+                RegisterOp::LoadInt, reg, static_cast<int32_t>(bits.int_value));
+        } else {
+            emit_wide(
+                RegisterOp::LoadConst,
+                reg,
+                static_cast<int32_t>(constant(bits)));
+        }
+    }
+
+    // ------------------------------------------
+    // Names and types
+    // ------------------------------------------
+
+    Symbol symbol_of(Identifier const& name) {
+        return name.symbol != no_symbol ? name.symbol
+                                        : interner.intern(name.name);
+    }
+
+    static BuiltInType type_of(Type const& type) {
+        if (!type.built_in_type) {
+            throw runtime_error(
+                format("unknown type '{}'", string(type.name.name)));
+        }
+        return *type.built_in_type;
+    }
+
+    void declare_variable(
+        Identifier const& name, uint32_t reg, BuiltInType type) {
+        names.declare(
+            symbol_of(name),
+            {.kind = Name::Kind::Variable,
+             .index = reg,
+             .frame = fn.index,
+             .type = type});
+    }
+
+    // A variable of the current function, or a global read from a
+    // function.
+    struct Access {
+        uint32_t index = 0; // register or global
+        BuiltInType type = BuiltInType::Unit;
+        bool global = false;
+    };
+
+    Access variable(Identifier const& name) {
+        auto const* binding = names.find(symbol_of(name));
+        if (binding != nullptr &&
+            binding->value.kind == Name::Kind::Variable) {
+            Name const& found = binding->value;
+            if (found.frame == fn.index || binding->depth == global_depth) {
+                return {
+                    .index = found.index,
+                    .type = found.type,
+                    .global = found.frame != fn.index};
+            }
+        }
+        throw runtime_error(
+            format("'{}' is not a variable here", string(name.name)));
+    }
+
+    // ------------------------------------------
+    // Statements and functions
+    // ------------------------------------------
+
+    // Compiles a block's statements. With `value`, a trailing `if`
+    // statement (see is_value_statement()) leaves its value there. Returns
+    // the type the block has without a final expression, like the checker.
+    template <typename Statements>
+    BuiltInType compile_statements(
+        Statements const& statements, optional<uint32_t> value) {
+        for (StmtPtr const stmt : statements) {
+            if (auto const* decl = std::get_if<FunctionDecl>(&stmt->node)) {
+                hoist(*decl);
+            }
+        }
+        bool diverges = false;
+        BuiltInType last = BuiltInType::Unit;
+        for (StmtPtr const stmt : statements) {
+            if (auto const* expr_stmt = std::get_if<ExprStmt>(&stmt->node)) {
+                bool const keep = value && stmt == statements.back() &&
+                                  is_value_statement(*stmt);
+                uint32_t const mark = fn.next_reg;
+                last = compile(*expr_stmt->expr, keep ? value : std::nullopt)
+                           .type;
+                fn.next_reg = mark;
+            } else if (auto const* decl = std::get_if<VarDecl>(&stmt->node)) {
+                last = compile_variable(*decl);
+            } else {
+                compile_function(std::get<FunctionDecl>(stmt->node));
+                last = BuiltInType::Unit;
+            }
+            diverges |= last == BuiltInType::Never;
+        }
+        if (diverges) {
+            return BuiltInType::Never;
+        }
+        if (statements.empty() || !is_value_statement(*statements.back())) {
+            return BuiltInType::Unit;
+        }
+        return last;
+    }
+
+    BuiltInType compile_variable(VarDecl const& decl) {
+        BuiltInType const type = type_of(decl.type);
+        uint32_t const reg = temp();
+        BuiltInType init = BuiltInType::Unit;
+        if (decl.init) {
+            init = compile(**decl.init, reg).type;
+        } else if (has_payload(type)) {
+            // all bits zero: 0, 0.0, false, '\0'
+            if (type == BuiltInType::String) {
+                emit_wide(
+                    RegisterOp::LoadConst,
+                    reg,
+                    static_cast<int32_t>(string_constant("")));
+            } else {
+                emit_wide(RegisterOp::LoadInt, reg, 0);
+            }
+        }
+        if (fn.index == 0 && names.depth() == global_depth) {
+            if (module.global_names.size() <= reg) {
+                module.global_names.resize(reg + 1);
+            }
+            module.global_names[reg] = string(decl.name.name);
+            emit(RegisterOp::DefineGlobal, reg);
+        }
+        declare_variable(decl.name, reg, type);
+        return init == BuiltInType::Never ? init : BuiltInType::Unit;
+    }
+
+    void hoist(FunctionDecl const& decl) {
+        auto const index = static_cast<uint32_t>(module.functions.size());
+        module.functions.push_back(
+            {.name = string(decl.name.name),
+             .params = static_cast<uint32_t>(decl.params.size())});
+        names.declare(
+            symbol_of(decl.name),
+            {.kind = Name::Kind::Function,
+             .index = index,
+             .type = type_of(decl.return_type)});
+    }
+
+    void compile_function(FunctionDecl const& decl) {
+        Name const found = names.find(symbol_of(decl.name))->value;
+        FunctionState outer = std::exchange(
+            fn, {.index = found.index, .return_type = found.type});
+        names.enter();
+        for (Param const& param : decl.params) {
+            declare_variable(param.name, temp(), type_of(param.type));
+        }
+        if (has_payload(fn.return_type)) {
+            uint32_t const result = temp();
+            compile_block(decl.body, result);
+            emit(RegisterOp::Return, result);
+        } else {
+            compile_block(decl.body, std::nullopt);
+            emit(RegisterOp::ReturnUnit, 0);
+        }
+        names.leave();
+        finish_function();
+        fn = std::move(outer);
+    }
+
+    void finish_function() {
+        RegisterFunction& function = module.functions[fn.index];
+        function.frame_size = std::max(fn.frame_size, uint32_t{1});
+        function.code = std::move(fn.code);
+    }
+
+    // ------------------------------------------
+    // Expressions
+    // ------------------------------------------
+
+    // Compiles `expr` into `target`, or without one into a register of the
+    // compiler's choice. Temporaries other than the result's are freed.
+    Operand compile(Expr const& expr, optional<uint32_t> target) {
+        uint32_t const mark = fn.next_reg;
+        Operand const value = std::visit(
+            [this, target](auto const& node) {
+                return compile_node(node, target);
+            },
+            expr.node);
+        bool const keeps = !target && !value.variable && value.reg == mark &&
+                           has_payload(value.type);
+        fn.next_reg = keeps ? mark + 1 : mark;
+        return value;
+    }
+
+    Operand compile_node(Identifier const& name, optional<uint32_t> target) {
+        auto const* binding = names.find(symbol_of(name));
+        if (binding != nullptr &&
+            binding->value.kind == Name::Kind::Constant) {
+            uint32_t const reg = destination(target);
+            emit_wide(
+                RegisterOp::LoadInt,
+                reg,
+                static_cast<int32_t>(binding->value.index));
+            return {.reg = reg, .type = binding->value.type};
+        }
+        Access const access = variable(name);
+        if (!access.global) {
+            return place(
+                {.reg = access.index, .type = access.type, .variable = true},
+                target);
+        }
+        uint32_t const reg = destination(target);
+        emit_wide(
+            RegisterOp::GetGlobal, reg, static_cast<int32_t>(access.index));
+        return {.reg = reg, .type = access.type};
+    }
+
+    Operand compile_node(
+        LiteralExpr const& literal, optional<uint32_t> target) {
+        if (!has_payload(literal.type)) {
+            return {.reg = target.value_or(0), .type = literal.type};
+        }
+        uint32_t const reg = destination(target);
+        if (literal.type == BuiltInType::String) {
+            emit_wide(
+                RegisterOp::LoadConst,
+                reg,
+                static_cast<int32_t>(
+                    string_constant(decode_escapes(literal.value))));
+        } else {
+            std::deque<string> unused;
+            load(reg, literal_value(literal, unused));
+        }
+        return {.reg = reg, .type = literal.type};
+    }
+
+    // The arguments are evaluated into consecutive registers, which become
+    // the callee's parameters.
+    Operand compile_node(CallExpr const& call, optional<uint32_t> target) {
+        auto const* binding = names.find(symbol_of(call.callee));
+        if (binding == nullptr ||
+            (binding->value.kind != Name::Kind::Function &&
+             binding->value.kind != Name::Kind::Print)) {
+            throw runtime_error(format(
+                "'{}' is not a function", string(call.callee.name)));
+        }
+        Name const callee = binding->value;
+        uint32_t const base = fn.next_reg;
+        vector<BuiltInType> types;
+        for (ExprPtr const arg : call.args) {
+            uint32_t const reg = temp();
+            types.push_back(compile(*arg, reg).type);
+        }
+        if (callee.kind == Name::Kind::Print) {
+            for (size_t i = 0; i < types.size(); ++i) {
+                emit(
+                    RegisterOp::Print,
+                    base + static_cast<uint32_t>(i),
+                    static_cast<uint32_t>(types[i]));
+            }
+            emit(RegisterOp::PrintLine, 0);
+            return {.reg = target.value_or(base), .type = BuiltInType::Unit};
+        }
+        if (module.functions[callee.index].params != call.args.size()) {
+            throw runtime_error(format(
+                "wrong number of arguments to '{}'",
+                string(call.callee.name)));
+        }
+        if (call.args.empty()) {
+            temp(); // for the result
+        }
+        emit_wide(
+            RegisterOp::Call, base, static_cast<int32_t>(callee.index));
+        return place({.reg = base, .type = callee.type}, target);
+    }
+
+    // Whether evaluating `expr` leaves every variable as it was, so one
+    // read before it may still be used after. Looks at a few nodes only;
+    // a bigger expression counts as one that does not.
+    bool leaves_variables(Expr const& expr) {
+        size_t const base = operand_stack.size();
+        operand_stack.push_back(&expr);
+        size_t budget = 16;
+        bool pure = true;
+        while (pure && operand_stack.size() > base) {
+            Expr const& next = *operand_stack.back();
+            operand_stack.pop_back();
+            if (budget-- == 0) {
+                pure = false;
+            } else if (
+                auto const* binary = std::get_if<BinaryExpr>(&next.node)) {
+                operand_stack.push_back(binary->lhs);
+                operand_stack.push_back(binary->rhs);
+            } else if (
+                auto const* prefix = std::get_if<PrefixExpr>(&next.node)) {
+                operand_stack.push_back(prefix->operand);
+            } else if (
+                auto const* postfix = std::get_if<PostfixExpr>(&next.node)) {
+                operand_stack.push_back(postfix->operand);
+            } else {
+                pure = std::holds_alternative<Identifier>(next.node) ||
+                       std::holds_alternative<LiteralExpr>(next.node);
+            }
+        }
+        operand_stack.resize(base);
+        return pure;
+    }
+
+    // The left operand of `node`, copied if the right one could change it.
+    Operand protect(Operand lhs, Expr const& rhs) {
+        if (!lhs.variable || leaves_variables(rhs)) {
+            return lhs;
+        }
+        uint32_t const reg = temp();
+        emit(RegisterOp::Move, reg, lhs.reg);
+        return {.reg = reg, .type = lhs.type};
+    }
+
+    // An int or char literal right operand, as a _K constant.
+    optional<uint32_t> constant_operand(Expr const& rhs) {
+        auto const* literal = std::get_if<LiteralExpr>(&rhs.node);
+        if (literal == nullptr || (literal->type != BuiltInType::Int &&
+                                   literal->type != BuiltInType::Char)) {
+            return std::nullopt;
+        }
+        std::deque<string> unused;
+        uint32_t const index =
+            constant(to_register(literal_value(*literal, unused)));
+        return index <= max_register ? optional(index) : std::nullopt;
+    }
+
+    static bool is_comparison(TokenKind op) {
+        switch (op) {
+        case TokenKind::Less:
+        case TokenKind::LessEq:
+        case TokenKind::Greater:
+        case TokenKind::GreaterEq:
+        case TokenKind::EqualComparison:
+        case TokenKind::NotEqualComparison:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static bool is_int_like(BuiltInType type) {
+        return type == BuiltInType::Int || type == BuiltInType::Char ||
+               type == BuiltInType::Bool;
+    }
+
+    // The instruction computing `op` on operands of type `type`.
+    static BinaryForm value_form(TokenKind op, BuiltInType type) {
+        using enum RegisterOp;
+        bool const is_float = type == BuiltInType::Float;
+        bool const is_string = type == BuiltInType::String;
+        switch (op) {
+        case TokenKind::Plus:
+            return is_float ? BinaryForm{AddFloat}
+                            : BinaryForm{AddInt, AddIntK};
+        case TokenKind::Minus:
+            return is_float ? BinaryForm{SubFloat}
+                            : BinaryForm{SubInt, SubIntK};
+        case TokenKind::Multiply:
+            return is_float ? BinaryForm{MulFloat}
+                            : BinaryForm{MulInt, MulIntK};
+        case TokenKind::Slash:
+            return is_float ? BinaryForm{DivFloat}
+                            : BinaryForm{DivInt, DivIntK};
+        case TokenKind::Modulo:
+            return {ModInt, ModIntK};
+        case TokenKind::KwLeftShift:
+            return {Shl};
+        case TokenKind::KwRightShift:
+            return {Shr};
+        case TokenKind::KwBitAnd:
+            return {BitAnd};
+        case TokenKind::KwBitOr:
+            return {BitOr};
+        case TokenKind::KwXor:
+            return {BitXor};
+        case TokenKind::Less:
+            return is_float ? BinaryForm{LtFloat} : BinaryForm{LtInt, LtIntK};
+        case TokenKind::LessEq:
+            return is_float ? BinaryForm{LeFloat} : BinaryForm{LeInt, LeIntK};
+        case TokenKind::Greater:
+            return is_float ? BinaryForm{LtFloat, std::nullopt, true}
+                            : BinaryForm{LtInt, GtIntK, true};
+        case TokenKind::GreaterEq:
+            return is_float ? BinaryForm{LeFloat, std::nullopt, true}
+                            : BinaryForm{LeInt, GeIntK, true};
+        case TokenKind::EqualComparison:
+            return is_float    ? BinaryForm{EqFloat}
+                   : is_string ? BinaryForm{EqString}
+                               : BinaryForm{EqInt, EqIntK};
+        case TokenKind::NotEqualComparison:
+            return is_float    ? BinaryForm{NeFloat}
+                   : is_string ? BinaryForm{NeString}
+                               : BinaryForm{NeInt, NeIntK};
+        default:
+            throw runtime_error(format(
+                "unsupported operator '{}'", string(to_string(op))));
+        }
+    }
+
+    // The compare-and-branch instruction of the comparison `op`.
+    static BinaryForm branch_form(TokenKind op, BuiltInType type) {
+        using enum RegisterOp;
+        bool const is_float = type == BuiltInType::Float;
+        bool const is_string = type == BuiltInType::String;
+        BinaryForm equal = is_float    ? BinaryForm{IfEqFloat}
+                           : is_string ? BinaryForm{IfEqString}
+                                       : BinaryForm{IfEqInt, IfEqIntK};
+        switch (op) {
+        case TokenKind::Less:
+            return is_float ? BinaryForm{IfLtFloat}
+                            : BinaryForm{IfLtInt, IfLtIntK};
+        case TokenKind::LessEq:
+            return is_float ? BinaryForm{IfLeFloat}
+                            : BinaryForm{IfLeInt, IfLeIntK};
+        case TokenKind::Greater:
+            return is_float ? BinaryForm{IfLtFloat, std::nullopt, true}
+                            : BinaryForm{IfLtInt, IfGtIntK, true};
+        case TokenKind::GreaterEq:
+            return is_float ? BinaryForm{IfLeFloat, std::nullopt, true}
+                            : BinaryForm{IfLeInt, IfGeIntK, true};
+        case TokenKind::NotEqualComparison:
+            equal.negate = true;
+            return equal;
+        default:
+            return equal;
+        }
+    }
+
+    // Left-deep chains "a + b + c + ...": the spine is collected on a stack
+    // and compiled from the leftmost operation out. Only the last one
+    // writes `target`.
+    Operand compile_node(BinaryExpr const& root, optional<uint32_t> target) {
+        size_t const base = binary_stack.size();
+        for (BinaryExpr const* node = &root; node != nullptr;
+             node = std::get_if<BinaryExpr>(&node->lhs->node)) {
+            binary_stack.push_back(node);
+        }
+        Operand value = compile(*binary_stack.back()->lhs, std::nullopt);
+        while (binary_stack.size() > base) {
+            BinaryExpr const& node = *binary_stack.back();
+            binary_stack.pop_back();
+            value = compile_binary(
+                node,
+                value,
+                binary_stack.size() == base ? target : std::nullopt);
+        }
+        return value;
+    }
+
+    // One operation of a chain, whose left operand is `lhs`.
+    Operand compile_binary(
+        BinaryExpr const& node, Operand lhs, optional<uint32_t> target) {
+        if (node.op == TokenKind::LogicalAnd ||
+            node.op == TokenKind::LogicalOr) {
+            uint32_t const reg = target ? *target : scratch(lhs);
+            place(lhs, reg);
+            size_t const skip = emit_jump(
+                node.op == TokenKind::LogicalAnd ? RegisterOp::JumpIfNot
+                                                 : RegisterOp::JumpIf,
+                reg);
+            compile(*node.rhs, reg);
+            bind(skip);
+            return {
+                .reg = reg,
+                .type = lhs.type == BuiltInType::Never ? lhs.type
+                                                       : BuiltInType::Bool};
+        }
+        lhs = protect(lhs, *node.rhs);
+        uint32_t const reg = target ? *target : scratch(lhs);
+        uint32_t const mark = fn.next_reg;
+        BinaryForm const form = value_form(node.op, lhs.type);
+        optional<uint32_t> const constant =
+            form.constant_op && is_int_like(lhs.type)
+                ? constant_operand(*node.rhs)
+                : std::nullopt;
+        Operand rhs{.type = lhs.type};
+        if (!constant) {
+            rhs = compile(*node.rhs, std::nullopt);
+        }
+        fn.next_reg = mark;
+        if (lhs.type == BuiltInType::Never || rhs.type == BuiltInType::Never) {
+            return {.reg = reg, .type = BuiltInType::Never};
+        }
+        BuiltInType const type =
+            is_comparison(node.op) ? BuiltInType::Bool : lhs.type;
+        if (lhs.type == BuiltInType::Unit) { // () == ()
+            load(reg, Value::of_bool(node.op == TokenKind::EqualComparison));
+        } else if (constant) {
+            emit(*form.constant_op, reg, lhs.reg, *constant);
+        } else if (form.swap) {
+            emit(form.op, reg, rhs.reg, lhs.reg);
+        } else {
+            emit(form.op, reg, lhs.reg, rhs.reg);
+        }
+        return {.reg = reg, .type = type};
+    }
+
+    Operand compile_node(PrefixExpr const& root, optional<uint32_t> target) {
+        return compile_unary_chain(root, target);
+    }
+
+    Operand compile_node(PostfixExpr const& root, optional<uint32_t> target) {
+        return compile_unary_chain(root, target);
+    }
+
+    // "- - x" or "x compl compl": the operators are collected on a stack and
+    // applied innermost first.
+    template <typename Node>
+    Operand compile_unary_chain(Node const& root, optional<uint32_t> target) {
+        size_t const base = unary_stack.size();
+        Node const* node = &root;
+        while (true) {
+            unary_stack.push_back(node->op);
+            Node const* inner = std::get_if<Node>(&node->operand->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        Operand value = compile(*node->operand, std::nullopt);
+        while (unary_stack.size() > base) {
+            TokenKind const op = unary_stack.back();
+            unary_stack.pop_back();
+            if (op == TokenKind::Plus || value.type == BuiltInType::Never) {
+                continue;
+            }
+            RegisterOp instruction = RegisterOp::Complement;
+            if (op == TokenKind::Minus) {
+                instruction = value.type == BuiltInType::Float
+                                  ? RegisterOp::NegFloat
+                                  : RegisterOp::NegInt;
+            } else if (op == TokenKind::Not) {
+                instruction = RegisterOp::Not;
+            }
+            uint32_t const reg = target && unary_stack.size() == base
+                                     ? *target
+                                     : scratch(value);
+            emit(instruction, reg, value.reg);
+            value = {.reg = reg, .type = value.type};
+        }
+        return place(value, target);
+    }
+
+    Operand compile_node(ReturnExpr const& node, optional<uint32_t> target) {
+        if (fn.index == 0) {
+            throw runtime_error("'return' outside of a function");
+        }
+        Operand value;
+        if (node.value) {
+            value = compile(**node.value, std::nullopt);
+        }
+        if (has_payload(fn.return_type)) {
+            emit(RegisterOp::Return, value.reg);
+        } else {
+            emit(RegisterOp::ReturnUnit, 0);
+        }
+        return {.reg = target.value_or(0), .type = BuiltInType::Never};
+    }
+
+    // Whether `expr`, compiled into a register, writes it only after it is
+    // done reading variables: then it can go straight into a variable.
+    static bool writes_once(Expr const& expr) {
+        if (auto const* binary = std::get_if<BinaryExpr>(&expr.node)) {
+            return binary->op != TokenKind::LogicalAnd &&
+                   binary->op != TokenKind::LogicalOr;
+        }
+        return std::holds_alternative<Identifier>(expr.node) ||
+               std::holds_alternative<LiteralExpr>(expr.node) ||
+               std::holds_alternative<CallExpr>(expr.node) ||
+               std::holds_alternative<PrefixExpr>(expr.node) ||
+               std::holds_alternative<PostfixExpr>(expr.node);
+    }
+
+    // Right-deep chains "a = b = c = ...": the targets are collected, then
+    // the value is stored into each from the innermost out.
+    Operand compile_node(AssignExpr const& root, optional<uint32_t> target) {
+        size_t const base = target_stack.size();
+        AssignExpr const* node = &root;
+        while (true) {
+            auto const* name = std::get_if<Identifier>(&node->lhs->node);
+            if (name == nullptr) {
+                target_stack.resize(base);
+                throw runtime_error("left side of '=' is not a variable");
+            }
+            target_stack.push_back(name);
+            auto const* inner = std::get_if<AssignExpr>(&node->rhs->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        Access const innermost = variable(*target_stack.back());
+        Operand value;
+        if (!innermost.global && writes_once(*node->rhs)) {
+            value = compile(*node->rhs, innermost.index);
+            value.variable = true;
+        } else {
+            value = compile(*node->rhs, std::nullopt);
+        }
+        while (target_stack.size() > base) {
+            Access const access = variable(*target_stack.back());
+            target_stack.pop_back();
+            BuiltInType const type = value.type == BuiltInType::Never
+                                         ? value.type
+                                         : access.type;
+            if (access.global) {
+                emit_wide(
+                    RegisterOp::SetGlobal,
+                    value.reg,
+                    static_cast<int32_t>(access.index));
+                value.type = type;
+            } else {
+                value = place(value, access.index);
+                value = {.reg = access.index, .type = type, .variable = true};
+            }
+        }
+        return place(value, target);
+    }
+
+    Operand compile_node(BlockExpr const& block, optional<uint32_t> target) {
+        uint32_t const reg = destination(target);
+        return {.reg = reg, .type = compile_block(block, reg)};
+    }
+
+    // Compiles a block; with `value` its value is left there.
+    BuiltInType compile_block(
+        BlockExpr const& block, optional<uint32_t> value) {
+        names.enter();
+        uint32_t const first_reg = fn.next_reg;
+        BuiltInType type = compile_statements(
+            block.statements, block.final_expr ? std::nullopt : value);
+        if (block.final_expr) {
+            type = compile(**block.final_expr, value).type;
+        }
+        fn.next_reg = first_reg; // sibling scopes reuse the registers
+        names.leave();
+        return type;
+    }
+
+    Operand compile_node(IfExpr const& node, optional<uint32_t> target) {
+        uint32_t const reg = destination(target);
+        vector<size_t> else_jumps;
+        compile_branch(*node.condition, false, else_jumps);
+        if (!node.else_expr) { // the value is unit
+            compile_block(node.then_block, std::nullopt);
+            bind(else_jumps);
+            return {.reg = reg, .type = BuiltInType::Unit};
+        }
+        BuiltInType const then_type = compile_block(node.then_block, reg);
+        size_t const end_jump = emit_jump(RegisterOp::Jump);
+        bind(else_jumps);
+        BuiltInType const else_type = compile(**node.else_expr, reg).type;
+        bind(end_jump);
+        return {
+            .reg = reg,
+            .type = then_type == BuiltInType::Never ? else_type : then_type};
+    }
+
+    // Emits code that jumps if `condition` is `when` and falls through
+    // otherwise; the jumps are added to `jumps` for the caller to bind.
+    void compile_branch(
+        Expr const& condition, bool when, vector<size_t>& jumps) {
+        Expr const* expr = &condition;
+        for (auto const* prefix = std::get_if<PrefixExpr>(&expr->node);
+             prefix != nullptr && prefix->op == TokenKind::Not;
+             prefix = std::get_if<PrefixExpr>(&expr->node)) {
+            when = !when;
+            expr = prefix->operand;
+        }
+        uint32_t const mark = fn.next_reg;
+        auto const* binary = std::get_if<BinaryExpr>(&expr->node);
+        auto const* name = std::get_if<Identifier>(&expr->node);
+        auto const* binding =
+            name != nullptr ? names.find(symbol_of(*name)) : nullptr;
+        if (binary != nullptr && (binary->op == TokenKind::LogicalAnd ||
+                                  binary->op == TokenKind::LogicalOr)) {
+            compile_logical_branch(*binary, when, jumps);
+        } else if (binary != nullptr && is_comparison(binary->op)) {
+            compile_comparison_branch(*binary, when, jumps);
+        } else if (
+            binding != nullptr &&
+            binding->value.kind == Name::Kind::Constant) { // true, false
+            if ((binding->value.index != 0) == when) {
+                jumps.push_back(emit_jump(RegisterOp::Jump));
+            }
+        } else {
+            Operand const value = compile(*expr, std::nullopt);
+            if (value.type != BuiltInType::Never) {
+                jumps.push_back(emit_jump(
+                    when ? RegisterOp::JumpIf : RegisterOp::JumpIfNot,
+                    value.reg));
+            }
+        }
+        fn.next_reg = mark;
+    }
+
+    // "a && b && ..." or "a || b || ...": the operands are collected on a
+    // stack and branched on from the leftmost.
+    void compile_logical_branch(
+        BinaryExpr const& root, bool when, vector<size_t>& jumps) {
+        size_t const base = operand_stack.size();
+        BinaryExpr const* node = &root;
+        while (true) {
+            operand_stack.push_back(node->rhs);
+            auto const* inner = std::get_if<BinaryExpr>(&node->lhs->node);
+            if (inner == nullptr || inner->op != root.op) {
+                operand_stack.push_back(node->lhs);
+                break;
+            }
+            node = inner;
+        }
+        // "a && b" is false as soon as one operand is; "a || b" true
+        bool const decided_by_one = (root.op == TokenKind::LogicalOr) == when;
+        vector<size_t> fall_through;
+        while (operand_stack.size() > base) {
+            Expr const& operand = *operand_stack.back();
+            operand_stack.pop_back();
+            if (decided_by_one || operand_stack.size() == base) {
+                compile_branch(operand, when, jumps);
+            } else {
+                compile_branch(operand, !when, fall_through);
+            }
+        }
+        bind(fall_through);
+    }
+
+    void compile_comparison_branch(
+        BinaryExpr const& node, bool when, vector<size_t>& jumps) {
+        Operand const lhs =
+            protect(compile(*node.lhs, std::nullopt), *node.rhs);
+        BinaryForm const form = branch_form(node.op, lhs.type);
+        optional<uint32_t> const constant =
+            form.constant_op && is_int_like(lhs.type)
+                ? constant_operand(*node.rhs)
+                : std::nullopt;
+        Operand rhs{.type = lhs.type};
+        if (!constant) {
+            rhs = compile(*node.rhs, std::nullopt);
+        }
+        if (lhs.type == BuiltInType::Never || rhs.type == BuiltInType::Never) {
+            return;
+        }
+        if (lhs.type == BuiltInType::Unit) { // () == ()
+            if ((node.op == TokenKind::EqualComparison) == when) {
+                jumps.push_back(emit_jump(RegisterOp::Jump));
+            }
+            return;
+        }
+        uint32_t const sense = when != form.negate ? 1 : 0;
+        if (constant) {
+            emit(*form.constant_op, sense, lhs.reg, *constant);
+        } else if (form.swap) {
+            emit(form.op, sense, rhs.reg, lhs.reg);
+        } else {
+            emit(form.op, sense, lhs.reg, rhs.reg);
+        }
+        jumps.push_back(emit_jump(RegisterOp::Jump));
+    }
+
+    // The condition is tested at the bottom: one branch per iteration.
+    Operand compile_node(WhileExpr const& node, optional<uint32_t> target) {
+        size_t const enter = emit_jump(RegisterOp::Jump);
+        fn.loops.emplace_back();
+        size_t const body = fn.code.size();
+        compile_block(node.body, std::nullopt);
+        bind(enter);
+        bind(fn.loops.back().continues);
+        vector<size_t> repeat;
+        compile_branch(*node.condition, true, repeat);
+        for (size_t const jump : repeat) {
+            patch(jump, body);
+        }
+        bind(fn.loops.back().breaks);
+        fn.loops.pop_back();
+        return {.reg = target.value_or(0), .type = BuiltInType::Unit};
+    }
+
+    // `for v in n` runs the body for v = 0, 1, ..., n - 1. The count and
+    // the counter live in hidden registers, so the body may assign v.
+    Operand compile_node(ForExpr const& node, optional<uint32_t> target) {
+        uint32_t const first = temp();
+        temp(); // the counter
+        uint32_t const loop_var = temp();
+        compile(*node.iter_expr, first); // outside the loop variable's scope
+        names.enter();
+        declare_variable(node.loop_var, loop_var, BuiltInType::Int);
+        emit(RegisterOp::ForPrep, first);
+        size_t const exit = emit_jump(RegisterOp::Jump);
+        fn.loops.emplace_back();
+        size_t const body = fn.code.size();
+        compile_block(node.body, std::nullopt);
+        bind(fn.loops.back().continues);
+        emit(RegisterOp::ForLoop, first);
+        patch(emit_jump(RegisterOp::Jump), body);
+        bind(exit);
+        bind(fn.loops.back().breaks);
+        fn.loops.pop_back();
+        names.leave();
+        return {.reg = target.value_or(0), .type = BuiltInType::Unit};
+    }
+
+    Loop& innermost_loop(string_view keyword) {
+        if (fn.loops.empty()) {
+            throw runtime_error(format("'{}' outside of a loop", keyword));
+        }
+        return fn.loops.back();
+    }
+
+    Operand compile_node(BreakExpr const&, optional<uint32_t> target) {
+        innermost_loop("break").breaks.push_back(
+            emit_jump(RegisterOp::Jump));
+        return {.reg = target.value_or(0), .type = BuiltInType::Never};
+    }
+
+    Operand compile_node(ContinueExpr const&, optional<uint32_t> target) {
+        innermost_loop("continue")
+            .continues.push_back(emit_jump(RegisterOp::Jump));
+        return {.reg = target.value_or(0), .type = BuiltInType::Never};
+    }
+};
+
+inline RegisterModule compile_register_code(
+    Program const& program, Interner& interner = global_interner()) {
+    return RegisterCompiler(interner).compile(program);
+}
+
+} // namespace mini_compiler
@@ -0,0 +1,354 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// register_vm.h
+
+#pragma once
+
+#include "interpreter.h"
+#include "output_writer.h"
+#include "register_bytecode.h"
+#include "stack_vm.h" // MINI_COMPILER_COMPUTED_GOTO, max_call_depth
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Register virtual machine
+// ==========================================
+
+// Runs a RegisterModule; it computes what the Interpreter computes and
+// prints what it prints (see RegisterCompiler for the one difference).
+//
+// All frames are windows into one register file: a call's window starts
+// at the register of its first argument, so the arguments are in place
+// and the result is left where the caller expects it. The bottom window
+// is the top-level code's, and its registers are the globals. Like the
+// StackVM, calls push a Frame record and do not recurse in C++.
+class RegisterVM {
+  public:
+    static constexpr size_t max_call_depth = StackVM::max_call_depth;
+
+    explicit RegisterVM(std::ostream& out) : out(out) {}
+
+    // print() output is flushed before returning or throwing.
+    void run(RegisterModule const& module) {
+        struct FlushOnExit {
+            OutputWriter& out;
+            ~FlushOnExit() { out.flush(); }
+        } const flush_on_exit{out};
+
+        size_t const globals = module.functions.front().frame_size;
+        registers.assign(std::max(initial_registers, globals), Register{});
+        defined.assign(globals, 0);
+        frames.clear();
+        execute(module);
+    }
+
+  private:
+    static constexpr size_t initial_registers = size_t{1} << 12;
+
+    struct Frame {
+        RegisterFunction const* function;
+        RegisterInstruction const* return_pc;
+        size_t base; // of the caller, an index: the registers may move
+    };
+
+    OutputWriter out;
+    vector<Register> registers;
+    vector<uint8_t> defined; // by global: initialized yet
+    vector<Frame> frames;
+
+    void execute(RegisterModule const& module) {
+        Register const* const constants = module.constants.data();
+        RegisterFunction const* function = &module.functions.front();
+        RegisterInstruction const* pc = function->code.data();
+        Register* r = registers.data(); // the current window
+        RegisterInstruction instruction = 0;
+
+        auto error = [&](string_view message) {
+            if (frames.empty()) {
+                return RuntimeError(string(message));
+            }
+            return RuntimeError(
+                format("{} (in function '{}')", message, function->name));
+        };
+
+#define R(field) r[field##_of(instruction)]
+#define K(field) constants[field##_of(instruction)]
+
+#if MINI_COMPILER_COMPUTED_GOTO
+#define AS_LABEL(name) &&op_##name,
+        static void* const labels[] = {REGISTER_OPS(AS_LABEL)};
+#undef AS_LABEL
+#define VM_CASE(name) op_##name:
+#define VM_NEXT()                                                              \
+    instruction = *pc++;                                                       \
+    goto* labels[instruction & 0xFF]
+
+        VM_NEXT();
+#else
+#define VM_CASE(name) case RegisterOp::name:
+#define VM_NEXT() continue
+
+        for (;;) {
+            instruction = *pc++;
+            switch (register_op_of(instruction)) {
+#endif
+
+        VM_CASE(Move) {
+            R(a) = R(b);
+            VM_NEXT();
+        }
+        VM_CASE(LoadInt) {
+            R(a).int_value = bx_of(instruction);
+            VM_NEXT();
+        }
+        VM_CASE(LoadConst) {
+            R(a) = K(bx);
+            VM_NEXT();
+        }
+        VM_CASE(GetGlobal) {
+            auto const global = static_cast<uint32_t>(bx_of(instruction));
+            if (!defined[global]) {
+                throw error(format(
+                    "'{}' is used before it is initialized",
+                    module.global_names[global]));
+            }
+            R(a) = registers[global];
+            VM_NEXT();
+        }
+        VM_CASE(SetGlobal) {
+            auto const global = static_cast<uint32_t>(bx_of(instruction));
+            registers[global] = R(a);
+            defined[global] = 1;
+            VM_NEXT();
+        }
+        VM_CASE(DefineGlobal) {
+            defined[a_of(instruction)] = 1;
+            VM_NEXT();
+        }
+
+#define VM_INT(name, apply)                                                    \
+    VM_CASE(name) {                                                            \
+        R(a).int_value = apply(R(b).int_value, R(c).int_value);                \
+        VM_NEXT();                                                             \
+    }
+#define VM_INT_K(name, apply)                                                  \
+    VM_INT(name, apply)                                                        \
+    VM_CASE(name##K) {                                                         \
+        R(a).int_value = apply(R(b).int_value, K(c).int_value);                \
+        VM_NEXT();                                                             \
+    }
+#define VM_INT_DIVISION(name, apply)                                           \
+    VM_INT_K(name, [&](int64_t lhs, int64_t rhs) {                             \
+        if (rhs == 0) {                                                        \
+            throw error("division by zero");                                   \
+        }                                                                      \
+        return apply(lhs, rhs);                                                \
+    })
+#define VM_FLOAT(name, op)                                                     \
+    VM_CASE(name) {                                                            \
+        R(a).float_value = R(b).float_value op R(c).float_value;               \
+        VM_NEXT();                                                             \
+    }
+
+        VM_INT_K(AddInt, wrapping_add)
+        VM_INT_K(SubInt, wrapping_sub)
+        VM_INT_K(MulInt, wrapping_mul)
+        VM_INT_DIVISION(DivInt, int_divide)
+        VM_INT_DIVISION(ModInt, int_modulo)
+        VM_INT(Shl, shift_left)
+        VM_INT(Shr, shift_right)
+        VM_INT(BitAnd, [](int64_t lhs, int64_t rhs) { return lhs & rhs; })
+        VM_INT(BitOr, [](int64_t lhs, int64_t rhs) { return lhs | rhs; })
+        VM_INT(BitXor, [](int64_t lhs, int64_t rhs) { return lhs ^ rhs; })
+        VM_FLOAT(AddFloat, +)
+        VM_FLOAT(SubFloat, -)
+        VM_FLOAT(MulFloat, *)
+        VM_FLOAT(DivFloat, /) // IEEE: inf or nan
+
+        VM_CASE(NegInt) {
+            R(a).int_value = wrapping_negate(R(b).int_value);
+            VM_NEXT();
+        }
+        VM_CASE(NegFloat) {
+            R(a).float_value = -R(b).float_value;
+            VM_NEXT();
+        }
+        VM_CASE(Not) {
+            R(a).int_value = R(b).int_value ^ 1;
+            VM_NEXT();
+        }
+        VM_CASE(Complement) {
+            R(a).int_value = ~R(b).int_value;
+            VM_NEXT();
+        }
+
+        // comparisons leave 0 or 1
+#define VM_COMPARE(name, lhs, relation, rhs)                                   \
+    VM_CASE(name) {                                                            \
+        R(a).int_value = (lhs)relation(rhs);                                   \
+        VM_NEXT();                                                             \
+    }
+
+        VM_COMPARE(LtInt, R(b).int_value, <, R(c).int_value)
+        VM_COMPARE(LeInt, R(b).int_value, <=, R(c).int_value)
+        VM_COMPARE(EqInt, R(b).int_value, ==, R(c).int_value)
+        VM_COMPARE(NeInt, R(b).int_value, !=, R(c).int_value)
+        VM_COMPARE(LtIntK, R(b).int_value, <, K(c).int_value)
+        VM_COMPARE(LeIntK, R(b).int_value, <=, K(c).int_value)
+        VM_COMPARE(GtIntK, R(b).int_value, >, K(c).int_value)
+        VM_COMPARE(GeIntK, R(b).int_value, >=, K(c).int_value)
+        VM_COMPARE(EqIntK, R(b).int_value, ==, K(c).int_value)
+        VM_COMPARE(NeIntK, R(b).int_value, !=, K(c).int_value)
+        VM_COMPARE(LtFloat, R(b).float_value, <, R(c).float_value)
+        VM_COMPARE(LeFloat, R(b).float_value, <=, R(c).float_value)
+        VM_COMPARE(EqFloat, R(b).float_value, ==, R(c).float_value)
+        VM_COMPARE(NeFloat, R(b).float_value, !=, R(c).float_value)
+        VM_COMPARE(EqString, *R(b).string_value, ==, *R(c).string_value)
+        VM_COMPARE(NeString, *R(b).string_value, !=, *R(c).string_value)
+
+        // Compare and branch: the JUMP that follows is taken here, without
+        // a dispatch, if the comparison came out as `a` says.
+#define VM_BRANCH(name, lhs, relation, rhs)                                    \
+    VM_CASE(name) {                                                            \
+        if (((lhs)relation(rhs)) == (a_of(instruction) != 0)) {                \
+            pc += 1 + bx_of(*pc);                                              \
+        } else {                                                               \
+            ++pc;                                                              \
+        }                                                                      \
+        VM_NEXT();                                                             \
+    }
+
+        VM_BRANCH(IfLtInt, R(b).int_value, <, R(c).int_value)
+        VM_BRANCH(IfLeInt, R(b).int_value, <=, R(c).int_value)
+        VM_BRANCH(IfEqInt, R(b).int_value, ==, R(c).int_value)
+        VM_BRANCH(IfLtIntK, R(b).int_value, <, K(c).int_value)
+        VM_BRANCH(IfLeIntK, R(b).int_value, <=, K(c).int_value)
+        VM_BRANCH(IfGtIntK, R(b).int_value, >, K(c).int_value)
+        VM_BRANCH(IfGeIntK, R(b).int_value, >=, K(c).int_value)
+        VM_BRANCH(IfEqIntK, R(b).int_value, ==, K(c).int_value)
+        VM_BRANCH(IfLtFloat, R(b).float_value, <, R(c).float_value)
+        VM_BRANCH(IfLeFloat, R(b).float_value, <=, R(c).float_value)
+        VM_BRANCH(IfEqFloat, R(b).float_value, ==, R(c).float_value)
+        VM_BRANCH(IfEqString, *R(b).string_value, ==, *R(c).string_value)
+#undef VM_BRANCH
+#undef VM_COMPARE
+#undef VM_FLOAT
+#undef VM_INT_DIVISION
+#undef VM_INT_K
+#undef VM_INT
+
+        VM_CASE(Jump) {
+            pc += bx_of(instruction);
+            VM_NEXT();
+        }
+        VM_CASE(JumpIf) {
+            if (R(a).int_value != 0) {
+                pc += bx_of(instruction);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(JumpIfNot) {
+            if (R(a).int_value == 0) {
+                pc += bx_of(instruction);
+            }
+            VM_NEXT();
+        }
+
+        // the JUMP that follows is taken here, without a dispatch
+        VM_CASE(ForPrep) {
+            Register* const loop = &R(a); // count, counter, variable
+            if (loop[0].int_value > 0) {
+                loop[1].int_value = 0;
+                loop[2].int_value = 0;
+                ++pc;
+            } else {
+                pc += 1 + bx_of(*pc);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(ForLoop) {
+            Register* const loop = &R(a);
+            int64_t const next = loop[1].int_value + 1;
+            if (next < loop[0].int_value) {
+                loop[1].int_value = next;
+                loop[2].int_value = next;
+                pc += 1 + bx_of(*pc);
+            } else {
+                ++pc;
+            }
+            VM_NEXT();
+        }
+
+        VM_CASE(Call) {
+            RegisterFunction const& callee =
+                module.functions[static_cast<uint32_t>(bx_of(instruction))];
+            if (frames.size() == max_call_depth) {
+                throw error(format(
+                    "stack overflow: more than {} nested calls",
+                    max_call_depth));
+            }
+            size_t const caller_base =
+                static_cast<size_t>(r - registers.data());
+            size_t const callee_base = caller_base + a_of(instruction);
+            size_t const needed = callee_base + callee.frame_size;
+            if (needed > registers.size()) {
+                registers.resize(std::max(needed, registers.size() * 2));
+            }
+            frames.push_back({function, pc, caller_base});
+            function = &callee;
+            r = registers.data() + callee_base;
+            pc = callee.code.data();
+            VM_NEXT();
+        }
+        // the result goes to the window's first register, the caller's a
+#define VM_RETURN()                                                            \
+    Frame const& caller = frames.back();                                       \
+    function = caller.function;                                                \
+    pc = caller.return_pc;                                                     \
+    r = registers.data() + caller.base;                                        \
+    frames.pop_back();                                                         \
+    VM_NEXT()
+
+        VM_CASE(Return) {
+            r[0] = R(a);
+            VM_RETURN();
+        }
+        VM_CASE(ReturnUnit) { VM_RETURN(); }
+#undef VM_RETURN
+        VM_CASE(Print) {
+            auto const type = static_cast<BuiltInType>(b_of(instruction));
+            write_value(out, to_value(R(a), type));
+            VM_NEXT();
+        }
+        VM_CASE(PrintLine) {
+            out.put('\n');
+            VM_NEXT();
+        }
+        VM_CASE(Halt) { return; }
+
+#if !MINI_COMPILER_COMPUTED_GOTO
+            }
+        }
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+#undef K
+#undef R
+    }
+};
+
+} // namespace mini_compiler
@@ -0,0 +1,69 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// sample_program.h
+
+#pragma once
+
+#include <string_view>
+
+namespace mini_compiler {
+
+// The program compiled when MiniCompiler runs without inputs; benchmarks
+// scale it up by repetition.
+inline constexpr std::string_view sample_program = R"(
+    let x: int = { let a: int = 2; let b: int = 3; a * b };  // x = 6
+    let y: int = 1 + 2 * 3 - 4 / 2;
+
+    fn foo(a: int, b: float) -> bool {
+        let s: string = "hi\n";
+        x = { return 5; 6 };
+        print(s);
+        return !(a!=0) && (x > 5);
+    }
+    fn calc(a: int, b: int, c: int) -> int {
+        -c + a * b + 10
+    }
+
+    let count: int = 0;
+    fn increment(amount: int) -> int {
+        count = count + amount;
+        return count;  // simplified
+    }
+
+    fn test() {
+        let a: int = -5;
+        let b: int = - -10;
+        let flag: bool = !true;
+        let x: int = 1 + 2 * 3;
+        x = x + 1;
+        print(x);
+        return;
+    }
+	fn test2() {
+		let c: char = 'a';
+		let nl: char = '\n';
+		let i: int = 0;
+		while i < 10 {
+			if i == 5 {
+				break;
+			}
+			i = i + 1;
+			continue;
+		}
+		let last: int = { i };
+	}
+
+    fn main() {
+        foo(2 - 3, 3.14 * 2);
+        x = add(x, 20, 10);
+        print("x: ", x);
+        let result: int = increment(5);
+        print("Result: ", result);
+        test();
+        test2();
+        let x1: int = if a > b { 5 } else { 10 };
+        while i < 10 { i = i + 1; }
+        print("Done");
+    }
+    )";
+
+} // namespace mini_compiler
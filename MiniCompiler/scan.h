@@ -0,0 +1,219 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// scan.h
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// SIMD kernels are selected at compile time. Define MINI_COMPILER_NO_SIMD to
+// force the scalar fallback (useful for differential testing).
+#if !defined(MINI_COMPILER_NO_SIMD)
+#if defined(__AVX2__)
+#define MINI_COMPILER_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MINI_COMPILER_SCAN_SSE2 1
+#include <emmintrin.h>
+#endif
+#endif
+
+namespace mini_compiler {
+
+// ==========================================
+// Character classes
+// ==========================================
+
+// Bits of char_class_table. Mirrors the "C" locale behaviour of
+// std::isspace / std::isdigit / std::isalpha / std::isalnum, so bytes >= 0x80
+// belong to no class.
+namespace char_class {
+
+inline constexpr uint8_t space = 1U << 0;
+inline constexpr uint8_t digit = 1U << 1;
+inline constexpr uint8_t ident_start = 1U << 2;
+inline constexpr uint8_t ident_part = 1U << 3;
+
+} // namespace char_class
+
+inline constexpr std::array<uint8_t, 256> char_class_table = [] {
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; ++c) {
+        uint8_t bits = 0;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            bits |= char_class::space;
+        }
+        if (c >= '0' && c <= '9') {
+            bits |= char_class::digit | char_class::ident_part;
+        }
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+            bits |= char_class::ident_start | char_class::ident_part;
+        }
+        table[static_cast<size_t>(c)] = bits;
+    }
+    return table;
+}();
+
+constexpr bool has_char_class(char c, uint8_t cls) {
+    return (char_class_table[static_cast<unsigned char>(c)] & cls) != 0;
+}
+
+// ==========================================
+// Run scanners
+// ==========================================
+
+// The sets a run scanner can skip over.
+enum class CharRun : uint8_t {
+    Space,     // ' ' '\t' '\n' '\v' '\f' '\r'
+    Digit,     // [0-9]
+    IdentPart, // [A-Za-z0-9_]
+    NotNewline // anything but '\n' (body of a // comment)
+};
+
+namespace detail {
+
+constexpr bool in_run(CharRun run, char c) {
+    switch (run) {
+    case CharRun::Space:
+        return has_char_class(c, char_class::space);
+    case CharRun::Digit:
+        return has_char_class(c, char_class::digit);
+    case CharRun::IdentPart:
+        return has_char_class(c, char_class::ident_part);
+    case CharRun::NotNewline:
+        return c != '\n';
+    }
+    return false;
+}
+
+#if defined(MINI_COMPILER_SCAN_SSE2)
+
+struct Sse2 {
+    using Vec = __m128i;
+    using Mask = uint32_t;
+    static constexpr ptrdiff_t width = 16;
+
+    static Vec load(char const* p) {
+        return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    }
+
+    static Vec set1(char c) { return _mm_set1_epi8(c); }
+
+    static Vec add(Vec a, Vec b) { return _mm_add_epi8(a, b); }
+
+    static Vec eq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+
+    static Vec lt(Vec a, Vec b) { return _mm_cmplt_epi8(a, b); }
+
+    static Vec bit_or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+
+    static Mask mask(Vec v) {
+        return static_cast<Mask>(_mm_movemask_epi8(v)) & 0xFFFFU;
+    }
+
+    static constexpr Mask all = 0xFFFFU;
+};
+
+#endif
+
+#if defined(MINI_COMPILER_SCAN_AVX2)
+
+struct Avx2 {
+    using Vec = __m256i;
+    using Mask = uint32_t;
+    static constexpr ptrdiff_t width = 32;
+
+    static Vec load(char const* p) {
+        return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+    }
+
+    static Vec set1(char c) { return _mm256_set1_epi8(c); }
+
+    static Vec add(Vec a, Vec b) { return _mm256_add_epi8(a, b); }
+
+    static Vec eq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+
+    static Vec lt(Vec a, Vec b) { return _mm256_cmpgt_epi8(b, a); }
+
+    static Vec bit_or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+
+    static Mask mask(Vec v) {
+        return static_cast<Mask>(_mm256_movemask_epi8(v));
+    }
+
+    static constexpr Mask all = 0xFFFFFFFFU;
+};
+
+#endif
+
+#if defined(MINI_COMPILER_SCAN_SSE2) || defined(MINI_COMPILER_SCAN_AVX2)
+
+// lo <= v <= hi as an unsigned byte compare, built from the signed compare
+// that SSE2/AVX2 provide: bias (v - lo) by 0x80 and compare against the
+// biased width of the range.
+template <typename S>
+typename S::Vec in_range(typename S::Vec v, char lo, char hi) {
+    auto const biased = S::add(v, S::set1(static_cast<char>(0x80 - lo)));
+    return S::lt(biased, S::set1(static_cast<char>(hi - lo - 127)));
+}
+
+// Bit i is set when block[i] belongs to the run.
+template <typename S, CharRun run>
+typename S::Mask run_mask(char const* block) {
+    auto const v = S::load(block);
+    if constexpr (run == CharRun::Space) {
+        return S::mask(
+            S::bit_or(S::eq(v, S::set1(' ')), in_range<S>(v, '\t', '\r')));
+    } else if constexpr (run == CharRun::Digit) {
+        return S::mask(in_range<S>(v, '0', '9'));
+    } else if constexpr (run == CharRun::IdentPart) {
+        // folding bit 5 maps 'A'-'Z' onto 'a'-'z' and leaves the digit and
+        // underscore tests below unaffected
+        auto const lower = S::bit_or(v, S::set1(0x20));
+        return S::mask(S::bit_or(
+            S::bit_or(in_range<S>(lower, 'a', 'z'), in_range<S>(v, '0', '9')),
+            S::eq(v, S::set1('_'))));
+    } else {
+        return S::mask(S::eq(v, S::set1('\n'))) ^ S::all;
+    }
+}
+
+template <typename S, CharRun run>
+char const* scan_blocks(char const* p, char const* end) {
+    while (end - p >= S::width) {
+        auto const stop = run_mask<S, run>(p) ^ S::all;
+        if (stop != 0) {
+            return p + std::countr_zero(stop);
+        }
+        p += S::width;
+    }
+    return p;
+}
+
+#endif
+
+} // namespace detail
+
+// Returns the first position in [p, end) that is not part of `run`, or `end`.
+// Never reads outside [p, end).
+template <CharRun run> char const* scan_run(char const* p, char const* end) {
+#if defined(MINI_COMPILER_SCAN_AVX2)
+    p = detail::scan_blocks<detail::Avx2, run>(p, end);
+    if (p != end && !detail::in_run(run, *p)) {
+        return p;
+    }
+#endif
+#if defined(MINI_COMPILER_SCAN_SSE2)
+    p = detail::scan_blocks<detail::Sse2, run>(p, end);
+#endif
+    while (p != end && detail::in_run(run, *p)) {
+        ++p;
+    }
+    return p;
+}
+
+} // namespace mini_compiler
@@ -0,0 +1,970 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// semantic.h
+
+#pragma once
+
+#include "interner.h"
+#include "lexer.h"
+#include "line_table.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::format;
+using std::optional;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Scoped symbol table
+// ==========================================
+//
+// Maps a symbol to its innermost visible declaration. All scopes share one
+// open-addressing table (symbol -> newest binding) and one binding array
+// that doubles as the undo stack: a binding remembers the binding it
+// shadows, and leaving a scope pops the bindings made in it and points
+// their slots back at the shadowed ones. Entering and leaving a scope
+// allocates nothing, and a lookup is one probe sequence no matter how
+// deeply scopes nest.
+
+template <typename Value> class ScopedSymbolTable {
+  public:
+    struct Binding {
+        Symbol symbol;
+        uint32_t depth;    // scope depth of the declaration
+        uint32_t shadowed; // index of the binding this one hides, or none
+        Value value;
+    };
+
+    ScopedSymbolTable() : slots(initial_capacity) {}
+
+    void enter() { marks.push_back(bindings.size()); }
+
+    void leave() {
+        size_t const mark = marks.back();
+        marks.pop_back();
+        while (bindings.size() > mark) {
+            Binding const& binding = bindings.back();
+            slots[probe(binding.symbol)].binding = binding.shadowed;
+            bindings.pop_back();
+        }
+    }
+
+    // Number of scopes entered and not yet left.
+    uint32_t depth() const { return static_cast<uint32_t>(marks.size()); }
+
+    // Binds `symbol` in the innermost scope. If it is already bound in that
+    // scope nothing is declared and the existing binding is returned.
+    Binding const* declare(Symbol symbol, Value const& value) {
+        if ((occupied + 1) * 2 > slots.size()) {
+            rehash();
+        }
+        Slot& slot = slots[probe(symbol)];
+        if (slot.symbol == no_symbol) {
+            slot.symbol = symbol;
+            ++occupied;
+        } else if (
+            slot.binding != none && bindings[slot.binding].depth == depth()) {
+            return &bindings[slot.binding];
+        }
+        bindings.push_back({symbol, depth(), slot.binding, value});
+        slot.binding = static_cast<uint32_t>(bindings.size() - 1);
+        return nullptr;
+    }
+
+    // The innermost binding of `symbol`, or nullptr. Valid until the next
+    // declare() or leave().
+    Binding const* find(Symbol symbol) const {
+        Slot const& slot = slots[probe(symbol)];
+        return slot.binding == none ? nullptr : &bindings[slot.binding];
+    }
+
+  private:
+    static constexpr uint32_t none = ~uint32_t{0};
+    static constexpr size_t initial_capacity = 256; // a power of two
+
+    struct Slot {
+        Symbol symbol = no_symbol;
+        uint32_t binding = none; // none: the symbol is not bound (any more)
+    };
+
+    vector<Slot> slots;
+    size_t occupied = 0; // slots with a symbol, bound or not
+    vector<Binding> bindings;
+    vector<size_t> marks; // bindings.size() when each open scope began
+
+    // Index of the slot holding `symbol`, or of the empty slot where it
+    // would go. Symbols are dense, so a multiplicative hash spreads them.
+    size_t probe(Symbol symbol) const {
+        size_t const mask = slots.size() - 1;
+        size_t i = static_cast<size_t>(
+                       (uint64_t{symbol} * 0x9E3779B97F4A7C15) >> 32) &
+                   mask;
+        while (slots[i].symbol != symbol && slots[i].symbol != no_symbol) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    // Drops the slots of symbols no longer bound and keeps the table at
+    // most a quarter full.
+    void rehash() {
+        vector<Slot> old = std::move(slots);
+        size_t live = 0;
+        for (Slot const& slot : old) {
+            live += slot.binding != none;
+        }
+        slots.assign(
+            std::max(initial_capacity, std::bit_ceil((live + 1) * 4)), Slot{});
+        occupied = live;
+        for (Slot const& slot : old) {
+            if (slot.binding != none) {
+                slots[probe(slot.symbol)] = slot;
+            }
+        }
+    }
+};
+
+// ==========================================
+// Typing rules
+// ==========================================
+//
+// Result types of the operators for operands of known types; nullopt when
+// the operator does not apply. Operands of type never are handled by the
+// caller (the expression never completes).
+
+// Both operands must have the same type: like Rust, the language has no
+// implicit conversions, so `3.14 * 2` is an error and `3.14 * 2.0` is not.
+// The register VM relies on it: its arithmetic instructions are typed.
+constexpr optional<BuiltInType> binary_result_type(
+    TokenKind op, BuiltInType lhs, BuiltInType rhs) {
+    if (lhs != rhs) {
+        return std::nullopt;
+    }
+    bool const numeric = lhs == BuiltInType::Int || lhs == BuiltInType::Float;
+    switch (op) {
+    case TokenKind::Plus:
+    case TokenKind::Minus:
+    case TokenKind::Multiply:
+    case TokenKind::Slash:
+        return numeric ? optional(lhs) : std::nullopt;
+    case TokenKind::Modulo:
+    case TokenKind::KwLeftShift:
+    case TokenKind::KwRightShift:
+    case TokenKind::KwBitAnd:
+    case TokenKind::KwBitOr:
+    case TokenKind::KwXor:
+        return lhs == BuiltInType::Int ? optional(lhs) : std::nullopt;
+    case TokenKind::Less:
+    case TokenKind::LessEq:
+    case TokenKind::Greater:
+    case TokenKind::GreaterEq:
+        return numeric || lhs == BuiltInType::Char
+                   ? optional(BuiltInType::Bool)
+                   : std::nullopt;
+    case TokenKind::EqualComparison:
+    case TokenKind::NotEqualComparison:
+        return BuiltInType::Bool;
+    case TokenKind::LogicalAnd:
+    case TokenKind::LogicalOr:
+        return lhs == BuiltInType::Bool ? optional(lhs) : std::nullopt;
+    default:
+        return std::nullopt;
+    }
+}
+
+constexpr optional<BuiltInType> prefix_result_type(
+    TokenKind op, BuiltInType operand) {
+    switch (op) {
+    case TokenKind::Plus:
+    case TokenKind::Minus:
+        return operand == BuiltInType::Int || operand == BuiltInType::Float
+                   ? optional(operand)
+                   : std::nullopt;
+    case TokenKind::Not:
+        return operand == BuiltInType::Bool ? optional(operand) : std::nullopt;
+    default:
+        return std::nullopt;
+    }
+}
+
+// Only `compl` (bitwise not) has a meaning as a postfix operator; the
+// grammar also accepts bitand, bitor and xor there.
+constexpr optional<BuiltInType> postfix_result_type(
+    TokenKind op, BuiltInType operand) {
+    if (op == TokenKind::KwCompl && operand == BuiltInType::Int) {
+        return operand;
+    }
+    return std::nullopt;
+}
+
+// Whether a value of type `actual` may be stored where `expected` is
+// required: never converts to every type.
+constexpr bool assignable(BuiltInType expected, BuiltInType actual) {
+    return actual == expected || actual == BuiltInType::Never;
+}
+
+// Whether `stmt`, last in a block without a final expression, gives the
+// block its value: an `if` there is parsed as a statement (no semicolon
+// follows it), but like in Rust it is the block's value.
+inline bool is_value_statement(Stmt const& stmt) {
+    auto const* expr_stmt = std::get_if<ExprStmt>(&stmt.node);
+    return expr_stmt != nullptr &&
+           std::holds_alternative<IfExpr>(expr_stmt->expr->node);
+}
+
+// ==========================================
+// Semantic analysis
+// ==========================================
+
+struct Diagnostic {
+    optional<offset_t> offset; // of the offending name or literal, if known
+    string message;
+};
+
+struct CheckResult {
+    vector<Diagnostic> diagnostics; // the first max_diagnostics errors
+    size_t error_count = 0;
+
+    bool ok() const { return error_count == 0; }
+};
+
+// Resolves every identifier against its lexical scope and type-checks the
+// program:
+// - a block is hoisted: its functions can be called before their
+//   declaration, its variables are visible after it;
+// - a name may be redeclared in a nested scope (shadowing), not in the
+//   scope that declared it;
+// - a function sees functions and the variables of the outermost scope,
+//   not the locals of the code around it;
+// - `print(...)` takes any arguments, `true` and `false` are bool
+//   constants;
+// - a block has the type of its final expression, or never if one of its
+//   statements cannot complete, or else unit; `if` without `else` is unit.
+//
+// An expression whose type cannot be determined (after an error) is
+// accepted everywhere, so one mistake is reported once. Operator chains
+// are walked with explicit stacks, so million-term expressions are fine.
+class SemanticAnalyzer {
+  public:
+    static constexpr size_t max_diagnostics = 100;
+
+    // `source` is the text the program was parsed from (for diagnostic
+    // offsets) and `interner` the one its lexer used.
+    explicit SemanticAnalyzer(
+        string_view source = {}, Interner& interner = global_interner())
+        : source(source), interner(interner),
+          print_symbol(interner.intern("print")),
+          true_symbol(interner.intern("true")),
+          false_symbol(interner.intern("false")) {}
+
+    CheckResult check(Program const& program) {
+        result = {};
+        table.enter(); // built-ins
+        table.declare(print_symbol, {.kind = Entity::Kind::Print});
+        Entity const constant{
+            .kind = Entity::Kind::Constant, .type = BuiltInType::Bool};
+        table.declare(true_symbol, constant);
+        table.declare(false_symbol, constant);
+        table.enter(); // globals
+        check_statements(program.statements);
+        table.leave();
+        table.leave();
+        return std::move(result);
+    }
+
+  private:
+    using SemaType = optional<BuiltInType>; // nullopt: already reported
+
+    struct Entity {
+        enum class Kind : uint8_t { Variable, Constant, Function, Print };
+        Kind kind = Kind::Variable;
+        SemaType type = std::nullopt; // of a variable; a function's result
+        uint32_t function_depth = 0; // of the declaration
+        FunctionDecl const* function = nullptr;
+    };
+
+    static constexpr uint32_t global_depth = 2;
+
+    string_view source;
+    Interner& interner;
+    Symbol print_symbol;
+    Symbol true_symbol;
+    Symbol false_symbol;
+
+    ScopedSymbolTable<Entity> table;
+    CheckResult result;
+
+    // the function whose body is being checked
+    FunctionDecl const* function = nullptr;
+    SemaType return_type = BuiltInType::Unit;
+    uint32_t function_depth = 0;
+    uint32_t loop_depth = 0;
+
+    // explicit stacks of the chain walks, shared by nested walks above
+    // their own base
+    vector<BinaryExpr const*> binary_stack;
+    vector<TokenKind> unary_stack;
+    struct Target {
+        SemaType type = std::nullopt;
+        string_view name;
+    };
+    vector<Target> target_stack;
+
+    // --- Diagnostics ---
+
+    void error(string_view anchor, string message) {
+        if (result.error_count++ < max_diagnostics) {
+            result.diagnostics.push_back(
+                {.offset = offset_of(anchor), .message = std::move(message)});
+        }
+    }
+
+    optional<offset_t> offset_of(string_view text) const {
+        auto const begin = reinterpret_cast<uintptr_t>(source.data());
+        auto const at = reinterpret_cast<uintptr_t>(text.data());
+        if (text.data() == nullptr || at < begin ||
+            at + text.size() > begin + source.size()) {
+            return std::nullopt;
+        }
+        return static_cast<offset_t>(at - begin);
+    }
+
+    // The leftmost name or literal of an expression, to point diagnostics
+    // at.
+    static string_view anchor_of(Expr const* expr) {
+        while (expr != nullptr) {
+            Expr const* next = nullptr;
+            string_view anchor;
+            std::visit(
+                [&]<typename Node>(Node const& node) {
+                    if constexpr (std::is_same_v<Node, Identifier>) {
+                        anchor = node.name;
+                    } else if constexpr (std::is_same_v<Node, LiteralExpr>) {
+                        anchor = node.value;
+                    } else if constexpr (std::is_same_v<Node, CallExpr>) {
+                        anchor = node.callee.name;
+                    } else if constexpr (
+                        std::is_same_v<Node, BinaryExpr> ||
+                        std::is_same_v<Node, AssignExpr>) {
+                        next = node.lhs;
+                    } else if constexpr (
+                        std::is_same_v<Node, PrefixExpr> ||
+                        std::is_same_v<Node, PostfixExpr>) {
+                        next = node.operand;
+                    } else if constexpr (std::is_same_v<Node, ReturnExpr>) {
+                        next = node.value.value_or(nullptr);
+                    } else if constexpr (
+                        std::is_same_v<Node, IfExpr> ||
+                        std::is_same_v<Node, WhileExpr>) {
+                        next = node.condition;
+                    } else if constexpr (std::is_same_v<Node, ForExpr>) {
+                        anchor = node.loop_var.name;
+                    } else if constexpr (
+                        std::is_same_v<Node, BreakExpr> ||
+                        std::is_same_v<Node, ContinueExpr>) {
+                        anchor = node.keyword;
+                    } else if constexpr (std::is_same_v<Node, BlockExpr>) {
+                        next = node.final_expr.value_or(nullptr);
+                    }
+                },
+                expr->node);
+            if (!anchor.empty()) {
+                return anchor;
+            }
+            expr = next;
+        }
+        return {};
+    }
+
+    static string describe(SemaType type) {
+        return string(to_string(*type));
+    }
+
+    // --- Names and types ---
+
+    Symbol symbol_of(Identifier const& name) {
+        return name.symbol != no_symbol ? name.symbol
+                                        : interner.intern(name.name);
+    }
+
+    SemaType resolve(Type const& type, bool report) {
+        if (!type.built_in_type && report) {
+            error(
+                type.name.name,
+                format("unknown type '{}'", string(type.name.name)));
+        }
+        return type.built_in_type;
+    }
+
+    void declare(Identifier const& name, Entity const& entity) {
+        if (table.declare(symbol_of(name), entity) != nullptr) {
+            error(
+                name.name,
+                format(
+                    "'{}' is already declared in this scope",
+                    string(name.name)));
+        }
+    }
+
+    // A variable or constant named by `name` that the current function may
+    // use; reports and returns nullptr otherwise.
+    Entity const* find_variable(Identifier const& name) {
+        auto const* binding = table.find(symbol_of(name));
+        if (binding == nullptr) {
+            error(
+                name.name,
+                format("undeclared identifier '{}'", string(name.name)));
+            return nullptr;
+        }
+        Entity const& entity = binding->value;
+        if (entity.kind == Entity::Kind::Function ||
+            entity.kind == Entity::Kind::Print) {
+            error(
+                name.name,
+                format(
+                    "function '{}' used as a value", string(name.name)));
+            return nullptr;
+        }
+        if (binding->depth > global_depth &&
+            entity.function_depth != function_depth) {
+            error(
+                name.name,
+                format(
+                    "'{}' is a local of the enclosing code and not visible "
+                    "in function '{}'",
+                    string(name.name),
+                    string(function->name.name)));
+            return nullptr;
+        }
+        return &entity;
+    }
+
+    // Reports `actual` where `expected` is required unless either is
+    // unknown or `actual` is never. `what()` names the place; it is only
+    // formatted for an error.
+    template <typename What>
+    void expect_type(
+        SemaType expected,
+        SemaType actual,
+        string_view anchor,
+        What const& what) {
+        if (expected && actual && !assignable(*expected, *actual)) {
+            error(
+                anchor,
+                format(
+                    "{}: expected {}, got {}",
+                    what(),
+                    describe(expected),
+                    describe(actual)));
+        }
+    }
+
+    // --- Statements ---
+
+    // Checks a block's statements in a scope the caller entered. Returns
+    // the type the block has without a final expression: never if one of
+    // the statements cannot complete, else that of a trailing `if` (see
+    // is_value_statement()), else unit.
+    template <typename Statements>
+    SemaType check_statements(Statements const& statements) {
+        // hoist the functions first, so calls may precede declarations
+        for (StmtPtr const stmt : statements) {
+            if (auto const* decl = std::get_if<FunctionDecl>(&stmt->node)) {
+                hoist(*decl);
+            }
+        }
+        bool diverges = false;
+        SemaType last = BuiltInType::Unit;
+        for (StmtPtr const stmt : statements) {
+            last = check_statement(*stmt);
+            diverges |= last == BuiltInType::Never;
+        }
+        if (diverges) {
+            return BuiltInType::Never;
+        }
+        if (statements.empty() || !is_value_statement(*statements.back())) {
+            return BuiltInType::Unit;
+        }
+        return last;
+    }
+
+    void hoist(FunctionDecl const& decl) {
+        for (Param const& param : decl.params) {
+            resolve(param.type, true);
+        }
+        declare(
+            decl.name,
+            {.kind = Entity::Kind::Function,
+             .type = resolve(decl.return_type, true),
+             .function = &decl});
+    }
+
+    SemaType check_statement(Stmt const& stmt) {
+        if (auto const* expr_stmt = std::get_if<ExprStmt>(&stmt.node)) {
+            return check(*expr_stmt->expr);
+        }
+        if (auto const* decl = std::get_if<VarDecl>(&stmt.node)) {
+            return check_variable(*decl);
+        }
+        check_function(std::get<FunctionDecl>(stmt.node));
+        return BuiltInType::Unit;
+    }
+
+    SemaType check_variable(VarDecl const& decl) {
+        SemaType const type = resolve(decl.type, true);
+        SemaType init = BuiltInType::Unit;
+        if (decl.init) {
+            // the initializer does not see the variable it initializes
+            init = check(**decl.init);
+            expect_type(
+                type,
+                init,
+                anchor_of(*decl.init),
+                [&] {
+                    return format(
+                        "initializer of '{}'", string(decl.name.name));
+                });
+        }
+        declare(
+            decl.name,
+            {.kind = Entity::Kind::Variable,
+             .type = type,
+             .function_depth = function_depth});
+        return init == BuiltInType::Never ? init : BuiltInType::Unit;
+    }
+
+    void check_function(FunctionDecl const& decl) {
+        FunctionDecl const* const outer_function = function;
+        SemaType const outer_return = return_type;
+        uint32_t const outer_loops = loop_depth;
+        function = &decl;
+        return_type = resolve(decl.return_type, false);
+        ++function_depth;
+        loop_depth = 0;
+
+        table.enter();
+        for (Param const& param : decl.params) {
+            if (table.declare(
+                    symbol_of(param.name),
+                    {.kind = Entity::Kind::Variable,
+                     .type = resolve(param.type, false),
+                     .function_depth = function_depth}) != nullptr) {
+                error(
+                    param.name.name,
+                    format(
+                        "duplicate parameter '{}'", string(param.name.name)));
+            }
+        }
+        SemaType const body = check_block(decl.body);
+        // a unit function discards the value of its body
+        if (return_type != BuiltInType::Unit) {
+            expect_type(
+                return_type,
+                body,
+                decl.body.final_expr ? anchor_of(*decl.body.final_expr)
+                                     : decl.name.name,
+                [&] {
+                    return format(
+                        "body of function '{}'", string(decl.name.name));
+                });
+        }
+        table.leave();
+
+        --function_depth;
+        function = outer_function;
+        return_type = outer_return;
+        loop_depth = outer_loops;
+    }
+
+    // --- Expressions ---
+
+    SemaType check(Expr const& expr) {
+        return std::visit(
+            [this](auto const& node) { return check_node(node); }, expr.node);
+    }
+
+    SemaType check_node(Identifier const& name) {
+        Entity const* const entity = find_variable(name);
+        return entity != nullptr ? entity->type : std::nullopt;
+    }
+
+    SemaType check_node(LiteralExpr const& literal) { return literal.type; }
+
+    SemaType check_node(CallExpr const& call) {
+        Identifier const& callee = call.callee;
+        auto const* binding = table.find(symbol_of(callee));
+        Entity const* const entity =
+            binding != nullptr ? &binding->value : nullptr;
+        if (entity == nullptr) {
+            error(
+                callee.name,
+                format("undeclared function '{}'", string(callee.name)));
+        } else if (
+            entity->kind != Entity::Kind::Function &&
+            entity->kind != Entity::Kind::Print) {
+            error(
+                callee.name,
+                format("'{}' is not a function", string(callee.name)));
+        }
+        FunctionDecl const* const decl =
+            entity != nullptr ? entity->function : nullptr;
+        if (decl == nullptr) {
+            for (ExprPtr const arg : call.args) {
+                check(*arg);
+            }
+            // print() returns unit
+            return entity != nullptr && entity->kind == Entity::Kind::Print
+                       ? SemaType(BuiltInType::Unit)
+                       : std::nullopt;
+        }
+
+        if (call.args.size() != decl->params.size()) {
+            error(
+                callee.name,
+                format(
+                    "function '{}' takes {} argument{}, got {}",
+                    string(callee.name),
+                    decl->params.size(),
+                    decl->params.size() == 1 ? "" : "s",
+                    call.args.size()));
+        }
+        for (size_t i = 0; i < call.args.size(); ++i) {
+            SemaType const arg = check(*call.args[i]);
+            if (i < decl->params.size()) {
+                Param const& param = decl->params[i];
+                expect_type(
+                    resolve(param.type, false),
+                    arg,
+                    anchor_of(call.args[i]),
+                    [&] {
+                        return format(
+                            "argument '{}' of '{}'",
+                            string(param.name.name),
+                            string(callee.name));
+                    });
+            }
+        }
+        return entity->type;
+    }
+
+    // Left-deep chains "a + b + c + ...": the spine is collected on a stack
+    // and folded from the innermost (leftmost) operation out.
+    SemaType check_node(BinaryExpr const& root) {
+        size_t const base = binary_stack.size();
+        for (BinaryExpr const* node = &root; node != nullptr;
+             node = std::get_if<BinaryExpr>(&node->lhs->node)) {
+            binary_stack.push_back(node);
+        }
+        SemaType type = check(*binary_stack.back()->lhs);
+        while (binary_stack.size() > base) {
+            BinaryExpr const& node = *binary_stack.back();
+            binary_stack.pop_back();
+            SemaType const rhs = check(*node.rhs);
+            type = binary_type(node, type, rhs);
+        }
+        return type;
+    }
+
+    SemaType binary_type(BinaryExpr const& node, SemaType lhs, SemaType rhs) {
+        if (!lhs || !rhs) {
+            return std::nullopt;
+        }
+        if (lhs == BuiltInType::Never || rhs == BuiltInType::Never) {
+            return BuiltInType::Never;
+        }
+        SemaType const type = binary_result_type(node.op, *lhs, *rhs);
+        if (!type) {
+            error(
+                anchor_of(node.lhs),
+                format(
+                    "operator '{}' cannot be applied to {} and {}",
+                    string(to_string(node.op)),
+                    describe(lhs),
+                    describe(rhs)));
+        }
+        return type;
+    }
+
+    SemaType check_node(PrefixExpr const& root) {
+        return check_unary_chain(root, prefix_result_type, "prefix");
+    }
+
+    SemaType check_node(PostfixExpr const& root) {
+        return check_unary_chain(root, postfix_result_type, "postfix");
+    }
+
+    // "- - - x" or "x compl compl": the operators are collected on a stack
+    // and applied innermost first.
+    template <typename Node, typename Rule>
+    SemaType check_unary_chain(Node const& root, Rule rule, string_view kind) {
+        size_t const base = unary_stack.size();
+        Node const* node = &root;
+        while (true) {
+            unary_stack.push_back(node->op);
+            Node const* inner = std::get_if<Node>(&node->operand->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        ExprPtr const operand = node->operand;
+        SemaType type = check(*operand);
+        while (unary_stack.size() > base) {
+            TokenKind const op = unary_stack.back();
+            unary_stack.pop_back();
+            if (!type || type == BuiltInType::Never) {
+                continue;
+            }
+            SemaType const applied = rule(op, *type);
+            if (!applied) {
+                error(
+                    anchor_of(operand),
+                    format(
+                        "{} operator '{}' cannot be applied to {}",
+                        kind,
+                        string(to_string(op)),
+                        describe(type)));
+            }
+            type = applied;
+        }
+        return type;
+    }
+
+    SemaType check_node(ReturnExpr const& ret) {
+        SemaType value = BuiltInType::Unit;
+        if (ret.value) {
+            value = check(**ret.value);
+        }
+        if (function == nullptr) {
+            error(
+                anchor_of(ret.value.value_or(nullptr)),
+                "'return' outside of a function");
+        } else {
+            expect_type(
+                return_type,
+                value,
+                ret.value ? anchor_of(*ret.value) : function->name.name,
+                [&] {
+                    return format(
+                        "return value of '{}'", string(function->name.name));
+                });
+        }
+        return BuiltInType::Never;
+    }
+
+    // Right-deep chains "a = b = c = ...": the targets are resolved
+    // left to right, then the value is checked and assigned back out.
+    SemaType check_node(AssignExpr const& root) {
+        size_t const base = target_stack.size();
+        AssignExpr const* node = &root;
+        while (true) {
+            target_stack.push_back(check_target(*node->lhs));
+            auto const* inner = std::get_if<AssignExpr>(&node->rhs->node);
+            if (inner == nullptr) {
+                break;
+            }
+            node = inner;
+        }
+        SemaType value = check(*node->rhs);
+        string_view anchor = anchor_of(node->rhs);
+        while (target_stack.size() > base) {
+            Target const target = target_stack.back();
+            target_stack.pop_back();
+            expect_type(
+                target.type,
+                value,
+                anchor,
+                [&] {
+                    return format("assignment to '{}'", string(target.name));
+                });
+            if (value != BuiltInType::Never) {
+                value = target.type; // "a = b" has the type of a
+            }
+            anchor = target.name;
+        }
+        return value;
+    }
+
+    Target check_target(Expr const& lhs) {
+        auto const* name = std::get_if<Identifier>(&lhs.node);
+        if (name == nullptr) {
+            check(lhs);
+            error(anchor_of(&lhs), "left side of '=' is not a variable");
+            return {};
+        }
+        Entity const* const entity = find_variable(*name);
+        if (entity == nullptr) {
+            return {.name = name->name};
+        }
+        if (entity->kind == Entity::Kind::Constant) {
+            error(
+                name->name,
+                format("cannot assign to constant '{}'", string(name->name)));
+            return {.name = name->name};
+        }
+        return {.type = entity->type, .name = name->name};
+    }
+
+    SemaType check_node(BlockExpr const& block) { return check_block(block); }
+
+    SemaType check_block(BlockExpr const& block) {
+        table.enter();
+        SemaType type = check_statements(block.statements);
+        if (block.final_expr) {
+            type = check(**block.final_expr);
+        }
+        table.leave();
+        return type;
+    }
+
+    void check_condition(Expr const& condition, string_view what) {
+        expect_type(
+            BuiltInType::Bool,
+            check(condition),
+            anchor_of(&condition),
+            [&] { return format("condition of '{}'", what); });
+    }
+
+    SemaType check_node(IfExpr const& node) {
+        check_condition(*node.condition, "if");
+        SemaType const then_type = check_block(node.then_block);
+        if (!node.else_expr) {
+            return BuiltInType::Unit;
+        }
+        SemaType const else_type = check(**node.else_expr);
+        if (!then_type || !else_type) {
+            return std::nullopt;
+        }
+        if (then_type == BuiltInType::Never) {
+            return else_type;
+        }
+        if (else_type == BuiltInType::Never || then_type == else_type) {
+            return then_type;
+        }
+        error(
+            anchor_of(node.condition),
+            format(
+                "'if' and 'else' have incompatible types {} and {}",
+                describe(then_type),
+                describe(else_type)));
+        return std::nullopt;
+    }
+
+    SemaType check_node(WhileExpr const& node) {
+        check_condition(*node.condition, "while");
+        ++loop_depth;
+        check_block(node.body);
+        --loop_depth;
+        return BuiltInType::Unit;
+    }
+
+    // `for v in n` runs the body for v = 0, 1, ..., n - 1.
+    SemaType check_node(ForExpr const& node) {
+        expect_type(
+            BuiltInType::Int,
+            check(*node.iter_expr),
+            anchor_of(node.iter_expr),
+            [] { return string("range of 'for'"); });
+        table.enter();
+        table.declare(
+            symbol_of(node.loop_var),
+            {.kind = Entity::Kind::Variable,
+             .type = BuiltInType::Int,
+             .function_depth = function_depth});
+        ++loop_depth;
+        check_block(node.body);
+        --loop_depth;
+        table.leave();
+        return BuiltInType::Unit;
+    }
+
+    SemaType check_node(BreakExpr const& node) {
+        return check_jump("break", node.keyword);
+    }
+
+    SemaType check_node(ContinueExpr const& node) {
+        return check_jump("continue", node.keyword);
+    }
+
+    SemaType check_jump(string_view keyword, string_view anchor) {
+        if (loop_depth == 0) {
+            error(anchor, format("'{}' outside of a loop", keyword));
+        }
+        return BuiltInType::Never;
+    }
+};
+
+// Checks `program`, parsed from `source` by a lexer using `interner`.
+inline CheckResult check_program(
+    Program const& program,
+    string_view source = {},
+    Interner& interner = global_interner()) {
+    return SemanticAnalyzer(source, interner).check(program);
+}
+
+// Thrown by the driver for a program with semantic errors. Diagnostics are
+// resolved to line and column while the source is still around.
+class SemanticError : public runtime_error {
+  public:
+    SemanticError(CheckResult const& result, string_view source)
+        : runtime_error(summary(result)) {
+        LineTable const lines(source);
+        for (Diagnostic const& diagnostic : result.diagnostics) {
+            string location;
+            if (diagnostic.offset) {
+                SourcePosition const at = lines.resolve(*diagnostic.offset);
+                location = format(":{}:{}", at.lineno, at.colno);
+            }
+            located.push_back({std::move(location), diagnostic.message});
+        }
+        if (result.error_count > result.diagnostics.size()) {
+            located.push_back(
+                {"",
+                 format(
+                     "{} more errors not shown",
+                     result.error_count - result.diagnostics.size())});
+        }
+    }
+
+    // "<file>:<line>:<col>: error: <message>" per diagnostic.
+    vector<string> messages(string_view file) const {
+        vector<string> lines;
+        for (auto const& [location, message] : located) {
+            lines.push_back(format(
+                "{}{}: error: {}", string(file), location, message));
+        }
+        return lines;
+    }
+
+  private:
+    struct Located {
+        string location; // ":line:col", or empty
+        string message;
+    };
+    vector<Located> located;
+
+    static string summary(CheckResult const& result) {
+        return format(
+            "{} semantic error{}",
+            result.error_count,
+            result.error_count == 1 ? "" : "s");
+    }
+};
+
+} // namespace mini_compiler
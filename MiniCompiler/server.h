@@ -0,0 +1,626 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// server.h
+
+#pragma once
+
+#include "driver.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace mini_compiler {
+
+using std::format;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace fs = std::filesystem;
+
+// ==========================================
+// Compile server
+// ==========================================
+//
+// `MiniCompiler serve` listens on a Unix domain socket and runs compile
+// requests with the usual command-line options, keeping its thread pool and
+// a ResultCache of unchanged inputs warm across requests.
+// `MiniCompiler client` sends one request (its working directory, its
+// arguments and optionally standard input as inline source) and prints the
+// reply, so it can stand in for a direct invocation.
+//
+// Messages are lists of netstrings ("<length>:<bytes>,") holding key/value
+// pairs and ending with an empty key:
+//   request: command (compile | shutdown), cwd, arg*, source, name
+//   reply:   status, out, err, output*
+//
+// The server's accept loop never blocks on a client: it polls the listening
+// socket and every connection whose request is still arriving, hands each
+// complete request to the pool, and drops a client that has not sent its
+// whole request within request_timeout.
+
+inline constexpr std::chrono::seconds request_timeout{10};
+
+inline constexpr string_view server_usage_text =
+    R"(Usage: MiniCompiler serve [--socket PATH] [-j N]
+       MiniCompiler client [--socket PATH] [--stdin NAME] [--print-outputs]
+                           [--shutdown] [compile options] [inputs...]
+
+serve   runs a compile server on a Unix domain socket until a client sends
+        --shutdown. The thread pool and a cache of unchanged inputs stay warm
+        between requests.
+client  compiles through a running server and prints what a direct run
+        would print. Relative paths are resolved in the client's working
+        directory.
+
+  --socket PATH    socket path (default: $XDG_RUNTIME_DIR/minicompiler.sock,
+                   else /tmp/minicompiler-<uid>.sock)
+  --stdin NAME     compile standard input as source NAME instead of inputs
+  --print-outputs  list the dump files written, one per line
+  --shutdown       stop the server
+)";
+
+using Message = vector<std::pair<string, string>>;
+
+namespace detail {
+
+inline constexpr size_t max_message_field = size_t{1} << 30;
+
+inline void append_netstring(string& out, string_view s) {
+    out += std::to_string(s.size());
+    out += ':';
+    out += s;
+    out += ',';
+}
+
+inline string encode_message(Message const& message) {
+    string out;
+    for (auto const& [key, value] : message) {
+        append_netstring(out, key);
+        append_netstring(out, value);
+    }
+    append_netstring(out, "");
+    return out;
+}
+
+// Removes the netstring at the front of `rest` and returns its contents, or
+// nullopt if `rest` ends before it does.
+inline std::optional<string_view> take_netstring(string_view& rest) {
+    size_t length = 0;
+    size_t colon = 0;
+    for (; colon < rest.size() && rest[colon] != ':'; ++colon) {
+        char const c = rest[colon];
+        if (c < '0' || c > '9' || length > max_message_field) {
+            throw runtime_error("Malformed message");
+        }
+        length = length * 10 + static_cast<size_t>(c - '0');
+    }
+    if (colon == rest.size() || rest.size() - colon - 1 <= length) {
+        return std::nullopt;
+    }
+    if (rest[colon + 1 + length] != ',') {
+        throw runtime_error("Malformed message");
+    }
+    string_view const contents = rest.substr(colon + 1, length);
+    rest.remove_prefix(colon + 2 + length);
+    return contents;
+}
+
+// The message at the front of `data`, or nullopt if it is not complete
+// yet. Cheap to retry as data arrives: field contents are only copied once
+// the whole message is there.
+inline std::optional<Message> decode_message(string_view data) {
+    vector<std::pair<string_view, string_view>> fields;
+    while (true) {
+        auto const key = take_netstring(data);
+        if (!key) {
+            return std::nullopt;
+        }
+        if (key->empty()) {
+            break;
+        }
+        auto const value = take_netstring(data);
+        if (!value) {
+            return std::nullopt;
+        }
+        fields.emplace_back(*key, *value);
+    }
+    Message message;
+    message.reserve(fields.size());
+    for (auto const [key, value] : fields) {
+        message.emplace_back(key, value);
+    }
+    return message;
+}
+
+inline std::optional<string_view>
+find_field(Message const& message, string_view key) {
+    for (auto const& [k, v] : message) {
+        if (k == key) {
+            return v;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace detail
+
+#if !defined(_WIN32)
+
+inline fs::path default_socket_path() {
+    if (char const* runtime = std::getenv("XDG_RUNTIME_DIR");
+        runtime != nullptr && *runtime != '\0') {
+        return fs::path(runtime) / "minicompiler.sock";
+    }
+    return format("/tmp/minicompiler-{}.sock", ::getuid());
+}
+
+namespace detail {
+
+// Owns a file descriptor.
+class Socket {
+  public:
+    explicit Socket(int fd = -1) : fd(fd) {}
+
+    Socket(Socket&& other) noexcept : fd(std::exchange(other.fd, -1)) {}
+
+    Socket& operator=(Socket&& other) noexcept {
+        if (this != &other) {
+            reset();
+            fd = std::exchange(other.fd, -1);
+        }
+        return *this;
+    }
+
+    Socket(Socket const&) = delete;
+    Socket& operator=(Socket const&) = delete;
+
+    ~Socket() { reset(); }
+
+    int get() const { return fd; }
+
+    void reset() {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+  private:
+    int fd;
+};
+
+[[noreturn]]
+inline void throw_errno(string_view what) {
+    throw runtime_error(format("{}: {}", what, std::strerror(errno)));
+}
+
+inline sockaddr_un socket_address(fs::path const& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    string const native = path.string();
+    if (native.size() >= sizeof(addr.sun_path)) {
+        throw runtime_error("Socket path too long: " + native);
+    }
+    std::memcpy(addr.sun_path, native.c_str(), native.size() + 1);
+    return addr;
+}
+
+inline void make_blocking(int fd) {
+    int const flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+        throw_errno("fcntl");
+    }
+}
+
+inline Socket connect_to(fs::path const& path) {
+    Socket sock(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (sock.get() < 0) {
+        throw_errno("socket");
+    }
+    sockaddr_un const addr = socket_address(path);
+    if (::connect(
+            sock.get(),
+            reinterpret_cast<sockaddr const*>(&addr),
+            sizeof(addr)) != 0) {
+        throw_errno("Cannot connect to " + path.string());
+    }
+    return sock;
+}
+
+inline void write_all(int fd, string_view data) {
+    while (!data.empty()) {
+        ssize_t const n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_errno("send");
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+}
+
+// Buffered reader of one message.
+class MessageReader {
+  public:
+    explicit MessageReader(int fd) : fd(fd) {}
+
+    Message read() {
+        Message message;
+        while (true) {
+            string key = read_netstring();
+            if (key.empty()) {
+                return message;
+            }
+            string value = read_netstring();
+            message.emplace_back(std::move(key), std::move(value));
+        }
+    }
+
+  private:
+    int fd;
+    string buffer;
+    size_t pos = 0;
+
+    char next() {
+        if (pos == buffer.size()) {
+            buffer.resize(64 << 10);
+            ssize_t n = 0;
+            do {
+                n = ::recv(fd, buffer.data(), buffer.size(), 0);
+            } while (n < 0 && errno == EINTR);
+            if (n < 0) {
+                throw_errno("recv");
+            }
+            if (n == 0) {
+                throw runtime_error("Connection closed mid-message");
+            }
+            buffer.resize(static_cast<size_t>(n));
+            pos = 0;
+        }
+        return buffer[pos++];
+    }
+
+    string read_netstring() {
+        size_t length = 0;
+        char c = next();
+        for (; c != ':'; c = next()) {
+            if (c < '0' || c > '9' || length > max_message_field) {
+                throw runtime_error("Malformed message");
+            }
+            length = length * 10 + static_cast<size_t>(c - '0');
+        }
+        string s;
+        s.reserve(length);
+        for (size_t i = 0; i < length; ++i) {
+            s += next();
+        }
+        if (next() != ',') {
+            throw runtime_error("Malformed message");
+        }
+        return s;
+    }
+};
+
+} // namespace detail
+
+class CompileServer {
+  public:
+    CompileServer(fs::path socket, size_t jobs, fs::path default_out_dir)
+        : socket_path(std::move(socket)), pool(jobs),
+          default_out_dir(std::move(default_out_dir)) {}
+
+    // Serves until a shutdown request arrives.
+    void run() {
+        detail::Socket const listener = listen();
+        std::println(std::cerr, "Listening on {}", socket_path.string());
+        vector<pollfd> ready;
+        bool stopping = false;
+        while (!stopping) {
+            ready.clear();
+            ready.push_back({.fd = listener.get(), .events = POLLIN});
+            for (Incoming const& incoming : receiving) {
+                ready.push_back({.fd = incoming.conn.get(), .events = POLLIN});
+            }
+            if (::poll(ready.data(), ready.size(), poll_timeout()) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                detail::throw_errno("poll");
+            }
+            // receiving[i] was polled as ready[i + 1]
+            auto const now = Clock::now();
+            size_t kept = 0;
+            for (size_t i = 0; i < receiving.size(); ++i) {
+                Incoming& incoming = receiving[i];
+                try {
+                    std::optional<Message> request;
+                    if (ready[i + 1].revents != 0) {
+                        request = receive(incoming);
+                    }
+                    if (request) {
+                        stopping |= dispatch(
+                            std::move(incoming.conn), std::move(*request));
+                        continue;
+                    }
+                    if (now >= incoming.deadline) {
+                        throw runtime_error("Timed out");
+                    }
+                } catch (std::exception const& e) {
+                    std::println(std::cerr, "Bad request: {}", e.what());
+                    continue;
+                }
+                if (kept != i) {
+                    receiving[kept] = std::move(incoming);
+                }
+                ++kept;
+            }
+            receiving.erase(receiving.begin() + kept, receiving.end());
+            if ((ready[0].revents & POLLIN) != 0) {
+                accept_from(listener);
+            }
+        }
+        pool.wait();
+        fs::remove(socket_path);
+    }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    // A connection whose request is still arriving.
+    struct Incoming {
+        detail::Socket conn; // non-blocking
+        string received;
+        Clock::time_point deadline;
+    };
+
+    fs::path socket_path;
+    ThreadPool pool;
+    ResultCache cache;
+    fs::path default_out_dir;
+    vector<Incoming> receiving;
+
+    void accept_from(detail::Socket const& listener) {
+        detail::Socket conn(::accept4(
+            listener.get(), nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK));
+        if (conn.get() < 0) {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN ||
+                errno == EWOULDBLOCK) {
+                return;
+            }
+            detail::throw_errno("accept");
+        }
+        receiving.push_back(
+            {.conn = std::move(conn),
+             .received = {},
+             .deadline = Clock::now() + request_timeout});
+    }
+
+    // Milliseconds until the first deadline, or -1 (none) for poll().
+    int poll_timeout() const {
+        if (receiving.empty()) {
+            return -1;
+        }
+        auto const first = std::ranges::min_element(
+            receiving, {}, &Incoming::deadline);
+        auto const left = std::chrono::ceil<std::chrono::milliseconds>(
+            first->deadline - Clock::now());
+        return static_cast<int>(std::max<int64_t>(left.count(), 0));
+    }
+
+    // Reads what has arrived; returns the request once it is complete.
+    static std::optional<Message> receive(Incoming& incoming) {
+        char chunk[64 << 10];
+        ssize_t const n = ::recv(incoming.conn.get(), chunk, sizeof(chunk), 0);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                return std::nullopt;
+            }
+            detail::throw_errno("recv");
+        }
+        if (n == 0) {
+            throw runtime_error("Connection closed mid-message");
+        }
+        incoming.received.append(chunk, static_cast<size_t>(n));
+        return detail::decode_message(incoming.received);
+    }
+
+    // Answers a shutdown request and returns true; any other request is
+    // run on the pool, where nested batch work joins it.
+    bool dispatch(detail::Socket conn, Message request) {
+        detail::make_blocking(conn.get());
+        if (detail::find_field(request, "command") == "shutdown") {
+            send_reply(conn.get(), {{"status", "0"}});
+            return true;
+        }
+        auto shared = std::make_shared<detail::Socket>(std::move(conn));
+        pool.submit([this, shared, request = std::move(request)] {
+            send_reply(shared->get(), handle(request));
+        });
+        return false;
+    }
+
+    detail::Socket listen() const {
+        if (fs::exists(socket_path)) {
+            try {
+                detail::connect_to(socket_path);
+            } catch (std::exception const&) {
+                fs::remove(socket_path); // left behind by a dead server
+            }
+            if (fs::exists(socket_path)) {
+                throw runtime_error(
+                    "A server is already listening on " +
+                    socket_path.string());
+            }
+        }
+        detail::Socket sock(
+            ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0));
+        if (sock.get() < 0) {
+            detail::throw_errno("socket");
+        }
+        sockaddr_un const addr = detail::socket_address(socket_path);
+        if (::bind(
+                sock.get(),
+                reinterpret_cast<sockaddr const*>(&addr),
+                sizeof(addr)) != 0) {
+            detail::throw_errno("bind " + socket_path.string());
+        }
+        if (::listen(sock.get(), SOMAXCONN) != 0) {
+            detail::throw_errno("listen");
+        }
+        return sock;
+    }
+
+    static void send_reply(int fd, Message const& reply) {
+        try {
+            detail::write_all(fd, detail::encode_message(reply));
+        } catch (std::exception const& e) {
+            std::println(std::cerr, "Reply failed: {}", e.what());
+        }
+    }
+
+    Message handle(Message const& request) {
+        std::ostringstream out;
+        std::ostringstream err;
+        vector<fs::path> written;
+        int status = 1;
+        try {
+            vector<string> args;
+            for (auto const& [key, value] : request) {
+                if (key == "arg") {
+                    args.push_back(value);
+                }
+            }
+            fs::path const cwd(
+                detail::find_field(request, "cwd").value_or(""));
+            DriverOptions const options =
+                parse_command_line(args, default_out_dir, cwd);
+            DriverContext context{
+                .pool = &pool, .cache = &cache, .written = &written};
+            if (auto const source = detail::find_field(request, "source")) {
+                context.source = *source;
+                context.source_name =
+                    detail::find_field(request, "name").value_or("stdin");
+            }
+            status = run_driver(options, out, err, context);
+        } catch (std::exception const& e) {
+            err << "Error: " << e.what() << "\n";
+        }
+        Message reply{
+            {"status", std::to_string(status)},
+            {"out", std::move(out).str()},
+            {"err", std::move(err).str()}};
+        for (auto const& path : written) {
+            reply.emplace_back("output", path.string());
+        }
+        return reply;
+    }
+};
+
+// `MiniCompiler serve ...`
+inline int run_server(vector<string> const& args, fs::path default_out_dir) {
+    fs::path socket = default_socket_path();
+    size_t jobs = ThreadPool::default_thread_count();
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--socket" && i + 1 < args.size()) {
+            socket = args[++i];
+        } else if (args[i] == "-j" && i + 1 < args.size()) {
+            jobs = std::max<size_t>(std::stoul(args[++i]), 1);
+        } else if (args[i] == "-h" || args[i] == "--help") {
+            std::cout << server_usage_text;
+            return 0;
+        } else {
+            throw runtime_error("Unknown serve option " + args[i]);
+        }
+    }
+    CompileServer(socket, jobs, std::move(default_out_dir)).run();
+    return 0;
+}
+
+// `MiniCompiler client ...`: forwards the remaining arguments.
+inline int run_client(
+    vector<string> const& args,
+    std::istream& in,
+    std::ostream& out,
+    std::ostream& err) {
+    fs::path socket = default_socket_path();
+    Message request{{"command", "compile"}};
+    bool print_outputs = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--socket" && i + 1 < args.size()) {
+            socket = args[++i];
+        } else if (args[i] == "--stdin" && i + 1 < args.size()) {
+            request.emplace_back("name", args[++i]);
+            request.emplace_back(
+                "source",
+                string(
+                    std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>()));
+        } else if (args[i] == "--print-outputs") {
+            print_outputs = true;
+        } else if (args[i] == "--shutdown") {
+            request.front().second = "shutdown";
+        } else {
+            request.emplace_back("arg", args[i]);
+        }
+    }
+    request.emplace_back("cwd", fs::current_path().string());
+
+    detail::Socket const sock = detail::connect_to(socket);
+    detail::write_all(sock.get(), detail::encode_message(request));
+    Message const reply = detail::MessageReader(sock.get()).read();
+    out << detail::find_field(reply, "out").value_or("");
+    err << detail::find_field(reply, "err").value_or("");
+    if (print_outputs) {
+        for (auto const& [key, value] : reply) {
+            if (key == "output") {
+                out << value << "\n";
+            }
+        }
+    }
+    return std::stoi(string(detail::find_field(reply, "status").value_or("1")));
+}
+
+#else
+
+inline int run_server(vector<string> const&, fs::path) {
+    throw runtime_error("The compile server needs Unix domain sockets");
+}
+
+inline int run_client(
+    vector<string> const&, std::istream&, std::ostream&, std::ostream&) {
+    throw runtime_error("The compile server needs Unix domain sockets");
+}
+
+#endif
+
+} // namespace mini_compiler
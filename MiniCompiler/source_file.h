@@ -0,0 +1,203 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// source_file.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mini_compiler {
+
+using std::runtime_error;
+using std::string;
+using std::string_view;
+
+enum class LoadMode : uint8_t {
+    Map, // read-only memory mapping, falling back to Read if mapping fails
+    Read // copy the file into an owned string
+};
+
+// Owns the program text. Tokens, Identifier::name and every other lexeme are
+// views into it, so a SourceFile must outlive the TokenBuffer and Program
+// built from it.
+class SourceFile {
+  public:
+    SourceFile() = default;
+
+    // In-memory source (e.g. the built-in sample program).
+    explicit SourceFile(string text) : owned(std::move(text)) {
+        view = owned;
+    }
+
+    static SourceFile open(
+        std::filesystem::path const& path, LoadMode mode = LoadMode::Map) {
+        SourceFile file;
+        if (mode == LoadMode::Map && file.map(path)) {
+            return file;
+        }
+        file.owned = read_file(path);
+        file.view = file.owned;
+        return file;
+    }
+
+    SourceFile(SourceFile const&) = delete;
+    SourceFile& operator=(SourceFile const&) = delete;
+
+    SourceFile(SourceFile&& other) noexcept { *this = std::move(other); }
+
+    SourceFile& operator=(SourceFile&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            owned = std::move(other.owned);
+            mapped = std::exchange(other.mapped, false);
+#if defined(_WIN32)
+            mapping = std::exchange(other.mapping, nullptr);
+#endif
+            // a moved std::string may relocate its (small) buffer
+            view = mapped ? other.view : string_view(owned);
+            other.view = {};
+        }
+        return *this;
+    }
+
+    ~SourceFile() { unmap(); }
+
+    string_view text() const { return view; }
+
+    bool is_mapped() const { return mapped; }
+
+  private:
+    string owned;
+    string_view view;
+    bool mapped = false;
+#if defined(_WIN32)
+    HANDLE mapping = nullptr;
+#endif
+
+    static string read_file(std::filesystem::path const& path) {
+        // 1. 打开流（使用 binary 模式可以避免在 Windows
+        // 上因换行符转换导致的偏移错误）
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file) {
+            throw runtime_error("Failed to open source file " + path.string());
+        }
+
+        // 2. 直接读取字节流；管道等没有文件大小，读到 EOF 为止
+        if (!std::filesystem::is_regular_file(path)) {
+            return {
+                std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>()};
+        }
+        auto size = std::filesystem::file_size(path);
+        string content(size, '\0');
+        file.read(content.data(), static_cast<std::streamsize>(size));
+        return content;
+    }
+
+#if defined(_WIN32)
+    bool map(std::filesystem::path const& path) {
+        HANDLE const file = CreateFileW(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        mapping =
+            CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            return false;
+        }
+        void const* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == nullptr) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+        view = string_view(
+            static_cast<char const*>(data),
+            static_cast<size_t>(size.QuadPart));
+        mapped = true;
+        return true;
+    }
+
+    void unmap() {
+        if (mapped) {
+            UnmapViewOfFile(view.data());
+            CloseHandle(mapping);
+            mapping = nullptr;
+            mapped = false;
+        }
+    }
+#else
+    bool map(std::filesystem::path const& path) {
+        int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st{};
+        // empty files cannot be mapped; non-regular files (pipes, devices)
+        // have no meaningful size
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+            st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        auto const size = static_cast<size_t>(st.st_size);
+        int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+        flags |= MAP_POPULATE; // pre-fault: the lexer reads every page anyway
+#endif
+        void* const data = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        ::madvise(data, size, MADV_SEQUENTIAL);
+        view = string_view(static_cast<char const*>(data), size);
+        mapped = true;
+        return true;
+    }
+
+    void unmap() {
+        if (mapped) {
+            ::munmap(const_cast<char*>(view.data()), view.size());
+            mapped = false;
+        }
+    }
+#endif
+};
+
+} // namespace mini_compiler
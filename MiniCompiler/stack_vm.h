@@ -0,0 +1,493 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// stack_vm.h
+
+#pragma once
+
+#include "bytecode.h"
+#include "interpreter.h"
+#include "output_writer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Threaded dispatch jumps from the end of each instruction's code straight
+// to the next one's through a label table ("labels as values", a GCC and
+// Clang extension); other compilers go through a switch in a loop.
+#ifndef MINI_COMPILER_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define MINI_COMPILER_COMPUTED_GOTO 1
+#else
+#define MINI_COMPILER_COMPUTED_GOTO 0
+#endif
+#endif
+
+namespace mini_compiler {
+
+using std::format;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Stack virtual machine
+// ==========================================
+
+// Runs a BytecodeModule compiled from a checked program; it computes what
+// the Interpreter computes and prints what it prints.
+//
+// All frames live on one value stack: a frame's slots (parameters first),
+// then its operand stack, whose greatest depth the compiler recorded, so
+// a call checks for room once. The bottom frame is the top-level code's,
+// and its slots are the globals. Calls do not recurse in C++: a call only
+// pushes a Frame record with the caller's state.
+class StackVM {
+  public:
+    // Deeper calls raise RuntimeError; the limit only keeps a runaway
+    // recursion from taking all memory.
+    static constexpr size_t max_call_depth = 100000;
+
+    explicit StackVM(std::ostream& out) : out(out) {}
+
+    // print() output is flushed before returning or throwing.
+    void run(BytecodeModule const& module) {
+        struct FlushOnExit {
+            OutputWriter& out;
+            ~FlushOnExit() { out.flush(); }
+        } const flush_on_exit{out};
+
+        stack.assign(
+            std::max(initial_stack, frame_room(module.functions.front())),
+            Value::uninitialized());
+        frames.clear();
+        execute(module);
+    }
+
+  private:
+    static constexpr size_t initial_stack = size_t{1} << 12;
+
+    struct Frame {
+        BytecodeFunction const* function;
+        Instruction const* return_pc;
+        size_t base; // of the caller, an index: the stack may move
+    };
+
+    OutputWriter out;
+    vector<Value> stack;
+    vector<Frame> frames;
+
+    // The top of the operand stack is kept in a local variable: the stored
+    // part of a frame's operand stack starts with one value more, a
+    // placeholder for what that variable held before the first push.
+    static size_t frame_room(BytecodeFunction const& function) {
+        return size_t{function.frame_size} + function.max_stack + 1;
+    }
+
+    // the binary operators; the program was checked, so only the types an
+    // operator accepts occur
+
+    static void copy(Value& to, Value const& from) {
+        to.type = from.type;
+        to.int_value = from.int_value;
+    }
+
+    static void add(Value& lhs, Value const& rhs) {
+        if (lhs.type == BuiltInType::Int) {
+            lhs = Value::of_int(wrapping_add(lhs.int_value, rhs.int_value));
+        } else {
+            lhs.float_value += rhs.float_value;
+        }
+    }
+
+    static void subtract(Value& lhs, Value const& rhs) {
+        if (lhs.type == BuiltInType::Int) {
+            lhs.int_value = wrapping_sub(lhs.int_value, rhs.int_value);
+        } else {
+            lhs.float_value -= rhs.float_value;
+        }
+    }
+
+    static void multiply(Value& lhs, Value const& rhs) {
+        if (lhs.type == BuiltInType::Int) {
+            lhs = Value::of_int(wrapping_mul(lhs.int_value, rhs.int_value));
+        } else {
+            lhs.float_value *= rhs.float_value;
+        }
+    }
+
+    static void divide(Value& lhs, Value const& rhs) { // not by an int zero
+        if (lhs.type == BuiltInType::Int) {
+            lhs.int_value = int_divide(lhs.int_value, rhs.int_value);
+        } else {
+            lhs.float_value /= rhs.float_value; // IEEE: inf or nan
+        }
+    }
+
+    static void modulo(Value& lhs, Value const& rhs) { // not by zero
+        lhs = Value::of_int(int_modulo(lhs.int_value, rhs.int_value));
+    }
+
+    template <typename Compare>
+    static bool compare(
+        Value const& lhs, Value const& rhs, Compare relation) {
+        switch (lhs.type) {
+        case BuiltInType::Int:
+            return relation(lhs.int_value, rhs.int_value);
+        case BuiltInType::Float:
+            return relation(lhs.float_value, rhs.float_value);
+        default:
+            return relation(lhs.char_value, rhs.char_value);
+        }
+    }
+
+    static bool less(Value const& lhs, Value const& rhs) {
+        return compare(lhs, rhs, [](auto a, auto b) { return a < b; });
+    }
+
+    static bool less_eq(Value const& lhs, Value const& rhs) {
+        return compare(lhs, rhs, [](auto a, auto b) { return a <= b; });
+    }
+
+    static bool greater(Value const& lhs, Value const& rhs) {
+        return compare(lhs, rhs, [](auto a, auto b) { return a > b; });
+    }
+
+    static bool greater_eq(Value const& lhs, Value const& rhs) {
+        return compare(lhs, rhs, [](auto a, auto b) { return a >= b; });
+    }
+
+    static bool not_equal(Value const& lhs, Value const& rhs) {
+        return !values_equal(lhs, rhs);
+    }
+
+    void execute(BytecodeModule const& module) {
+        Value const* const constants = module.constants.data();
+        BytecodeFunction const* function = &module.functions.front();
+        Instruction const* pc = function->code.data();
+        Value* base = stack.data();
+        Value* sp = base + function->frame_size;
+        Value tos; // the top of the operand stack
+        Instruction instruction = 0;
+
+        auto error = [&](string_view message) {
+            if (frames.empty()) {
+                return RuntimeError(string(message));
+            }
+            return RuntimeError(
+                format("{} (in function '{}')", message, function->name));
+        };
+
+#if MINI_COMPILER_COMPUTED_GOTO
+#define AS_LABEL(name, mnemonic, operand) &&op_##name,
+        static void* const labels[] = {BYTECODE_OPS(AS_LABEL)};
+#undef AS_LABEL
+#define VM_CASE(name) op_##name:
+#define VM_NEXT()                                                              \
+    instruction = *pc++;                                                       \
+    goto* labels[instruction & 0xFF]
+
+        VM_NEXT();
+#else
+#define VM_CASE(name) case Op::name:
+#define VM_NEXT() continue
+
+        for (;;) {
+            instruction = *pc++;
+            switch (op_of(instruction)) {
+#endif
+
+        VM_CASE(Const) {
+            copy(*sp++, tos);
+            copy(tos, constants[operand_of(instruction)]);
+            VM_NEXT();
+        }
+        VM_CASE(Unit) {
+            copy(*sp++, tos);
+            tos = Value{};
+            VM_NEXT();
+        }
+        VM_CASE(Pop) {
+            copy(tos, *--sp);
+            VM_NEXT();
+        }
+        VM_CASE(PopN) {
+            sp -= operand_of(instruction);
+            copy(tos, *sp);
+            VM_NEXT();
+        }
+        VM_CASE(Dup) {
+            copy(*sp++, tos);
+            VM_NEXT();
+        }
+        VM_CASE(LoadLocal) {
+            copy(*sp++, tos);
+            copy(tos, base[operand_of(instruction)]);
+            VM_NEXT();
+        }
+        VM_CASE(StoreLocal) {
+            copy(base[operand_of(instruction)], tos);
+            copy(tos, *--sp);
+            VM_NEXT();
+        }
+        VM_CASE(LoadGlobal) {
+            uint32_t const slot = operand_of(instruction);
+            Value const& value = stack[slot];
+            if (value.type == BuiltInType::Never) {
+                throw error(format(
+                    "'{}' is used before it is initialized",
+                    module.functions.front().slot_names[slot]));
+            }
+            copy(*sp++, tos);
+            copy(tos, value);
+            VM_NEXT();
+        }
+        VM_CASE(StoreGlobal) {
+            copy(stack[operand_of(instruction)], tos);
+            copy(tos, *--sp);
+            VM_NEXT();
+        }
+
+        // The operands have the same type (the program was checked): the
+        // left one's tag decides. Each operator also has a _CONST and a
+        // _LOCAL form, whose left operand is the top of the stack.
+#define VM_BINARY(name, apply)                                                 \
+    VM_CASE(name) {                                                            \
+        Value lhs;                                                             \
+        copy(lhs, *--sp);                                                      \
+        apply(lhs, tos);                                                       \
+        copy(tos, lhs);                                                        \
+        VM_NEXT();                                                             \
+    }                                                                          \
+    VM_CASE(name##Const) {                                                     \
+        apply(tos, constants[operand_of(instruction)]);                        \
+        VM_NEXT();                                                             \
+    }                                                                          \
+    VM_CASE(name##Local) {                                                     \
+        apply(tos, base[operand_of(instruction)]);                             \
+        VM_NEXT();                                                             \
+    }
+#define VM_DIVISION(name, apply)                                               \
+    VM_BINARY(name, [&](Value& lhs, Value const& rhs) {                        \
+        if (rhs.type == BuiltInType::Int && rhs.int_value == 0) {              \
+            throw error("division by zero");                                   \
+        }                                                                      \
+        apply(lhs, rhs);                                                       \
+    })
+
+        VM_BINARY(Add, add)
+        VM_BINARY(Sub, subtract)
+        VM_BINARY(Mul, multiply)
+        VM_DIVISION(Div, divide)
+        VM_DIVISION(Mod, modulo)
+
+        // A comparison followed by JUMP_IF_TRUE or JUMP_IF_FALSE (a loop or
+        // if condition) also does the jump: one dispatch less.
+#define VM_COMPARE(name, test)                                                 \
+    VM_CASE(name) {                                                            \
+        bool const result = test(*--sp, tos);                                  \
+        VM_BRANCH_ON(result);                                                  \
+    }                                                                          \
+    VM_CASE(name##Const) {                                                     \
+        bool const result = test(tos, constants[operand_of(instruction)]);     \
+        VM_BRANCH_ON(result);                                                  \
+    }                                                                          \
+    VM_CASE(name##Local) {                                                     \
+        bool const result = test(tos, base[operand_of(instruction)]);          \
+        VM_BRANCH_ON(result);                                                  \
+    }
+#define VM_BRANCH_ON(result)                                                   \
+    instruction = *pc;                                                         \
+    if (op_of(instruction) == Op::JumpIfTrue ||                                \
+        op_of(instruction) == Op::JumpIfFalse) {                               \
+        copy(tos, *--sp);                                                      \
+        ++pc;                                                                  \
+        if ((op_of(instruction) == Op::JumpIfTrue) == (result)) {              \
+            pc += jump_offset_of(instruction);                                 \
+        }                                                                      \
+        VM_NEXT();                                                             \
+    }                                                                          \
+    tos = Value::of_bool(result);                                              \
+    VM_NEXT()
+
+        VM_COMPARE(Less, less)
+        VM_COMPARE(LessEq, less_eq)
+        VM_COMPARE(Greater, greater)
+        VM_COMPARE(GreaterEq, greater_eq)
+        VM_COMPARE(Equal, values_equal)
+        VM_COMPARE(NotEqual, not_equal)
+#undef VM_BRANCH_ON
+#undef VM_COMPARE
+#undef VM_DIVISION
+#undef VM_BINARY
+
+        VM_CASE(Shl) {
+            tos.int_value = shift_left((--sp)->int_value, tos.int_value);
+            VM_NEXT();
+        }
+        VM_CASE(Shr) {
+            tos.int_value = shift_right((--sp)->int_value, tos.int_value);
+            VM_NEXT();
+        }
+        VM_CASE(BitAnd) {
+            tos.int_value &= (--sp)->int_value;
+            VM_NEXT();
+        }
+        VM_CASE(BitOr) {
+            tos.int_value |= (--sp)->int_value;
+            VM_NEXT();
+        }
+        VM_CASE(BitXor) {
+            tos.int_value ^= (--sp)->int_value;
+            VM_NEXT();
+        }
+        VM_CASE(Negate) {
+            if (tos.type == BuiltInType::Int) {
+                tos.int_value = wrapping_negate(tos.int_value);
+            } else {
+                tos.float_value = -tos.float_value;
+            }
+            VM_NEXT();
+        }
+        VM_CASE(Not) {
+            tos.bool_value = !tos.bool_value;
+            VM_NEXT();
+        }
+        VM_CASE(Complement) {
+            tos.int_value = ~tos.int_value;
+            VM_NEXT();
+        }
+
+        VM_CASE(Jump) {
+            pc += jump_offset_of(instruction);
+            VM_NEXT();
+        }
+        VM_CASE(JumpIfFalse) {
+            bool const condition = tos.bool_value;
+            copy(tos, *--sp);
+            if (!condition) {
+                pc += jump_offset_of(instruction);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(JumpIfTrue) {
+            bool const condition = tos.bool_value;
+            copy(tos, *--sp);
+            if (condition) {
+                pc += jump_offset_of(instruction);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(JumpIfFalseOrPop) {
+            if (!tos.bool_value) {
+                pc += jump_offset_of(instruction);
+            } else {
+                copy(tos, *--sp);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(JumpIfTrueOrPop) {
+            if (tos.bool_value) {
+                pc += jump_offset_of(instruction);
+            } else {
+                copy(tos, *--sp);
+            }
+            VM_NEXT();
+        }
+
+        // the JUMP that follows is taken here, without a dispatch
+        VM_CASE(ForPrep) {
+            Value* const slots = base + operand_of(instruction);
+            copy(slots[0], tos);
+            copy(tos, *--sp);
+            slots[1] = Value::of_int(0);
+            if (slots[0].int_value > 0) {
+                slots[2] = Value::of_int(0);
+                ++pc;
+            } else {
+                pc += 1 + jump_offset_of(*pc);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(ForLoop) {
+            Value* const slots = base + operand_of(instruction);
+            int64_t const next = slots[1].int_value + 1;
+            if (next < slots[0].int_value) {
+                slots[1].int_value = next;
+                slots[2] = Value::of_int(next);
+                pc += 1 + jump_offset_of(*pc);
+            } else {
+                ++pc;
+            }
+            VM_NEXT();
+        }
+
+        // The arguments are the topmost values, the last one in `tos`; once
+        // it is stored they are the callee's first slots.
+        VM_CASE(Call) {
+            BytecodeFunction const& callee =
+                module.functions[operand_of(instruction)];
+            if (frames.size() == max_call_depth) {
+                throw error(format(
+                    "stack overflow: more than {} nested calls",
+                    max_call_depth));
+            }
+            copy(*sp++, tos);
+            auto const callee_base =
+                static_cast<size_t>(sp - stack.data()) - callee.params;
+            size_t const needed = callee_base + frame_room(callee);
+            if (needed > stack.size()) {
+                size_t const caller_base =
+                    static_cast<size_t>(base - stack.data());
+                stack.resize(std::max(needed, stack.size() * 2));
+                base = stack.data() + caller_base;
+            }
+            frames.push_back(
+                {function, pc, static_cast<size_t>(base - stack.data())});
+            function = &callee;
+            base = stack.data() + callee_base;
+            // locals start out as unit, like in the Interpreter
+            std::fill(base + callee.params, base + callee.frame_size, Value{});
+            sp = base + callee.frame_size;
+            pc = callee.code.data();
+            VM_NEXT();
+        }
+        VM_CASE(Return) { // the result is in `tos`
+            Frame const& caller = frames.back();
+            sp = base;
+            function = caller.function;
+            pc = caller.return_pc;
+            base = stack.data() + caller.base;
+            frames.pop_back();
+            VM_NEXT();
+        }
+        VM_CASE(Print) {
+            uint32_t const count = operand_of(instruction);
+            copy(*sp++, tos);
+            sp -= count;
+            for (uint32_t i = 0; i < count; ++i) {
+                write_value(out, sp[i]);
+            }
+            out.put('\n');
+            copy(tos, *--sp);
+            VM_NEXT();
+        }
+        VM_CASE(Halt) { return; }
+        VM_CASE(Trap) {
+            throw error(*constants[operand_of(instruction)].string_value);
+        }
+
+#if !MINI_COMPILER_COMPUTED_GOTO
+            }
+        }
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+    }
+};
+
+} // namespace mini_compiler
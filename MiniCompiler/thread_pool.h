@@ -0,0 +1,237 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// thread_pool.h
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mini_compiler {
+
+using std::vector;
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own work
+// from the back (LIFO, cache-warm) and steals from the front of the others
+// when it runs dry. Threads that wait on the pool (wait(), parallel_for())
+// run queued tasks instead of blocking, so nested parallel_for calls from
+// inside a task cannot deadlock.
+class ThreadPool {
+  public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(size_t thread_count = default_thread_count())
+        : queues(std::max<size_t>(thread_count, 1)) {
+        for (auto& q : queues) {
+            q = std::make_unique<Queue>();
+        }
+        threads.reserve(queues.size());
+        for (size_t i = 0; i < queues.size(); ++i) {
+            threads.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::scoped_lock const lock(state_mutex);
+            stopping = true;
+        }
+        signal.notify_all();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    static size_t default_thread_count() {
+        return std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    }
+
+    size_t size() const { return threads.size(); }
+
+    void submit(Task task) {
+        size_t const target = current_worker_of(this).value_or(
+            next_queue.fetch_add(1, std::memory_order_relaxed) %
+            queues.size());
+        pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::scoped_lock const lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::scoped_lock const lock(state_mutex);
+            queued.fetch_add(1, std::memory_order_release);
+        }
+        signal.notify_all();
+    }
+
+    // Runs queued tasks until every submitted task has finished, then
+    // rethrows the first exception a submit()ted task escaped with.
+    void wait() {
+        help_until([this] {
+            return pending.load(std::memory_order_acquire) == 0;
+        });
+        std::exception_ptr error;
+        {
+            std::scoped_lock const lock(state_mutex);
+            error = std::exchange(first_error, nullptr);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Calls body(i) for i in [0, n) on the pool and returns when all calls
+    // are done; the caller participates. Rethrows the first exception.
+    template <typename Body> void parallel_for(size_t n, Body&& body) {
+        if (n == 0) {
+            return;
+        }
+        std::atomic<size_t> remaining{n};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        for (size_t i = 0; i < n; ++i) {
+            submit([&, i] {
+                try {
+                    body(i);
+                } catch (...) {
+                    std::scoped_lock const lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::scoped_lock const lock(state_mutex);
+                    signal.notify_all();
+                }
+            });
+        }
+        help_until([&] {
+            return remaining.load(std::memory_order_acquire) == 0;
+        });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    vector<std::unique_ptr<Queue>> queues;
+    vector<std::thread> threads;
+
+    std::mutex state_mutex; // guards stopping/first_error, orders `signal`
+    std::condition_variable signal;
+    bool stopping = false;
+    std::exception_ptr first_error;
+
+    std::atomic<size_t> queued{0};  // tasks sitting in a deque
+    std::atomic<size_t> pending{0}; // submitted and not yet finished
+    std::atomic<size_t> next_queue{0};
+
+    struct WorkerId {
+        ThreadPool const* pool = nullptr;
+        size_t index = 0;
+    };
+
+    static WorkerId& current_worker() {
+        thread_local WorkerId id;
+        return id;
+    }
+
+    static std::optional<size_t> current_worker_of(ThreadPool const* pool) {
+        WorkerId const& id = current_worker();
+        if (id.pool == pool) {
+            return id.index;
+        }
+        return std::nullopt;
+    }
+
+    bool try_pop(size_t self, Task& task) {
+        size_t const n = queues.size();
+        for (size_t k = 0; k < n; ++k) {
+            size_t const victim = (self + k) % n;
+            Queue& q = *queues[victim];
+            std::scoped_lock const lock(q.mutex);
+            if (q.tasks.empty()) {
+                continue;
+            }
+            if (k == 0) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            queued.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+        return false;
+    }
+
+    bool try_run_one(size_t self) {
+        Task task;
+        if (!try_pop(self, task)) {
+            return false;
+        }
+        try {
+            task();
+        } catch (...) {
+            std::scoped_lock const lock(state_mutex);
+            if (!first_error) {
+                first_error = std::current_exception();
+            }
+        }
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::scoped_lock const lock(state_mutex);
+            signal.notify_all();
+        }
+        return true;
+    }
+
+    template <typename Done> void help_until(Done const& done) {
+        size_t const self = current_worker_of(this).value_or(0);
+        while (!done()) {
+            if (try_run_one(self)) {
+                continue;
+            }
+            std::unique_lock lock(state_mutex);
+            signal.wait(lock, [&] {
+                return done() || queued.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+    void worker_loop(size_t index) {
+        current_worker() = {.pool = this, .index = index};
+        while (true) {
+            if (try_run_one(index)) {
+                continue;
+            }
+            std::unique_lock lock(state_mutex);
+            signal.wait(lock, [this] {
+                return stopping || queued.load(std::memory_order_acquire) > 0;
+            });
+            if (stopping && queued.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+};
+
+} // namespace mini_compiler
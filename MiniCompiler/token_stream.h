@@ -0,0 +1,124 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// token_stream.h
+
+#pragma once
+
+#include "lexer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+namespace mini_compiler {
+
+using std::runtime_error;
+using std::string_view;
+
+// ==========================================
+// Token sources for the parser
+// ==========================================
+//
+// A token source exposes the window the parser looks at:
+//   kind(k) / peek(k)  the k-th token from the current one (k <= lookahead)
+//   advance()          moves one token forward
+//   source()           the program text, for diagnostics
+//   finish()           throws the lex errors of the whole source, if any;
+//                      called before a parse error is reported, as batch
+//                      mode reports lex errors before it parses
+// Past the last token both keep returning End.
+
+// Batch source: walks a fully materialized TokenBuffer, or the sub-range
+// [begin, end) of one, in which case the token at `end` reads as End.
+class TokenCursor {
+  public:
+    // `tokens` must outlive the cursor and end with an End token.
+    explicit TokenCursor(TokenBuffer const& tokens)
+        : TokenCursor(tokens, 0, tokens.empty() ? 0 : tokens.size() - 1) {}
+
+    TokenCursor(TokenBuffer const& tokens, size_t begin, size_t end)
+        : tokens(&tokens), kinds(tokens.kind_data()), last(end), pos(begin) {
+        if (tokens.empty() || tokens.back().kind != TokenKind::End) {
+            throw runtime_error("Token buffer must end with an End token");
+        }
+        if (begin > end || end >= tokens.size()) {
+            throw runtime_error("Token range out of bounds");
+        }
+    }
+
+    explicit TokenCursor(TokenBuffer&&) = delete;
+    TokenCursor(TokenBuffer&&, size_t, size_t) = delete;
+
+    TokenKind kind(size_t k = 0) const {
+        size_t const i = index_of(k);
+        return i == last ? TokenKind::End : kinds[i];
+    }
+
+    Token peek(size_t k = 0) const {
+        size_t const i = index_of(k);
+        Token token = (*tokens)[i];
+        if (i == last) {
+            // keeps the offset, so errors at the range end point at it
+            token.kind = TokenKind::End;
+        }
+        return token;
+    }
+
+    void advance() { ++pos; }
+
+    string_view source() const { return tokens->source(); }
+
+    // the buffer was lexed, and lex errors thrown, before parsing
+    void finish() const {}
+
+  private:
+    TokenBuffer const* tokens;
+    TokenKind const* kinds; // tokens->kind_data()
+    size_t last;            // index of the token read as End
+    size_t pos = 0;
+
+    size_t index_of(size_t k) const { return std::min(pos + k, last); }
+};
+
+// Streaming source: pulls tokens from a Lexer on demand and keeps only a ring
+// of `Lookahead + 1` tokens, so parsing needs no TokenBuffer at all.
+template <size_t Lookahead> class TokenStream {
+  public:
+    explicit TokenStream(
+        string_view source, Interner& interner = global_interner())
+        : lexer(source, interner) {
+        for (auto& slot : ring) {
+            slot = lexer.next();
+        }
+    }
+
+    TokenKind kind(size_t k = 0) const { return peek(k).kind; }
+
+    Token peek(size_t k = 0) const {
+        if (k > Lookahead) {
+            throw runtime_error("Lookahead exceeds token stream window");
+        }
+        return ring[(head + k) & mask];
+    }
+
+    void advance() {
+        ring[head] = lexer.next();
+        head = (head + 1) & mask;
+    }
+
+    string_view source() const { return lexer.get_source(); }
+
+    void finish() { lexer.finish(); }
+
+  private:
+    static constexpr size_t capacity = std::bit_ceil(Lookahead + 1);
+    static constexpr size_t mask = capacity - 1;
+
+    Lexer lexer;
+    std::array<Token, capacity> ring;
+    size_t head = 0; // slot of the current token
+};
+
+} // namespace mini_compiler
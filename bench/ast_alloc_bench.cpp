@@ -0,0 +1,86 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// ast_alloc_bench.cpp: 统计解析期间的堆分配次数与耗时。
+//
+// Parses the sample program repeated N times (argument, default 2000) and
+// reports heap allocations and time for Parser::parse and for destroying the
+// Program. Global operator new/delete are replaced to count calls.
+
+#include "lexer.h"
+#include "parser.h"
+#include "sample_program.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <print>
+#include <string>
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> deallocations{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    if (p != nullptr) {
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+int main(int argc, char* argv[]) {
+    using namespace mini_compiler;
+    using Clock = std::chrono::steady_clock;
+
+    size_t const copies = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    std::string source;
+    for (size_t i = 0; i < copies; ++i) {
+        source += sample_program;
+    }
+    Lexer lexer(source);
+    auto const tokens = lexer.tokenize();
+
+    std::optional<Program> program;
+    Parser parser(tokens);
+    uint64_t const before_parse = allocations.load();
+    auto const t0 = Clock::now();
+    program.emplace(parser.parse());
+    auto const t1 = Clock::now();
+    uint64_t const parse_allocs = allocations.load() - before_parse;
+    size_t const statements = program->statements.size();
+
+    uint64_t const before_free = deallocations.load();
+    auto const t2 = Clock::now();
+    program.reset();
+    auto const t3 = Clock::now();
+    uint64_t const frees = deallocations.load() - before_free;
+
+    auto ms = [](auto d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    std::println(
+        "input {:.2f} MB, {} tokens, {} statements",
+        static_cast<double>(source.size()) / 1e6,
+        tokens.size(),
+        statements);
+    std::println(
+        "parse:    {:>10} allocations  {:>8.1f} ms", parse_allocs, ms(t1 - t0));
+    std::println(
+        "teardown: {:>10} frees        {:>8.1f} ms", frees, ms(t3 - t2));
+    return 0;
+}
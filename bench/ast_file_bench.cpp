@@ -0,0 +1,95 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// ast_file_bench.cpp: 二进制 AST 文件的加载耗时与重新解析对比。
+//
+// Builds a program from N copies of the sample program (argument, default
+// 20000), writes it as an .ast file and compares lexing + parsing the source
+// with mapping + verifying the file, and with materializing a Program from
+// it. The parse trees printed from all three must be identical.
+
+#include "ast_file.h"
+#include "flat_ast.h"
+#include "hash.h"
+#include "lexer.h"
+#include "parser.h"
+#include "sample_program.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <print>
+#include <sstream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    using namespace mini_compiler;
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](auto d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+
+    size_t const copies =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::string source;
+    source.reserve(sample_program.size() * copies);
+    for (size_t i = 0; i < copies; ++i) {
+        source += sample_program;
+    }
+    auto const path =
+        std::filesystem::temp_directory_path() / "ast_file_bench.ast";
+
+    try {
+        auto const t0 = Clock::now();
+        auto const tokens = Lexer(source).tokenize();
+        Program const parsed = Parser(tokens).parse();
+        auto const t1 = Clock::now();
+
+        FlatAst const flat = flatten(parsed, source);
+        save_ast_file(flat.view(), xxh64(source), path);
+
+        auto const t2 = Clock::now();
+        AstFile const file = AstFile::open(path);
+        auto const t3 = Clock::now();
+        Program const materialized = materialize(file.view());
+        auto const t4 = Clock::now();
+        Program const last_item = materialize(
+            file.view(),
+            file.view().roots().size() - 1,
+            file.view().roots().size());
+        auto const t5 = Clock::now();
+
+        std::ostringstream expected;
+        std::ostringstream from_view;
+        std::ostringstream from_tree;
+        parser_debug_print(parsed, expected);
+        flat_ast_debug_print(file.view(), from_view);
+        parser_debug_print(materialized, from_tree);
+        if (expected.str() != from_view.str() ||
+            expected.str() != from_tree.str() || !file.matches(source) ||
+            last_item.statements.size() != 1) {
+            std::println(stderr, "Error: round trip differs");
+            return 1;
+        }
+
+        std::println(
+            "source: {:.2f} MB, {} statements; .ast file: {:.2f} MB, "
+            "{} nodes",
+            static_cast<double>(source.size()) / 1e6,
+            parsed.statements.size(),
+            static_cast<double>(std::filesystem::file_size(path)) / 1e6,
+            flat.nodes.size());
+        std::println("tokenize + parse:        {:>8.2f} ms", ms(t1 - t0));
+        std::println(
+            "map + verify .ast:       {:>8.2f} ms ({:.0f}x faster)",
+            ms(t3 - t2),
+            ms(t1 - t0) / ms(t3 - t2));
+        std::println("materialize Program:     {:>8.2f} ms", ms(t4 - t3));
+        std::println("materialize last item:   {:>8.3f} ms", ms(t5 - t4));
+    } catch (std::exception const& e) {
+        std::println(stderr, "Error: {}", e.what());
+        return 1;
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
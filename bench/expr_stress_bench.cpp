@@ -0,0 +1,145 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// expr_stress_bench.cpp: 超长表达式的解析压力测试。
+//
+// Parses machine-generated expressions of N terms (argument, default
+// 1000000): a long mixed-precedence binary chain, a left-deep chain of one
+// operator, a run of prefix operators and a chained assignment. With a
+// recursive expression parser these overflow the stack; the iterative one
+// parses them in constant stack depth. Each input is then put through the
+// whole driver pipeline (check, parser.txt, bytecode) once from each AST
+// layout, which has to finish without recursing per term either.
+
+#include "driver.h"
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <print>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using namespace mini_compiler;
+
+namespace fs = std::filesystem;
+
+// let x: int = a0 + a1 * a2 - a3 < a4 && ... ;
+std::string binary_chain(size_t terms) {
+    constexpr std::array<std::string_view, 8> ops{
+        " + ", " * ", " - ", " / ", " < ", " && ", " % ", " || "};
+    std::string s = "let x: int = a0";
+    for (size_t i = 1; i < terms; ++i) {
+        s += ops[i % ops.size()];
+        s += 'a';
+        s += std::to_string(i % 1000);
+    }
+    s += ";\n";
+    return s;
+}
+
+// let z: int = 1 + 1 + ... ;
+std::string sum_chain(size_t terms) {
+    std::string s = "let z: int = 1";
+    for (size_t i = 1; i < terms; ++i) {
+        s += " + 1";
+    }
+    s += ";\n";
+    return s;
+}
+
+// let y: int = - ! - ! ... x;
+std::string prefix_chain(size_t terms) {
+    std::string s = "let y: int = ";
+    for (size_t i = 0; i < terms; ++i) {
+        s += i % 2 == 0 ? "- " : "! ";
+    }
+    s += "x;\n";
+    return s;
+}
+
+// fn f() { a = a = ... = 1; }
+std::string assignment_chain(size_t terms) {
+    std::string s = "fn f() {\n";
+    for (size_t i = 0; i < terms; ++i) {
+        s += "a = ";
+    }
+    s += "1;\n}\n";
+    return s;
+}
+
+using Clock = std::chrono::steady_clock;
+
+double ms(Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void run(
+    std::string_view name, std::string const& source, fs::path const& out_dir) {
+    auto const t0 = Clock::now();
+    Lexer lexer(source);
+    auto const tokens = lexer.tokenize();
+    auto const t1 = Clock::now();
+    Parser parser(tokens);
+    Program const program = parser.parse();
+    auto const t2 = Clock::now();
+
+    std::println(
+        "{:<12} {:>9} tokens  lex {:>8.1f} ms  parse {:>8.1f} ms  "
+        "({:.1f} ns/token)",
+        name,
+        tokens.size(),
+        ms(t1 - t0),
+        ms(t2 - t1),
+        std::chrono::duration<double, std::nano>(t2 - t1).count() /
+            static_cast<double>(tokens.size()));
+
+    // most chains use undeclared names; their check fails after the dumps
+    // have been written
+    auto drive = [&](AstLayout layout, bool emit_ast) {
+        OutputPaths const outputs =
+            output_paths_for(out_dir, name, emit_ast, true);
+        auto const start = Clock::now();
+        try {
+            compile_source(source, &outputs, layout);
+        } catch (SemanticError const&) {
+        }
+        return ms(Clock::now() - start);
+    };
+    double const tree = drive(AstLayout::Tree, false);
+    double const flat = drive(AstLayout::Flat, true);
+    std::println(
+        "{:<12} {:>9} driver  {:>8.1f} ms  flat + .ast {:>8.1f} ms",
+        "",
+        "",
+        tree,
+        flat);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t const terms =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    fs::path const out_dir =
+        fs::temp_directory_path() / "minicompiler_expr_stress";
+    int status = 0;
+    try {
+        run("binary", binary_chain(terms), out_dir);
+        run("sum", sum_chain(terms), out_dir);
+        run("prefix", prefix_chain(terms), out_dir);
+        run("assignment", assignment_chain(terms), out_dir);
+    } catch (std::exception const& e) {
+        std::println(stderr, "Error: {}", e.what());
+        status = 1;
+    }
+    std::error_code ignored;
+    fs::remove_all(out_dir, ignored);
+    return status;
+}
@@ -0,0 +1,109 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// incremental_bench.cpp: 编辑后增量重新词法/语法分析的延迟。
+//
+// Builds a document of about N lines (argument, default 100000) from copies
+// of the sample program, then types and deletes characters inside function
+// bodies spread over the file. Reports the time of a full tokenize + parse
+// and the latency of each incremental Document::apply().
+
+#include "incremental.h"
+#include "lexer.h"
+#include "parser.h"
+#include "sample_program.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    using namespace mini_compiler;
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](auto d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+
+    size_t const lines =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    size_t const sample_lines = static_cast<size_t>(
+        std::ranges::count(sample_program, '\n'));
+    std::string text;
+    while (static_cast<size_t>(std::ranges::count(text, '\n')) < lines) {
+        text += sample_program;
+        if (text.size() > size_t{1} << 30) {
+            break;
+        }
+    }
+    size_t const copies = text.size() / sample_program.size();
+
+    try {
+        auto const t0 = Clock::now();
+        auto const tokens = Lexer(text).tokenize();
+        Program const full = Parser(tokens).parse();
+        auto const t1 = Clock::now();
+
+        auto const t2 = Clock::now();
+        Document doc(text);
+        auto const t3 = Clock::now();
+
+        // "count = count + amount;" sits inside fn increment in every copy
+        size_t const anchor = sample_program.find("count + amount");
+        std::mt19937 rng(42);
+        std::vector<double> latencies;
+        size_t reparsed = 0;
+        for (int i = 0; i < 200; ++i) {
+            size_t const copy = rng() % copies;
+            auto const at =
+                static_cast<offset_t>(copy * sample_program.size() + anchor);
+            for (std::string_view const c : {"z", "q"}) {
+                auto const s0 = Clock::now();
+                auto stats = doc.apply({.offset = at, .inserted = c});
+                latencies.push_back(ms(Clock::now() - s0));
+                reparsed += stats.reparsed_items;
+            }
+            for (int k = 0; k < 2; ++k) {
+                auto const s0 = Clock::now();
+                auto stats = doc.apply({.offset = at, .removed = 1});
+                latencies.push_back(ms(Clock::now() - s0));
+                reparsed += stats.reparsed_items;
+            }
+        }
+        if (doc.text() != text || !doc.ok()) {
+            std::println(stderr, "Error: document diverged");
+            return 1;
+        }
+
+        std::ranges::sort(latencies);
+        double total = 0;
+        for (double const l : latencies) {
+            total += l;
+        }
+        std::println(
+            "document: {} lines, {:.2f} MB, {} tokens, {} statements",
+            copies * sample_lines,
+            static_cast<double>(text.size()) / 1e6,
+            tokens.size(),
+            full.statements.size());
+        std::println("full tokenize + parse:  {:>8.2f} ms", ms(t1 - t0));
+        std::println("Document construction:  {:>8.2f} ms", ms(t3 - t2));
+        std::println(
+            "incremental edit:       {:>8.3f} ms mean, {:.3f} ms median, "
+            "{:.3f} ms max ({} edits, {:.1f} items reparsed per edit)",
+            total / static_cast<double>(latencies.size()),
+            latencies[latencies.size() / 2],
+            latencies.back(),
+            latencies.size(),
+            static_cast<double>(reparsed) /
+                static_cast<double>(latencies.size()));
+    } catch (std::exception const& e) {
+        std::println(stderr, "Error: {}", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// keyword_bench.cpp: 比较关键字查找的两种实现。
+//
+// Compares lookup_keyword (compile-time perfect hash) with the function-local
+// static unordered_map that Lexer::lex_identifier used before, on an
+// identifier-heavy word list (about one word in five is a keyword).
+
+#include "lexer.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using namespace mini_compiler;
+using std::string;
+using std::string_view;
+using std::vector;
+
+TokenKind lookup_keyword_map(string_view text) {
+    static std::unordered_map<string_view, TokenKind> keyword_map = []() {
+        std::unordered_map<string_view, TokenKind> m;
+        for (TokenKind const k : get_keywords()) {
+            m[to_string(k)] = k;
+        }
+        return m;
+    }();
+    if (auto it = keyword_map.find(text); it != keyword_map.end()) {
+        return it->second;
+    }
+    return TokenKind::Identifier;
+}
+
+vector<string> make_words(size_t count) {
+    std::mt19937 rng(42);
+    auto const keywords = get_keywords();
+    string_view const alphabet = "abcdefghijklmnopqrstuvwxyz_0123456789";
+    vector<string> words;
+    words.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (rng() % 5 == 0) {
+            words.emplace_back(to_string(keywords[rng() % keywords.size()]));
+            continue;
+        }
+        string word(1, static_cast<char>('a' + rng() % 26));
+        size_t const len = 1 + rng() % 10;
+        for (size_t j = 0; j < len; ++j) {
+            word += alphabet[rng() % alphabet.size()];
+        }
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+template <typename Lookup>
+void run(string_view name, vector<string> const& words, Lookup lookup) {
+    constexpr int rounds = 20;
+    uint64_t checksum = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (auto const& word : words) {
+            checksum += static_cast<uint64_t>(lookup(word));
+        }
+    }
+    std::chrono::duration<double> const elapsed =
+        std::chrono::steady_clock::now() - start;
+    double const lookups = static_cast<double>(words.size()) * rounds;
+    std::println(
+        "{:<16} {:>8.2f} ns/lookup  {:>8.1f} M lookups/s  (checksum {})",
+        name,
+        elapsed.count() * 1e9 / lookups,
+        lookups / elapsed.count() / 1e6,
+        checksum);
+}
+
+} // namespace
+
+int main() {
+    auto const words = make_words(1'000'000);
+    run("unordered_map", words, lookup_keyword_map);
+    run("perfect_hash", words, lookup_keyword);
+    return 0;
+}
@@ -0,0 +1,643 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// minicompiler_bench.cpp: 词法分析与语法分析热点路径的基准测试套件。
+//
+// Google Benchmark style: every benchmark repeats one operation on a fixed,
+// deterministic corpus until --min-time has passed, --repetitions times,
+// and reports the median time per iteration with bytes/s and items/s.
+//
+//   MiniCompilerBench [--filter SUBSTR] [--size MB] [--repetitions N]
+//                     [--min-time SECONDS] [--json FILE]
+//                     [--compare FILE] [--threshold PERCENT]
+//
+// --json writes the results; --compare reads such a file from an earlier
+// commit, prints the change of every benchmark and exits with 1 if one got
+// slower by more than --threshold percent (default 10). Corpora depend only
+// on --size, so results of different commits are comparable. The
+// "generated" corpora come from ProgramGenerator (program_generator.h).
+
+#include "bytecode.h"
+#include "interner.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "parser.h"
+#include "program_generator.h"
+#include "register_bytecode.h"
+#include "register_vm.h"
+#include "sample_program.h"
+#include "stack_vm.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <print>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace mini_compiler;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// ==========================================
+// Harness
+// ==========================================
+
+// What one iteration processed.
+struct Work {
+    uint64_t bytes = 0;
+    uint64_t items = 0;
+};
+
+struct Benchmark {
+    string name;
+    string_view unit; // what items counts
+    std::function<Work()> run;
+};
+
+struct Result {
+    string name;
+    uint64_t iterations = 0;
+    double ns = 0; // median time per iteration
+    double cv = 0; // coefficient of variation of the repetitions
+    double bytes_per_second = 0;
+    double items_per_second = 0;
+};
+
+struct Settings {
+    string filter;
+    size_t corpus_bytes = size_t{1} << 20;
+    int repetitions = 5;
+    double min_time = 0.2;
+    string json;
+    string compare;
+    double threshold = 10;
+};
+
+// Keeps results alive so the measured work is not optimized away.
+volatile uint64_t sink = 0;
+
+Result measure(Benchmark const& bench, Settings const& settings) {
+    using Clock = std::chrono::steady_clock;
+    Work work = bench.run(); // warm-up; also the work per iteration
+    sink = sink + work.items;
+
+    // grow the iteration count until one batch takes min_time
+    uint64_t iterations = 1;
+    for (;;) {
+        auto const start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            sink = sink + bench.run().items;
+        }
+        std::chrono::duration<double> const elapsed = Clock::now() - start;
+        if (elapsed.count() >= settings.min_time || iterations >= 1 << 30) {
+            break;
+        }
+        double const scale =
+            elapsed.count() > 0 ? settings.min_time / elapsed.count() : 10;
+        iterations = static_cast<uint64_t>(
+            static_cast<double>(iterations) * std::clamp(scale * 1.2, 2., 10.));
+    }
+
+    vector<double> samples;
+    for (int r = 0; r < settings.repetitions; ++r) {
+        auto const start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            sink = sink + bench.run().items;
+        }
+        std::chrono::duration<double, std::nano> const elapsed =
+            Clock::now() - start;
+        samples.push_back(elapsed.count() / static_cast<double>(iterations));
+    }
+    std::ranges::sort(samples);
+    double const median = samples[samples.size() / 2];
+    double mean = 0;
+    for (double const s : samples) {
+        mean += s / static_cast<double>(samples.size());
+    }
+    double variance = 0;
+    for (double const s : samples) {
+        variance += (s - mean) * (s - mean);
+    }
+    variance /= static_cast<double>(samples.size());
+    return {
+        .name = bench.name,
+        .iterations = iterations,
+        .ns = median,
+        .cv = mean > 0 ? std::sqrt(variance) / mean * 100 : 0,
+        .bytes_per_second = static_cast<double>(work.bytes) * 1e9 / median,
+        .items_per_second = static_cast<double>(work.items) * 1e9 / median};
+}
+
+void write_json(string const& path, vector<Result> const& results) {
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Failed to open output file " + path);
+    }
+    // one benchmark per line, so read_baseline() needs no JSON parser
+    out << "{\"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        Result const& r = results[i];
+        std::println(
+            out,
+            "{{\"name\": \"{}\", \"iterations\": {}, \"real_time_ns\": {:.3f}, "
+            "\"cv_percent\": {:.2f}, \"bytes_per_second\": {:.0f}, "
+            "\"items_per_second\": {:.0f}}}{}",
+            r.name,
+            r.iterations,
+            r.ns,
+            r.cv,
+            r.bytes_per_second,
+            r.items_per_second,
+            i + 1 < results.size() ? "," : "");
+    }
+    out << "]}\n";
+}
+
+// name -> real_time_ns of a file written by write_json()
+std::map<string, double, std::less<>> read_baseline(string const& path) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open baseline " + path);
+    }
+    std::map<string, double, std::less<>> times;
+    string line;
+    while (std::getline(in, line)) {
+        constexpr string_view name_key = "\"name\": \"";
+        constexpr string_view time_key = "\"real_time_ns\": ";
+        size_t const name_at = line.find(name_key);
+        size_t const time_at = line.find(time_key);
+        if (name_at == string::npos || time_at == string::npos) {
+            continue;
+        }
+        size_t const begin = name_at + name_key.size();
+        string name = line.substr(begin, line.find('"', begin) - begin);
+        times[std::move(name)] =
+            std::strtod(line.c_str() + time_at + time_key.size(), nullptr);
+    }
+    return times;
+}
+
+// ==========================================
+// Corpora
+// ==========================================
+//
+// Built from a fixed seed and sized to about `bytes`.
+
+string random_name(std::mt19937& rng, size_t min_len, size_t max_len) {
+    string_view const alphabet = "abcdefghijklmnopqrstuvwxyz_0123456789";
+    string name(1, static_cast<char>('a' + rng() % 26));
+    size_t const len = min_len + rng() % (max_len - min_len + 1);
+    while (name.size() < len) {
+        name += alphabet[rng() % alphabet.size()];
+    }
+    return name;
+}
+
+// let total_count_7: int = value_3 + other_name(first_arg, x9) * limit;
+string identifier_corpus(size_t bytes) {
+    std::mt19937 rng(1);
+    string s;
+    while (s.size() < bytes) {
+        s += std::format(
+            "let {}: int = {} + {}({}, {}) * {};\n",
+            random_name(rng, 4, 16),
+            random_name(rng, 3, 12),
+            random_name(rng, 4, 14),
+            random_name(rng, 2, 10),
+            random_name(rng, 2, 10),
+            random_name(rng, 3, 12));
+    }
+    return s;
+}
+
+// a+=b*(c-d)/e%f<=g&&h||i!=j; ... with few and short identifiers
+string symbol_corpus(size_t bytes) {
+    constexpr std::array<string_view, 24> ops{
+        "+",  "-",  "*",  "/",  "%",  "<",  "<=", ">",
+        ">=", "==", "!=", "&&", "||", "=",  "+=", "-=",
+        "*=", "/=", "%=", "&",  "|",  "^",  "->", "::"};
+    std::mt19937 rng(2);
+    string s;
+    while (s.size() < bytes) {
+        for (int i = 0; i < 8; ++i) {
+            s += static_cast<char>('a' + rng() % 26);
+            s += ops[rng() % ops.size()];
+            if (rng() % 4 == 0) {
+                s += "(!";
+                s += static_cast<char>('a' + rng() % 26);
+                s += ')';
+                s += ops[rng() % 13];
+            }
+        }
+        s += "z;\n";
+    }
+    return s;
+}
+
+// print("forty-odd characters of text with \n escapes", "more text");
+string string_corpus(size_t bytes) {
+    std::mt19937 rng(3);
+    string_view const words[] = {
+        "lorem", "ipsum", "dolor", "sit", "amet", "\\n", "\\t", "\\\\"};
+    auto text = [&] {
+        string t;
+        while (t.size() < 40) {
+            t += words[rng() % std::size(words)];
+            t += ' ';
+        }
+        return t;
+    };
+    string s;
+    while (s.size() < bytes) {
+        s += std::format("print(\"{}\", \"{}\");\n", text(), text());
+    }
+    return s;
+}
+
+// four comment lines per statement
+string comment_corpus(size_t bytes) {
+    std::mt19937 rng(4);
+    string s;
+    while (s.size() < bytes) {
+        for (int i = 0; i < 4; ++i) {
+            s += "// ";
+            while (s.size() - s.rfind('\n') < 64) {
+                s += random_name(rng, 2, 9);
+                s += ' ';
+            }
+            s += '\n';
+        }
+        s += "let x: int = 1; // trailing comment\n";
+    }
+    return s;
+}
+
+// every operator and punctuation spelling, in turn
+string operator_corpus(size_t bytes) {
+    vector<string_view> spellings;
+    for (int k = 0; k <= static_cast<int>(TokenKind::Dollar); ++k) {
+        spellings.push_back(to_string(static_cast<TokenKind>(k)));
+    }
+    string s;
+    while (s.size() < bytes) {
+        for (string_view const spelling : spellings) {
+            s += spelling;
+            s += ' ';
+        }
+        s += '\n';
+    }
+    return s;
+}
+
+// let v: int = { if c { ( { if c { ( ... x ... ) } else { 0 } } ) } ... };
+string nesting_corpus(size_t bytes, int depth) {
+    string unit = "let v: int = ";
+    for (int i = 0; i < depth; ++i) {
+        unit += i % 3 == 0 ? "{ " : i % 3 == 1 ? "if c { " : "(";
+    }
+    unit += "x";
+    for (int i = depth - 1; i >= 0; --i) {
+        unit += i % 3 == 0 ? " }" : i % 3 == 1 ? " } else { 0 }" : ")";
+    }
+    unit += ";\n";
+    string s;
+    while (s.size() < bytes) {
+        s += unit;
+    }
+    return s;
+}
+
+// let v: int = f(a0 + 1, a1 + 1, ..., a999 + 1);
+string wide_call_corpus(size_t bytes, int args) {
+    string unit = "let v: int = f(";
+    for (int i = 0; i < args; ++i) {
+        unit += std::format("{}a{} + 1", i == 0 ? "" : ", ", i);
+    }
+    unit += ");\n";
+    string s;
+    while (s.size() < bytes) {
+        s += unit;
+    }
+    return s;
+}
+
+// let x: int = a0 + a1 * a2 - a3 < a4 && ... ;
+string operator_chain_corpus(size_t bytes, int terms) {
+    constexpr std::array<string_view, 10> ops{
+        " + ", " * ", " - ", " / ", " < ", " && ", " % ", " || ", " == ",
+        " shl "};
+    string unit = "let x: int = a0";
+    for (int i = 1; i < terms; ++i) {
+        unit += ops[static_cast<size_t>(i) % ops.size()];
+        unit += std::format("a{}", i % 100);
+    }
+    unit += ";\n";
+    string s;
+    while (s.size() < bytes) {
+        s += unit;
+    }
+    return s;
+}
+
+string generated_program(size_t bytes) {
+    return generate_program({.bytes = bytes, .seed = 1});
+}
+
+string repeated_sample(size_t bytes) {
+    string s;
+    while (s.size() < bytes) {
+        s += sample_program;
+    }
+    return s;
+}
+
+// ==========================================
+// Benchmarks
+// ==========================================
+
+Benchmark lex_benchmark(string name, string source) {
+    return {
+        .name = "tokenize/" + name,
+        .unit = "tokens",
+        .run = [source = std::move(source)] {
+            auto const tokens = Lexer(source).tokenize();
+            return Work{.bytes = source.size(), .items = tokens.size()};
+        }};
+}
+
+// Tokens and trees refer to their source, so it is kept alongside.
+struct ParseFixture {
+    string source;
+    TokenBuffer tokens;
+    Program program;
+    std::ostringstream out;
+
+    explicit ParseFixture(string text)
+        : source(std::move(text)),
+          tokens(Lexer(source).tokenize()),
+          program(Parser(tokens).parse()) {} // throws on invalid input
+};
+
+Benchmark parse_benchmark(string name, string source) {
+    auto const fixture = std::make_shared<ParseFixture>(std::move(source));
+    return {
+        .name = "parse/" + name,
+        .unit = "tokens",
+        .run = [fixture] {
+            Program const program = Parser(fixture->tokens).parse();
+            sink = sink + program.statements.size();
+            return Work{
+                .bytes = fixture->source.size(),
+                .items = fixture->tokens.size()};
+        }};
+}
+
+Benchmark printer_benchmark(size_t bytes) {
+    auto const fixture = std::make_shared<ParseFixture>(repeated_sample(bytes));
+    return {
+        .name = "print/parse_tree",
+        .unit = "nodes",
+        .run = [fixture] {
+            fixture->out.str({});
+            ParseTreePrinter(fixture->out).print(fixture->program);
+            return Work{
+                .bytes = static_cast<uint64_t>(fixture->out.tellp()),
+                .items = fixture->program.arena->node_count()};
+        }};
+}
+
+// Identifier spellings in the order a lexer meets them, views into `source`.
+struct InternFixture {
+    string source;
+    vector<string_view> names;
+
+    explicit InternFixture(string text) : source(std::move(text)) {
+        for (Token const& token : Lexer(source).tokenize()) {
+            if (token.kind == TokenKind::Identifier) {
+                names.push_back(token.lexeme);
+            }
+        }
+    }
+};
+
+// Each of `threads` threads interns every identifier of the generated
+// corpus into global_interner(), as the chunks of the parallel lexer share
+// one interner.
+// After the warm-up every name is known, so this measures the lookup path
+// and whether it scales: items/s should grow with the thread count.
+Benchmark intern_benchmark(size_t bytes, unsigned threads) {
+    auto const fixture =
+        std::make_shared<InternFixture>(generated_program(bytes));
+    return {
+        .name = std::format("intern/generated/threads:{}", threads),
+        .unit = "names",
+        .run = [fixture, threads] {
+            auto intern_all = [&] {
+                uint64_t sum = 0;
+                for (string_view const name : fixture->names) {
+                    sum += global_interner().intern(name);
+                }
+                sink = sink + sum;
+            };
+            vector<std::jthread> helpers;
+            for (unsigned t = 1; t < threads; ++t) {
+                helpers.emplace_back(intern_all);
+            }
+            intern_all();
+            helpers.clear(); // joins
+            return Work{
+                .bytes = fixture->source.size() * threads,
+                .items = fixture->names.size() * threads};
+        }};
+}
+
+// The loop the execution engines are compared on; items are iterations.
+constexpr uint64_t arithmetic_loop_iterations = 100000;
+
+string arithmetic_loop() {
+    return std::format(
+        "fn main() {{\n"
+        "    let i: int = 0;\n"
+        "    let sum: int = 0;\n"
+        "    while i < {} {{\n"
+        "        sum = sum + i * 2 % 7;\n"
+        "        i = i + 1;\n"
+        "    }}\n"
+        "    print(sum);\n"
+        "}}\n",
+        arithmetic_loop_iterations);
+}
+
+Benchmark interpreter_benchmark() {
+    auto const fixture = std::make_shared<ParseFixture>(arithmetic_loop());
+    return {
+        .name = "run/ast/arithmetic_loop",
+        .unit = "iterations",
+        .run = [fixture] {
+            fixture->out.str({});
+            Interpreter(fixture->out).run(fixture->program);
+            return Work{.items = arithmetic_loop_iterations};
+        }};
+}
+
+Benchmark stack_vm_benchmark() {
+    auto const fixture = std::make_shared<ParseFixture>(arithmetic_loop());
+    auto const module = std::make_shared<BytecodeModule const>(
+        compile_bytecode(fixture->program));
+    return {
+        .name = "run/stack/arithmetic_loop",
+        .unit = "iterations",
+        .run = [fixture, module] {
+            fixture->out.str({});
+            StackVM(fixture->out).run(*module);
+            return Work{.items = arithmetic_loop_iterations};
+        }};
+}
+
+Benchmark register_vm_benchmark() {
+    auto const fixture = std::make_shared<ParseFixture>(arithmetic_loop());
+    auto const module = std::make_shared<RegisterModule const>(
+        compile_register_code(fixture->program));
+    return {
+        .name = "run/register/arithmetic_loop",
+        .unit = "iterations",
+        .run = [fixture, module] {
+            fixture->out.str({});
+            RegisterVM(fixture->out).run(*module);
+            return Work{.items = arithmetic_loop_iterations};
+        }};
+}
+
+vector<Benchmark> make_benchmarks(size_t bytes) {
+    vector<Benchmark> benches;
+    benches.push_back(lex_benchmark("identifiers", identifier_corpus(bytes)));
+    benches.push_back(lex_benchmark("symbols", symbol_corpus(bytes)));
+    benches.push_back(lex_benchmark("strings", string_corpus(bytes)));
+    benches.push_back(lex_benchmark("comments", comment_corpus(bytes)));
+    // lex_symbol() dispatch: nothing but operators and punctuation
+    benches.push_back(lex_benchmark("operators", operator_corpus(bytes)));
+    benches.push_back(lex_benchmark("sample", repeated_sample(bytes)));
+    benches.push_back(lex_benchmark("generated", generated_program(bytes)));
+    benches.push_back(
+        parse_benchmark("deep_nesting", nesting_corpus(bytes, 300)));
+    benches.push_back(
+        parse_benchmark("wide_call_args", wide_call_corpus(bytes, 1000)));
+    benches.push_back(parse_benchmark(
+        "long_operator_chain", operator_chain_corpus(bytes, 10000)));
+    benches.push_back(parse_benchmark("sample", repeated_sample(bytes)));
+    benches.push_back(
+        parse_benchmark("generated", generated_program(bytes)));
+    benches.push_back(printer_benchmark(bytes));
+    for (unsigned const threads : {1U, 2U, 4U, 8U}) {
+        benches.push_back(intern_benchmark(bytes, threads));
+    }
+    benches.push_back(interpreter_benchmark());
+    benches.push_back(stack_vm_benchmark());
+    benches.push_back(register_vm_benchmark());
+    return benches;
+}
+
+Settings parse_arguments(int argc, char* argv[]) {
+    Settings settings;
+    for (int i = 1; i < argc; ++i) {
+        string_view const arg = argv[i];
+        auto value = [&]() -> string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(
+                    std::format("Missing value for {}", arg));
+            }
+            return argv[++i];
+        };
+        if (arg == "--filter") {
+            settings.filter = value();
+        } else if (arg == "--size") {
+            settings.corpus_bytes = static_cast<size_t>(
+                std::stod(value()) * static_cast<double>(size_t{1} << 20));
+        } else if (arg == "--repetitions") {
+            settings.repetitions = std::max(1, std::stoi(value()));
+        } else if (arg == "--min-time") {
+            settings.min_time = std::stod(value());
+        } else if (arg == "--json") {
+            settings.json = value();
+        } else if (arg == "--compare") {
+            settings.compare = value();
+        } else if (arg == "--threshold") {
+            settings.threshold = std::stod(value());
+        } else {
+            throw std::runtime_error(std::format("Unknown option {}", arg));
+        }
+    }
+    return settings;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        Settings const settings = parse_arguments(argc, argv);
+        std::map<string, double, std::less<>> baseline;
+        if (!settings.compare.empty()) {
+            baseline = read_baseline(settings.compare);
+        }
+
+        std::println(
+            "{:<32} {:>12} {:>10} {:>6} {:>10} {:>18}",
+            "benchmark",
+            "time/iter",
+            "iters",
+            "cv",
+            "MB/s",
+            "items/s");
+        vector<Result> results;
+        bool regressed = false;
+        for (Benchmark const& bench : make_benchmarks(settings.corpus_bytes)) {
+            if (!bench.name.contains(settings.filter)) {
+                continue;
+            }
+            Result const r = measure(bench, settings);
+            string change;
+            if (auto const it = baseline.find(r.name); it != baseline.end()) {
+                double const percent = (r.ns / it->second - 1) * 100;
+                bool const slower = percent > settings.threshold;
+                regressed = regressed || slower;
+                change = std::format(
+                    "  {:+.1f}%{}", percent, slower ? " REGRESSION" : "");
+            }
+            std::println(
+                "{:<32} {:>9.3f} ms {:>10} {:>5.1f}% {:>10.1f} {:>11.3g} {}{}",
+                r.name,
+                r.ns / 1e6,
+                r.iterations,
+                r.cv,
+                r.bytes_per_second / 1e6,
+                r.items_per_second,
+                bench.unit,
+                change);
+            results.push_back(r);
+        }
+        if (!settings.json.empty()) {
+            write_json(settings.json, results);
+        }
+        return regressed ? 1 : 0;
+    } catch (std::exception const& e) {
+        std::println(stderr, "Error: {}", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,132 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// ast_file_tests.cpp: 二进制 AST 文件的写出、加载与校验。
+//
+//   round-trip  .ast files written from the sample and generated programs
+//               load, verify, and print and materialize to the original
+//               tree
+//   truncated   a cut-off .ast file is rejected
+//   jumps       break and continue keep their keyword and its offset
+
+#include "test_support.h"
+
+#include "ast_file.h"
+#include "flat_ast.h"
+#include "hash.h"
+#include "lexer.h"
+#include "parser.h"
+#include "sample_program.h"
+#include "semantic.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace mini_compiler;
+using namespace mini_compiler::testing;
+
+// Writes `source` as an .ast file and loads it back.
+void round_trip(string_view source, fs::path const& path, string_view what) {
+    TokenBuffer const tokens = Lexer(source).tokenize();
+    Program const parsed = Parser(tokens).parse();
+    string const expected = print_tree(parsed);
+    FlatAst const flat = flatten(parsed, source);
+    save_ast_file(flat.view(), xxh64(source), path);
+
+    AstFile const file = AstFile::open(path);
+    expect(file.matches(source), std::format("{}: source hash", what));
+    expect(
+        print_flat(file.view()) == expected,
+        std::format("{}: printed .ast differs", what));
+    expect(
+        print_tree(materialize(file.view())) == expected,
+        std::format("{}: materialized tree differs", what));
+    size_t const items = file.view().roots().size();
+    expect(
+        items == parsed.statements.size() &&
+            materialize(file.view(), items - 1, items).statements.size() == 1,
+        std::format("{}: materialized last item", what));
+}
+
+void test_round_trip(fs::path const& dir) {
+    fs::path const path = dir / "program.ast";
+    round_trip(sample_program, path, "sample");
+    for (uint64_t seed = 1; seed <= 4; ++seed) {
+        for (bool const postfix : {false, true}) {
+            round_trip(
+                generate(seed, 64 << 10, postfix),
+                path,
+                std::format("seed {}{}", seed, postfix ? " --postfix" : ""));
+        }
+    }
+}
+
+// A cut-off file is rejected, not read out of bounds.
+void test_truncated(fs::path const& dir) {
+    fs::path const path = dir / "program.ast";
+    round_trip(sample_program, path, "sample");
+    string const bytes = read_file(path);
+    write_file(path, string_view(bytes).substr(0, bytes.size() / 2));
+    expect_error(
+        [&] { AstFile::open(path); }, "AST file", "truncated .ast file");
+}
+
+using Jump = std::pair<string_view, uint32_t>; // keyword, source offset
+
+// The break and continue nodes of `ast`.
+vector<Jump> jumps(FlatAstView ast) {
+    vector<Jump> found;
+    for (NodeId id = 0; id < ast.nodes().size(); ++id) {
+        FlatNode const& node = ast.node(id);
+        if (node.kind == FlatKind::Break || node.kind == FlatKind::Continue) {
+            found.emplace_back(ast.str(node.a), ast.offset(id));
+        }
+    }
+    return found;
+}
+
+// The keywords of break and continue are what their diagnostics point at.
+void test_jumps(fs::path const& dir) {
+    string_view const source = "fn f() {\n"
+                               "    while true { continue; }\n"
+                               "    break;\n"
+                               "}\n";
+    fs::path const path = dir / "program.ast";
+    round_trip(source, path, "jumps");
+    AstFile const file = AstFile::open(path);
+    vector<Jump> const expected{
+        {"continue", static_cast<uint32_t>(source.find("continue"))},
+        {"break", static_cast<uint32_t>(source.find("break"))}};
+    expect(jumps(file.view()) == expected, ".ast jumps differ");
+
+    Program const materialized = materialize(file.view());
+    FlatAst const flat = flatten(materialized);
+    expect(
+        std::ranges::equal(
+            jumps(flat.view()), expected, {}, &Jump::first, &Jump::first),
+        "materialized keywords differ");
+    CheckResult const result = check_program(materialized);
+    expect(
+        result.diagnostics.size() == 1 &&
+            result.diagnostics.front().message == "'break' outside of a loop",
+        "materialized break not checked");
+}
+
+constexpr std::array<Test, 3> tests{{
+    {"round-trip", test_round_trip},
+    {"truncated", test_truncated},
+    {"jumps", test_jumps},
+}};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    return run_tests("ast_file_tests", tests, argc, argv);
+}
@@ -0,0 +1,164 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// deep_chain_tests.cpp: 超长表达式链不得逐项递归（回归测试）。
+//
+// Every test puts 200000-term chains through a pass that once recursed per
+// term and overflowed the stack: a mixed-precedence binary chain, a sum, a
+// run of prefix operators and a chained assignment.
+//   tree      parsing (batch and streaming) and printing parser.txt,
+//             directly and through the driver
+//   flat      flattening and printing the flat AST: parser.txt must be
+//             the same as from the tree
+//   ast-file  writing the chain as .ast through the driver, and loading,
+//             verifying and materializing it
+//   run       checking and running the chain with `MiniCompiler run` on
+//             every engine
+
+#include "test_support.h"
+
+#include "ast_file.h"
+#include "driver.h"
+#include "flat_ast.h"
+#include "lexer.h"
+#include "parser.h"
+
+#include <array>
+#include <cstddef>
+#include <format>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace mini_compiler;
+using namespace mini_compiler::testing;
+
+constexpr size_t chain_terms = 200000;
+
+constexpr std::array<string_view, 3> engines{"ast", "stack", "register"};
+
+struct Chain {
+    string_view name;
+    string source;
+    string output; // printed when run
+};
+
+vector<Chain> chains() {
+    constexpr std::array<string_view, 4> ops{" * ", " + ", " / ", " - "};
+    string binary = "let b: int = 1";
+    string sum = "let s: int = 1";
+    string prefix = "let p: int = ";
+    string assignment = "fn main() {\n    let a: int = 0;\n    ";
+    for (size_t i = 1; i < chain_terms; ++i) {
+        binary += ops[i % ops.size()];
+        binary += '1';
+        sum += " + 1";
+    }
+    for (size_t i = 0; i < chain_terms; ++i) {
+        prefix += "- ";
+        assignment += "a = ";
+    }
+    binary += ";\nprint(b);\n";
+    sum += ";\nprint(s);\n";
+    prefix += "3;\nprint(p);\n";
+    assignment += "7;\n    print(a);\n}\n";
+    // 1 + 1 / 1 - 1 * 1 + 1 / 1 - ... - 1: after the first 1 the terms
+    // alternate between +1 and -1, so it is 1
+    return {
+        {"binary", binary, "1\n"},
+        {"sum", sum, std::format("{}\n", chain_terms)},
+        {"prefix", prefix, "3\n"},
+        {"assignment", assignment, "7\n"}};
+}
+
+void test_tree(fs::path const& dir) {
+    for (Chain const& chain : chains()) {
+        TokenBuffer const tokens = Lexer(chain.source).tokenize();
+        string const printed = print_tree(Parser(tokens).parse());
+        expect(
+            printed.size() > chain_terms,
+            std::format("{}: parser.txt too short", chain.name));
+        expect(
+            print_tree(StreamingParser(chain.source).parse()) == printed,
+            std::format("{}: streaming parse differs", chain.name));
+
+        OutputPaths const outputs =
+            output_paths_for(dir, std::format("{}.mc", chain.name));
+        compile_source(chain.source, &outputs, AstLayout::Tree);
+        expect(
+            read_file(outputs.parser) == printed,
+            std::format("{}: driver parser.txt differs", chain.name));
+    }
+}
+
+void test_flat(fs::path const& dir) {
+    for (Chain const& chain : chains()) {
+        TokenBuffer const tokens = Lexer(chain.source).tokenize();
+        Program const program = Parser(tokens).parse();
+        string const printed = print_tree(program);
+        expect(
+            print_flat(flatten(program, chain.source).view()) == printed,
+            std::format("{}: flat AST prints differently", chain.name));
+
+        OutputPaths const outputs =
+            output_paths_for(dir, std::format("{}.mc", chain.name));
+        compile_source(chain.source, &outputs, AstLayout::Flat);
+        expect(
+            read_file(outputs.parser) == printed,
+            std::format("{}: --flat-ast parser.txt differs", chain.name));
+    }
+}
+
+void test_ast_file(fs::path const& dir) {
+    for (Chain const& chain : chains()) {
+        TokenBuffer const tokens = Lexer(chain.source).tokenize();
+        string const printed = print_tree(Parser(tokens).parse());
+
+        OutputPaths const outputs =
+            output_paths_for(dir, std::format("{}.mc", chain.name), true);
+        compile_source(chain.source, &outputs, AstLayout::Tree);
+        AstFile const file = AstFile::open(outputs.ast);
+        expect(
+            file.matches(chain.source) && print_flat(file.view()) == printed,
+            std::format("{}: .ast prints differently", chain.name));
+        expect(
+            print_tree(materialize(file.view())) == printed,
+            std::format("{}: materialized tree differs", chain.name));
+    }
+}
+
+void test_run(fs::path const& dir) {
+    for (Chain const& chain : chains()) {
+        fs::path const input = dir / std::format("{}.mc", chain.name);
+        write_file(input, chain.source);
+        for (string_view const engine : engines) {
+            std::istringstream in;
+            std::ostringstream out;
+            std::ostringstream err;
+            int const status = run_program(
+                {"--engine", string(engine), input.string()}, in, out, err);
+            expect(
+                status == 0 && out.str() == chain.output,
+                std::format(
+                    "{}: --engine {} printed \"{}\" ({})",
+                    chain.name,
+                    engine,
+                    out.str(),
+                    err.str()));
+        }
+    }
+}
+
+constexpr std::array<Test, 4> tests{{
+    {"tree", test_tree},
+    {"flat", test_flat},
+    {"ast-file", test_ast_file},
+    {"run", test_run},
+}};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    return run_tests("deep_chain_tests", tests, argc, argv);
+}
@@ -0,0 +1,79 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// driver_tests.cpp: 批量编译驱动写出的文件。
+//
+//   dump-bytecode  bytecode.txt is written only with --dump-bytecode, and
+//                  only for inputs that check
+
+#include "test_support.h"
+
+#include "driver.h"
+
+#include <array>
+#include <filesystem>
+#include <format>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace mini_compiler;
+using namespace mini_compiler::testing;
+
+// Compiles `inputs` into `out_dir` like `MiniCompiler -j 1 -o out_dir`
+// with `options`; returns the exit status.
+int compile(
+    fs::path const& out_dir,
+    vector<string> options,
+    vector<fs::path> const& inputs) {
+    options.insert(options.end(), {"-j", "1", "-o", out_dir.string()});
+    for (fs::path const& input : inputs) {
+        options.push_back(input.string());
+    }
+    std::ostringstream out;
+    std::ostringstream err;
+    return run_driver(parse_command_line(options, out_dir), out, err);
+}
+
+void test_dump_bytecode(fs::path const& dir) {
+    fs::path const good = dir / "good.mc";
+    fs::path const bad = dir / "bad.mc"; // an undeclared name
+    write_file(good, "let a: int = 1;\nprint(a + 2);\n");
+    write_file(bad, "let a: int = 1;\nprint(b + 2);\n");
+    fs::path const out_dir = dir / "out";
+    OutputPaths const good_outputs =
+        output_paths_for(out_dir, good, false, true);
+    OutputPaths const bad_outputs = output_paths_for(out_dir, bad, false, true);
+
+    expect(compile(out_dir, {}, {good, bad}) == 1, "bad.mc compiled");
+    expect(
+        fs::exists(good_outputs.parser) && fs::exists(bad_outputs.parser),
+        "parser.txt not written");
+    expect(
+        !fs::exists(good_outputs.bytecode) &&
+            !fs::exists(bad_outputs.bytecode),
+        "bytecode.txt written without --dump-bytecode");
+
+    // a stale dump of bad.mc must not survive either
+    write_file(bad_outputs.bytecode, "stale");
+    expect(
+        compile(out_dir, {"--dump-bytecode"}, {good, bad}) == 1,
+        "bad.mc compiled");
+    expect(
+        read_file(good_outputs.bytecode).contains("PRINT"),
+        "bytecode.txt of good.mc missing");
+    expect(
+        !fs::exists(bad_outputs.bytecode),
+        "bytecode.txt written for an input that does not check");
+}
+
+constexpr std::array<Test, 1> tests{{
+    {"dump-bytecode", test_dump_bytecode},
+}};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    return run_tests("driver_tests", tests, argc, argv);
+}
@@ -0,0 +1,247 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// incremental_tests.cpp: 增量重新分析必须与完整分析结果一致。
+//
+//   edits       random edits of generated programs and their undo: every
+//               Document state must match a fresh lex and parse of its text
+//   lex-errors  unexpected characters in a new Document and typed into one
+//   interners   names of a Document, and of compilations and runs through
+//               the driver, do not stay in global_interner()
+//   jumps       break and continue keep their keyword across edits, and
+//               checking the edited tree reports what a new Document's does
+
+#include "test_support.h"
+
+#include "driver.h"
+#include "flat_ast.h"
+#include "incremental.h"
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+
+#include <array>
+#include <cstdint>
+#include <format>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace mini_compiler;
+using namespace mini_compiler::testing;
+
+// `doc` after edits must be what lexing and parsing its text from scratch
+// gives: the same tokens, errors and tree as a new Document, and where the
+// whole text lexes and parses, the same tokens and tree as Lexer and Parser.
+// Each Document has its own interner, so symbols are compared by name.
+void check_document(Document& doc, string_view context) {
+    string const text(doc.text());
+    Document fresh(text);
+    expect(
+        same_tokens(
+            doc.tokens(), fresh.tokens(), &doc.interner(), &fresh.interner()),
+        std::format("{}: tokens differ from a new Document", context));
+    expect(
+        doc.errors() == fresh.errors(),
+        std::format("{}: errors differ from a new Document", context));
+    expect(
+        print_tree(doc.program()) == print_tree(fresh.program()),
+        std::format("{}: tree differs from a new Document", context));
+
+    TokenBuffer tokens;
+    Program program;
+    try {
+        tokens = Lexer(text).tokenize();
+        program = Parser(tokens).parse();
+    } catch (std::runtime_error const&) {
+        expect(!doc.ok(), std::format("{}: error not reported", context));
+        return;
+    }
+    expect(doc.ok(), std::format("{}: spurious error", context));
+    expect(
+        same_tokens(
+            doc.tokens(), tokens, &doc.interner(), &global_interner()),
+        std::format("{}: tokens differ from tokenize()", context));
+    expect(
+        print_tree(doc.program()) == print_tree(program),
+        std::format("{}: tree differs from parse()", context));
+}
+
+void test_edits(fs::path const&) {
+    // bits of syntax and of broken syntax: a fragment usually damages the
+    // item it lands in and undoing it must repair the item
+    constexpr std::array<string_view, 14> fragments{
+        " ",
+        "\n",
+        "x",
+        "1 + ",
+        ";",
+        "{",
+        "}",
+        "(",
+        "\"",
+        "'",
+        "// ",
+        "#",
+        "let q: int = 2;\n",
+        "fn g() -> int { 1 }\n"};
+    for (uint64_t seed = 1; seed <= 4; ++seed) {
+        string const original = generate(seed, 16 << 10, seed % 2 == 0);
+        Document doc(original);
+        check_document(doc, std::format("seed {}", seed));
+        std::mt19937 rng(static_cast<uint32_t>(seed));
+        auto below = [&](size_t n) {
+            return std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+        };
+        for (int i = 0; i < 150; ++i) {
+            auto const context = std::format("seed {} edit {}", seed, i);
+            auto const at = static_cast<offset_t>(below(doc.text().size()));
+            string_view inserted;
+            string removed;
+            if (below(2) == 0) {
+                inserted = fragments[below(fragments.size())];
+            } else {
+                removed = doc.text().substr(at, 1 + below(40));
+            }
+            doc.apply(
+                {.offset = at,
+                 .removed = static_cast<offset_t>(removed.size()),
+                 .inserted = inserted});
+            check_document(doc, context);
+            doc.apply(
+                {.offset = at,
+                 .removed = static_cast<offset_t>(inserted.size()),
+                 .inserted = removed});
+            check_document(doc, context + " undone");
+            expect(doc.text() == original, context + ": undo changed text");
+            expect(doc.ok(), context + ": undo left an error");
+        }
+    }
+}
+
+void test_lex_errors(fs::path const&) {
+    for (string_view const c : {"\\", "#", "`"}) {
+        string const source =
+            std::format("let a: int = 1;\nlet b: int = a {} 2;\n", c);
+        auto const what = std::format("'{}'", c);
+        Document doc(source);
+        expect(
+            !doc.ok() && doc.errors().front().starts_with(
+                             std::format("Unexpected character: {}", c)),
+            what + " Document");
+        check_document(doc, what + " Document");
+        string const fixed = "let a: int = 1;\nlet b: int = a + 2;\n";
+        Document edited(fixed);
+        auto const at = static_cast<offset_t>(fixed.find('+'));
+        edited.apply({.offset = at, .removed = 1, .inserted = c});
+        check_document(edited, what + " Document edit");
+    }
+}
+
+void test_interners(fs::path const& dir) {
+    // names no other code interns
+    string const source =
+        "fn interner_f(interner_p: int) -> int { interner_p }\n"
+        "let interner_x: int = interner_f(1);\n"
+        "print(interner_x);\n";
+    constexpr std::array<string_view, 4> names{
+        "interner_f", "interner_p", "interner_x", "interner_y"};
+
+    Document doc(source);
+    auto const at = static_cast<offset_t>(source.rfind("interner_x"));
+    doc.apply({.offset = at + 9, .removed = 1, .inserted = "y"});
+    expect(
+        doc.interner().lookup("interner_y").has_value(),
+        "Document: edited name not interned");
+
+    OutputPaths const outputs = output_paths_for(dir, "names.mc", true);
+    compile_source(source, &outputs);
+    for (Engine const engine : {Engine::Ast, Engine::Stack, Engine::Register}) {
+        std::ostringstream out;
+        std::ostringstream err;
+        expect(
+            detail::run_source(source, "names.mc", engine, out, err) == 0 &&
+                out.str() == "1\n",
+            "run: " + err.str());
+    }
+    for (string_view const name : names) {
+        expect(
+            !global_interner().lookup(name).has_value(),
+            std::format("{} is in global_interner()", name));
+    }
+}
+
+vector<string> check_messages(Document& doc) {
+    CheckResult const result =
+        check_program(doc.program(), doc.text(), doc.interner());
+    vector<string> messages;
+    for (Diagnostic const& diagnostic : result.diagnostics) {
+        messages.push_back(diagnostic.message);
+    }
+    return messages;
+}
+
+void test_jumps(fs::path const&) {
+    string const source = "fn f(n: int) -> int {\n"
+                          "    let i: int = 0;\n"
+                          "    while i < n {\n"
+                          "        i = i + 1;\n"
+                          "        if i == 2 { continue; }\n"
+                          "        if i == 5 { break; }\n"
+                          "    }\n"
+                          "    i\n"
+                          "}\n"
+                          "fn g() {\n"
+                          "    break;\n"
+                          "}\n";
+    Document doc(source);
+    for (int i = 0; i < 20; ++i) {
+        auto const context = std::format("edit {}", i);
+        // every edit replaces the text; the items after it are reused
+        string const inserted = std::format("let v{}: int = 1;\n", i);
+        doc.apply({.offset = 0, .inserted = inserted});
+        check_document(doc, context);
+
+        // the keywords must have moved into the items' copies of the text
+        FlatAst const flat = flatten(doc.program(), doc.text());
+        FlatAstView const view = flat.view();
+        size_t jumps = 0;
+        for (NodeId id = 0; id < view.nodes().size(); ++id) {
+            FlatNode const& node = view.node(id);
+            if (node.kind != FlatKind::Break &&
+                node.kind != FlatKind::Continue) {
+                continue;
+            }
+            ++jumps;
+            expect(
+                view.str(node.a) ==
+                        (node.kind == FlatKind::Break ? "break" : "continue") &&
+                    view.offset(id) == no_offset,
+                context + ": keyword not moved with its item");
+        }
+        expect(jumps == 3, context + ": jumps lost");
+
+        Document fresh{string(doc.text())};
+        vector<string> const messages = check_messages(doc);
+        expect(
+            messages == check_messages(fresh) && messages.size() == 1 &&
+                messages.front() == "'break' outside of a loop",
+            context + ": check differs from a new Document");
+    }
+}
+
+constexpr std::array<Test, 4> tests{{
+    {"edits", test_edits},
+    {"lex-errors", test_lex_errors},
+    {"interners", test_interners},
+    {"jumps", test_jumps},
+}};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    return run_tests("incremental_tests", tests, argc, argv);
+}
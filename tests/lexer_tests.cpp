@@ -0,0 +1,126 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// lexer_tests.cpp: 词法错误的报告方式（回归测试）。
+//
+//   unexpected-character  characters no token starts with are reported,
+//                         sequentially and in parallel, instead of lexing
+//                         forever
+//   streaming-errors      the streaming lexer reports the same errors as
+//                         tokenize(), so a file gets the same diagnostics
+//                         with and without dump files
+
+#include "test_support.h"
+
+#include "driver.h"
+#include "lexer.h"
+#include "parallel_lexer.h"
+#include "parser.h"
+#include "sample_program.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <format>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using namespace mini_compiler;
+using namespace mini_compiler::testing;
+
+void test_unexpected_character(fs::path const&) {
+    for (string_view const c : {"\\", "#", "`"}) {
+        string const source =
+            std::format("let a: int = 1;\nlet b: int = a {} 2;\n", c);
+        auto const what = std::format("'{}'", c);
+        auto const message = std::format("Unexpected character: {}", c);
+        expect_error(
+            [&] { Lexer(source).tokenize(); }, message, what + " tokenize");
+        expect_error(
+            [&] { StreamingParser(source).parse(); },
+            message,
+            what + " streaming parse");
+    }
+
+    // several MB, so lexed in chunks on the pool; the error is in the middle
+    string source;
+    while (source.size() < size_t{3} << 20) {
+        source += sample_program;
+    }
+    ThreadPool pool(4);
+    expect(
+        same_tokens(tokenize_parallel(source, pool), Lexer(source).tokenize()),
+        "tokenize_parallel() differs from tokenize()");
+    source.insert(source.find('\n', source.size() / 2) + 1, "#\n");
+    expect_error(
+        [&] { tokenize_parallel(source, pool); },
+        "Unexpected character: #",
+        "tokenize_parallel");
+    expect_error(
+        [&] { compile_source(source, nullptr, AstLayout::Tree, &pool); },
+        "Unexpected character: #",
+        "compile_source on a pool");
+}
+
+// The message `f` throws; "" if it does not throw.
+string error_of(std::function<void()> const& f) {
+    try {
+        f();
+    } catch (std::runtime_error const& e) {
+        return e.what();
+    }
+    return {};
+}
+
+void test_streaming_errors(fs::path const& dir) {
+    // several bad characters, some after a parse error, and an unterminated
+    // string at the end
+    constexpr std::array<string_view, 5> sources{
+        "let a: int = 1 # 2;\nlet b: int = a \\ 3;\n",
+        "let a: int = ;\nlet b: int = ` 3;\n",
+        "fn f() {\n    let c: char = 'ab';\n}\n#",
+        "let a: int = 1;\n",
+        "let a: int = 1 # 2;\nlet s: string = \"open\n",
+    };
+    for (string_view const source : sources) {
+        auto const what = std::format("\"{}\"", source);
+        string const batch = error_of([&] {
+            TokenBuffer const tokens = Lexer(source).tokenize();
+            Parser(tokens).parse();
+        });
+        string const streaming =
+            error_of([&] { StreamingParser(source).parse(); });
+        expect(
+            streaming == batch,
+            std::format(
+                "{}: streaming \"{}\", batch \"{}\"",
+                what,
+                streaming,
+                batch));
+
+        OutputPaths const outputs = output_paths_for(dir, "program.mc");
+        string const without_dumps =
+            error_of([&] { compile_source(source, nullptr); });
+        string const with_dumps =
+            error_of([&] { compile_source(source, &outputs); });
+        expect(
+            without_dumps == with_dumps,
+            std::format(
+                "{}: without dumps \"{}\", with dumps \"{}\"",
+                what,
+                without_dumps,
+                with_dumps));
+    }
+}
+
+constexpr std::array<Test, 2> tests{{
+    {"unexpected-character", test_unexpected_character},
+    {"streaming-errors", test_streaming_errors},
+}};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    return run_tests("lexer_tests", tests, argc, argv);
+}
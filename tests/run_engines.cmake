@@ -0,0 +1,49 @@
+# run_engines.cmake: 用一种字节码引擎运行生成的程序，并与 AST 解释器的输出比较。
+#
+#   cmake -DMINICOMPILER=<exe> -DGENERATE_PROGRAM=<exe> -DENGINE=<engine>
+#         -DSEED=<n> -DWORK_DIR=<dir> -P run_engines.cmake
+#
+# Generates the program of SEED, runs it with `MiniCompiler run --engine
+# ast` and `--engine ENGINE` and fails unless both exit with 0 and print
+# the same, non-empty output. (--postfix programs are not run: the postfix
+# operators have no semantics yet, so they do not check.)
+
+foreach(var MINICOMPILER GENERATE_PROGRAM ENGINE SEED WORK_DIR)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "${var} is not set")
+    endif()
+endforeach()
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+set(program "${WORK_DIR}/${ENGINE}_seed${SEED}.mc")
+execute_process(
+    COMMAND "${GENERATE_PROGRAM}" --seed ${SEED} --size 32K -o "${program}"
+    RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "GenerateProgram --seed ${SEED} exited with ${status}")
+endif()
+
+foreach(engine ast ${ENGINE})
+    execute_process(
+        COMMAND "${MINICOMPILER}" run --engine ${engine} "${program}"
+        OUTPUT_VARIABLE output_${engine}
+        ERROR_VARIABLE errors
+        RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR
+            "${program}: --engine ${engine} exited with ${status}\n${errors}")
+    endif()
+endforeach()
+
+if(output_ast STREQUAL "")
+    message(FATAL_ERROR "${program}: printed nothing")
+endif()
+if(NOT output_${ENGINE} STREQUAL output_ast)
+    file(WRITE "${program}.ast.txt" "${output_ast}")
+    file(WRITE "${program}.${ENGINE}.txt" "${output_${ENGINE}}")
+    message(FATAL_ERROR
+        "${program}: --engine ${ENGINE} printed something else than "
+        "--engine ast; see ${program}.{ast,${ENGINE}}.txt")
+endif()
+file(REMOVE "${program}")
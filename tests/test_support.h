@@ -0,0 +1,165 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// test_support.h: 测试程序共用的断言与运行框架。
+//
+// Every test program is a list of named tests:
+//
+//   <Program> [TEST...]
+//
+// runs the named tests (all of them without arguments) and exits non-zero
+// if one fails. A test fails by throwing; each gets an empty scratch
+// directory. CTest runs every test on its own, with a timeout, so a test
+// that hangs fails too.
+
+#pragma once
+
+#include "flat_ast.h"
+#include "lexer.h"
+#include "parser.h"
+#include "program_generator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <print>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mini_compiler::testing {
+
+namespace fs = std::filesystem;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+struct Failure : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+inline void expect(bool condition, string_view what) {
+    if (!condition) {
+        throw Failure(string(what));
+    }
+}
+
+// Runs `f` and expects it to throw runtime_error with `text` in its message.
+inline void expect_error(
+    std::function<void()> const& f, string_view text, string_view what) {
+    try {
+        f();
+    } catch (std::runtime_error const& e) {
+        expect(
+            string_view(e.what()).find(text) != string_view::npos,
+            std::format("{}: unexpected error \"{}\"", what, e.what()));
+        return;
+    }
+    throw Failure(std::format("{}: no error", what));
+}
+
+inline string generate(uint64_t seed, uint64_t bytes, bool postfix) {
+    GeneratorOptions options;
+    options.bytes = bytes;
+    options.seed = seed;
+    options.postfix_operators = postfix;
+    return generate_program(options);
+}
+
+inline string print_tree(Program const& program) {
+    std::ostringstream out;
+    parser_debug_print(program, out);
+    return std::move(out).str();
+}
+
+inline string print_flat(FlatAstView ast) {
+    std::ostringstream out;
+    flat_ast_debug_print(ast, out);
+    return std::move(out).str();
+}
+
+inline string read_file(fs::path const& path) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return std::move(out).str();
+}
+
+inline void write_file(fs::path const& path, string_view text) {
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    out << text;
+    expect(static_cast<bool>(out), "cannot write " + path.string());
+}
+
+// Tokens of `a` and `b` are the same; with interners, their symbols come
+// from those and must name the same spelling instead of being equal.
+inline bool same_tokens(
+    TokenBuffer const& a,
+    TokenBuffer const& b,
+    Interner const* a_names = nullptr,
+    Interner const* b_names = nullptr) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    auto same_symbol = [&](Symbol x, Symbol y) {
+        if (a_names == nullptr || x == no_symbol || y == no_symbol) {
+            return x == y;
+        }
+        return a_names->name(x) == b_names->name(y);
+    };
+    for (size_t i = 0; i < a.size(); ++i) {
+        Token const x = a[i];
+        Token const y = b[i];
+        if (x.kind != y.kind || x.lexeme != y.lexeme || x.offset != y.offset ||
+            !same_symbol(x.symbol, y.symbol)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Test {
+    string_view name;
+    void (*run)(fs::path const& dir);
+};
+
+// The main() of a test program named `program`.
+inline int run_tests(
+    string_view program, std::span<Test const> tests, int argc, char* argv[]) {
+    vector<string_view> names(argv + 1, argv + argc);
+    if (names.empty()) {
+        for (Test const& test : tests) {
+            names.push_back(test.name);
+        }
+    }
+    int status = 0;
+    for (string_view const name : names) {
+        auto const test = std::ranges::find(tests, name, &Test::name);
+        if (test == tests.end()) {
+            std::println(stderr, "Error: unknown test {}", name);
+            return 2;
+        }
+        fs::path const dir = fs::temp_directory_path() /
+                             std::format("{}_{}", program, name);
+        std::error_code ignored;
+        fs::remove_all(dir, ignored);
+        try {
+            fs::create_directories(dir);
+            test->run(dir);
+            std::println("ok      {}", name);
+        } catch (std::exception const& e) {
+            std::println(stderr, "FAILED  {}: {}", name, e.what());
+            status = 1;
+        }
+        fs::remove_all(dir, ignored);
+    }
+    return status;
+}
+
+} // namespace mini_compiler::testing
@@ -0,0 +1,80 @@
+// Copyright 2026 Chen Jisen. All rights reserved.
+// generate_program.cpp: 生成任意规模的合成 MiniCompiler 程序。
+//
+//   GenerateProgram [-o FILE] [--size SIZE] [--seed N] [--depth N]
+//                   [--vocabulary N] [--zipf S] [--postfix]
+//
+// SIZE takes K, M and G suffixes (default 64K). Without -o the program is
+// written to stdout. See GeneratorOptions in program_generator.h.
+
+#include "driver.h"
+#include "program_generator.h"
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    using namespace mini_compiler;
+
+    try {
+        GeneratorOptions options;
+        std::string output;
+        std::vector<std::string> const args(argv + 1, argv + argc);
+        for (size_t i = 0; i < args.size(); ++i) {
+            std::string_view const arg = args[i];
+            auto value = [&]() -> std::string const& {
+                if (i + 1 >= args.size()) {
+                    throw std::runtime_error(
+                        std::format("Missing value for {}", arg));
+                }
+                return args[++i];
+            };
+            if (arg == "-o") {
+                output = value();
+            } else if (arg == "--size") {
+                options.bytes = detail::parse_size(value());
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value());
+            } else if (arg == "--depth") {
+                options.max_depth = std::stoi(value());
+            } else if (arg == "--vocabulary") {
+                options.vocabulary = std::stoul(value());
+            } else if (arg == "--zipf") {
+                options.zipf = std::stod(value());
+            } else if (arg == "--postfix") {
+                options.postfix_operators = true;
+            } else {
+                throw std::runtime_error(
+                    std::format("Unknown option {}", arg));
+            }
+        }
+
+        std::ios::sync_with_stdio(false);
+        std::unique_ptr<std::ofstream> file;
+        if (!output.empty()) {
+            file = std::make_unique<std::ofstream>(
+                output, std::ios::out | std::ios::binary);
+            if (!*file) {
+                throw std::runtime_error("Failed to open output file " + output);
+            }
+        }
+        std::ostream& out = file ? *file : std::cout;
+        ProgramGenerator(options).generate(out);
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Failed to write the program");
+        }
+    } catch (std::exception const& e) {
+        std::println(stderr, "Error: {}", e.what());
+        return 1;
+    }
+    return 0;
+}